@@ -1,6 +1,6 @@
 /*
  * Backend Server Application. Serves web API endpoints for routing and incident management.
- * Keeps reference to MapGraph, IncidentManager and Router.
+ * Keeps reference to GraphHolder, each request works on the graph context current when it starts.
  * Libraries: CPPCMS
  * Version: 1.0
  * Author: Terence Chow
@@ -22,6 +22,8 @@
 #include "ims/map_graph.h"
 #include "ims/incident_manager.h"
 #include "ims/router.h"
+#include "ims/path_manager.h"
+#include "ims/incident_feed.h"
 
 
 using namespace std;
@@ -56,12 +58,14 @@ cppcms::json::value extract_json_data(pair<void *,size_t> raw_post_data) throw (
 /* Utility function for building JSON object to be returned for a found Path.
  *
  * Parameter(s): const IMS::Path *path
+ *               unsigned path_id: ID assigned by PathManager
  * Returns: cppcms::json::value: built path in JSON
  */
-cppcms::json::value build_path_response_body(const IMS::Path *path)
+cppcms::json::value build_path_response_body(const IMS::Path *path, unsigned path_id)
 {
     cppcms::json::value response_body;
 
+    response_body["data"]["id"] = path_id;
     response_body["data"]["start_time"] = path->start_time;
     response_body["data"]["end_time"] = path->end_time;
 
@@ -85,14 +89,15 @@ boost::mutex IMSApp::atomic_lock;
 /* Constructor of IMSApp class.
  * Initializes essential class fields. Assign handler functions to corresponding URL endpoints.
  *
- * Parameter(s): const IMS::Path *path
- * Returns: cppcms::json::value: built path in JSON
+ * Parameter(s): cppcms::service &srv
+ *               IMS::GraphHolder *graph_holder
+ *               IMS::IncidentFeed *incident_feed
  */
-IMSApp::IMSApp(cppcms::service &srv, IMS::MapGraph *map_graph, IMS::IncidentManager *incident_manager) : cppcms::application(srv)
+IMSApp::IMSApp(cppcms::service &srv, IMS::GraphHolder *graph_holder, IMS::IncidentFeed *incident_feed)
+        : cppcms::application(srv)
 {
-    this->map_graph = map_graph;
-    this->incident_manager = incident_manager;
-    this->router = new IMS::Router(map_graph, incident_manager);
+    this->graph_holder = graph_holder;
+    this->incident_feed = incident_feed;
 
     // Dev url for checking graph
     dispatcher().map("GET", "/graph", &IMSApp::check_graph, this);
@@ -102,6 +107,11 @@ IMSApp::IMSApp(cppcms::service &srv, IMS::MapGraph *map_graph, IMS::IncidentMana
     dispatcher().map("POST", "/reroute", &IMSApp::reroute, this);
     dispatcher().map("POST", "/incident", &IMSApp::inject_incident, this);
     dispatcher().map("DELETE", "/incident", &IMSApp::remove_incident, this);
+    dispatcher().map("POST", "/incidents", &IMSApp::ingest_incidents, this);
+
+    // Admin url dispatchers
+    dispatcher().map("POST", "/admin/reload", &IMSApp::reload_graph, this);
+    dispatcher().map("GET", "/admin/reload", &IMSApp::check_reload, this);
 }
 
 /* Dev-only endpoint for checking basic information of loaded MapGraph.
@@ -111,9 +121,12 @@ IMSApp::IMSApp(cppcms::service &srv, IMS::MapGraph *map_graph, IMS::IncidentMana
  */
 void IMSApp::check_graph()
 {
-    response().out() << "Node Count: " << map_graph->latitude.size();
+    IMS::graph_handle_t graph = graph_holder->acquire();
+    response().out() << "Node Count: " << graph->map_graph->get_num_of_nodes();
+    response().out() << "<br>";
+    response().out() << "Edge Count: " << graph->map_graph->get_num_of_edges();
     response().out() << "<br>";
-    response().out() << "Edge Count: " << map_graph->head.size();
+    response().out() << "Version: " << graph->version;
 }
 
 /* Handler function for POST /route.
@@ -145,9 +158,13 @@ void IMSApp::route()
     double destination_long = json_data["coordinates"][1][0].number();
     double destination_lat = json_data["coordinates"][1][1].number();
 
+    /* Node IDs are valid in the graph of this handle only */
+    boost::shared_lock<boost::shared_mutex> update_lock(graph_holder->get_update_access());
+    IMS::graph_handle_t graph = graph_holder->acquire();
+
     /* Reverse Geocoding for origin and destination */
-    unsigned origin = map_graph->find_nearest_node_of_location(origin_long, origin_lat, RADIUS);
-    unsigned destination = map_graph->find_nearest_node_of_location(destination_long, destination_lat, RADIUS);
+    unsigned origin = graph->map_graph->find_nearest_node_of_location(origin_long, origin_lat, RADIUS);
+    unsigned destination = graph->map_graph->find_nearest_node_of_location(destination_long, destination_lat, RADIUS);
     if(origin == RoutingKit::invalid_id)
     {
         response().make_error_response(400, "No node within " + to_string(RADIUS) + "m from origin position.");
@@ -163,15 +180,15 @@ void IMSApp::route()
     boost::lock_guard<boost::mutex> lock(IMS::IMSApp::atomic_lock);
 
     time_t now = time(nullptr);
-    IMS::Path * path = router->route(origin, destination, now);
+    IMS::Path * path = graph->router->route(origin, destination, now);
     /* Perform graph update */
 
     if(path != nullptr)
     {
-        map_graph->inject_impact_of_routed_path(path);
+        unsigned path_id = graph->path_manager->add_path(path);
 
         /* Write route to response */
-        cppcms::json::value response_body = build_path_response_body(path);
+        cppcms::json::value response_body = build_path_response_body(path, path_id);
         response().out() << response_body;
 
         cout << endl << "==== Route ====" << endl;
@@ -200,7 +217,7 @@ void IMSApp::route()
  * Parameter(s): JSON object with format:
  * {
  *   "coordinates": [[longitude, latitude], [longitude, latitude]],
- *   <original path>
+ *   "path": <original path, with "id" if returned by the server>
  * }
  * Returns: Found path to requester, error on no nodes / path found.
  */
@@ -238,9 +255,11 @@ void IMSApp::reroute()
     }
 
     /* Reroute from current location */
-    unsigned destination = map_graph->find_nearest_node_of_location(destination_long, destination_lat, RADIUS);
+    boost::shared_lock<boost::shared_mutex> update_lock(graph_holder->get_update_access());
+    IMS::graph_handle_t graph = graph_holder->acquire();
+    unsigned destination = graph->map_graph->find_nearest_node_of_location(destination_long, destination_lat, RADIUS);
 
-    unsigned current_origin = map_graph->find_nearest_node_of_location(current_long, current_lat, RADIUS);
+    unsigned current_origin = graph->map_graph->find_nearest_node_of_location(current_long, current_lat, RADIUS);
     if(current_origin == RoutingKit::invalid_id)
     {
         response().make_error_response(400, "No node within " + to_string(RADIUS) + "m from current position.");
@@ -249,18 +268,26 @@ void IMSApp::reroute()
 
     boost::lock_guard<boost::mutex> lock(IMS::IMSApp::atomic_lock);
     /* Remove old path from graph's density information */
-    map_graph->remove_impact_of_routed_path(old_path);
+    /* Paths with ID are tracked by PathManager, which has nothing to remove once they are retired */
+    if(json_data.find("path.id").type() == cppcms::json::is_number)
+    {
+        graph->path_manager->remove_path((unsigned) json_data["path"]["id"].number());
+    }
+    else
+    {
+        graph->map_graph->remove_impact_of_routed_path(old_path);
+    }
 
     time_t now = time(nullptr);
-    auto new_path = router->route(current_origin, destination, now);
+    auto new_path = graph->router->route(current_origin, destination, now);
 
     /* Perform graph update */
     if(new_path != nullptr)
     {
-        map_graph->inject_impact_of_routed_path(new_path);
+        unsigned path_id = graph->path_manager->add_path(new_path);
 
         /* Write route to response */
-        cppcms::json::value response_body = build_path_response_body(new_path);
+        cppcms::json::value response_body = build_path_response_body(new_path, path_id);
         response().out() << response_body;
 
         cout << endl << "==== Route ====" << endl;
@@ -288,7 +315,9 @@ void IMSApp::reroute()
  * Parameter(s): JSON object with format:
  * {
  *   "location": [longitude, latitude],
- *   "impact": impact on travelling time in milliseconds
+ *   "impact": impact on travelling time in milliseconds,
+ *   "start_time": optional, time in milliseconds when the incident starts to apply,
+ *   "end_time": optional, time in milliseconds when the incident stops applying
  * }
  * Returns: incident ID,  error on no edge found.
  */
@@ -310,16 +339,34 @@ void IMSApp::inject_incident()
     double incident_lat = json_data["location"][1].number();
     unsigned impact = (unsigned) json_data["impact"].number();
 
+    time_t start_time = 0;
+    time_t end_time = IMS::IncidentManager::NO_END_TIME;
+    if(json_data.find("start_time").type() == cppcms::json::is_number)
+    {
+        start_time = (time_t) json_data["start_time"].number();
+    }
+    if(json_data.find("end_time").type() == cppcms::json::is_number)
+    {
+        end_time = (time_t) json_data["end_time"].number();
+    }
+    if(end_time <= start_time)
+    {
+        response().make_error_response(400, "Incident ends before it starts");
+        return;
+    }
+
     /* Reverse Geocoding for affected edge */
     /* OFFSET OF NEAREST_EDGE = 0.002 for accuracy of result */
-    vector<unsigned> affected_edges = map_graph->find_nearest_edge_of_location(incident_long, incident_lat, OFFSET);
+    boost::shared_lock<boost::shared_mutex> update_lock(graph_holder->get_update_access());
+    IMS::graph_handle_t graph = graph_holder->acquire();
+    vector<unsigned> affected_edges = graph->map_graph->find_nearest_edge_of_location(incident_long, incident_lat, OFFSET);
     if(affected_edges.empty())
     {
         response().make_error_response(400, "Incident location not on any road");
         return;
     }
 
-    unsigned incident_id = incident_manager->add_incident(affected_edges, impact);
+    unsigned incident_id = graph->incident_manager->add_incident(affected_edges, impact, start_time, end_time);
 
     /* Write route to response */
     cppcms::json::value response_body;
@@ -356,7 +403,8 @@ void IMSApp::remove_incident()
         return;
     }
 
-    unsigned num_of_incident_removed = incident_manager->remove_incident(incident_id);
+    boost::shared_lock<boost::shared_mutex> update_lock(graph_holder->get_update_access());
+    unsigned num_of_incident_removed = graph_holder->acquire()->incident_manager->remove_incident(incident_id);
     if(num_of_incident_removed == 0)
     {
         response().make_error_response(400, "Incident not found");
@@ -365,3 +413,207 @@ void IMSApp::remove_incident()
 
     response().status(200);
 }
+
+/* Handler function for POST /incidents.
+ * Takes a batch from the incident feed -> Diffs against live feed incidents -> Snaps and applies in one batch
+ * -> Returns ingestion report.
+ *
+ * Parameter(s): JSON object with format:
+ * {
+ *   "incidents": [{
+ *     "key": ID of the incident in the feed,
+ *     "location": [longitude, latitude],
+ *     "impact": impact on travelling time in milliseconds,
+ *     "start_time": optional, time in milliseconds when the incident starts to apply,
+ *     "end_time": optional, time in milliseconds when the incident stops applying
+ *   }],
+ *   "removed": optional, [keys of incidents cleared from the feed],
+ *   "snapshot": optional, true if "incidents" is the full feed, feed incidents not in it are removed
+ * }
+ * Returns: ingestion report, error on malformed batch.
+ */
+void IMSApp::ingest_incidents()
+{
+    /* Take POST JSON body */
+    cppcms::json::value json_data;
+    try
+    {
+        json_data = extract_json_data(request().raw_post_data());
+    }
+    catch (booster::invalid_argument & e)
+    {
+        response().make_error_response(400, e.what());
+        return;
+    }
+
+    vector<IMS::feed_incident_t> upserts;
+    vector<string> removed_keys;
+    bool is_snapshot = false;
+    try
+    {
+        if(json_data.find("incidents").type() == cppcms::json::is_array)
+        {
+            for(auto & item : json_data["incidents"].array())
+            {
+                IMS::feed_incident_t record;
+                record.key = item["key"].str();
+                record.longitude = (float) item["location"][0].number();
+                record.latitude = (float) item["location"][1].number();
+                if(item["impact"].number() < 0)
+                {
+                    response().make_error_response(400, "Incident " + record.key + " has a negative impact");
+                    return;
+                }
+                record.impact = (unsigned) item["impact"].number();
+                record.start_time = 0;
+                record.end_time = IMS::IncidentManager::NO_END_TIME;
+                if(item.find("start_time").type() == cppcms::json::is_number)
+                {
+                    record.start_time = (time_t) item["start_time"].number();
+                }
+                if(item.find("end_time").type() == cppcms::json::is_number)
+                {
+                    record.end_time = (time_t) item["end_time"].number();
+                }
+                if(record.end_time <= record.start_time)
+                {
+                    response().make_error_response(400, "Incident " + record.key + " ends before it starts");
+                    return;
+                }
+                upserts.push_back(record);
+            }
+        }
+        if(json_data.find("removed").type() == cppcms::json::is_array)
+        {
+            for(auto & key : json_data["removed"].array())
+            {
+                removed_keys.push_back(key.str());
+            }
+        }
+        if(json_data.find("snapshot").type() == cppcms::json::is_boolean)
+        {
+            is_snapshot = json_data["snapshot"].boolean();
+        }
+    }
+    catch (cppcms::json::bad_value_cast & e)
+    {
+        response().make_error_response(400, "Malformed incident batch");
+        return;
+    }
+
+    IMS::ingestion_report_t report = is_snapshot?
+                                     incident_feed->ingest_snapshot(upserts) :
+                                     incident_feed->ingest_updates(upserts, removed_keys);
+
+    /* Write report to response */
+    cppcms::json::value response_body;
+    response_body["data"]["received"] = report.num_of_received;
+    response_body["data"]["added"] = report.num_of_added;
+    response_body["data"]["removed"] = report.num_of_removed;
+    response_body["data"]["unchanged"] = report.num_of_unchanged;
+    response_body["data"]["unlocated"] = report.num_of_unlocated;
+    response_body["data"]["snapping_time"] = report.snapping_time;
+    response_body["data"]["applying_time"] = report.applying_time;
+    response_body["data"]["updates_per_second"] = report.total_time > 0?
+                                                  report.num_of_received / report.total_time * 1000 : 0;
+    response().out() << response_body;
+}
+
+/* Utility function for admin endpoints, which are served to requests from the server host only.
+ *
+ * Parameter(s): NIL
+ * Returns: bool: true for a local request, otherwise responds 403
+ */
+bool IMSApp::is_local_request()
+{
+    string remote_addr = request().remote_addr();
+    if(remote_addr != "127.0.0.1" && remote_addr != "::1")
+    {
+        response().make_error_response(403, "Admin endpoint is local only");
+        return false;
+    }
+    return true;
+}
+
+/* Handler function for POST /admin/reload.
+ * Starts loading a MapGraph file in the background. Once loaded, live paths and incidents are migrated to it and
+ * it replaces the current graph; requests in progress finish on the old graph.
+ *
+ * Parameter(s): optional JSON object with format:
+ * {
+ *   "path": MapGraph file path, default file of the current graph
+ * }
+ * Returns: 202 with version of the current graph, error if a reload is in progress.
+ */
+void IMSApp::reload_graph()
+{
+    if(!is_local_request())
+    {
+        return;
+    }
+
+    string file_path;
+    pair<void *, size_t> raw_post_data = request().raw_post_data();
+    if(raw_post_data.second > 0)
+    {
+        try
+        {
+            cppcms::json::value json_data = extract_json_data(raw_post_data);
+            if(json_data.find("path").type() == cppcms::json::is_string)
+            {
+                file_path = json_data["path"].str();
+            }
+        }
+        catch (booster::invalid_argument & e)
+        {
+            response().make_error_response(400, e.what());
+            return;
+        }
+    }
+
+    if(!graph_holder->reload_in_background(file_path))
+    {
+        response().make_error_response(409, "Reload in progress");
+        return;
+    }
+
+    cppcms::json::value response_body;
+    response_body["data"]["version"] = graph_holder->acquire()->version;
+    response().status(202);
+    response().out() << response_body;
+}
+
+/* Handler function for GET /admin/reload.
+ *
+ * Parameter(s): NIL
+ * Returns: report of the last reload, or of the reload in progress.
+ */
+void IMSApp::check_reload()
+{
+    if(!is_local_request())
+    {
+        return;
+    }
+
+    IMS::reload_report_t report = graph_holder->get_reload_report();
+    cppcms::json::value response_body;
+    response_body["data"]["current_version"] = graph_holder->acquire()->version;
+    response_body["data"]["is_reloading"] = report.is_reloading;
+    response_body["data"]["is_successful"] = report.is_successful;
+    response_body["data"]["error"] = report.error;
+    response_body["data"]["path"] = report.file_path;
+    response_body["data"]["version"] = report.version;
+    response_body["data"]["nodes_matched"] = report.num_of_nodes_matched;
+    response_body["data"]["nodes_unmatched"] = report.num_of_nodes_unmatched;
+    response_body["data"]["edges_matched"] = report.num_of_edges_matched;
+    response_body["data"]["edges_unmatched"] = report.num_of_edges_unmatched;
+    response_body["data"]["incidents_migrated"] = report.num_of_incidents_migrated;
+    response_body["data"]["incidents_dropped"] = report.num_of_incidents_dropped;
+    response_body["data"]["paths_migrated"] = report.num_of_paths_migrated;
+    response_body["data"]["paths_dropped"] = report.num_of_paths_dropped;
+    response_body["data"]["loading_time"] = report.loading_time;
+    response_body["data"]["matching_time"] = report.matching_time;
+    response_body["data"]["migrating_time"] = report.migrating_time;
+    response_body["data"]["total_time"] = report.total_time;
+    response().out() << response_body;
+}
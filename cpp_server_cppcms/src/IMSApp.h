@@ -14,6 +14,9 @@
 #include "ims/map_graph.h"
 #include "ims/incident_manager.h"
 #include "ims/router.h"
+#include "ims/path_manager.h"
+#include "ims/incident_feed.h"
+#include "ims/graph_holder.h"
 
 using namespace std;
 
@@ -23,14 +26,13 @@ namespace IMS
     class IMSApp : public cppcms::application
     {
     public:
-        IMSApp(cppcms::service &srv, IMS::MapGraph *map_graph, IMS::IncidentManager *incident_manager);
+        IMSApp(cppcms::service &srv, IMS::GraphHolder *graph_holder, IMS::IncidentFeed *incident_feed);
 
     private:
         static boost::mutex atomic_lock;
 
-        IMS::MapGraph *map_graph;
-        IMS::IncidentManager *incident_manager;
-        IMS::Router *router;
+        IMS::GraphHolder *graph_holder;
+        IMS::IncidentFeed *incident_feed;
 
         const float RADIUS = 100;
         const float OFFSET = 0.0008;
@@ -43,6 +45,12 @@ namespace IMS
         void reroute();
         void inject_incident();
         void remove_incident();
+        void ingest_incidents();
+
+        // Admin controller functions, local requests only
+        bool is_local_request();
+        void reload_graph();
+        void check_reload();
     };
 
 }
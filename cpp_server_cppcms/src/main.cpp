@@ -1,4 +1,6 @@
 #include <string>
+#include <fstream>
+#include <cstring>
 #include <unistd.h>
 
 #include <cppcms/applications_pool.h>
@@ -7,9 +9,19 @@
 
 #include "IMSApp.h"
 #include "ims/map_graph.h"
+#include "ims/path_manager.h"
+#include "ims/incident_feed.h"
+#include "ims/graph_holder.h"
 
 using namespace std;
 
+/* Interval between retiring expired paths and incidents */
+const unsigned EXPIRY_INTERVAL = 30; // seconds
+/* Interval between reading the local incident feed */
+const unsigned FEED_REOPEN_INTERVAL = 1; // seconds
+/* Offset for finding edges of incident locations, same as IMSApp */
+const float INCIDENT_OFFSET = 0.0008;
+
 /* Utility function for finding excution path of this application instance.
  *
  * Parameter(s): NIL
@@ -26,31 +38,117 @@ string get_exec_dir()
     return full_path.substr(0, pos);
 }
 
-/* Helper function to get MapGraph file path.
+/* Optional arguments of the server, following -c <config.js> */
+struct server_options_t
+{
+    string map_file_path; // empty for the default
+    string feed_file_path; // empty if not given
+    string function_file_path; // empty if not given
+    bool is_compressed = false;
+};
+
+/* Helper function to parse the optional arguments following -c <config.js>.
+ * Exits with usage on unknown arguments or a flag without value.
  *
- * Parameter(s): NIL
- * Returns: string: Path of MapGraph file.
+ * Parameter(s): const int & argc
+ *               char ** argv
+ * Returns: server_options_t: the arguments given
  */
-string get_map_file_path(const int & argc, char ** argv) {
-    if(argc > 3)
+server_options_t parse_server_arguments(const int & argc, char ** argv) {
+    server_options_t options;
+    for(int i = 3; i < argc; i++)
     {
-        if(strcmp(argv[3], "-m") == 0)
+        const string flag = argv[i];
+        if(flag == "-z")
         {
-            return string(argv[4]); /* Get user defined file path. */
+            /* Switch without value */
+            options.is_compressed = true;
+            continue;
         }
-        else
+        string * value = flag == "-m"? &options.map_file_path
+                       : flag == "-f"? &options.feed_file_path
+                       : flag == "-t"? &options.function_file_path : nullptr;
+        if(value == nullptr || i + 1 >= argc)
         {
             /* Invalid argument, exit */
-            cout << "Usage: " << argv[0] << " -c <config.js> [-m <map file path>]" << endl;
+            cout << "Usage: " << argv[0]
+                 << " -c <config.js> [-m <map file path>] [-f <incident feed file / pipe path>]"
+                 << " [-t <travel time function file path>] [-z (compress graph)]" << endl;
             exit(1);
         }
+        *value = argv[++i];
     }
-    else
+    return options;
+}
+
+/* Helper function to get MapGraph file path.
+ *
+ * Parameter(s): const server_options_t & options
+ * Returns: string: Path of MapGraph file.
+ */
+string get_map_file_path(const server_options_t & options) {
+    string map_file_path = options.map_file_path; /* Get user defined file path. */
+    if(map_file_path.empty())
     {
         /* Use default MapGraph file dir: executable directory */
         const string map_file_dir = get_exec_dir();
         const string map_file_name = "HK.graph";
-        return map_file_dir + "/" + map_file_name;
+        map_file_path = map_file_dir + "/" + map_file_name;
+    }
+    return map_file_path;
+}
+
+/* Background loop consuming a local incident feed, standing in for the traffic authority feed.
+ * A regular file is re-read, a named pipe is re-opened for the next writer, after FEED_REOPEN_INTERVAL.
+ *
+ * Parameter(s): IMS::IncidentFeed * incident_feed
+ *               const string feed_file_path
+ * Returns: never, runs until the server exits.
+ */
+void consume_incident_feed(IMS::IncidentFeed * incident_feed, const string feed_file_path)
+{
+    while(true)
+    {
+        ifstream feed(feed_file_path); /* Blocks until a writer opens the pipe */
+        if(feed.is_open())
+        {
+            incident_feed->consume(feed);
+        }
+        else
+        {
+            cout << "Cannot open incident feed at: " << feed_file_path << endl;
+        }
+        boost::this_thread::sleep(boost::posix_time::seconds(FEED_REOPEN_INTERVAL));
+    }
+}
+
+/* Background loop retiring paths which are overdue, so that abandoned trips stop adding density,
+ * and purging incidents which have ended, on the current graph.
+ *
+ * Parameter(s): IMS::GraphHolder * graph_holder
+ * Returns: never, runs until the server exits.
+ */
+void expire_periodically(IMS::GraphHolder * graph_holder)
+{
+    while(true)
+    {
+        boost::this_thread::sleep(boost::posix_time::seconds(EXPIRY_INTERVAL));
+
+        boost::shared_lock<boost::shared_mutex> update_lock(graph_holder->get_update_access());
+        IMS::graph_handle_t graph = graph_holder->acquire();
+        time_t now = time(nullptr) * 1000; // Path and incident times are in milliseconds
+        unsigned num_of_paths_retired = graph->path_manager->retire_expired_paths(now);
+        if(num_of_paths_retired > 0)
+        {
+            cout << "Retired " << num_of_paths_retired << " expired paths, "
+                 << graph->path_manager->get_num_of_active_paths() << " paths active." << endl;
+        }
+
+        unsigned num_of_incidents_purged = graph->incident_manager->purge_expired_incidents(now);
+        if(num_of_incidents_purged > 0)
+        {
+            cout << "Purged " << num_of_incidents_purged << " expired incidents." << endl;
+        }
     }
 }
 
@@ -61,16 +159,48 @@ string get_map_file_path(const int & argc, char ** argv) {
  */
 int main(int argc, char ** argv)
 {
-    string map_file_path = get_map_file_path(argc, argv);
+    server_options_t options = parse_server_arguments(argc, argv);
+    string map_file_path = get_map_file_path(options);
+    const string &feed_file_path = options.feed_file_path;
+    const string &function_file_path = options.function_file_path;
     cout << "Using MapGraph file at: " << map_file_path << endl;
     try
     {
         cout << "Initializing MapGraph..." << endl;
         auto map_graph = IMS::MapGraph::deserialize_and_initialize(map_file_path);
-        auto incident_manager = new IMS::IncidentManager();
+        const IMS::initialization_timing_t &timing = map_graph->get_initialization_timing();
+        cout << "MapGraph initialized in " << timing.total_time << " ms | "
+             << "density " << timing.density_time << " ms, "
+             << "inverse " << timing.inverse_time << " ms, "
+             << "geo index " << timing.geo_index_time << " ms, "
+             << "distance tables " << timing.distance_table_time << " ms" << endl;
+        if(!function_file_path.empty())
+        {
+            cout << "Loading travel time functions at: " << function_file_path << endl;
+            map_graph->load_travel_time_functions(function_file_path);
+        }
+        const bool is_compressed = options.is_compressed;
+        if(is_compressed)
+        {
+            cout << "Compressing MapGraph..." << endl;
+            map_graph->compress();
+        }
+        auto incident_manager = new IMS::IncidentManager(map_graph->get_num_of_edges());
+        auto path_manager = new IMS::PathManager(map_graph);
+        auto incident_feed = new IMS::IncidentFeed(map_graph, incident_manager, INCIDENT_OFFSET);
+        /* Reloaded through POST /admin/reload, see GraphHolder */
+        auto graph_holder = new IMS::GraphHolder(map_file_path, map_graph, incident_manager, path_manager,
+                                                 incident_feed, is_compressed, function_file_path);
+        boost::thread expiry_thread(expire_periodically, graph_holder);
+        if(!feed_file_path.empty())
+        {
+            cout << "Consuming incident feed at: " << feed_file_path << endl;
+            boost::thread feed_thread(consume_incident_feed, incident_feed, feed_file_path);
+            feed_thread.detach();
+        }
 
         cppcms::service srv(argc, argv);
-        srv.applications_pool().mount(cppcms::applications_factory<IMS::IMSApp>(map_graph, incident_manager));
+        srv.applications_pool().mount(cppcms::applications_factory<IMS::IMSApp>(graph_holder, incident_feed));
         cout << "Server starting at 8080..." << endl;
         srv.run();
     }
@@ -0,0 +1,18 @@
+/*
+ * Header file for report module.
+ * Helpers shared by the tools writing reports, e.g. tune, graph_builder and the benchmarks.
+ * Version: 1.0
+ * Author: Yuen Hoi Man
+ */
+
+#ifndef EXP_REPORT_H
+#define EXP_REPORT_H
+
+#include <string>
+
+using namespace std;
+
+string escape_json(const string &text);
+long read_memory_status(const string &field);
+
+#endif
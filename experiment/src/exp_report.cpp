@@ -0,0 +1,39 @@
+#include <fstream>
+
+#include "../include/exp_report.h"
+
+/* Escape a string as JSON string content
+ * Parameters: const string & text
+ * Return: string
+ */
+string escape_json(const string &text)
+{
+    string escaped;
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+        }
+        escaped += (unsigned char) c < 0x20? ' ' : c;
+    }
+    return escaped;
+}
+
+/* Read a memory field of this process from /proc/self/status.
+ * Parameters: const string & field: e.g. VmRSS, VmHWM
+ * Return: long: value in KiB, 0 if not available
+ */
+long read_memory_status(const string &field)
+{
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line))
+    {
+        if (line.compare(0, field.size() + 1, field + ":") == 0)
+        {
+            return stol(line.substr(field.size() + 1));
+        }
+    }
+    return 0;
+}
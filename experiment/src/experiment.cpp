@@ -12,6 +12,12 @@
 #include <chrono>
 #include <ctime>
 #include <iomanip>
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
 
 #include "ims/map_graph.h"
 #include "ims/incident_manager.h"
@@ -20,9 +26,22 @@
 
 using namespace std;
 
-int main()
+/* Run one experiment on the graphs built beforehand, see the comment of each below.
+ * Usage: experiment [all-route | renumbering | partition-schemes | precise-heuristic | weight-profiles]
+ *        all-route if none is given
+ */
+int main(int argc, char ** argv)
 {
-    cout << "Start Experiment" << endl;
+    const string experiment = argc > 1? argv[1] : "all-route";
+    const vector<string> experiments = {"all-route", "renumbering", "partition-schemes", "precise-heuristic",
+                                        "weight-profiles"};
+    if(argc > 2 || find(experiments.begin(), experiments.end(), experiment) == experiments.end())
+    {
+        cout << "Usage: " << argv[0]
+             << " [all-route | renumbering | partition-schemes | precise-heuristic | weight-profiles]" << endl;
+        return 1;
+    }
+    cout << "Start Experiment " << experiment << endl;
 
     float ss_long = 114.127758f;
     float ss_lat = 22.502621f;
@@ -49,11 +68,47 @@ int main()
 
     float radius = 100;
 
+    // Route of one OD pair on each HK_<k>_<l>.graph built beforehand. The tune executable (tune.cpp) builds and
+    // compares the configurations itself on a sample of OD pairs, and recommends one.
     //experiment_all_route("ss_hku", ss_long, ss_lat, hku_long, hku_lat, radius);
     //experiment_all_route("tp_st", tp_long, tp_lat, st_long, st_lat, radius);
     //experiment_all_route("kt_tm", kt_long, kt_lat, tm_long, tm_lat, radius);
     //experiment_all_route("tw_mk", tw_long, tw_lat, mk_long, mk_lat, radius);
-    experiment_all_route("tw_kc", tw_long, tw_lat, kc_long, kc_lat, radius);
+    if(experiment == "all-route")
+    {
+        experiment_all_route("tw_kc", tw_long, tw_lat, kc_long, kc_lat, radius);
+    }
+
+    // Locality of partition-ordered node IDs, graphs built with and without renumbering in graph_builder
+    vector<od_pair_t> od_pairs = {
+            {"ss_hku", ss_long, ss_lat, hku_long, hku_lat},
+            {"tp_st", tp_long, tp_lat, st_long, st_lat},
+            {"kt_tm", kt_long, kt_lat, tm_long, tm_lat},
+            {"tw_mk", tw_long, tw_lat, mk_long, mk_lat},
+            {"tw_kc", tw_long, tw_lat, kc_long, kc_lat}
+    };
+    if(experiment == "renumbering")
+    {
+        experiment_renumbering("HK_8_3.graph", "HK_8_3_renumbered.graph", od_pairs, radius, 20);
+    }
+
+    // Grid against inertial flow partitioning of the same graph
+    if(experiment == "partition-schemes")
+    {
+        experiment_partition_schemes("HK_8_3.graph", 8, 3, od_pairs, radius);
+    }
+
+    // Heuristic of the distance tables against the precise heuristic of boundary distances
+    if(experiment == "precise-heuristic")
+    {
+        experiment_precise_heuristic("HK_8_3.graph", 8, 3, od_pairs, radius);
+    }
+
+    // Routing by departure time on a graph with hourly weight profiles, see graph_builder --profiles
+    if(experiment == "weight-profiles")
+    {
+        experiment_weight_profiles("HK_8_3_profiles.graph", od_pairs, radius, 1546272000); // 2019-01-01 00:00 HKT
+    }
 
     return 0;
 }
@@ -103,7 +158,7 @@ string experiment_route(string filename, string graph, float origin_long, float
     cout << "Initializing MapGraph ..." << endl;
     auto map_graph = IMS::MapGraph::deserialize_and_initialize(graph);
     cout << "Initializing IncidentManager ..." << endl;
-    auto incident_manager = new IMS::IncidentManager();
+    auto incident_manager = new IMS::IncidentManager(map_graph->get_num_of_edges());
     cout << "Initializing Router ..." << endl;
     auto router = new IMS::Router(map_graph, incident_manager);
 
@@ -236,4 +291,325 @@ void create_xml(string filename, ExpandedLog* log) // <from_node, to_node>
 
     // close file
     fout.close();
-}
\ No newline at end of file
+}
+
+/* Open a counter of last level cache misses of this thread, disabled until reset.
+ * Return: int: file descriptor, -1 if hardware counters are not available
+ */
+int open_cache_miss_counter()
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/* Compare routing on a graph built with and without partition-order renumbering.
+ * Writes renumbering_data.csv.
+ */
+void experiment_renumbering(string graph, string renumbered_graph, const vector<od_pair_t> &od_pairs, float radius, unsigned repetitions)
+{
+    ofstream fout;
+    fout.open("renumbering_data.csv");
+
+    fout << "graph,od pair,routing time (us),cache misses,expanded nodes\n";
+    fout << experiment_locality(graph, od_pairs, radius, repetitions);
+    fout << experiment_locality(renumbered_graph, od_pairs, radius, repetitions);
+
+    fout.close();
+}
+
+/* Route each OD pair repeatedly after one warm-up query, measuring mean time and cache misses per query.
+ * Return: string: csv lines, one per OD pair
+ */
+string experiment_locality(string graph, const vector<od_pair_t> &od_pairs, float radius, unsigned repetitions)
+{
+    cout << "==== Locality Experiment " << graph << " ====" << endl;
+    auto map_graph = IMS::MapGraph::deserialize_and_initialize(graph);
+    auto incident_manager = new IMS::IncidentManager(map_graph->get_num_of_edges());
+    auto router = new IMS::Router(map_graph, incident_manager);
+    int counter = open_cache_miss_counter();
+    if (counter < 0)
+    {
+        cout << "Hardware cache counters not available, only timing is measured." << endl;
+    }
+
+    string csv = "";
+    for (auto & od_pair : od_pairs)
+    {
+        unsigned origin = map_graph->find_nearest_node_of_location(od_pair.origin_long, od_pair.origin_lat, radius);
+        unsigned destination = map_graph->find_nearest_node_of_location(od_pair.destination_long, od_pair.destination_lat, radius);
+        if(origin == RoutingKit::invalid_id || destination == RoutingKit::invalid_id)
+        {
+            csv = csv + graph + "," + od_pair.name + ",No node within " + to_string(radius) + "m\n";
+            continue;
+        }
+
+        // Warm up and count expanded nodes
+        ExpandedLog* log = new ExpandedLog();
+        delete router->route(origin, destination, 0, log);
+        auto no_node = log->expanded_nodes.size();
+        delete log;
+
+        long long cache_misses = 0;
+        if (counter >= 0)
+        {
+            ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+            ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+        }
+        auto start = chrono::steady_clock::now();
+        for (unsigned i = 0; i < repetitions; i++)
+        {
+            delete router->route(origin, destination, 0);
+        }
+        auto end = chrono::steady_clock::now();
+        if (counter >= 0)
+        {
+            ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(counter, &cache_misses, sizeof(cache_misses)) != sizeof(cache_misses))
+            {
+                cache_misses = 0;
+            }
+        }
+
+        double routing_time = chrono::duration<double, micro>(end - start).count() / repetitions;
+        cout << od_pair.name << ": " << routing_time << " us per query";
+        csv = csv + graph + "," + od_pair.name + "," + to_string(routing_time) + ",";
+        if (counter >= 0)
+        {
+            cout << ", " << cache_misses / repetitions << " cache misses per query";
+            csv = csv + to_string(cache_misses / repetitions);
+        }
+        else
+        {
+            csv = csv + "n/a";
+        }
+        cout << endl;
+        csv = csv + "," + to_string(no_node) + "\n";
+    }
+
+    if (counter >= 0)
+    {
+        close(counter);
+    }
+    delete router;
+    delete incident_manager;
+    delete map_graph;
+    return csv;
+}
+
+// helper function
+/* Count nodes of each cell of the lowest level and boundary nodes of all cells below the root.
+ * Parameters: const IMS::Partition::partition_tree_t * p
+ *             vector<unsigned long> & cell_sizes: sizes of cells holding nodes are added
+ *             unsigned long & num_of_boundary_nodes: outward and inward boundary nodes of cells are added
+ * Return: unsigned long: number of nodes in p
+ */
+unsigned long count_partition(const IMS::Partition::partition_tree_t * p, vector<unsigned long> &cell_sizes,
+                              unsigned long &num_of_boundary_nodes)
+{
+    for (unsigned curr = 1; curr < p->num_of_partitions(); curr++)
+    {
+        num_of_boundary_nodes += p->outwards_of(curr).size() + p->inwards_of(curr).size();
+    }
+    for (unsigned curr = p->level_first[p->num_of_levels() - 1]; curr < p->num_of_partitions(); curr++)
+    {
+        cell_sizes.push_back(p->nodes_of(curr).size());
+    }
+    return p->nodes.size();
+}
+
+/* Compare partition schemes on one graph: boundary nodes and balance of the cells, time to partition and preprocess,
+ * and nodes expanded by routing each OD pair. Writes partition_schemes_data.csv, one line per scheme.
+ * Cell balance is the size of the largest cell of the lowest level over the mean size.
+ */
+void experiment_partition_schemes(string graph, unsigned k, unsigned l, const vector<od_pair_t> &od_pairs, float radius)
+{
+    cout << "==== Partition Scheme Experiment " << graph << " ====" << endl;
+    auto map_graph = IMS::MapGraph::deserialize_and_initialize(graph);
+    auto incident_manager = new IMS::IncidentManager(map_graph->get_num_of_edges());
+    auto router = new IMS::Router(map_graph, incident_manager);
+
+    ofstream fout;
+    fout.open("partition_schemes_data.csv");
+    fout << "scheme,k-l,cells,boundary nodes,cell balance,partition time (ms),preprocess time (ms)";
+    for (auto & od_pair : od_pairs)
+    {
+        fout << "," << od_pair.name << " expanded nodes";
+    }
+    fout << "\n";
+
+    vector<pair<string, IMS::Partition::partition_scheme_t> > schemes = {
+            {"grid", IMS::Partition::GRID_PARTITION},
+            {"inertial-flow", IMS::Partition::INERTIAL_FLOW_PARTITION}
+    };
+    for (auto & scheme : schemes)
+    {
+        auto start = chrono::steady_clock::now();
+        IMS::Partition::partition_tree_t * partitions = map_graph->partition(k, l, scheme.second);
+        auto partitioned = chrono::steady_clock::now();
+
+        vector<unsigned long> cell_sizes;
+        unsigned long num_of_boundary_nodes = 0;
+        unsigned long num_of_nodes = count_partition(partitions, cell_sizes, num_of_boundary_nodes);
+        double balance = *max_element(cell_sizes.begin(), cell_sizes.end()) / ((double) num_of_nodes / cell_sizes.size());
+
+        map_graph->preprocess(partitions, 0);
+        auto preprocessed = chrono::steady_clock::now();
+        delete partitions;
+
+        double partition_time = chrono::duration<double, milli>(partitioned - start).count();
+        double preprocess_time = chrono::duration<double, milli>(preprocessed - partitioned).count();
+        cout << scheme.first << ": " << cell_sizes.size() << " cells, " << num_of_boundary_nodes
+             << " boundary nodes, cell balance " << balance << ", partition " << partition_time << " ms, preprocess "
+             << preprocess_time << " ms" << endl;
+        fout << scheme.first << "," << k << "-" << l << "," << cell_sizes.size() << "," << num_of_boundary_nodes << ","
+             << balance << "," << partition_time << "," << preprocess_time;
+
+        for (auto & od_pair : od_pairs)
+        {
+            unsigned origin = map_graph->find_nearest_node_of_location(od_pair.origin_long, od_pair.origin_lat, radius);
+            unsigned destination = map_graph->find_nearest_node_of_location(od_pair.destination_long, od_pair.destination_lat, radius);
+            if (origin == RoutingKit::invalid_id || destination == RoutingKit::invalid_id)
+            {
+                fout << ",n/a";
+                continue;
+            }
+            ExpandedLog* log = new ExpandedLog();
+            delete router->route(origin, destination, 0, log);
+            cout << od_pair.name << ": " << log->expanded_nodes.size() << " nodes expanded" << endl;
+            fout << "," << log->expanded_nodes.size();
+            delete log;
+        }
+        fout << "\n";
+    }
+
+    fout.close();
+    delete router;
+    delete incident_manager;
+    delete map_graph;
+}
+
+/* Compare the heuristic of the distance tables alone against the precise heuristic of boundary distances on one
+ * graph preprocessed with grid (k, l): memory of the preprocessed data, time of preprocessing the boundary distances,
+ * and nodes expanded and arrival time of routing each OD pair. Writes precise_heuristic_data.csv, one line per
+ * heuristic.
+ */
+void experiment_precise_heuristic(string graph, unsigned k, unsigned l, const vector<od_pair_t> &od_pairs, float radius)
+{
+    cout << "==== Precise Heuristic Experiment " << graph << " ====" << endl;
+    auto map_graph = IMS::MapGraph::deserialize_and_initialize(graph);
+    auto incident_manager = new IMS::IncidentManager(map_graph->get_num_of_edges());
+    auto router = new IMS::Router(map_graph, incident_manager);
+
+    ofstream fout;
+    fout.open("precise_heuristic_data.csv");
+    fout << "heuristic,k-l,distance tables (KiB),boundary distances (KiB),preprocess time (ms)";
+    for (auto & od_pair : od_pairs)
+    {
+        fout << "," << od_pair.name << " expanded nodes," << od_pair.name << " arrival time";
+    }
+    fout << "\n";
+
+    for (auto is_precise : {false, true})
+    {
+        double preprocess_time = 0;
+        if (is_precise)
+        {
+            IMS::Partition::partition_tree_t * partitions = map_graph->partition(k, l);
+            auto start = chrono::steady_clock::now();
+            map_graph->preprocess_boundary_distances(partitions, 0);
+            preprocess_time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            delete partitions;
+        }
+        size_t boundary_size = is_precise? map_graph->boundary_distances->memory_size() : 0;
+        cout << (is_precise? "precise" : "cell") << ": distance tables "
+             << map_graph->flat_distance_tables->memory_size() / 1024 << " KiB, boundary distances "
+             << boundary_size / 1024 << " KiB, preprocess " << preprocess_time << " ms" << endl;
+        fout << (is_precise? "precise" : "cell") << "," << k << "-" << l << ","
+             << map_graph->flat_distance_tables->memory_size() / 1024 << "," << boundary_size / 1024 << ","
+             << preprocess_time;
+
+        for (auto & od_pair : od_pairs)
+        {
+            unsigned origin = map_graph->find_nearest_node_of_location(od_pair.origin_long, od_pair.origin_lat, radius);
+            unsigned destination = map_graph->find_nearest_node_of_location(od_pair.destination_long, od_pair.destination_lat, radius);
+            if (origin == RoutingKit::invalid_id || destination == RoutingKit::invalid_id)
+            {
+                fout << ",n/a,n/a";
+                continue;
+            }
+            ExpandedLog* log = new ExpandedLog();
+            IMS::Path* path = router->route(origin, destination, 0, log);
+            cout << od_pair.name << ": " << log->expanded_nodes.size() << " nodes expanded, arrival at "
+                 << path->end_time << endl;
+            fout << "," << log->expanded_nodes.size() << "," << path->end_time;
+            delete path;
+            delete log;
+        }
+        fout << "\n";
+    }
+
+    fout.close();
+    delete router;
+    delete incident_manager;
+    delete map_graph;
+}
+
+/* Route each OD pair departing at every hour of a day on a graph with weight profiles: weight profile of the
+ * departure, nodes expanded and travel time. Writes weight_profiles_data.csv, one line per departure.
+ * Departures are day_start + hour * 3600, day_start being a local midnight in seconds since epoch.
+ */
+void experiment_weight_profiles(string graph, const vector<od_pair_t> &od_pairs, float radius, time_t day_start)
+{
+    cout << "==== Weight Profile Experiment " << graph << " ====" << endl;
+    auto map_graph = IMS::MapGraph::deserialize_and_initialize(graph);
+    auto incident_manager = new IMS::IncidentManager(map_graph->get_num_of_edges());
+    auto router = new IMS::Router(map_graph, incident_manager);
+
+    ofstream fout;
+    fout.open("weight_profiles_data.csv");
+    fout << "hour,profile";
+    for (auto & od_pair : od_pairs)
+    {
+        fout << "," << od_pair.name << " expanded nodes," << od_pair.name << " travel time (ms)";
+    }
+    fout << "\n";
+
+    for (unsigned hour = 0; hour < 24; hour++)
+    {
+        time_t departure = day_start + hour * 3600;
+        unsigned profile = map_graph->find_weight_profile(departure * 1000);
+        cout << hour << ":00, profile " << (int)profile << endl;
+        fout << hour << "," << (int)profile;
+
+        for (auto & od_pair : od_pairs)
+        {
+            unsigned origin = map_graph->find_nearest_node_of_location(od_pair.origin_long, od_pair.origin_lat, radius);
+            unsigned destination = map_graph->find_nearest_node_of_location(od_pair.destination_long, od_pair.destination_lat, radius);
+            if (origin == RoutingKit::invalid_id || destination == RoutingKit::invalid_id)
+            {
+                fout << ",n/a,n/a";
+                continue;
+            }
+            ExpandedLog* log = new ExpandedLog();
+            IMS::Path* path = router->route(origin, destination, departure, log);
+            cout << od_pair.name << ": " << log->expanded_nodes.size() << " nodes expanded, "
+                 << path->end_time - path->start_time << " ms" << endl;
+            fout << "," << log->expanded_nodes.size() << "," << path->end_time - path->start_time;
+            delete path;
+            delete log;
+        }
+        fout << "\n";
+    }
+
+    fout.close();
+    delete router;
+    delete incident_manager;
+    delete map_graph;
+}
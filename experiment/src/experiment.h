@@ -2,11 +2,27 @@
 #define EXPERIMENT_H
 
 #include <string>
+#include <vector>
 #include "../include/exp_log.h"
 
+/* Origin and destination of an experiment route */
+struct od_pair_t
+{
+    string name;
+    float origin_long;
+    float origin_lat;
+    float destination_long;
+    float destination_lat;
+};
+
 void experiment_all_route(string suffix, float origin_long, float origin_lat, float destination_long, float destination_lat, float radius);
 string experiment_route(string filename, string graph, float origin_long, float origin_lat, float destination_long, float destination_lat, float radius);
 void create_xml(string filename, ExpandedLog* log);
+void experiment_renumbering(string graph, string renumbered_graph, const vector<od_pair_t> &od_pairs, float radius, unsigned repetitions);
+string experiment_locality(string graph, const vector<od_pair_t> &od_pairs, float radius, unsigned repetitions);
+void experiment_partition_schemes(string graph, unsigned k, unsigned l, const vector<od_pair_t> &od_pairs, float radius);
+void experiment_precise_heuristic(string graph, unsigned k, unsigned l, const vector<od_pair_t> &od_pairs, float radius);
+void experiment_weight_profiles(string graph, const vector<od_pair_t> &od_pairs, float radius, time_t day_start);
 
 
 #endif
\ No newline at end of file
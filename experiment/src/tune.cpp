@@ -0,0 +1,637 @@
+/*
+ * Tuning of the partition (k, l) of a graph: each configuration is preprocessed from one MapGraph file, written as
+ * binary graph file and queried with a sample of OD pairs, in processes of their own so that time and memory of one
+ * configuration do not depend on the others. Configurations are built in parallel processes, queried one at a time.
+ * Writes the results as JSON and CSV, and recommends a configuration.
+ * Usage: see parse_tune_arguments
+ * Version: 1.0
+ * Author: Yuen Hoi Man
+ */
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "ims/map_graph.h"
+#include "ims/incident_manager.h"
+#include "ims/router.h"
+#include "../include/exp_report.h"
+#include "tune.h"
+
+using namespace std;
+
+int main(int argc, char ** argv)
+{
+    tune_options_t options;
+    if (!parse_tune_arguments(argc, argv, options))
+    {
+        return 1;
+    }
+    vector<tune_result_t> results(options.configs.size());
+    for (unsigned i = 0; i < results.size(); i++)
+    {
+        results[i].k = options.configs[i].first;
+        results[i].l = options.configs[i].second;
+    }
+
+    cout << "==== Tuning " << options.graph_file_path << ": " << results.size() << " configurations ====" << endl;
+    auto start = chrono::steady_clock::now();
+    run_in_processes(results, options.num_of_jobs, [&options](tune_result_t &result)
+    {
+        build_config(options, result);
+    });
+    auto built = chrono::steady_clock::now();
+    run_in_processes(results, options.is_query_parallel? options.num_of_jobs : 1, [&options](tune_result_t &result)
+    {
+        if (result.is_built)
+        {
+            query_config(options, result);
+        }
+    });
+    cout << "Built in " << chrono::duration<double>(built - start).count() << " s, queried in "
+         << chrono::duration<double>(chrono::steady_clock::now() - built).count() << " s" << endl;
+
+    if (!options.is_graph_kept)
+    {
+        for (auto & result : results)
+        {
+            remove(get_tune_graph_file_path(options, result).c_str());
+        }
+    }
+    int recommended = recommend_config(options, results);
+    write_tune_results(options, results, recommended);
+    return recommended >= 0? 0 : 2;
+}
+
+// helper function
+/* Run a stage for each result in a child process, at most num_of_jobs at once. The child passes its copy of the
+ * result back through a pipe, a child which fails or dies, e.g. out of memory, leaves an error in the result.
+ * Parameters: vector<tune_result_t> & results: updated by the stage
+ *             const unsigned & num_of_jobs
+ *             function<void(tune_result_t &)> stage: throws runtime_error on failure
+ * Return: when all stages are finished
+ */
+void run_in_processes(vector<tune_result_t> &results, const unsigned &num_of_jobs,
+                      function<void(tune_result_t &)> stage)
+{
+    map<pid_t, pair<unsigned, int> > running; // pid -> result index, read end of its pipe
+    unsigned next = 0;
+    while (next < results.size() || !running.empty())
+    {
+        if (next < results.size() && running.size() < max(1u, num_of_jobs))
+        {
+            int pipe_ends[2];
+            if (pipe(pipe_ends) != 0)
+            {
+                throw runtime_error("Cannot create pipe for configuration process");
+            }
+            cout.flush();
+            fflush(stdout);
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                close(pipe_ends[0]);
+                tune_result_t result = results[next];
+                try
+                {
+                    stage(result);
+                }
+                catch (exception &e)
+                {
+                    snprintf(result.error, sizeof(result.error), "%s", e.what());
+                }
+                cout.flush();
+                bool is_written = write(pipe_ends[1], &result, sizeof(result)) == sizeof(result);
+                close(pipe_ends[1]);
+                _exit(is_written? 0 : 1);
+            }
+            close(pipe_ends[1]);
+            if (pid < 0)
+            {
+                close(pipe_ends[0]);
+                snprintf(results[next].error, sizeof(results[next].error), "Cannot start process");
+            }
+            else
+            {
+                running[pid] = make_pair(next, pipe_ends[0]);
+            }
+            next++;
+            continue;
+        }
+
+        int status;
+        pid_t pid = wait(&status);
+        auto child = running.find(pid);
+        if (pid < 0 || child == running.end())
+        {
+            continue;
+        }
+        tune_result_t &result = results[child->second.first];
+        tune_result_t child_result;
+        if (read(child->second.second, &child_result, sizeof(child_result)) == sizeof(child_result))
+        {
+            result = child_result;
+        }
+        else
+        {
+            snprintf(result.error, sizeof(result.error), "Process exited abnormally (status %d)", status);
+        }
+        close(child->second.second);
+        running.erase(child);
+    }
+}
+
+// helper function
+/* Read a list of (k, l) configurations, e.g. 4x2,8x3,8x5
+ * Parameters: const string & list
+ * Return: vector<pair<unsigned, unsigned>>: empty if the list is invalid
+ */
+vector< pair<unsigned, unsigned> > parse_configs(const string &list)
+{
+    vector< pair<unsigned, unsigned> > configs;
+    istringstream fields(list);
+    string config;
+    while (getline(fields, config, ','))
+    {
+        size_t separator = config.find('x');
+        if (separator == string::npos || separator == 0 || separator + 1 == config.size()
+            || config.find_first_not_of("0123456789x") != string::npos)
+        {
+            return vector< pair<unsigned, unsigned> >();
+        }
+        configs.push_back(make_pair(stoul(config.substr(0, separator)), stoul(config.substr(separator + 1))));
+        if (configs.back().first == 0 || configs.back().second == 0)
+        {
+            return vector< pair<unsigned, unsigned> >();
+        }
+    }
+    return configs;
+}
+
+/* Read options of a tuning run from command line flags:
+ *   --graph <MapGraph file> [--configs <k>x<l>,...] [--partition grid|inertial-flow]
+ *   [--od random:<n> | --od <OD file or server log>] [--seed <n>] [--radius <m>] [--departure <s since epoch>]
+ *   [--warmup <queries>] [--jobs <processes>] [--threads <per process>] [--parallel-queries]
+ *   [--max-rss <MiB>] [--max-file-size <MiB>] [--max-preprocess <s>] [--tolerance <%>]
+ *   [--work-dir <directory>] [--keep-graphs] [-o <output prefix>]
+ * The graph file may be preprocessed with any configuration, it is preprocessed again with each.
+ * An OD file holds <origin long> <origin lat> <destination long> <destination lat> per line, a server log the
+ * routes printed by the server, whose first and last nodes are taken.
+ *
+ * Parameters: const int & argc
+ *             char ** argv
+ *             tune_options_t & options: options read
+ * Return: bool: false with usage printed if the flags are invalid
+ */
+bool parse_tune_arguments(const int &argc, char ** argv, tune_options_t &options)
+{
+    bool is_valid = true;
+    options.configs = parse_configs("1x2,4x2,8x2,16x2,32x2,64x2,4x3,8x3,16x3,32x3,64x3,4x4,8x4,16x4,32x4,64x4,8x5");
+    for (int i = 1; i < argc && is_valid; i++)
+    {
+        string flag = argv[i];
+        bool has_value = i + 1 < argc;
+        try
+        {
+            if (flag == "--parallel-queries")
+            {
+                options.is_query_parallel = true;
+            }
+            else if (flag == "--keep-graphs")
+            {
+                options.is_graph_kept = true;
+            }
+            else if (!has_value)
+            {
+                is_valid = false;
+            }
+            else if (flag == "--graph")
+            {
+                options.graph_file_path = argv[++i];
+            }
+            else if (flag == "--configs")
+            {
+                options.configs = parse_configs(argv[++i]);
+                is_valid = !options.configs.empty();
+            }
+            else if (flag == "--partition")
+            {
+                options.partition_scheme = argv[++i];
+                is_valid = options.partition_scheme == "grid" || options.partition_scheme == "inertial-flow";
+            }
+            else if (flag == "--od")
+            {
+                options.od_source = argv[++i];
+            }
+            else if (flag == "--seed")
+            {
+                options.seed = stoul(argv[++i]);
+            }
+            else if (flag == "--radius")
+            {
+                options.radius = stof(argv[++i]);
+            }
+            else if (flag == "--departure")
+            {
+                options.departure = stoll(argv[++i]);
+            }
+            else if (flag == "--warmup")
+            {
+                options.num_of_warmups = stoul(argv[++i]);
+            }
+            else if (flag == "--jobs")
+            {
+                options.num_of_jobs = stoul(argv[++i]);
+            }
+            else if (flag == "--threads")
+            {
+                options.num_of_threads = stoul(argv[++i]);
+            }
+            else if (flag == "--max-rss")
+            {
+                options.max_rss = stod(argv[++i]);
+            }
+            else if (flag == "--max-file-size")
+            {
+                options.max_file_size = stod(argv[++i]);
+            }
+            else if (flag == "--max-preprocess")
+            {
+                options.max_preprocess_time = stod(argv[++i]);
+            }
+            else if (flag == "--tolerance")
+            {
+                options.tolerance = stod(argv[++i]);
+            }
+            else if (flag == "--work-dir")
+            {
+                options.work_dir = argv[++i];
+            }
+            else if (flag == "-o")
+            {
+                options.output_prefix = argv[++i];
+            }
+            else
+            {
+                is_valid = false;
+            }
+        }
+        catch (exception &e)
+        {
+            is_valid = false;
+        }
+    }
+    if (options.od_source.compare(0, 7, "random:") == 0)
+    {
+        is_valid = is_valid && options.od_source.size() > 7
+                   && options.od_source.find_first_not_of("0123456789", 7) == string::npos;
+    }
+    if (!is_valid || options.graph_file_path.empty())
+    {
+        cout << "Usage: " << argv[0] << " --graph <MapGraph file> [--configs <k>x<l>,...]"
+             << " [--partition grid|inertial-flow] [--od random:<n> | --od <OD file or server log>] [--seed <n>]"
+             << " [--radius <m>] [--departure <s since epoch>] [--warmup <queries>] [--jobs <processes>]"
+             << " [--threads <per process>] [--parallel-queries] [--max-rss <MiB>] [--max-file-size <MiB>]"
+             << " [--max-preprocess <s>] [--tolerance <%>] [--work-dir <directory>] [--keep-graphs]"
+             << " [-o <output prefix>]" << endl;
+        return false;
+    }
+    return true;
+}
+
+/* Binary graph file of a configuration in the work directory
+ * Parameters: const tune_options_t & options
+ *             const tune_result_t & result
+ * Return: string
+ */
+string get_tune_graph_file_path(const tune_options_t &options, const tune_result_t &result)
+{
+    return options.work_dir + "/tune_" + to_string(result.k) + "_" + to_string(result.l) + ".graph";
+}
+
+/* Preprocess the graph with a configuration and write it as binary graph file, measuring time and memory.
+ * Parameters: const tune_options_t & options
+ *             tune_result_t & result: with k and l
+ * Return: when built, throws runtime_error on failure
+ */
+void build_config(const tune_options_t &options, tune_result_t &result)
+{
+    cout << "Building " << result.k << "x" << result.l << "..." << endl;
+    unique_ptr<IMS::MapGraph> graph(IMS::MapGraph::deserialize_and_initialize(options.graph_file_path));
+    IMS::Partition::partition_scheme_t scheme = options.partition_scheme == "inertial-flow"?
+                                                IMS::Partition::INERTIAL_FLOW_PARTITION
+                                                : IMS::Partition::GRID_PARTITION;
+
+    auto start = chrono::steady_clock::now();
+    IMS::Partition::partition_tree_t * partitions = graph->partition(result.k, result.l, scheme);
+    auto partitioned = chrono::steady_clock::now();
+    graph->preprocess(partitions, options.num_of_threads);
+    delete partitions;
+    auto preprocessed = chrono::steady_clock::now();
+    const string file_path = get_tune_graph_file_path(options, result);
+    graph->serialize_binary(file_path);
+    auto serialized = chrono::steady_clock::now();
+
+    struct stat file_stat;
+    if (stat(file_path.c_str(), &file_stat) != 0)
+    {
+        throw runtime_error("Cannot read graph file written: " + file_path);
+    }
+    result.partition_time = chrono::duration<double, milli>(partitioned - start).count();
+    result.preprocess_time = chrono::duration<double, milli>(preprocessed - partitioned).count();
+    result.serialize_time = chrono::duration<double, milli>(serialized - preprocessed).count();
+    result.file_size = file_stat.st_size;
+    result.distance_table_size = graph->flat_distance_tables->memory_size();
+    result.build_peak_rss = read_memory_status("VmHWM");
+    result.is_built = true;
+    cout << result.k << "x" << result.l << ": partition " << result.partition_time << " ms, preprocess "
+         << result.preprocess_time << " ms, " << result.file_size / 1024 << " KiB" << endl;
+}
+
+// helper function
+/* OD pairs of the options as node pairs of a graph: random node pairs, or OD coordinates snapped to the nearest
+ * node within the radius, from a file of coordinates or from routes in a server log.
+ * Parameters: IMS::MapGraph & graph
+ *             const tune_options_t & options
+ *             unsigned & num_of_unmatched: set to OD pairs without node within radius
+ * Return: vector<pair<unsigned, unsigned>>: origin, destination
+ */
+vector< pair<unsigned, unsigned> > load_od_pairs(IMS::MapGraph &graph, const tune_options_t &options,
+                                                 unsigned &num_of_unmatched)
+{
+    vector< pair<unsigned, unsigned> > od_pairs;
+    num_of_unmatched = 0;
+    if (options.od_source.compare(0, 7, "random:") == 0)
+    {
+        const unsigned num_of_pairs = stoul(options.od_source.substr(7));
+        mt19937 generator(options.seed);
+        uniform_int_distribution<unsigned> random_node(0, graph.get_num_of_nodes() - 1);
+        while (od_pairs.size() < num_of_pairs && graph.get_num_of_nodes() > 1)
+        {
+            unsigned origin = random_node(generator);
+            unsigned destination = random_node(generator);
+            if (origin != destination)
+            {
+                od_pairs.push_back(make_pair(origin, destination));
+            }
+        }
+        return od_pairs;
+    }
+
+    ifstream ifs(options.od_source);
+    if (!ifs)
+    {
+        throw runtime_error("Cannot read OD pairs: " + options.od_source);
+    }
+    vector< vector<float> > coordinates; // origin long, lat, destination long, lat
+    vector< pair<float, float> > route; // lat, long of each node of a logged route
+    bool is_in_route = false;
+    string line;
+    while (getline(ifs, line))
+    {
+        if (line.find("==== Route ====") != string::npos)
+        {
+            is_in_route = true;
+            route.clear();
+            continue;
+        }
+        if (is_in_route)
+        {
+            float lat, lon;
+            char separator;
+            istringstream fields(line);
+            if (fields >> lat >> separator >> lon && separator == ',')
+            {
+                route.push_back(make_pair(lat, lon));
+                continue;
+            }
+            is_in_route = false;
+            if (route.size() > 1)
+            {
+                coordinates.push_back({route.front().second, route.front().first,
+                                       route.back().second, route.back().first});
+            }
+            continue;
+        }
+        istringstream fields(line);
+        vector<float> od(4);
+        if (line.empty() || line[0] == '#' || !(fields >> od[0] >> od[1] >> od[2] >> od[3]))
+        {
+            continue;
+        }
+        coordinates.push_back(od);
+    }
+
+    for (auto & od : coordinates)
+    {
+        unsigned origin = graph.find_nearest_node_of_location(od[0], od[1], options.radius);
+        unsigned destination = graph.find_nearest_node_of_location(od[2], od[3], options.radius);
+        if (origin == RoutingKit::invalid_id || destination == RoutingKit::invalid_id)
+        {
+            num_of_unmatched++;
+            continue;
+        }
+        od_pairs.push_back(make_pair(origin, destination));
+    }
+    return od_pairs;
+}
+
+/* Route the OD pairs on the binary graph file of a configuration after some warm-up queries, measuring latency of
+ * each query without logging, then nodes expanded with logging, and memory after all queries.
+ * Parameters: const tune_options_t & options
+ *             tune_result_t & result: built by build_config
+ * Return: when queried, throws runtime_error on failure
+ */
+void query_config(const tune_options_t &options, tune_result_t &result)
+{
+    cout << "Querying " << result.k << "x" << result.l << "..." << endl;
+    auto start = chrono::steady_clock::now();
+    unique_ptr<IMS::MapGraph> graph(IMS::MapGraph::deserialize_and_initialize(get_tune_graph_file_path(options, result)));
+    result.load_time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    IMS::IncidentManager incident_manager(graph->get_num_of_edges());
+    IMS::Router router(graph.get(), &incident_manager);
+    vector< pair<unsigned, unsigned> > od_pairs = load_od_pairs(*graph, options, result.num_of_unmatched);
+    if (od_pairs.empty())
+    {
+        throw runtime_error("No OD pair to query from " + options.od_source);
+    }
+
+    for (unsigned i = 0; i < options.num_of_warmups; i++)
+    {
+        auto & od_pair = od_pairs[i % od_pairs.size()];
+        delete router.route(od_pair.first, od_pair.second, options.departure);
+    }
+    vector<double> latencies;
+    for (auto & od_pair : od_pairs)
+    {
+        auto query_start = chrono::steady_clock::now();
+        IMS::Path * path = router.route(od_pair.first, od_pair.second, options.departure);
+        double latency = chrono::duration<double, milli>(chrono::steady_clock::now() - query_start).count();
+        if (path == nullptr)
+        {
+            result.num_of_failed++;
+            continue;
+        }
+        latencies.push_back(latency);
+        delete path;
+    }
+    unsigned long long num_of_expanded_nodes = 0;
+    for (auto & od_pair : od_pairs)
+    {
+        ExpandedLog log;
+        delete router.route(od_pair.first, od_pair.second, options.departure, &log);
+        num_of_expanded_nodes += log.expanded_nodes.size();
+    }
+    if (latencies.empty())
+    {
+        throw runtime_error("No path found for any OD pair");
+    }
+
+    sort(latencies.begin(), latencies.end());
+    result.num_of_queries = latencies.size();
+    for (auto latency : latencies)
+    {
+        result.mean_latency += latency / latencies.size();
+    }
+    // nearest rank
+    result.p50_latency = latencies[(latencies.size() * 50 + 99) / 100 - 1];
+    result.p99_latency = latencies[(latencies.size() * 99 + 99) / 100 - 1];
+    result.max_latency = latencies.back();
+    result.mean_expanded_nodes = (double) num_of_expanded_nodes / od_pairs.size();
+    result.serving_rss = read_memory_status("VmRSS");
+    result.is_queried = true;
+    cout << result.k << "x" << result.l << ": p50 " << result.p50_latency << " ms, p99 " << result.p99_latency
+         << " ms, " << result.mean_expanded_nodes << " nodes expanded, RSS " << result.serving_rss / 1024 << " MiB"
+         << endl;
+}
+
+/* Recommend a configuration: of those queried within the limits of the options, the one of least serving memory
+ * among those whose p99 latency is within tolerance of the lowest, then the smaller graph file.
+ * Parameters: const tune_options_t & options
+ *             const vector<tune_result_t> & results
+ * Return: int: index of the recommended configuration, -1 if none is within the limits
+ */
+int recommend_config(const tune_options_t &options, const vector<tune_result_t> &results)
+{
+    vector<unsigned> candidates;
+    double best_p99 = 0;
+    for (unsigned i = 0; i < results.size(); i++)
+    {
+        const tune_result_t &result = results[i];
+        if (!result.is_queried
+            || (options.max_rss > 0 && result.serving_rss > options.max_rss * 1024)
+            || (options.max_file_size > 0 && result.file_size > options.max_file_size * 1024 * 1024)
+            || (options.max_preprocess_time > 0
+                && result.partition_time + result.preprocess_time > options.max_preprocess_time * 1000))
+        {
+            continue;
+        }
+        if (candidates.empty() || result.p99_latency < best_p99)
+        {
+            best_p99 = result.p99_latency;
+        }
+        candidates.push_back(i);
+    }
+
+    int recommended = -1;
+    for (auto i : candidates)
+    {
+        const tune_result_t &result = results[i];
+        if (result.p99_latency > best_p99 * (1 + options.tolerance / 100))
+        {
+            continue;
+        }
+        if (recommended < 0 || result.serving_rss < results[recommended].serving_rss
+            || (result.serving_rss == results[recommended].serving_rss
+                && result.file_size < results[recommended].file_size))
+        {
+            recommended = i;
+        }
+    }
+    return recommended;
+}
+
+/* Print the results as table and write them to <output prefix>.json and <output prefix>.csv.
+ * Parameters: const tune_options_t & options
+ *             const vector<tune_result_t> & results
+ *             const int & recommended: index, -1 for none
+ * Return: when written
+ */
+void write_tune_results(const tune_options_t &options, const vector<tune_result_t> &results, const int &recommended)
+{
+    ofstream json(options.output_prefix + ".json");
+    ofstream csv(options.output_prefix + ".csv");
+    json << "{\n  \"graph\": \"" << escape_json(options.graph_file_path) << "\",\n"
+         << "  \"partition_scheme\": \"" << options.partition_scheme << "\",\n"
+         << "  \"od_source\": \"" << escape_json(options.od_source) << "\",\n"
+         << "  \"seed\": " << options.seed << ",\n"
+         << "  \"threads_per_process\": " << options.num_of_threads << ",\n"
+         << "  \"parallel_queries\": " << (options.is_query_parallel? "true" : "false") << ",\n"
+         << "  \"results\": [";
+    csv << "k,l,error,partition time (ms),preprocess time (ms),serialize time (ms),file size (KiB),"
+        << "distance tables (KiB),build peak RSS (KiB),load time (ms),serving RSS (KiB),queries,unmatched,failed,"
+        << "mean latency (ms),p50 latency (ms),p99 latency (ms),max latency (ms),mean expanded nodes\n";
+
+    printf("\n%-6s %10s %10s %10s %11s %9s %9s %10s\n", "k-l", "prep (s)", "file MiB", "RSS MiB", "load (ms)",
+           "p50 (ms)", "p99 (ms)", "expanded");
+    for (unsigned i = 0; i < results.size(); i++)
+    {
+        const tune_result_t &r = results[i];
+        json << (i == 0? "\n" : ",\n") << "    {\"k\": " << r.k << ", \"l\": " << r.l
+             << ", \"built\": " << (r.is_built? "true" : "false")
+             << ", \"queried\": " << (r.is_queried? "true" : "false")
+             << ", \"error\": \"" << escape_json(r.error) << "\""
+             << ", \"partition_time_ms\": " << r.partition_time << ", \"preprocess_time_ms\": " << r.preprocess_time
+             << ", \"serialize_time_ms\": " << r.serialize_time << ", \"file_size_bytes\": " << r.file_size
+             << ", \"distance_table_bytes\": " << r.distance_table_size
+             << ", \"build_peak_rss_kib\": " << r.build_peak_rss << ", \"load_time_ms\": " << r.load_time
+             << ", \"serving_rss_kib\": " << r.serving_rss << ", \"queries\": " << r.num_of_queries
+             << ", \"unmatched\": " << r.num_of_unmatched << ", \"failed\": " << r.num_of_failed
+             << ", \"mean_latency_ms\": " << r.mean_latency << ", \"p50_latency_ms\": " << r.p50_latency
+             << ", \"p99_latency_ms\": " << r.p99_latency << ", \"max_latency_ms\": " << r.max_latency
+             << ", \"mean_expanded_nodes\": " << r.mean_expanded_nodes << "}";
+        string error = r.error;
+        replace(error.begin(), error.end(), ',', ';');
+        csv << r.k << "," << r.l << "," << error << "," << r.partition_time << "," << r.preprocess_time << ","
+            << r.serialize_time << "," << r.file_size / 1024 << "," << r.distance_table_size / 1024 << ","
+            << r.build_peak_rss << "," << r.load_time << "," << r.serving_rss << "," << r.num_of_queries << ","
+            << r.num_of_unmatched << "," << r.num_of_failed << "," << r.mean_latency << "," << r.p50_latency << ","
+            << r.p99_latency << "," << r.max_latency << "," << r.mean_expanded_nodes << "\n";
+
+        string name = to_string(r.k) + "x" + to_string(r.l);
+        if (!r.is_queried)
+        {
+            printf("%-6s %s\n", name.c_str(), r.error);
+            continue;
+        }
+        printf("%-6s %10.2f %10.1f %10.1f %11.1f %9.3f %9.3f %10.0f%s\n", name.c_str(),
+               (r.partition_time + r.preprocess_time) / 1000, r.file_size / 1048576.0, r.serving_rss / 1024.0,
+               r.load_time, r.p50_latency, r.p99_latency, r.mean_expanded_nodes,
+               (int) i == recommended? "   <- recommended" : "");
+    }
+    json << "\n  ],\n  \"recommended\": ";
+    if (recommended >= 0)
+    {
+        json << "{\"k\": " << results[recommended].k << ", \"l\": " << results[recommended].l << "}\n}\n";
+        printf("Recommended: k = %u, l = %u\n", results[recommended].k, results[recommended].l);
+    }
+    else
+    {
+        json << "null\n}\n";
+        printf("No configuration is within the limits\n");
+    }
+    cout << "Results are stored at " << options.output_prefix << ".json and " << options.output_prefix << ".csv"
+         << endl;
+}
@@ -0,0 +1,80 @@
+#ifndef TUNE_H
+#define TUNE_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <ctime>
+#include <functional>
+
+using namespace std;
+
+/* Options of a tuning run, see parse_tune_arguments
+ * Fields: string od_source: random:<n> for n random node pairs, or a file of OD coordinates or a server log
+ *         unsigned num_of_jobs: configurations built in parallel processes
+ *         unsigned num_of_threads: preprocessing threads of each process
+ *         bool is_query_parallel: also measure queries of several configurations at once, which skews latency
+ *         double max_rss, max_file_size, max_preprocess_time: MiB, MiB, s, 0 for no limit
+ *         double tolerance: %, p99 latency within which the configuration of least memory is recommended
+ */
+struct tune_options_t
+{
+    string graph_file_path;
+    vector< pair<unsigned, unsigned> > configs;
+    string partition_scheme = "grid";
+    string od_source = "random:200";
+    unsigned seed = 42;
+    float radius = 100;
+    time_t departure = 0;
+    unsigned num_of_warmups = 10;
+    unsigned num_of_jobs = 2;
+    unsigned num_of_threads = 1;
+    bool is_query_parallel = false;
+    double max_rss = 0;
+    double max_file_size = 0;
+    double max_preprocess_time = 0;
+    double tolerance = 10;
+    string work_dir = ".";
+    bool is_graph_kept = false;
+    string output_prefix = "tune_results";
+};
+
+/* Result of one configuration, filled by the build and query processes. Times are in milliseconds, memory in KiB.
+ * Plain data, as it is passed back from the processes through a pipe.
+ */
+struct tune_result_t
+{
+    unsigned k = 0;
+    unsigned l = 0;
+    bool is_built = false;
+    bool is_queried = false;
+    char error[256] = "";
+    double partition_time = 0;
+    double preprocess_time = 0;
+    double serialize_time = 0;
+    unsigned long long file_size = 0; // bytes
+    unsigned long long distance_table_size = 0; // bytes
+    long build_peak_rss = 0;
+    double load_time = 0;
+    long serving_rss = 0; // after all queries, graph file mapped
+    unsigned num_of_queries = 0;
+    unsigned num_of_unmatched = 0; // OD pairs without node within radius
+    unsigned num_of_failed = 0; // OD pairs without path
+    double mean_latency = 0;
+    double p50_latency = 0;
+    double p99_latency = 0;
+    double max_latency = 0;
+    double mean_expanded_nodes = 0;
+};
+
+void run_in_processes(vector<tune_result_t> &results, const unsigned &num_of_jobs,
+                      function<void(tune_result_t &)> stage);
+bool parse_tune_arguments(const int &argc, char ** argv, tune_options_t &options);
+string get_tune_graph_file_path(const tune_options_t &options, const tune_result_t &result);
+void build_config(const tune_options_t &options, tune_result_t &result);
+void query_config(const tune_options_t &options, tune_result_t &result);
+int recommend_config(const tune_options_t &options, const vector<tune_result_t> &results);
+void write_tune_results(const tune_options_t &options, const vector<tune_result_t> &results, const int &recommended);
+
+
+#endif
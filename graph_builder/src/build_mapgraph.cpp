@@ -1,6 +1,9 @@
 /*
  * Module for option of building and serializing graph as adjacency list in C++ data structure
- * from OpenStreetMap PBF file.
+ * from OpenStreetMap PBF file, or from a synthetic road graph.
+ * A build runs in stages: load -> initialize -> renumber -> partition -> preprocess -> serialize.
+ * The graph, the partition and the distance tables are checkpointed, so that a build interrupted in a later stage
+ * resumes from the last finished one.
  * Libraries: RoutingKit, Boost.Serialization
  * Version: 1.0
  * Author: Terence Chow
@@ -8,9 +11,23 @@
 
 #include <iostream>
 #include <string>
+#include <fstream>
+#include <functional>
+#include <chrono>
+#include <memory>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <sys/stat.h>
 
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
 #include <routingkit/osm_simple.h>
 #include "ims/map_graph.h"
+#include "ims/synthetic_graph.h"
+#include "exp_report.h"
 
 #include "build_mapgraph.h"
 
@@ -18,6 +35,858 @@ using namespace std;
 using namespace RoutingKit;
 using namespace IMS;
 
+// helper function
+/* Report a finished stage with its time and the memory of the process.
+ * Parameters: const string & stage
+ *             const chrono::steady_clock::time_point & start: start of the stage
+ *             const bool & is_resumed: stage result is read from a checkpoint
+ * Return: stage_report_t
+ */
+stage_report_t finish_stage(const string &stage, const chrono::steady_clock::time_point &start, const bool &is_resumed)
+{
+    stage_report_t report;
+    report.stage = stage;
+    report.is_resumed = is_resumed;
+    report.time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    report.rss = read_memory_status("VmRSS");
+    report.peak_rss = read_memory_status("VmHWM");
+    cout << "Stage " << stage << (is_resumed? " resumed from checkpoint" : " done") << " in "
+         << report.time / 1000 << " s, RSS " << report.rss / 1024 << " MiB." << endl;
+    return report;
+}
+
+// helper function
+/* Print the time and memory of each stage as table.
+ * Parameters: const vector<stage_report_t> & reports
+ *             const chrono::steady_clock::time_point & start: start of the build
+ * Return: when printed
+ */
+void print_stage_reports(const vector<stage_report_t> &reports, const chrono::steady_clock::time_point &start)
+{
+    cout << endl << "Stage              Time (s)   RSS (MiB)   Peak RSS (MiB)" << endl;
+    for(auto & report : reports)
+    {
+        printf("%-18s %8.2f   %9ld   %14ld%s\n", report.stage.c_str(), report.time / 1000, report.rss / 1024,
+               report.peak_rss / 1024, report.is_resumed? "   (checkpoint)" : "");
+    }
+    printf("%-18s %8.2f\n", "total", chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    fflush(stdout);
+}
+
+// helper function
+/* Key identifying the input of the graph checkpoint, a checkpoint with another key is stale.
+ * Parameters: const build_options_t & options
+ * Return: string: PBF file path, size and modification time, or synthetic graph and seed, renumbering and its k, l
+ *         and partition scheme
+ */
+string graph_checkpoint_key(const build_options_t &options)
+{
+    if(!options.synthetic_graph.empty())
+    {
+        string key = "synthetic;" + options.synthetic_graph + ";" + to_string(options.synthetic_seed);
+        if(options.is_renumbered)
+        {
+            key += ";renumbered;" + to_string(options.variants[0].first) + ";" + to_string(options.variants[0].second)
+                   + ";" + options.partition_scheme;
+        }
+        return key;
+    }
+    struct stat pbf_status;
+    if(stat(options.pbf_file_path.c_str(), &pbf_status) != 0)
+    {
+        throw runtime_error("PBF file not found: " + options.pbf_file_path);
+    }
+    string key = options.pbf_file_path + ";" + to_string(pbf_status.st_size) + ";" + to_string(pbf_status.st_mtime);
+    if(options.is_renumbered)
+    {
+        key += ";renumbered;" + to_string(options.variants[0].first) + ";" + to_string(options.variants[0].second)
+               + ";" + options.partition_scheme;
+    }
+    return key;
+}
+
+// helper function
+/* Write a checkpoint as Boost binary archive. Written to a temporary file first, so that an interrupted
+ * write never leaves a truncated checkpoint.
+ * Parameters: const string & file_path
+ *             const string & key: see graph_checkpoint_key
+ *             function<void(boost::archive::binary_oarchive &)> save: writes the content
+ * Return: when the checkpoint is written
+ */
+void write_checkpoint(const string &file_path, const string &key,
+                      function<void(boost::archive::binary_oarchive &)> save)
+{
+    const string temp_file_path = file_path + ".tmp";
+    {
+        ofstream ofs(temp_file_path, ios::binary);
+        boost::archive::binary_oarchive output_archive_stream(ofs);
+        output_archive_stream << key;
+        save(output_archive_stream);
+    }
+    if(rename(temp_file_path.c_str(), file_path.c_str()) != 0)
+    {
+        throw runtime_error("Cannot write checkpoint " + file_path);
+    }
+}
+
+// helper function
+/* Read a checkpoint written by write_checkpoint.
+ * Parameters: const string & file_path
+ *             const string & key: content is read only if the checkpoint has the same key
+ *             function<void(boost::archive::binary_iarchive &)> load: reads the content
+ * Return: bool: true if the content is read
+ */
+bool read_checkpoint(const string &file_path, const string &key,
+                     function<void(boost::archive::binary_iarchive &)> load)
+{
+    ifstream ifs(file_path, ios::binary);
+    if(!ifs)
+    {
+        return false;
+    }
+    try
+    {
+        boost::archive::binary_iarchive input_archive_stream(ifs);
+        string checkpoint_key;
+        input_archive_stream >> checkpoint_key;
+        if(checkpoint_key != key)
+        {
+            cout << "Checkpoint " << file_path << " is stale, stage is run again." << endl;
+            return false;
+        }
+        load(input_archive_stream);
+        return true;
+    }
+    catch(exception &e)
+    {
+        cout << "Checkpoint " << file_path << " cannot be read (" << e.what() << "), stage is run again." << endl;
+        return false;
+    }
+}
+
+// helper function
+/* Name of a variant in reports and checkpoint file names.
+ * Parameters: const pair<unsigned, unsigned> & variant: (k, l)
+ * Return: string: e.g. 8_5
+ */
+string get_variant_name(const pair<unsigned, unsigned> &variant)
+{
+    return to_string(variant.first) + "_" + to_string(variant.second);
+}
+
+/* Path of the overlay file of a variant, e.g. HK.graph.8_5.overlay
+ * Parameters: const build_options_t & options
+ *             const pair<unsigned, unsigned> & variant: (k, l)
+ * Return: string
+ */
+string get_overlay_file_path(const build_options_t &options, const pair<unsigned, unsigned> &variant)
+{
+    return options.output_file_path + "." + get_variant_name(variant) + ".overlay";
+}
+
+// helper function
+/* Partition scheme of a build.
+ * Parameters: const build_options_t & options
+ * Return: IMS::Partition::partition_scheme_t
+ */
+IMS::Partition::partition_scheme_t get_partition_scheme(const build_options_t &options)
+{
+    if(options.partition_scheme == "grid")
+    {
+        return IMS::Partition::GRID_PARTITION;
+    }
+    if(options.partition_scheme == "inertial-flow")
+    {
+        return IMS::Partition::INERTIAL_FLOW_PARTITION;
+    }
+    throw runtime_error("Unknown partition scheme: " + options.partition_scheme);
+}
+
+// helper function
+/* Partition and preprocess a (k, l) variant of the graph, resuming from its checkpoints.
+ * Variants can run concurrently, the graph is only read.
+ * Parameters: IMS::MapGraph & graph: initialized graph with owned arrays, only read
+ *             const build_options_t & options
+ *             const pair<unsigned, unsigned> & variant: (k, l)
+ *             const string & graph_key: see graph_checkpoint_key
+ *             const unsigned & num_of_threads: threads for preprocessing this variant
+ *             IMS::Partition::layer_t *& layers: set to the layers of the variant
+ *             IMS::Preprocess::distance_table_t *& distance_tables: set to the distance tables of the variant
+ *             vector<stage_report_t> & reports: reports of this variant are added
+ *             boost::mutex & report_access: guards reports
+ * Return: when the variant is preprocessed
+ */
+void preprocess_variant(IMS::MapGraph &graph, const build_options_t &options, const pair<unsigned, unsigned> &variant,
+                        const string &graph_key, const unsigned &num_of_threads,
+                        IMS::Partition::layer_t *& layers, IMS::Preprocess::distance_table_t *& distance_tables,
+                        vector<stage_report_t> &reports, boost::mutex &report_access)
+{
+    const bool is_checkpointed = !options.checkpoint_dir.empty();
+    const string name = get_variant_name(variant);
+    const string partition_checkpoint = options.checkpoint_dir + "/partition_" + name + ".checkpoint";
+    const string distance_table_checkpoint = options.checkpoint_dir + "/distance_tables_" + name + ".checkpoint";
+    const string preprocess_key = graph_key + ";" + to_string(variant.first) + ";" + to_string(variant.second)
+                                  + ";" + options.partition_scheme;
+
+    /* Distance tables from checkpoint skip partitioning and preprocessing */
+    auto start = chrono::steady_clock::now();
+    bool is_preprocess_resumed = is_checkpointed && read_checkpoint(distance_table_checkpoint, preprocess_key,
+            [&layers, &distance_tables](boost::archive::binary_iarchive &archive)
+            {
+                layers = new IMS::Partition::layer_t();
+                distance_tables = new IMS::Preprocess::distance_table_t();
+                archive >> *layers >> *distance_tables;
+            });
+    if(is_preprocess_resumed)
+    {
+        stage_report_t report = finish_stage("preprocess " + name, start, true);
+        boost::lock_guard<boost::mutex> lock(report_access);
+        reports.push_back(report);
+        return;
+    }
+
+    /* Partition */
+    IMS::Partition::partition_tree_t * partitions = nullptr;
+    bool is_partition_resumed = is_checkpointed && read_checkpoint(partition_checkpoint, preprocess_key,
+            [&partitions](boost::archive::binary_iarchive &archive)
+            {
+                archive >> partitions;
+            });
+    if(!is_partition_resumed)
+    {
+        cout << "Partitioning " << name << "..." << endl;
+        partitions = graph.partition(variant.first, variant.second, get_partition_scheme(options));
+        if(is_checkpointed)
+        {
+            write_checkpoint(partition_checkpoint, preprocess_key,
+                             [&partitions](boost::archive::binary_oarchive &archive)
+                             {
+                                 archive << partitions;
+                             });
+        }
+    }
+    stage_report_t partition_report = finish_stage("partition " + name, start, is_partition_resumed);
+
+    /* Pre-processing */
+    cout << "Pre-processing " << name << "..." << endl;
+    start = chrono::steady_clock::now();
+    graph.build_preprocessed(partitions, num_of_threads, layers, distance_tables);
+    delete partitions;
+    if(is_checkpointed)
+    {
+        write_checkpoint(distance_table_checkpoint, preprocess_key,
+                         [&layers, &distance_tables](boost::archive::binary_oarchive &archive)
+                         {
+                             archive << *layers << *distance_tables;
+                         });
+    }
+    stage_report_t preprocess_report = finish_stage("preprocess " + name, start, false);
+
+    boost::lock_guard<boost::mutex> lock(report_access);
+    reports.push_back(partition_report);
+    reports.push_back(preprocess_report);
+}
+
+/*
+ * Build, preprocess and serialize a MapGraph from a PBF file, resuming from checkpoints of an earlier build.
+ * The graph is loaded and initialized once for all (k, l) variants, which are preprocessed concurrently.
+ * The first variant is written with the graph, with more than one variant each is also written as overlay file.
+ *
+ * Parameters: const build_options_t & options
+ * Return: vector<stage_report_t>: time and memory of each stage
+ */
+vector<stage_report_t> build_mapgraph(const build_options_t &options)
+{
+    if(options.variants.empty())
+    {
+        throw runtime_error("No (k, l) variant to build");
+    }
+    const auto build_start = chrono::steady_clock::now();
+    vector<stage_report_t> reports;
+    const bool is_checkpointed = !options.checkpoint_dir.empty();
+    if(is_checkpointed)
+    {
+        mkdir(options.checkpoint_dir.c_str(), 0755);
+    }
+    const string graph_checkpoint = options.checkpoint_dir + "/graph.checkpoint";
+    const string graph_key = graph_checkpoint_key(options);
+    const string renumbering_file_path = options.output_file_path + ".ids";
+
+    IMS::MapGraph graph;
+
+    /* Load graph, from checkpoint or PBF file */
+    auto start = chrono::steady_clock::now();
+    bool is_graph_resumed = is_checkpointed && read_checkpoint(graph_checkpoint, graph_key,
+            [&graph](boost::archive::binary_iarchive &archive)
+            {
+                vector<float> longitude, latitude;
+                vector<unsigned> head, first_out, default_travel_time, geo_distance;
+                archive >> longitude >> latitude >> head >> first_out >> default_travel_time >> geo_distance;
+                graph.longitude = move(longitude);
+                graph.latitude = move(latitude);
+                graph.head = move(head);
+                graph.first_out = move(first_out);
+                graph.default_travel_time = move(default_travel_time);
+                graph.geo_distance = move(geo_distance);
+            });
+    if(!is_graph_resumed && !options.synthetic_graph.empty())
+    {
+        IMS::SyntheticGraph::options_t synthetic_options;
+        IMS::SyntheticGraph::parse_options(options.synthetic_graph, synthetic_options);
+        synthetic_options.seed = options.synthetic_seed;
+        auto graph_data = IMS::SyntheticGraph::generate(synthetic_options);
+        graph.longitude = move(graph_data.longitude);
+        graph.latitude = move(graph_data.latitude);
+        graph.head = move(graph_data.head);
+        graph.first_out = move(graph_data.first_out);
+        graph.default_travel_time = move(graph_data.travel_time);
+        graph.geo_distance = move(graph_data.geo_distance);
+    }
+    else if(!is_graph_resumed)
+    {
+        auto graph_data = simple_load_osm_car_routing_graph_from_pbf(options.pbf_file_path);
+        graph.longitude = move(graph_data.longitude);
+        graph.latitude = move(graph_data.latitude);
+        graph.head = move(graph_data.head);
+        graph.first_out = move(graph_data.first_out);
+        graph.default_travel_time = move(graph_data.travel_time);
+        graph.geo_distance = move(graph_data.geo_distance);
+    }
+    reports.push_back(finish_stage("load", start, is_graph_resumed));
+    cout << "Number of nodes: " << graph.get_num_of_nodes() << endl;
+    cout << "Number of edges: " << graph.get_num_of_edges() << endl;
+
+    start = chrono::steady_clock::now();
+    graph.initialize();
+    reports.push_back(finish_stage("initialize", start, false));
+
+    /* Renumber nodes for locality by the first variant, keeping old -> new IDs. A resumed graph is renumbered already. */
+    if(options.is_renumbered && !is_graph_resumed)
+    {
+        start = chrono::steady_clock::now();
+        IMS::Renumbering renumbering = graph.renumber_by_partition(options.variants[0].first,
+                                                                   options.variants[0].second,
+                                                                   get_partition_scheme(options));
+        ofstream ofs(renumbering_file_path);
+        boost::archive::text_oarchive output_archive_stream(ofs);
+        output_archive_stream << renumbering;
+        ofs.close();
+        cout << "Old to new node and edge IDs are stored at " << renumbering_file_path << endl;
+        reports.push_back(finish_stage("renumber", start, false));
+    }
+    if(is_checkpointed && !is_graph_resumed)
+    {
+        write_checkpoint(graph_checkpoint, graph_key, [&graph](boost::archive::binary_oarchive &archive)
+        {
+            archive << graph.longitude.to_vector() << graph.latitude.to_vector() << graph.head.to_vector()
+                    << graph.first_out.to_vector() << graph.default_travel_time.to_vector()
+                    << graph.geo_distance.to_vector();
+        });
+    }
+
+    /* Partition and preprocess the variants concurrently, sharing the graph and its inverse */
+    unsigned num_of_threads = options.num_of_threads != 0? options.num_of_threads
+                                                         : max(1u, boost::thread::hardware_concurrency());
+    unsigned num_of_variant_threads = max<unsigned>(1, num_of_threads / options.variants.size());
+    vector<IMS::Partition::layer_t *> layers(options.variants.size(), nullptr);
+    vector<IMS::Preprocess::distance_table_t *> distance_tables(options.variants.size(), nullptr);
+    vector<string> errors(options.variants.size());
+    boost::mutex report_access;
+    boost::thread_group variant_threads;
+    for(unsigned i = 0; i < options.variants.size(); i++)
+    {
+        variant_threads.create_thread([&, i]()
+        {
+            try
+            {
+                preprocess_variant(graph, options, options.variants[i], graph_key, num_of_variant_threads,
+                                   layers[i], distance_tables[i], reports, report_access);
+            }
+            catch(exception &e)
+            {
+                errors[i] = e.what();
+            }
+        });
+    }
+    variant_threads.join_all();
+    for(unsigned i = 0; i < options.variants.size(); i++)
+    {
+        if(!errors[i].empty())
+        {
+            for(unsigned j = 0; j < options.variants.size(); j++)
+            {
+                delete layers[j];
+                delete distance_tables[j];
+            }
+            throw runtime_error("Variant " + get_variant_name(options.variants[i]) + " failed: " + errors[i]);
+        }
+    }
+
+    /* Write overlays, the first variant stays with the graph */
+    start = chrono::steady_clock::now();
+    const uint64_t graph_checksum = graph.get_checksum();
+    for(unsigned i = 0; i < options.variants.size(); i++)
+    {
+        if(options.variants.size() > 1)
+        {
+            const string overlay_file_path = get_overlay_file_path(options, options.variants[i]);
+            IMS::Preprocess::write_overlay(overlay_file_path, graph_checksum, layers[i], distance_tables[i]);
+            cout << "Variant " << get_variant_name(options.variants[i]) << " is stored at " << overlay_file_path << endl;
+        }
+        if(i == 0)
+        {
+            graph.set_preprocessed(layers[i], distance_tables[i]);
+        }
+        else
+        {
+            delete layers[i];
+            delete distance_tables[i];
+        }
+    }
+
+    /* Optional boundary distances of the first variant, for the precise heuristic */
+    if(options.is_precise_heuristic)
+    {
+        auto boundary_start = chrono::steady_clock::now();
+        unique_ptr<IMS::Partition::partition_tree_t> partitions(graph.partition(options.variants[0].first,
+                                                                                 options.variants[0].second,
+                                                                                 get_partition_scheme(options)));
+        graph.preprocess_boundary_distances(partitions.get(), num_of_threads);
+        cout << "Precise heuristic: boundary distances " << graph.boundary_distances->memory_size() / 1024
+             << " KiB, distance tables " << graph.flat_distance_tables->memory_size() / 1024 << " KiB" << endl;
+        reports.push_back(finish_stage("boundary distances", boundary_start, false));
+    }
+
+    /* Serialize created graph */
+    cout << "Start serializing graph..." << endl;
+    if(options.output_format == "binary")
+    {
+        graph.serialize_binary(options.output_file_path);
+    }
+    else
+    {
+        graph.serialize(options.output_file_path);
+    }
+    cout << "Graph serialized and is stored at " << options.output_file_path << endl;
+    reports.push_back(finish_stage("serialize", start, false));
+
+    if(is_checkpointed && !options.is_checkpoint_kept)
+    {
+        remove(graph_checkpoint.c_str());
+        for(auto & variant : options.variants)
+        {
+            remove((options.checkpoint_dir + "/partition_" + get_variant_name(variant) + ".checkpoint").c_str());
+            remove((options.checkpoint_dir + "/distance_tables_" + get_variant_name(variant) + ".checkpoint").c_str());
+        }
+        rmdir(options.checkpoint_dir.c_str());
+    }
+
+    /* Report, variants run concurrently and their time overlaps */
+    print_stage_reports(reports, build_start);
+    return reports;
+}
+
+/*
+ * Apply edge changes to a preprocessed MapGraph file and update its distance tables incrementally,
+ * see MapGraph::apply_edge_changes. The partition tree is rebuilt from the node locations, which is much faster
+ * than preprocessing, and checked against the layers of the graph.
+ *
+ * Parameters: const build_options_t & options: with changes_file_path, graph_file_path of a text MapGraph file
+ *                                              and its (k, l) as the only variant
+ * Return: vector<stage_report_t>: time and memory of each stage
+ */
+vector<stage_report_t> update_mapgraph(const build_options_t &options)
+{
+    const auto update_start = chrono::steady_clock::now();
+    vector<stage_report_t> reports;
+
+    auto start = chrono::steady_clock::now();
+    vector<IMS::edge_change_t> changes = IMS::MapGraph::read_edge_changes(options.changes_file_path);
+    unique_ptr<IMS::MapGraph> graph(IMS::MapGraph::deserialize_and_initialize(options.graph_file_path));
+    if(graph->layers == nullptr)
+    {
+        throw runtime_error("Graph file is not a preprocessed text MapGraph file: " + options.graph_file_path);
+    }
+    reports.push_back(finish_stage("load", start, false));
+
+    start = chrono::steady_clock::now();
+    unique_ptr<IMS::Partition::partition_tree_t> partitions(graph->partition(options.variants[0].first,
+                                                                              options.variants[0].second,
+                                                                              get_partition_scheme(options)));
+    unique_ptr<IMS::Partition::layer_t> layers(IMS::Partition::build_layer(partitions.get(),
+                                                                           graph->get_num_of_nodes()));
+    if(*layers != *graph->layers)
+    {
+        throw runtime_error("Graph file is not preprocessed with k = " + to_string(options.variants[0].first)
+                            + ", l = " + to_string(options.variants[0].second)
+                            + " and partition scheme " + options.partition_scheme);
+    }
+    reports.push_back(finish_stage("partition", start, false));
+
+    start = chrono::steady_clock::now();
+    IMS::update_report_t update_report = graph->apply_edge_changes(changes, partitions.get(), options.num_of_threads);
+    cout << update_report.num_of_edges_added << " edges added, " << update_report.num_of_edges_removed
+         << " removed, " << update_report.num_of_edges_retimed << " retimed | "
+         << update_report.num_of_boundaries_changed << " partition boundaries changed | "
+         << update_report.num_of_entries_recomputed << " of " << update_report.num_of_entries
+         << " distance table entries recomputed" << endl;
+    reports.push_back(finish_stage("update", start, false));
+
+    cout << "Start serializing graph..." << endl;
+    start = chrono::steady_clock::now();
+    if(options.output_format == "binary")
+    {
+        graph->serialize_binary(options.output_file_path);
+    }
+    else
+    {
+        graph->serialize(options.output_file_path);
+    }
+    cout << "Graph serialized and is stored at " << options.output_file_path << endl;
+    reports.push_back(finish_stage("serialize", start, false));
+
+    print_stage_reports(reports, update_start);
+    return reports;
+}
+
+/*
+ * Set travel time profiles by time of day of a preprocessed MapGraph file and preprocess their heuristic,
+ * see MapGraph::set_weight_profiles. The partition tree is rebuilt from the node locations as for updates.
+ *
+ * Parameters: const build_options_t & options: with profiles_file_path, see MapGraph::read_weight_profiles,
+ *                                              graph_file_path of a MapGraph file and its (k, l) as the only variant
+ * Return: vector<stage_report_t>: time and memory of each stage
+ */
+vector<stage_report_t> profile_mapgraph(const build_options_t &options)
+{
+    const auto profile_start = chrono::steady_clock::now();
+    vector<stage_report_t> reports;
+
+    auto start = chrono::steady_clock::now();
+    unique_ptr<IMS::MapGraph> graph(IMS::MapGraph::deserialize_and_initialize(options.graph_file_path));
+    vector<unsigned> start_times;
+    vector< vector<unsigned> > travel_times;
+    int utc_offset;
+    graph->read_weight_profiles(options.profiles_file_path, start_times, travel_times, utc_offset);
+    reports.push_back(finish_stage("load", start, false));
+
+    start = chrono::steady_clock::now();
+    unique_ptr<IMS::Partition::partition_tree_t> partitions(graph->partition(options.variants[0].first,
+                                                                              options.variants[0].second,
+                                                                              get_partition_scheme(options)));
+    reports.push_back(finish_stage("partition", start, false));
+
+    cout << "Pre-processing " << start_times.size() << " weight profiles..." << endl;
+    start = chrono::steady_clock::now();
+    unsigned num_of_threads = options.num_of_threads != 0? options.num_of_threads
+                                                         : max(1u, boost::thread::hardware_concurrency());
+    graph->set_weight_profiles(start_times, travel_times, utc_offset, partitions.get(), num_of_threads,
+                               options.max_trip_minutes * 60);
+    cout << "Weight profiles: " << graph->weight_profiles->memory_size() / 1024 << " KiB, distance tables "
+         << graph->flat_distance_tables->memory_size() / 1024 << " KiB" << endl;
+    reports.push_back(finish_stage("weight profiles", start, false));
+
+    cout << "Start serializing graph..." << endl;
+    start = chrono::steady_clock::now();
+    if(options.output_format == "binary")
+    {
+        graph->serialize_binary(options.output_file_path);
+    }
+    else
+    {
+        graph->serialize(options.output_file_path);
+    }
+    cout << "Graph serialized and is stored at " << options.output_file_path << endl;
+    reports.push_back(finish_stage("serialize", start, false));
+
+    print_stage_reports(reports, profile_start);
+    return reports;
+}
+
+/*
+ * Build travel time functions of a MapGraph file from its travel time history and write them as side file,
+ * see IMS::TravelTimeFunction::build. The graph file is not changed.
+ *
+ * Parameters: const build_options_t & options: with history_file_path, see MapGraph::read_travel_time_history,
+ *                                              graph_file_path of a MapGraph file and function_interval
+ * Return: vector<stage_report_t>: time and memory of each stage
+ */
+vector<stage_report_t> build_travel_time_functions(const build_options_t &options)
+{
+    const auto function_start = chrono::steady_clock::now();
+    vector<stage_report_t> reports;
+
+    auto start = chrono::steady_clock::now();
+    unique_ptr<IMS::MapGraph> graph(IMS::MapGraph::deserialize_and_initialize(options.graph_file_path));
+    vector< vector< pair<unsigned, unsigned> > > samples;
+    int utc_offset;
+    graph->read_travel_time_history(options.history_file_path, samples, utc_offset);
+    reports.push_back(finish_stage("load", start, false));
+
+    start = chrono::steady_clock::now();
+    graph->default_travel_time.materialize();
+    unique_ptr<IMS::TravelTimeFunction::travel_time_function_table_t> table(
+            IMS::TravelTimeFunction::build(graph->default_travel_time, samples, options.function_interval * 60,
+                                           utc_offset));
+    unsigned num_of_edges_sampled = 0;
+    for(auto & edge_samples : samples)
+    {
+        num_of_edges_sampled += edge_samples.empty()? 0 : 1;
+    }
+    const size_t plain_memory = table->function_of_edge.size() * (size_t)table->num_of_breakpoints() * sizeof(unsigned);
+    cout << num_of_edges_sampled << " of " << table->function_of_edge.size() << " edges with history, "
+         << table->num_of_functions() << " distinct functions of " << table->num_of_breakpoints() << " breakpoints | "
+         << table->memory_size() / 1024 << " KiB, " << plain_memory / 1024 << " KiB as travel time per edge and"
+         << " breakpoint" << endl;
+    reports.push_back(finish_stage("functions", start, false));
+
+    start = chrono::steady_clock::now();
+    IMS::TravelTimeFunction::write(*table, graph->get_checksum(), options.output_file_path);
+    cout << "Travel time functions are stored at " << options.output_file_path << endl;
+    reports.push_back(finish_stage("serialize", start, false));
+
+    print_stage_reports(reports, function_start);
+    return reports;
+}
+
+// helper function
+/* Read a list of (k, l) variants, e.g. 4x2,8x3,8x5
+ * Parameters: const string & list
+ * Return: vector<pair<unsigned, unsigned>>: empty if the list is invalid
+ */
+vector< pair<unsigned, unsigned> > parse_variants(const string &list)
+{
+    vector< pair<unsigned, unsigned> > variants;
+    size_t begin = 0;
+    while(begin <= list.size())
+    {
+        size_t end = list.find(',', begin);
+        if(end == string::npos)
+        {
+            end = list.size();
+        }
+        const string variant = list.substr(begin, end - begin);
+        size_t separator = variant.find('x');
+        if(separator == string::npos || separator == 0 || separator + 1 == variant.size()
+           || variant.find_first_not_of("0123456789x") != string::npos)
+        {
+            return vector< pair<unsigned, unsigned> >();
+        }
+        variants.push_back(make_pair(stoul(variant.substr(0, separator)), stoul(variant.substr(separator + 1))));
+        begin = end + 1;
+    }
+    return variants;
+}
+
+// helper function
+/* Print the flags of parse_build_arguments
+ * Parameters: const char * program
+ * Return: when the usage is printed
+ */
+static void print_build_usage(const char * program)
+{
+    cout << "Usage: " << program << " --pbf <PBF file> (-k <partitions> -l <levels> | --variants <k>x<l>,...)"
+         << " [-o <output file>] [--binary] [--renumber] [--partition grid|inertial-flow]"
+         << " [--threads <threads, 0 for all cores>]"
+         << " [--checkpoint-dir <directory>] [--no-checkpoint] [--keep-checkpoint] [--precise-heuristic]" << endl;
+    cout << "       " << program << " --synthetic <grid|random>:<nodes> [--seed <n>] followed by the flags above"
+         << " except --pbf, for a synthetic road graph" << endl;
+    cout << "       " << program << " --update <edge changes file> --graph <text MapGraph file> -k <partitions>"
+         << " -l <levels> [-o <output file, default: the graph file>] [--binary]"
+         << " [--partition <scheme of the graph file>] [--threads <threads>]" << endl;
+    cout << "       " << program << " --profiles <weight profiles file> --graph <MapGraph file> -k <partitions>"
+         << " -l <levels> [-o <output file, default: the graph file>] [--binary]"
+         << " [--partition <scheme of the graph file>] [--threads <threads>]"
+         << " [--max-trip <minutes of the longest route kept optimal, default: "
+         << IMS::Preprocess::MAX_TRIP_DURATION / 60 << ">]" << endl;
+    cout << "       " << program << " --history <travel time history file> --graph <MapGraph file>"
+         << " [-o <output file, default: <graph file>.ttf>] [--interval <minutes between breakpoints, default: 15>]"
+         << endl;
+    cout << "Without arguments the interactive menu is shown." << endl;
+}
+
+/*
+ * Read options of a build from command line flags:
+ *   --pbf <PBF file> (-k <k> -l <l> | --variants <k>x<l>,...) [-o <output file>] [--binary] [--renumber]
+ *   [--partition grid|inertial-flow] [--threads <n>] [--checkpoint-dir <directory>] [--no-checkpoint]
+ *   [--keep-checkpoint] [--precise-heuristic]
+ * Checkpoints are stored in <output file>.checkpoint by default and removed after a successful build.
+ * Or, to build a synthetic road graph instead, the same flags with --synthetic <grid|random>:<nodes> [--seed <n>]
+ * instead of --pbf.
+ * Or, to update a preprocessed graph with edge changes:
+ *   --update <edge changes file> --graph <text MapGraph file> -k <k> -l <l> [-o <output file>] [--binary]
+ *   [--partition grid|inertial-flow] [--threads <n>]
+ * Or, to set the weight profiles of a preprocessed graph:
+ *   --profiles <weight profiles file> --graph <MapGraph file> -k <k> -l <l> [-o <output file>] [--binary]
+ *   [--partition grid|inertial-flow] [--threads <n>] [--max-trip <minutes>]
+ * Or, to build the travel time functions of a graph, written to <MapGraph file>.ttf by default:
+ *   --history <travel time history file> --graph <MapGraph file> [-o <output file>] [--interval <minutes>]
+ * --help prints the usage and exits with status 0.
+ *
+ * Parameters: const int & argc
+ *             char ** argv
+ *             build_options_t & options: options read
+ * Return: bool: false with usage printed if the flags are invalid
+ */
+bool parse_build_arguments(const int &argc, char ** argv, build_options_t &options)
+{
+    bool is_checkpointed = true;
+    bool is_valid = true;
+    bool is_output_given = false;
+    unsigned k = 0, l = 0;
+    for(int i = 1; i < argc && is_valid; i++)
+    {
+        string flag = argv[i];
+        bool has_value = i + 1 < argc;
+        if(flag == "--help")
+        {
+            print_build_usage(argv[0]);
+            exit(0);
+        }
+        else if(flag == "--binary")
+        {
+            options.output_format = "binary";
+        }
+        else if(flag == "--renumber")
+        {
+            options.is_renumbered = true;
+        }
+        else if(flag == "--no-checkpoint")
+        {
+            is_checkpointed = false;
+        }
+        else if(flag == "--keep-checkpoint")
+        {
+            options.is_checkpoint_kept = true;
+        }
+        else if(flag == "--precise-heuristic")
+        {
+            options.is_precise_heuristic = true;
+        }
+        else if(!has_value)
+        {
+            is_valid = false;
+        }
+        else if(flag == "--pbf")
+        {
+            options.pbf_file_path = argv[++i];
+        }
+        else if(flag == "--synthetic")
+        {
+            options.synthetic_graph = argv[++i];
+            IMS::SyntheticGraph::options_t synthetic_options;
+            is_valid = IMS::SyntheticGraph::parse_options(options.synthetic_graph, synthetic_options);
+        }
+        else if(flag == "--seed")
+        {
+            options.synthetic_seed = stoul(argv[++i]);
+        }
+        else if(flag == "-k")
+        {
+            k = stoul(argv[++i]);
+        }
+        else if(flag == "-l")
+        {
+            l = stoul(argv[++i]);
+        }
+        else if(flag == "--variants")
+        {
+            options.variants = parse_variants(argv[++i]);
+            is_valid = !options.variants.empty();
+        }
+        else if(flag == "-o")
+        {
+            options.output_file_path = argv[++i];
+            is_output_given = true;
+        }
+        else if(flag == "--update")
+        {
+            options.changes_file_path = argv[++i];
+        }
+        else if(flag == "--profiles")
+        {
+            options.profiles_file_path = argv[++i];
+        }
+        else if(flag == "--max-trip")
+        {
+            options.max_trip_minutes = stoul(argv[++i]);
+        }
+        else if(flag == "--history")
+        {
+            options.history_file_path = argv[++i];
+        }
+        else if(flag == "--interval")
+        {
+            options.function_interval = stoul(argv[++i]);
+        }
+        else if(flag == "--graph")
+        {
+            options.graph_file_path = argv[++i];
+        }
+        else if(flag == "--partition")
+        {
+            options.partition_scheme = argv[++i];
+            is_valid = options.partition_scheme == "grid" || options.partition_scheme == "inertial-flow";
+        }
+        else if(flag == "--threads")
+        {
+            options.num_of_threads = stoul(argv[++i]);
+        }
+        else if(flag == "--checkpoint-dir")
+        {
+            options.checkpoint_dir = argv[++i];
+        }
+        else
+        {
+            is_valid = false;
+        }
+    }
+    if(k != 0 && l != 0 && options.variants.empty())
+    {
+        options.variants.push_back(make_pair(k, l));
+    }
+    for(auto & variant : options.variants)
+    {
+        is_valid = is_valid && variant.first != 0 && variant.second != 0;
+    }
+
+    bool is_update = !options.changes_file_path.empty() || !options.profiles_file_path.empty();
+    if(is_update)
+    {
+        is_valid = is_valid && (options.changes_file_path.empty() || options.profiles_file_path.empty());
+        is_valid = is_valid && !options.graph_file_path.empty() && options.variants.size() == 1;
+        if(!is_output_given)
+        {
+            options.output_file_path = options.graph_file_path;
+        }
+    }
+    bool is_history = !options.history_file_path.empty();
+    if(is_history)
+    {
+        is_valid = is_valid && !is_update && !options.graph_file_path.empty() && options.function_interval != 0;
+        if(!is_output_given)
+        {
+            options.output_file_path = options.graph_file_path + ".ttf";
+        }
+    }
+    is_valid = is_valid && (options.pbf_file_path.empty() || options.synthetic_graph.empty());
+    if(!is_valid || (!is_update && !is_history && options.pbf_file_path.empty() && options.synthetic_graph.empty())
+       || (!is_history && options.variants.empty()))
+    {
+        print_build_usage(argv[0]);
+        return false;
+    }
+    if(!is_checkpointed)
+    {
+        options.checkpoint_dir.clear();
+    }
+    else if(options.checkpoint_dir.empty())
+    {
+        options.checkpoint_dir = options.output_file_path + ".checkpoint";
+    }
+    return true;
+}
+
 /*
  * Entrance of module from external source.
  * Acts as facet of graph building and serialization function.
@@ -28,49 +897,36 @@ using namespace IMS;
  */
 void build_mapgraph_entrance()
 {
-    string input_file_path;
-    const string output_file_path = "HK.graph";
+    build_options_t options;
+    string renumber_option, precise_option;
+    unsigned k, l;
 
-    int k, l;
     cout << "Number of Partitions (k): ";
     cin >> k;
     cout << "Number of Levels (l): ";
     cin >> l;
+    options.variants.push_back(make_pair(k, l));
 
     cin.ignore();           /* Clear input buffer */
     cout << "PBF file path: ";
-    getline(cin, input_file_path);
+    getline(cin, options.pbf_file_path);
+    cout << "Output format (text / binary): ";
+    getline(cin, options.output_format);
+    cout << "Renumber nodes by partition (y / n): ";
+    getline(cin, renumber_option);
+    options.is_renumbered = renumber_option == "y";
+    cout << "Partition scheme (grid / inertial-flow): ";
+    getline(cin, options.partition_scheme);
+    cout << "Precompute boundary distances for a precise heuristic (y / n): ";
+    getline(cin, precise_option);
+    options.is_precise_heuristic = precise_option == "y";
+    options.checkpoint_dir = options.output_file_path + ".checkpoint";
 
     try
     {
         /* Build graph data structure. */
         cout << "Start building graph..." << endl;
-
-        auto graph_data = simple_load_osm_car_routing_graph_from_pbf(input_file_path);
-        IMS::MapGraph graph;
-        graph.longitude = graph_data.longitude;
-        graph.latitude = graph_data.latitude;
-        graph.head = graph_data.head;
-        graph.first_out = graph_data.first_out;
-        graph.default_travel_time = graph_data.travel_time;
-        graph.geo_distance = graph_data.geo_distance;
-
-        graph.initialize();
-
-        cout << "Graph built." << endl;
-        cout << "Number of nodes: " << graph_data.node_count() << endl;
-        cout << "Number of edges: " << graph_data.arc_count() << endl;
-        cout << "Tails of edges need to be created separately with invert_inverse_vetor(graph.first_out)" << endl;
-        cout << endl;
-
-        /* Perform Partitioning and Pre-processing */
-        cout << "Partitioning and Pre-processing..." << endl;
-        graph.preprocess(k, l);
-
-        /* Serialize created graph */
-        cout << "Start serializing graph..." << endl;
-        graph.serialize(output_file_path);
-        cout << "Graph serialized and is stored at " << output_file_path << endl;
+        build_mapgraph(options);
     }
     catch (runtime_error &e)
     {
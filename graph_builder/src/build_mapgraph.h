@@ -7,7 +7,81 @@
 #ifndef GRAPH_BUILDER_BUILD_MAPGRAPH_H
 #define GRAPH_BUILDER_BUILD_MAPGRAPH_H
 
+#include <string>
+#include <vector>
+#include <utility>
+
+/* Stores the options of a build, from the menu or from command line flags.
+ * Fields: vector<pair<unsigned, unsigned>> variants: (k, l) of each variant, preprocessed concurrently. The first one
+ *                                                   is written with the graph, each one as overlay if there are more
+ *         string partition_scheme: grid / inertial-flow, see IMS::Partition::partition_scheme_t
+ *         string checkpoint_dir: directory of stage checkpoints, empty for no checkpoints
+ *         unsigned num_of_threads: threads for preprocessing, 0 for all cores
+ *         bool is_checkpoint_kept: keep checkpoints after a successful build
+ *         bool is_precise_heuristic: also store boundary distances of the first variant, see
+ *                                    MapGraph::preprocess_boundary_distances
+ *         string changes_file_path: edge changes applied to graph_file_path instead of building from PBF file,
+ *                                   see MapGraph::read_edge_changes
+ *         string profiles_file_path: weight profiles set to graph_file_path instead of building from PBF file,
+ *                                    see MapGraph::read_weight_profiles
+ *         unsigned max_trip_minutes: routes up to this long are optimal with the weight profiles, see
+ *                                    MapGraph::set_weight_profiles
+ *         string history_file_path: travel time history turned into travel time functions of graph_file_path
+ *                                   instead of building from PBF file, see MapGraph::read_travel_time_history
+ *         unsigned function_interval: minutes between breakpoints of travel time functions
+ *         string synthetic_graph: <grid|random>:<number of nodes>, a synthetic road graph is built instead of the PBF
+ *                                 file, see IMS::SyntheticGraph::parse_options
+ *         unsigned synthetic_seed: seed of the synthetic road graph
+ */
+struct build_options_t
+{
+    std::string pbf_file_path;
+    std::vector< std::pair<unsigned, unsigned> > variants;
+    std::string output_file_path = "HK.graph";
+    std::string output_format = "text";
+    bool is_renumbered = false;
+    std::string partition_scheme = "grid";
+    std::string checkpoint_dir;
+    unsigned num_of_threads = 0;
+    bool is_checkpoint_kept = false;
+    bool is_precise_heuristic = false;
+    std::string changes_file_path;
+    std::string profiles_file_path;
+    unsigned max_trip_minutes = 180; // IMS::Preprocess::MAX_TRIP_DURATION
+    std::string history_file_path;
+    unsigned function_interval = 15;
+    std::string synthetic_graph;
+    unsigned synthetic_seed = 42;
+    std::string graph_file_path;
+};
+
+/* Stores the report of a build stage. Times are in milliseconds, memory in KiB.
+ * Fields: bool is_resumed: stage result is read from a checkpoint
+ *         long rss: resident memory after the stage
+ *         long peak_rss: peak resident memory of the process so far
+ */
+struct stage_report_t
+{
+    std::string stage;
+    bool is_resumed = false;
+    double time = 0;
+    long rss = 0;
+    long peak_rss = 0;
+};
+
 void build_mapgraph_entrance();
 
+std::vector<stage_report_t> build_mapgraph(const build_options_t &options);
+
+std::vector<stage_report_t> update_mapgraph(const build_options_t &options);
+
+std::vector<stage_report_t> profile_mapgraph(const build_options_t &options);
+
+std::vector<stage_report_t> build_travel_time_functions(const build_options_t &options);
+
+std::string get_overlay_file_path(const build_options_t &options, const std::pair<unsigned, unsigned> &variant);
+
+bool parse_build_arguments(const int &argc, char ** argv, build_options_t &options);
+
 
 #endif //GRAPH_BUILDER_BUILD_MAPGRAPH_H
@@ -0,0 +1,61 @@
+/*
+ * Module for option of converting a serialized text MapGraph file into the memory-mapped binary graph file.
+ * Libraries: Boost.Serialization
+ * Version: 1.0
+ * Author: Terence Chow
+ */
+
+#include <iostream>
+#include <string>
+#include <chrono>
+
+#include "ims/map_graph.h"
+
+#include "convert_graph_file.h"
+
+using namespace std;
+
+/*
+ * Entrance of module from external source.
+ * Prompts user input for text file path and binary file path, converts and maps the binary file back for checking.
+ *
+ * Parameters: NIL
+ * Return: When conversion is done.
+ */
+void convert_graph_file_entrance()
+{
+    string input_file_path;
+    string output_file_path;
+
+    cout << "Text MapGraph file path: ";
+    getline(cin, input_file_path);
+    cout << "Binary graph file path: ";
+    getline(cin, output_file_path);
+
+    try
+    {
+        cout << "Deserializing text file..." << endl;
+        auto start = chrono::steady_clock::now();
+        auto graph = IMS::MapGraph::deserialize_and_initialize(input_file_path);
+        auto deserialized = chrono::steady_clock::now();
+
+        cout << "Writing binary graph file..." << endl;
+        graph->serialize_binary(output_file_path);
+        delete graph;
+
+        cout << "Mapping binary graph file..." << endl;
+        auto mapping = chrono::steady_clock::now();
+        graph = IMS::MapGraph::map_and_initialize(output_file_path);
+        auto mapped = chrono::steady_clock::now();
+        delete graph;
+
+        cout << "Graph file stored at " << output_file_path << endl;
+        cout << "Initial time | Text: " << chrono::duration<double, milli>(deserialized - start).count() << " ms"
+             << " | Binary: " << chrono::duration<double, milli>(mapped - mapping).count() << " ms" << endl;
+    }
+    catch (runtime_error &e)
+    {
+        /* Catch exceptions thrown from deserialization or writing procedures */
+        cout << e.what() << endl;
+    }
+}
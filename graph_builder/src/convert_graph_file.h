@@ -0,0 +1,12 @@
+/*
+ * Header file for convert_graph_file module.
+ * Version: 1.0
+ * Author: Terence Chow
+ */
+
+#ifndef GRAPH_BUILDER_CONVERT_GRAPH_FILE_H
+#define GRAPH_BUILDER_CONVERT_GRAPH_FILE_H
+
+void convert_graph_file_entrance();
+
+#endif //GRAPH_BUILDER_CONVERT_GRAPH_FILE_H
@@ -1,6 +1,7 @@
 /*
  * Driver program for the Graph Builder applet.
  * Provides user menu for graph building and serializing, and testing of created file.
+ * With command line flags, builds a MapGraph without the menu, see parse_build_arguments.
  * Version: 1.0
  * Author: Terence Chow
  */
@@ -9,12 +10,14 @@
 
 #include "build_mapgraph.h"
 #include "test_serialized_file.h"
+#include "convert_graph_file.h"
 
 using namespace std;
 
 const int BUILD_GRAPH_OPTION = 1;
 const int TEST_FILE_OPTION = 2;
-const int EXIT_OPTION = 3;
+const int CONVERT_FILE_OPTION = 3;
+const int EXIT_OPTION = 4;
 
 
 /*
@@ -25,17 +28,53 @@ void print_menu()
     cout << "╔══════════════════IMS Graph Builder═════════════════════════╗" << endl;
     cout << "║ 1: Preprocess MapGraph from PBF file and serialize to file ║" << endl;
     cout << "║ 2: Test serialized file                                    ║" << endl;
-    cout << "║ 3: Exit                                                    ║" << endl;
+    cout << "║ 3: Convert text MapGraph file to binary graph file         ║" << endl;
+    cout << "║ 4: Exit                                                    ║" << endl;
     cout << "╚════════════════════════════════════════════════════════════╝" << endl;
     cout << "Selection: ";
 }
 
 
-int main()
+int main(int argc, char ** argv)
 {
     bool exit = false;
     int selection;
 
+    if(argc > 1)
+    {
+        /* Non-interactive build */
+        build_options_t options;
+        if(!parse_build_arguments(argc, argv, options))
+        {
+            return 1;
+        }
+        try
+        {
+            if(!options.changes_file_path.empty())
+            {
+                update_mapgraph(options);
+            }
+            else if(!options.profiles_file_path.empty())
+            {
+                profile_mapgraph(options);
+            }
+            else if(!options.history_file_path.empty())
+            {
+                build_travel_time_functions(options);
+            }
+            else
+            {
+                build_mapgraph(options);
+            }
+        }
+        catch (exception &e)
+        {
+            cout << e.what() << endl;
+            return 1;
+        }
+        return 0;
+    }
+
     do
     {
         /* Main UI loop */
@@ -54,6 +93,10 @@ int main()
                 compare_serialized_graph();
                 break;
 
+            case CONVERT_FILE_OPTION:
+                convert_graph_file_entrance();
+                break;
+
             case EXIT_OPTION:
                 exit = true;
                 break;
@@ -0,0 +1,150 @@
+/*
+ * Header file for CompressedGraph.
+ * Compact read-only form of the MapGraph arrays for large regions. Heads are delta / varint encoded in blocks of nodes,
+ * coordinates are quantized per block, travel times and distances are 16-bit with an overflow table.
+ * Libraries:
+ * Version: 1.0
+ * Author: Terence Chow
+ */
+
+#ifndef IMS_CPP_COMPRESSED_GRAPH_H
+#define IMS_CPP_COMPRESSED_GRAPH_H
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include "mapped_array.h"
+
+using namespace std;
+
+namespace IMS
+{
+
+/* Edge IDs are the same as in the uncompressed graph: outward edges of a node are consecutive.
+ * Block b holds nodes [b * BLOCK_SIZE, (b + 1) * BLOCK_SIZE), encoded from block_offset[b] in head_data as
+ *   for each node: varint degree, then zigzag varint of (head - previous head), previous head starts at the node.
+ * Locality of node IDs (partition order) keeps the deltas small.
+ */
+class CompressedGraph
+{
+private:
+    static const unsigned BLOCK_SIZE = 16;
+    static const uint16_t OVERFLOW_MARK = 0xFFFF;
+    static constexpr double MIN_COORDINATE_SCALE = 1e-6; // degree, finer than float at HK longitudes
+
+    unsigned num_of_nodes = 0;
+    unsigned num_of_edges = 0;
+
+    // Adjacency
+    vector<uint32_t> block_offset;
+    vector<uint32_t> block_first_edge;
+    vector<uint8_t> head_data;
+
+    // Coordinates: base + offset * scale of the block
+    vector<float> block_latitude;
+    vector<float> block_longitude;
+    vector<float> block_latitude_scale;
+    vector<float> block_longitude_scale;
+    vector<uint16_t> latitude_offset;
+    vector<uint16_t> longitude_offset;
+
+    // Edge weights, OVERFLOW_MARK -> look up (edge, value) in the sorted overflow table
+    vector<uint16_t> travel_time;
+    vector<pair<unsigned, unsigned> > travel_time_overflow;
+    vector<uint16_t> geo_distance;
+    vector<pair<unsigned, unsigned> > geo_distance_overflow;
+
+    static unsigned decode_varint(const uint8_t * &data)
+    {
+        unsigned value = *data & 0x7F;
+        unsigned shift = 7;
+        while(*data++ & 0x80)
+        {
+            value |= (unsigned) (*data & 0x7F) << shift;
+            shift += 7;
+        }
+        return value;
+    }
+
+    static unsigned find_overflow(const vector<pair<unsigned, unsigned> > &overflow, const unsigned &edge)
+    {
+        return lower_bound(overflow.begin(), overflow.end(), make_pair(edge, 0u))->second;
+    }
+
+public:
+    CompressedGraph(const MappedArray<float> &latitude, const MappedArray<float> &longitude,
+                    const MappedArray<unsigned> &head, const MappedArray<unsigned> &first_out,
+                    const MappedArray<unsigned> &default_travel_time, const MappedArray<unsigned> &geo_distance);
+
+    /* Call visit(edge, head) for each outward edge of node, in edge ID order.
+     * Parameter(s): const unsigned & node
+     *               Function visit
+     * Returns: when all outward edges are visited
+     */
+    template<class Function>
+    void for_each_out_edge(const unsigned &node, Function visit) const
+    {
+        const unsigned block = node / BLOCK_SIZE;
+        const uint8_t * data = head_data.data() + block_offset[block];
+        unsigned edge = block_first_edge[block];
+
+        // Skip preceding nodes of the block
+        for(unsigned skipped = block * BLOCK_SIZE; skipped < node; skipped++)
+        {
+            unsigned degree = decode_varint(data);
+            edge += degree;
+            for(unsigned i = 0; i < degree; data++)
+            {
+                i += (*data & 0x80) == 0;
+            }
+        }
+
+        unsigned degree = decode_varint(data);
+        unsigned previous_head = node;
+        for(unsigned i = 0; i < degree; i++)
+        {
+            unsigned zigzag = decode_varint(data);
+            previous_head += (zigzag >> 1) ^ -(zigzag & 1);
+            visit(edge + i, previous_head);
+        }
+    }
+
+    unsigned get_num_of_nodes() const
+    {
+        return num_of_nodes;
+    }
+
+    unsigned get_num_of_edges() const
+    {
+        return num_of_edges;
+    }
+
+    float get_latitude(const unsigned &node) const
+    {
+        const unsigned block = node / BLOCK_SIZE;
+        return block_latitude[block] + latitude_offset[node] * block_latitude_scale[block];
+    }
+
+    float get_longitude(const unsigned &node) const
+    {
+        const unsigned block = node / BLOCK_SIZE;
+        return block_longitude[block] + longitude_offset[node] * block_longitude_scale[block];
+    }
+
+    unsigned get_travel_time(const unsigned &edge) const
+    {
+        return travel_time[edge] != OVERFLOW_MARK? travel_time[edge] : find_overflow(travel_time_overflow, edge);
+    }
+
+    unsigned get_geo_distance(const unsigned &edge) const
+    {
+        return geo_distance[edge] != OVERFLOW_MARK? geo_distance[edge] : find_overflow(geo_distance_overflow, edge);
+    }
+
+    size_t get_memory_usage() const;
+};
+
+}
+
+#endif //IMS_CPP_COMPRESSED_GRAPH_H
@@ -0,0 +1,127 @@
+/*
+ * Header file for DensityTable.
+ * Sparse per-edge density: an edge only gets its critical change times once a routed vehicle is injected into it.
+ * Libraries:
+ * Version: 1.0
+ * Author: Terence Chow
+ */
+
+#ifndef IMS_CPP_DENSITY_TABLE_H
+#define IMS_CPP_DENSITY_TABLE_H
+
+#include <ctime>
+#include <map>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+namespace IMS
+{
+
+/* Table of edge ID -> critical change time -> density. Edges without a vehicle have no entry and density 0.
+ * An entry starts with density 0 at time 0, as the dense table of every edge used to.
+ * NOT thread safe, owner must lock.
+ */
+class DensityTable
+{
+private:
+    vector< unique_ptr< map<time_t, double> > > densities;
+    size_t num_of_allocated = 0;
+
+public:
+    /* Set the number of edges, entries of edges beyond it are released */
+    void resize(const size_t &num_of_edges)
+    {
+        for(size_t edge = num_of_edges; edge < densities.size(); edge++)
+        {
+            release(edge);
+        }
+        densities.resize(num_of_edges);
+    }
+
+    /* Move entries to new edge IDs, e.g. after edges are added or removed.
+     * Parameter(s): const vector<unsigned> & new_edge: new ID of each current edge, num_of_edges or more if the edge
+     *                                                 is removed, its entry is released
+     *               const size_t & num_of_edges: new number of edges
+     * Returns: when the entries are moved
+     */
+    void remap(const vector<unsigned> &new_edge, const size_t &num_of_edges)
+    {
+        vector< unique_ptr< map<time_t, double> > > remapped(num_of_edges);
+        for(size_t edge = 0; edge < densities.size(); edge++)
+        {
+            if(!densities[edge])
+            {
+                continue;
+            }
+            if(new_edge[edge] < num_of_edges)
+            {
+                remapped[new_edge[edge]] = move(densities[edge]);
+            }
+            else
+            {
+                num_of_allocated--;
+            }
+        }
+        densities.swap(remapped);
+    }
+
+    /* Release all entries and the table */
+    void clear()
+    {
+        vector< unique_ptr< map<time_t, double> > >().swap(densities);
+        num_of_allocated = 0;
+    }
+
+    size_t size() const
+    {
+        return densities.size();
+    }
+
+    /* Density of the edge for writing, allocated on first access.
+     * Parameter(s): const size_t & edge
+     * Returns: map<time_t, double> &: critical change time -> density
+     */
+    map<time_t, double> & operator[](const size_t &edge)
+    {
+        if(!densities[edge])
+        {
+            densities[edge].reset(new map<time_t, double>());
+            (*densities[edge])[0] = 0;
+            num_of_allocated++;
+        }
+        return *densities[edge];
+    }
+
+    /* Density of the edge for reading.
+     * Parameter(s): const size_t & edge
+     * Returns: const map<time_t, double> *: nullptr if the edge has density 0 all the time
+     */
+    const map<time_t, double> * find(const size_t &edge) const
+    {
+        return densities[edge].get();
+    }
+
+    /* Drop the entry of an edge, e.g. after the last vehicle on it is removed.
+     * Parameter(s): const size_t & edge
+     * Returns: when the entry is released
+     */
+    void release(const size_t &edge)
+    {
+        if(densities[edge])
+        {
+            densities[edge].reset();
+            num_of_allocated--;
+        }
+    }
+
+    size_t get_num_of_allocated() const
+    {
+        return num_of_allocated;
+    }
+};
+
+}
+
+#endif //IMS_CPP_DENSITY_TABLE_H
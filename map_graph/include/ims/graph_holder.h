@@ -0,0 +1,110 @@
+/*
+ * Header file for GraphHolder
+ * Libraries:
+ * Version: 1.0
+ * Author: Terence Chow
+ */
+
+#ifndef IMS_CPP_GRAPH_HOLDER_H
+#define IMS_CPP_GRAPH_HOLDER_H
+
+#include <string>
+#include <memory>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/shared_mutex.hpp>
+
+#include "map_graph.h"
+#include "incident_manager.h"
+#include "path_manager.h"
+#include "incident_feed.h"
+#include "router.h"
+
+using namespace std;
+
+namespace IMS
+{
+
+/* Stores a MapGraph with the live state kept on its edge IDs. Deleted with all its members
+ * when the last handle to it is released.
+ * Fields: unsigned version: 1 for the graph loaded at startup, incremented on each reload
+ *         string file_path: file the graph is loaded from
+ */
+struct graph_context_t
+{
+    unsigned version = 1;
+    string file_path;
+    IMS::MapGraph * map_graph = nullptr;
+    IMS::IncidentManager * incident_manager = nullptr;
+    IMS::PathManager * path_manager = nullptr;
+    IMS::Router * router = nullptr;
+
+    ~graph_context_t();
+};
+
+typedef shared_ptr<graph_context_t> graph_handle_t;
+
+/* Stores the outcome of a reload. Times are in milliseconds. */
+struct reload_report_t
+{
+    bool is_reloading = false;
+    bool is_successful = false;
+    string error;
+    string file_path;
+    unsigned version = 0;
+    unsigned num_of_nodes_matched = 0;
+    unsigned num_of_nodes_unmatched = 0;
+    unsigned num_of_edges_matched = 0;
+    unsigned num_of_edges_unmatched = 0;
+    unsigned num_of_incidents_migrated = 0;
+    unsigned num_of_incidents_dropped = 0;
+    unsigned num_of_paths_migrated = 0;
+    unsigned num_of_paths_dropped = 0;
+    double loading_time = 0;
+    double matching_time = 0;
+    double migrating_time = 0; // updates are paused for this long
+    double total_time = 0;
+};
+
+/* Serves the current graph context and replaces it on reload without stopping the server.
+ * Queries acquire a handle and use it until they are done, a reload swaps in the new context atomically
+ * and the old one is deleted when its last handle is released.
+ * Queries which update live state (paths, incidents) take the update access in shared mode before acquiring,
+ * so that no update is lost while the state is migrated.
+ */
+class GraphHolder
+{
+private:
+    const float MATCHING_RADIUS = 1; // meter
+
+    graph_handle_t current; // read and replaced with atomic_load / atomic_store only
+    boost::shared_mutex update_access;
+    boost::mutex reload_access; // guards is_reloading and last_report
+    bool is_reloading = false;
+    reload_report_t last_report;
+    IMS::IncidentFeed * incident_feed;
+    bool is_compressed;
+    string function_file_path;
+
+    bool begin_reload(const string &file_path);
+    reload_report_t do_reload(const string &file_path);
+
+public:
+    GraphHolder(const string &file_path, IMS::MapGraph * mg, IMS::IncidentManager * im, IMS::PathManager * pm,
+                IMS::IncidentFeed * incident_feed = nullptr, const bool &is_compressed = false,
+                const string &function_file_path = "");
+
+    graph_handle_t acquire() const;
+    boost::shared_mutex & get_update_access();
+
+    /* Reloading */
+    reload_report_t reload(const string &file_path);
+    bool reload_in_background(const string &file_path);
+    reload_report_t get_reload_report();
+};
+
+}
+
+
+#endif //IMS_CPP_GRAPH_HOLDER_H
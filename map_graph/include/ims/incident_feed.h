@@ -0,0 +1,95 @@
+/*
+ * Header file for IncidentFeed
+ * Libraries:
+ * Version: 1.0
+ * Author: Terence Chow
+ */
+
+#ifndef IMS_CPP_INCIDENT_FEED_H
+#define IMS_CPP_INCIDENT_FEED_H
+
+#include <ctime>
+#include <string>
+#include <vector>
+#include <istream>
+#include <unordered_map>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "map_graph.h"
+#include "incident_manager.h"
+
+using namespace std;
+
+namespace IMS
+{
+
+/* Stores an incident record from a feed
+ * Fields: string key: ID of the incident in the feed
+ *         float longitude, latitude
+ *         unsigned impact: impact on travelling time in milliseconds
+ *         time_t start_time, end_time: validity window in milliseconds
+ */
+struct feed_incident_t
+{
+    string key;
+    float longitude;
+    float latitude;
+    unsigned impact;
+    time_t start_time;
+    time_t end_time;
+};
+
+/* Stores statistics of an ingested batch. Times are in milliseconds. */
+struct ingestion_report_t
+{
+    unsigned num_of_received = 0;
+    unsigned num_of_added = 0;
+    unsigned num_of_removed = 0;
+    unsigned num_of_unchanged = 0;
+    unsigned num_of_unlocated = 0;
+    double snapping_time = 0;
+    double applying_time = 0;
+    double total_time = 0;
+};
+
+class IncidentFeed
+{
+private:
+    /* Stores a live incident of the feed
+     * Fields: unsigned incident_id: ID in IncidentManager
+     *         feed_incident_t record: record it is created from
+     */
+    struct live_incident_t
+    {
+        unsigned incident_id;
+        feed_incident_t record;
+    };
+
+    boost::mutex access;
+    IMS::MapGraph * map_graph;
+    IMS::IncidentManager * incident_manager;
+    float offset;
+    unsigned num_of_threads;
+    unordered_map<string, live_incident_t> live_incidents;
+
+    ingestion_report_t ingest(const vector<feed_incident_t> &upserts, const vector<string> &removed_keys);
+
+public:
+    IncidentFeed(IMS::MapGraph * mg, IMS::IncidentManager * im, const float &offset, unsigned num_of_threads = 0);
+
+    ingestion_report_t ingest_snapshot(const vector<feed_incident_t> &snapshot);
+    ingestion_report_t ingest_updates(const vector<feed_incident_t> &upserts, const vector<string> &removed_keys);
+    unsigned consume(istream &feed);
+
+    /* Reloading */
+    void lock();
+    void unlock();
+    unsigned rebind(IMS::MapGraph * mg, IMS::IncidentManager * im);
+};
+
+}
+
+
+#endif //IMS_CPP_INCIDENT_FEED_H
@@ -8,12 +8,16 @@
 #ifndef IMS_CPP_INCIDENTS_H
 #define IMS_CPP_INCIDENTS_H
 
+#include <ctime>
+#include <climits>
+#include <vector>
 #include <unordered_map>
-#include <unordered_set>
 
 #include <boost/thread/thread.hpp>
 #include <boost/thread/shared_mutex.hpp>
 
+#include "timer_wheel.h"
+
 using namespace std;
 
 namespace IMS
@@ -22,15 +26,84 @@ namespace IMS
 class IncidentManager
 {
 private:
+    const unsigned NO_WINDOW = UINT_MAX;
+    const unsigned EXPIRY_TICK = 60000; // 1 minute in milliseconds
+    const unsigned EXPIRY_SLOTS = 256;
+
+    /* Stores an incident
+     * Fields: unsigned impact: impact on travelling time in milliseconds
+     *         time_t start_time, end_time: validity window [start_time, end_time) in milliseconds
+     *         vector<unsigned> affected_edges: distinct edges affected
+     *         vector<unsigned> windows: window of each affected edge, empty if the incident is unbounded
+     */
+    struct incident_t
+    {
+        unsigned impact;
+        time_t start_time;
+        time_t end_time;
+        vector<unsigned> affected_edges;
+        vector<unsigned> windows;
+    };
+
+    /* Stores the validity window of an incident on one edge, chained per edge
+     * Fields: time_t start_time, end_time
+     *         double impact
+     *         unsigned next: next window of the same edge, or next free window, NO_WINDOW if none
+     */
+    struct window_t
+    {
+        time_t start_time;
+        time_t end_time;
+        double impact;
+        unsigned next;
+    };
+
     boost::shared_mutex access;
     unsigned num_of_incident = 0;
-    unordered_map<unsigned, unsigned> incidents;
-    unordered_map<unsigned, unordered_set<unsigned> > affected_roads;
+    unordered_map<unsigned, incident_t> incidents;
+    // Aggregated impact of all unbounded incidents on each edge, vector id = edge ID
+    vector<double> edge_impact;
+    // First window of time-windowed incidents on each edge, vector id = edge ID
+    vector<unsigned> edge_first_window;
+    // Window pool, released windows are reused through free_window
+    vector<window_t> windows;
+    unsigned free_window = NO_WINDOW;
+    IMS::TimerWheel<unsigned> expiry_wheel;
+
+    unsigned insert_incident(vector<unsigned> &affected_edges, unsigned impact, time_t start_time, time_t end_time);
+    void erase_incident(unordered_map<unsigned, incident_t>::iterator incident);
 
 public:
-    unsigned add_incident(vector<unsigned> affected_edges, unsigned impact);
+    static const time_t NO_END_TIME = LONG_MAX;
+
+    /* Stores an incident to be added in a batch
+     * Fields: vector<unsigned> affected_edges
+     *         unsigned impact: impact on travelling time in milliseconds
+     *         time_t start_time, end_time: validity window in milliseconds
+     */
+    struct new_incident_t
+    {
+        vector<unsigned> affected_edges;
+        unsigned impact;
+        time_t start_time;
+        time_t end_time;
+    };
+
+    IncidentManager(unsigned num_of_edges = 0)
+            : edge_impact(num_of_edges, 0), edge_first_window(num_of_edges, NO_WINDOW),
+              expiry_wheel(EXPIRY_TICK, EXPIRY_SLOTS) {};
+
+    unsigned add_incident(vector<unsigned> affected_edges, unsigned impact,
+                          time_t start_time = 0, time_t end_time = NO_END_TIME);
     unsigned remove_incident(unsigned incident_id);
-    double get_total_incident_impact(unsigned edge_id);
+    vector<unsigned> apply_incidents(vector<new_incident_t> &additions, const vector<unsigned> &removals);
+    unsigned purge_expired_incidents(const time_t &now);
+    double get_total_incident_impact(unsigned edge_id, time_t enter_time);
+    bool has_incident(unsigned incident_id);
+    unsigned get_num_of_incidents();
+
+    /* Reloading */
+    IncidentManager * migrate(const vector<unsigned> &new_edge_id, unsigned num_of_edges);
 };
 
 }
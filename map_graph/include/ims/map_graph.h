@@ -12,6 +12,8 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <cstdint>
+#include <climits>
 
 #include <boost/thread/thread.hpp>
 #include <boost/thread/shared_mutex.hpp>
@@ -19,10 +21,16 @@
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/serialization/vector.hpp>
 #include <boost/serialization/map.hpp>
+#include <boost/serialization/split_free.hpp>
+#include <boost/serialization/version.hpp>
 #include <routingkit/geo_position_to_node.h>
 
+#include "mapped_array.h"
+#include "density_table.h"
+#include "compressed_graph.h"
 #include "../src/partition.h"
 #include "../src/preprocess.h"
+#include "../src/travel_time_function.h"
 
 using namespace std;
 
@@ -40,7 +48,58 @@ namespace IMS
     {
         vector<unsigned> head;
         vector<unsigned> first_out;
-        map<unsigned, unsigned> relative_edge;
+        vector<unsigned> relative_edge; // relative_edge[inversed edge ID] = edge ID in MapGraph
+    };
+
+    /* Old -> new IDs after renumbering or matching, e.g. for translating IDs kept outside the MapGraph */
+    struct Renumbering
+    {
+        vector<unsigned> new_node_id; // new_node_id[old node ID]
+        vector<unsigned> new_edge_id; // new_edge_id[old edge ID]
+
+        template<class Archive>
+        void serialize(Archive & archive, const unsigned int version)
+        {
+            archive & new_node_id;
+            archive & new_edge_id;
+        }
+    };
+
+    /* Stores a change of the edges between two nodes, see MapGraph::apply_edge_changes
+     * Fields: unsigned travel_time: milliseconds, of added and retimed edges
+     *         unsigned geo_distance: meter, of added edges
+     */
+    struct edge_change_t
+    {
+        enum change_type_t { ADD, REMOVE, RETIME };
+        change_type_t type;
+        unsigned from;
+        unsigned to;
+        unsigned travel_time = 0;
+        unsigned geo_distance = 0;
+    };
+
+    /* Stores the outcome of MapGraph::apply_edge_changes. Time is in milliseconds. */
+    struct update_report_t
+    {
+        unsigned num_of_edges_added = 0;
+        unsigned num_of_edges_removed = 0;
+        unsigned num_of_edges_retimed = 0;
+        unsigned num_of_boundaries_changed = 0; // partitions with a node added to or removed from a boundary
+        unsigned num_of_entries_recomputed = 0;
+        unsigned num_of_entries = 0;
+        double edge_time = 0; // applying changes to the arrays and the inverse
+        double preprocess_time = 0;
+    };
+
+    /* Time taken by each stage of MapGraph::initialize(), in milliseconds. Stages run in parallel. */
+    struct initialization_timing_t
+    {
+        double density_time = 0;
+        double inverse_time = 0;
+        double geo_index_time = 0;
+        double distance_table_time = 0; // flattening of tables read from text archive
+        double total_time = 0;
     };
 
     class MapGraph
@@ -48,54 +107,219 @@ namespace IMS
     private:
         boost::shared_mutex access;
 
+        // Binary graph file mapped by map_and_initialize, arrays view it in place
+        void * mapped_file = nullptr;
+        size_t mapped_file_size = 0;
+        // Travel time function file mapped by load_travel_time_functions
+        void * mapped_functions_file = nullptr;
+        size_t mapped_functions_file_size = 0;
+
+        void unload_travel_time_functions();
+        void subtract_impact_of_routed_path(IMS::Path * path, vector<unsigned> * touched_edges = NULL);
+        void compact_density(const unsigned &edge, const time_t &before);
+
     public:
-        vector<float> latitude;
-        vector<float> longitude;
-        vector<unsigned> head;
-        vector<unsigned> first_out;
-        vector<unsigned> geo_distance; // meter
-        vector<unsigned> default_travel_time; // milliseconds
-        InversedGraph* inversed;
+        MappedArray<float> latitude;
+        MappedArray<float> longitude;
+        MappedArray<unsigned> head;
+        MappedArray<unsigned> first_out;
+        MappedArray<unsigned> geo_distance; // meter
+        MappedArray<unsigned> default_travel_time; // milliseconds
+        InversedGraph* inversed = nullptr;
         RoutingKit::GeoPositionToNode map_geo_position; // Reversed geocoding index
+        // Replaces latitude, longitude, head, first_out, default_travel_time, geo_distance and inversed after compress()
+        IMS::CompressedGraph* compressed = nullptr;
 
-        // Preprocessed data
-        IMS::Partition::layer_t* layers;
-        IMS::Preprocess::distance_table_t* distance_tables;
+        // Preprocessed data, layers and distance_tables are only kept by graphs built or read from text archive
+        IMS::Partition::layer_t* layers = nullptr;
+        IMS::Preprocess::distance_table_t* distance_tables = nullptr;
+        IMS::Preprocess::flat_distance_table_t* flat_distance_tables = nullptr; // Used for routing
+        // Optional, tightens the heuristic of routing, see preprocess_boundary_distances
+        IMS::Preprocess::boundary_distance_table_t* boundary_distances = nullptr;
+        // Optional, travel time and heuristic by time of day, see set_weight_profiles
+        IMS::Preprocess::weight_profile_table_t* weight_profiles = nullptr;
+        // Optional, historical travel time by time of day from a side file, see load_travel_time_functions
+        IMS::TravelTimeFunction::travel_time_function_table_t* travel_time_functions = nullptr;
 
         // Density related
-        // current_density: vector id = edge ID, map key = critical change time, map value = density
-        vector< map<time_t, double> > current_density;
+        // current_density: edge ID -> map key = critical change time, map value = density
+        // Allocated on first injection, edges never routed through have no entry
+        DensityTable current_density;
         // Max Density = 1 / avg. car length = 1 / 5
         const double max_density = 0.2;
+        // Graphs with fewer edges are inversed in one thread
+        static const unsigned PARALLEL_INVERSE_MIN_EDGES = 100000;
+        // Weight profile of the default travel time, see find_weight_profile
+        static const unsigned NO_PROFILE = UINT_MAX;
+        initialization_timing_t initialization_timing;
 
         /* Destructor */
         ~MapGraph();
 
         /* Initialize dynamic fields: current_density, inversed, map_geo_location */
-        void initialize();
+        initialization_timing_t initialize();
 
-        /* Initialize from deserialization */
+        const initialization_timing_t & get_initialization_timing() const
+        {
+            return initialization_timing;
+        }
+
+        /* Initialize from deserialization, of binary graph file or text archive */
         static MapGraph * deserialize_and_initialize(const string &input_file_path)
         {
+            if(is_binary_file(input_file_path))
+            {
+                return map_and_initialize(input_file_path);
+            }
+
             auto graph = new MapGraph();
             ifstream ifs(input_file_path);
             boost::archive::text_iarchive input_archive_stream(ifs);
             input_archive_stream >> *graph;
             ifs.close();
 
-            graph->initialize();
+            try
+            {
+                graph->initialize();
+            }
+            catch (...)
+            {
+                delete graph;
+                throw;
+            }
 
             return graph;
         }
 
+        /* Initialize from memory-mapped binary graph file */
+        static bool is_binary_file(const string &input_file_path);
+        static MapGraph * map_and_initialize(const string &input_file_path, const bool &verify_checksum = true);
+
         /* Serialization*/
         void serialize(const string& output_file_path);
+        void serialize_binary(const string& output_file_path) const;
+
+        /* Compression, after initialize and before serving */
+        void compress();
+
+        /* Graph access, from the arrays or the compressed graph */
+        unsigned get_num_of_nodes() const
+        {
+            return compressed != nullptr? compressed->get_num_of_nodes() : first_out.size();
+        }
+
+        unsigned get_num_of_edges() const
+        {
+            return compressed != nullptr? compressed->get_num_of_edges() : head.size();
+        }
+
+        float get_latitude(const unsigned &node) const
+        {
+            return compressed != nullptr? compressed->get_latitude(node) : latitude[node];
+        }
+
+        float get_longitude(const unsigned &node) const
+        {
+            return compressed != nullptr? compressed->get_longitude(node) : longitude[node];
+        }
+
+        unsigned get_travel_time(const unsigned &edge) const
+        {
+            return compressed != nullptr? compressed->get_travel_time(edge) : default_travel_time[edge];
+        }
+
+        /* Base travel time of an edge entered at a time (ms), of its travel time function if loaded, else of the
+         * weight profile applying then if any */
+        unsigned get_travel_time(const unsigned &edge, const time_t &enter_time) const
+        {
+            if(travel_time_functions != nullptr)
+            {
+                return travel_time_functions->evaluate(edge, get_travel_time(edge), enter_time);
+            }
+            if(weight_profiles == nullptr)
+            {
+                return get_travel_time(edge);
+            }
+            return weight_profiles->get_travel_time(weight_profiles->find_profile(enter_time), edge);
+        }
+
+        /* Weight profile applying at a time (ms), NO_PROFILE without weight profiles or with travel time functions,
+         * which replace them */
+        unsigned find_weight_profile(const time_t &time) const
+        {
+            return weight_profiles != nullptr && travel_time_functions == nullptr?
+                   weight_profiles->find_profile(time) : NO_PROFILE;
+        }
+
+        unsigned get_geo_distance(const unsigned &edge) const
+        {
+            return compressed != nullptr? compressed->get_geo_distance(edge) : geo_distance[edge];
+        }
+
+        /* Call visit(edge, head) for each outward edge of node */
+        template<class Function>
+        void for_each_out_edge(const unsigned &node, Function visit) const
+        {
+            if(compressed != nullptr)
+            {
+                compressed->for_each_out_edge(node, visit);
+                return;
+            }
+            unsigned first_edge = first_out[node];
+            unsigned last_edge = (node == first_out.size() -1) ? (head.size()) : first_out[node + 1];
+            for (unsigned edge = first_edge; edge < last_edge; edge++)
+            {
+                visit(edge, head[edge]);
+            }
+        }
 
         /* Inverse */
-        InversedGraph* inverse();
+        InversedGraph* inverse(unsigned num_of_threads = 0);
+
+        /* Renumbering, before pre-processing, and matching to another graph */
+        Renumbering renumber_by_partition(const unsigned &k, const unsigned &l,
+                                          const IMS::Partition::partition_scheme_t &scheme
+                                          = IMS::Partition::GRID_PARTITION);
+        Renumbering renumber(const vector<unsigned> &order);
+        Renumbering match(MapGraph &other, const float &radius) const;
+
+        /* Pre-processing, in one call or by stage */
+        void preprocess(const unsigned &k, const unsigned &l, const unsigned &num_of_threads = 1,
+                        const IMS::Partition::partition_scheme_t &scheme = IMS::Partition::GRID_PARTITION);
+        IMS::Partition::partition_tree_t* partition(const unsigned &k, const unsigned &l,
+                                               const IMS::Partition::partition_scheme_t &scheme
+                                               = IMS::Partition::GRID_PARTITION);
+        void preprocess(IMS::Partition::partition_tree_t* partitions, const unsigned &num_of_threads = 1);
+        void build_preprocessed(IMS::Partition::partition_tree_t* partitions, const unsigned &num_of_threads,
+                                IMS::Partition::layer_t*& layers,
+                                IMS::Preprocess::distance_table_t*& distance_tables) const;
+        void set_preprocessed(IMS::Partition::layer_t* layers, IMS::Preprocess::distance_table_t* distance_tables);
+        void preprocess_boundary_distances(const IMS::Partition::partition_tree_t* partitions,
+                                           const unsigned &num_of_threads = 1);
+
+        /* Travel time profiles by time of day */
+        void set_weight_profiles(const vector<unsigned> &start_times, const vector< vector<unsigned> > &travel_times,
+                                 const int &utc_offset, const IMS::Partition::partition_tree_t* partitions,
+                                 const unsigned &num_of_threads = 1,
+                                 const unsigned &max_trip_duration = IMS::Preprocess::MAX_TRIP_DURATION);
+        void read_weight_profiles(const string &input_file_path, vector<unsigned> &start_times,
+                                  vector< vector<unsigned> > &travel_times, int &utc_offset);
+
+        /* Historical travel time functions, stored in a side file apart from the graph */
+        void load_travel_time_functions(const string &input_file_path);
+        void read_travel_time_history(const string &input_file_path,
+                                      vector< vector< pair<unsigned, unsigned> > > &samples, int &utc_offset);
 
-        /* Pre-processing */
-        void preprocess(const unsigned &k, const unsigned &l);
+        /* Incremental pre-processing after roads open, close or change travel time */
+        update_report_t apply_edge_changes(const vector<edge_change_t> &changes,
+                                           IMS::Partition::partition_tree_t* partitions = nullptr,
+                                           const unsigned &num_of_threads = 1);
+        static vector<edge_change_t> read_edge_changes(const string &input_file_path);
+
+        /* Preprocessed variants, stored as overlay files apart from the graph */
+        void load_overlay(const string &input_file_path);
+        void serialize_overlay(const string &output_file_path) const;
+        uint64_t get_checksum() const;
 
         /* Routing */
         unsigned find_edge(const unsigned &from, const unsigned &to);
@@ -104,6 +328,7 @@ namespace IMS
         /* Updating */
         void inject_impact_of_routed_path(IMS::Path * path);
         void remove_impact_of_routed_path(IMS::Path * path);
+        void remove_impact_of_routed_paths(const vector<IMS::Path *> &paths, const time_t &compact_before);
 
         /* Reverse Geocoding */
         vector<unsigned int> find_nearest_edge_of_location(const float &longi, const float &lat, const float &offset);
@@ -116,34 +341,88 @@ namespace IMS
 
 }
 
-/* Schema for serialization of MapGraph in Boost.Serialization */
+/* Schema for serialization of MapGraph in Boost.Serialization.
+ * Arrays are stored as vectors, layers and distance tables in their nested form.
+ */
 namespace boost
 {
 namespace serialization
 {
+template<class Archive, class T>
+void save_array(Archive &archive, const IMS::MappedArray<T> &array)
+{
+    const vector<T> elements = array.to_vector();
+    archive << elements;
+}
+
+template<class Archive, class T>
+void load_array(Archive &archive, IMS::MappedArray<T> &array)
+{
+    vector<T> elements;
+    archive >> elements;
+    array = std::move(elements);
+}
+
 template<class Archive>
-void serialize(Archive &archive, IMS::MapGraph &mapGraph, const unsigned int version)
+void save(Archive &archive, const IMS::MapGraph &mapGraph, const unsigned int version)
 {
+    if(mapGraph.compressed != nullptr)
+    {
+        throw runtime_error("Compressed MapGraph cannot be saved");
+    }
+    if(mapGraph.layers == nullptr || mapGraph.distance_tables == nullptr)
+    {
+        throw runtime_error("MapGraph read from binary graph file cannot be saved as text archive");
+    }
+
     /* Geo-location of nodes */
-    archive & mapGraph.longitude;
-    archive & mapGraph.latitude;
+    save_array(archive, mapGraph.longitude);
+    save_array(archive, mapGraph.latitude);
 
     /* Edges */
     /* Head node of each edge */
-    archive & mapGraph.head;
+    save_array(archive, mapGraph.head);
     /* ID of the first of the batch of outward edges from i (i = Tail node of edge) */
-    archive & mapGraph.first_out;
+    save_array(archive, mapGraph.first_out);
 
     /* Edge Information */
-    archive & mapGraph.default_travel_time;
-    archive & mapGraph.geo_distance;
+    save_array(archive, mapGraph.default_travel_time);
+    save_array(archive, mapGraph.geo_distance);
 
     /* Preprocessed Data */
-    archive & mapGraph.layers;
-    archive & mapGraph.distance_tables;
+    archive << mapGraph.layers;
+    archive << mapGraph.distance_tables;
+    /* Optional, since version 1 */
+    archive << mapGraph.boundary_distances;
+    /* Optional, since version 2 */
+    archive << mapGraph.weight_profiles;
 }
+
+template<class Archive>
+void load(Archive &archive, IMS::MapGraph &mapGraph, const unsigned int version)
+{
+    load_array(archive, mapGraph.longitude);
+    load_array(archive, mapGraph.latitude);
+    load_array(archive, mapGraph.head);
+    load_array(archive, mapGraph.first_out);
+    load_array(archive, mapGraph.default_travel_time);
+    load_array(archive, mapGraph.geo_distance);
+    archive >> mapGraph.layers;
+    archive >> mapGraph.distance_tables;
+    if(version >= 1)
+    {
+        archive >> mapGraph.boundary_distances;
+    }
+    if(version >= 2)
+    {
+        archive >> mapGraph.weight_profiles;
+    }
 }
 }
+}
+
+BOOST_SERIALIZATION_SPLIT_FREE(IMS::MapGraph)
+BOOST_CLASS_VERSION(IMS::MapGraph, 2)
 
 
 #endif  //CPP_SERVER_MAPGRAPH_H
@@ -0,0 +1,194 @@
+/*
+ * Header file for MappedArray.
+ * Array which either owns its elements in a vector or views elements in place, e.g. in a memory-mapped graph file.
+ * Libraries:
+ * Version: 1.0
+ * Author: Terence Chow
+ */
+
+#ifndef IMS_CPP_MAPPED_ARRAY_H
+#define IMS_CPP_MAPPED_ARRAY_H
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace IMS
+{
+
+/* Read access is the same in both modes.
+ * Modifying functions (assign, push_back, resize) copy viewed elements into an owned vector first.
+ * A viewed array must be materialized before it is passed as a vector, e.g. to partitioning and preprocessing.
+ */
+template<class T>
+class MappedArray
+{
+private:
+    vector<T> owned;
+    T * mapped_data = nullptr;
+    size_t mapped_size = 0;
+
+public:
+    MappedArray() {};
+    MappedArray(const vector<T> &elements) : owned(elements) {};
+
+    MappedArray & operator=(const vector<T> &elements)
+    {
+        unmap();
+        owned = elements;
+        return *this;
+    }
+
+    MappedArray & operator=(vector<T> &&elements)
+    {
+        unmap();
+        owned = move(elements);
+        return *this;
+    }
+
+    /* View size elements at data in place. The memory must outlive the array or the next modification.
+     * Parameter(s): T * data
+     *               const size_t & size
+     * Returns: when the array views the memory
+     */
+    void map(T * data, const size_t &size)
+    {
+        vector<T>().swap(owned);
+        mapped_data = data;
+        mapped_size = size;
+    }
+
+    bool is_mapped() const
+    {
+        return mapped_data != nullptr;
+    }
+
+    /* Copy viewed elements into an owned vector. No-op for an owned array.
+     * Parameter(s): NIL
+     * Returns: when the array owns its elements
+     */
+    void materialize()
+    {
+        if(is_mapped())
+        {
+            owned.assign(mapped_data, mapped_data + mapped_size);
+            unmap();
+        }
+    }
+
+    /* Owned elements as vector.
+     * Throws logic_error for a viewed array, which must be materialized first.
+     */
+    const vector<T> & get_vector() const
+    {
+        if(is_mapped())
+        {
+            throw logic_error("Memory-mapped array must be materialized before use as vector");
+        }
+        return owned;
+    }
+
+    operator const vector<T> &() const
+    {
+        return get_vector();
+    }
+
+    vector<T> to_vector() const
+    {
+        return vector<T>(begin(), end());
+    }
+
+    template<class InputIterator>
+    void assign(InputIterator first, InputIterator last)
+    {
+        unmap();
+        owned.assign(first, last);
+    }
+
+    void push_back(const T &element)
+    {
+        materialize();
+        owned.push_back(element);
+    }
+
+    void resize(const size_t &size, const T &element = T())
+    {
+        materialize();
+        owned.resize(size, element);
+    }
+
+    /* Remove all elements and release owned memory */
+    void clear()
+    {
+        unmap();
+        vector<T>().swap(owned);
+    }
+
+    size_t size() const
+    {
+        return is_mapped()? mapped_size : owned.size();
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    T * data()
+    {
+        return is_mapped()? mapped_data : owned.data();
+    }
+
+    const T * data() const
+    {
+        return is_mapped()? mapped_data : owned.data();
+    }
+
+    T & operator[](const size_t &i)
+    {
+        return data()[i];
+    }
+
+    const T & operator[](const size_t &i) const
+    {
+        return data()[i];
+    }
+
+    T * begin()
+    {
+        return data();
+    }
+
+    T * end()
+    {
+        return data() + size();
+    }
+
+    const T * begin() const
+    {
+        return data();
+    }
+
+    const T * end() const
+    {
+        return data() + size();
+    }
+
+    friend bool operator==(const MappedArray &array, const vector<T> &elements)
+    {
+        return array.size() == elements.size() && equal(array.begin(), array.end(), elements.begin());
+    }
+
+private:
+    void unmap()
+    {
+        mapped_data = nullptr;
+        mapped_size = 0;
+    }
+};
+
+}
+
+#endif //IMS_CPP_MAPPED_ARRAY_H
@@ -0,0 +1,62 @@
+/*
+ * Header file for PathManager
+ * Libraries:
+ * Version: 1.0
+ * Author: Terence Chow
+ */
+
+#ifndef IMS_CPP_PATH_MANAGER_H
+#define IMS_CPP_PATH_MANAGER_H
+
+#include <ctime>
+#include <vector>
+#include <unordered_map>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "map_graph.h"
+#include "timer_wheel.h"
+
+using namespace std;
+
+namespace IMS
+{
+
+class PathManager
+{
+private:
+    const unsigned EXPIRY_TICK = 60000; // 1 minute in milliseconds
+    const unsigned EXPIRY_SLOTS = 256;
+
+    boost::mutex access;
+    IMS::MapGraph * map_graph;
+    time_t grace_period;
+    unsigned num_of_path = 0;
+    unordered_map<unsigned, IMS::Path*> active_paths;
+    IMS::TimerWheel<unsigned> expiry_wheel;
+
+public:
+    static const time_t DEFAULT_GRACE_PERIOD = 900000; // 15 minutes in milliseconds
+    static const unsigned DEFAULT_BATCH_SIZE = 256;
+
+    PathManager(IMS::MapGraph * mg, const time_t &grace_period = DEFAULT_GRACE_PERIOD);
+    ~PathManager();
+
+    unsigned add_path(IMS::Path * path);
+    unsigned remove_path(unsigned path_id);
+    unsigned retire_expired_paths(const time_t &now, const unsigned &batch_size = DEFAULT_BATCH_SIZE);
+    unsigned get_num_of_active_paths();
+    time_t get_grace_period() const
+    {
+        return grace_period;
+    }
+
+    /* Reloading */
+    unsigned migrate_paths(PathManager &old_manager, const vector<unsigned> &new_edge_id);
+};
+
+}
+
+
+#endif //IMS_CPP_PATH_MANAGER_H
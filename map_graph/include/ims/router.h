@@ -25,7 +25,8 @@ private:
 public:
     Router(IMS::MapGraph * mg, IMS::IncidentManager * im) : map_graph(mg), incident_manager(im) {};
 
-    unsigned retrieve_future_weight(const unsigned &from_node, const unsigned &to_node);
+    unsigned retrieve_future_weight(const unsigned &from_node, const unsigned &to_node,
+                                    const unsigned &profile = IMS::MapGraph::NO_PROFILE);
     unsigned int retrieve_realized_weight(const unsigned &edge, const time_t &enter_time);
 
     IMS::Path* route(const unsigned &origin, const unsigned &destination, const time_t &start_time, ExpandedLog* log = NULL);
@@ -0,0 +1,90 @@
+/*
+ * Header file for synthetic_graph module.
+ * Road-like graphs generated from a seed, for benchmarks and scaling tests without an OSM extract: a perturbed grid
+ * of streets with arterial roads, or a random geometric graph of nearby junctions.
+ * Version: 1.0
+ * Author: Terence Chow
+ */
+
+#ifndef IMS_CPP_SYNTHETIC_GRAPH_H
+#define IMS_CPP_SYNTHETIC_GRAPH_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "map_graph.h"
+
+using namespace std;
+
+namespace IMS
+{
+namespace SyntheticGraph
+{
+
+/* PERTURBED_GRID: jittered, gently curved grid of streets, with expressways, primary and secondary roads along
+ *                 every 64th, 16th and 8th row and column, and local streets thinned to the mean degree
+ * RANDOM_GEOMETRIC: junctions placed uniformly, joined to their nearest neighbours, longer links being faster
+ */
+enum topology_t
+{
+    PERTURBED_GRID,
+    RANDOM_GEOMETRIC
+};
+
+enum road_class_t
+{
+    EXPRESSWAY,
+    PRIMARY,
+    SECONDARY,
+    LOCAL
+};
+
+const double SPEED[] = {80, 50, 40, 25}; // km/h of each road_class_t
+const double SPEED_NOISE = 0.2; // speed of each road is varied by up to this share
+
+/* Options of a generated graph.
+ * Fields: double spacing: mean distance between neighbouring junctions, m
+ *         double mean_degree: roads per junction, counting a road in both directions once; real road networks
+ *                             are around 2.5 to 3, a full grid is 4
+ *         double one_way_share: share of local streets beyond those keeping the graph connected which are one-way
+ *         double longitude, latitude: centre of the graph
+ */
+struct options_t
+{
+    topology_t topology = PERTURBED_GRID;
+    unsigned num_of_nodes = 10000;
+    unsigned seed = 42;
+    double spacing = 120;
+    double mean_degree = 2.8;
+    double one_way_share = 0.1;
+    double longitude = 114.15;
+    double latitude = 22.35;
+};
+
+/* Arrays as taken by MapGraph: first_out has one entry per node, outward edges of a node are consecutive.
+ * Every node can reach every other node.
+ */
+struct road_graph_t
+{
+    vector<float> longitude;
+    vector<float> latitude;
+    vector<unsigned> first_out;
+    vector<unsigned> head;
+    vector<unsigned> travel_time; // ms
+    vector<unsigned> geo_distance; // m
+    vector<uint8_t> road_class; // road_class_t of each edge
+};
+
+road_graph_t generate(const options_t &options);
+
+MapGraph * build_map_graph(const options_t &options, const unsigned &k, const unsigned &l,
+                           const unsigned &num_of_threads = 1,
+                           const IMS::Partition::partition_scheme_t &scheme = IMS::Partition::GRID_PARTITION);
+
+bool parse_options(const string &description, options_t &options);
+
+}
+}
+
+#endif //IMS_CPP_SYNTHETIC_GRAPH_H
@@ -0,0 +1,117 @@
+/*
+ * Header file for TimerWheel.
+ * Hashed timer wheel for bucketing items by deadline and retiring overdue ones in batches.
+ * Libraries:
+ * Version: 1.0
+ * Author: Terence Chow
+ */
+
+#ifndef IMS_CPP_TIMER_WHEEL_H
+#define IMS_CPP_TIMER_WHEEL_H
+
+#include <ctime>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+namespace IMS
+{
+
+/* Stores items in slots by deadline. Slot = (deadline / tick) % number of slots.
+ * Items with deadlines beyond one rotation stay in their slot and are skipped until due.
+ * Cancellation is lazy: owners ignore expired items that are no longer valid.
+ * NOT thread safe, owner must lock.
+ */
+template<class T>
+class TimerWheel
+{
+private:
+    struct slot_entry_t
+    {
+        time_t deadline;
+        T item;
+    };
+
+    vector< vector<slot_entry_t> > slots;
+    time_t tick;
+    time_t current_tick = -1; // last tick fully elapsed and processed, -1 before first advance
+    size_t num_of_timers = 0;
+
+public:
+    TimerWheel(const time_t &tick, const unsigned &num_of_slots) : slots(num_of_slots), tick(tick) {};
+
+    /* Schedule an item to expire at deadline.
+     * Items already overdue are placed at the next tick to be processed.
+     * Parameter(s): const time_t & deadline
+     *               const T & item
+     * Returns: when item is scheduled
+     */
+    void schedule(const time_t &deadline, const T &item)
+    {
+        time_t deadline_tick = deadline / tick;
+        if(current_tick >= 0 && deadline_tick <= current_tick)
+        {
+            deadline_tick = current_tick + 1;
+        }
+        slots[deadline_tick % slots.size()].push_back({deadline, item});
+        num_of_timers++;
+    }
+
+    /* Move items with deadline <= now into expired, at most max_expired of them.
+     * The wheel only advances past slots which are completely processed,
+     * so calling again continues with the remaining overdue items.
+     * Parameter(s): const time_t & now
+     *               vector<T> & expired: output list, items are appended
+     *               const size_t & max_expired
+     * Returns: size_t: number of items expired in this call
+     */
+    size_t advance(const time_t &now, vector<T> &expired, const size_t &max_expired)
+    {
+        const time_t target_tick = now / tick;
+        const time_t num_of_slots = slots.size();
+        if(current_tick < 0 || target_tick - current_tick > num_of_slots)
+        {
+            // Full rotation covers every slot
+            current_tick = max((time_t) -1, target_tick - num_of_slots);
+        }
+
+        size_t num_of_expired = 0;
+        for(time_t t = current_tick + 1; t <= target_tick; t++)
+        {
+            vector<slot_entry_t> &slot = slots[t % num_of_slots];
+            auto kept = slot.begin();
+            for(auto entry = slot.begin(); entry != slot.end(); entry++)
+            {
+                if(entry->deadline <= now && num_of_expired < max_expired)
+                {
+                    expired.push_back(entry->item);
+                    num_of_expired++;
+                }
+                else
+                {
+                    *kept++ = *entry;
+                }
+            }
+            num_of_timers -= slot.end() - kept;
+            slot.erase(kept, slot.end());
+
+            if(num_of_expired == max_expired || t == target_tick)
+            {
+                // Slot may hold more overdue items or items due later in this tick, revisit it next call
+                return num_of_expired;
+            }
+            current_tick = t;
+        }
+        return num_of_expired;
+    }
+
+    size_t size() const
+    {
+        return num_of_timers;
+    }
+};
+
+}
+
+#endif //IMS_CPP_TIMER_WHEEL_H
@@ -0,0 +1,145 @@
+/*
+ * Compact read-only form of the MapGraph arrays, so that graphs of larger regions fit the memory budget of an instance.
+ * Libraries:
+ * Version: 1.0
+ * Author: Terence Chow
+ */
+
+#include <cmath>
+
+#include "../include/ims/compressed_graph.h"
+
+using namespace std;
+
+const unsigned IMS::CompressedGraph::BLOCK_SIZE;
+const uint16_t IMS::CompressedGraph::OVERFLOW_MARK;
+constexpr double IMS::CompressedGraph::MIN_COORDINATE_SCALE;
+
+// helper function
+/* Append value as varint: 7 bits per byte, least significant first, high bit set on all but the last byte.
+ * Parameters: vector<uint8_t> & data
+ *             unsigned value
+ * Return: when value is appended
+ */
+void encode_varint(vector<uint8_t> &data, unsigned value)
+{
+    while(value >= 0x80)
+    {
+        data.push_back((uint8_t) (value | 0x80));
+        value >>= 7;
+    }
+    data.push_back((uint8_t) value);
+}
+
+// helper function
+/* Store values in 16 bits, values which do not fit go to the overflow table.
+ * Parameters: const MappedArray<unsigned> & values
+ *             vector<uint16_t> & compact
+ *             vector<pair<unsigned, unsigned>> & overflow: sorted by index
+ *             const uint16_t & overflow_mark
+ * Return: when values are stored
+ */
+void encode_uint16(const IMS::MappedArray<unsigned> &values, vector<uint16_t> &compact,
+                   vector<pair<unsigned, unsigned> > &overflow, const uint16_t &overflow_mark)
+{
+    compact.resize(values.size());
+    for(unsigned i = 0; i < values.size(); i++)
+    {
+        if(values[i] < overflow_mark)
+        {
+            compact[i] = (uint16_t) values[i];
+        }
+        else
+        {
+            compact[i] = overflow_mark;
+            overflow.emplace_back(i, values[i]);
+        }
+    }
+}
+
+/* Constructor of CompressedGraph, encodes the uncompressed MapGraph arrays.
+ * Parameter(s): const MappedArray<float> & latitude
+ *               const MappedArray<float> & longitude
+ *               const MappedArray<unsigned> & head
+ *               const MappedArray<unsigned> & first_out
+ *               const MappedArray<unsigned> & default_travel_time
+ *               const MappedArray<unsigned> & geo_distance
+ */
+IMS::CompressedGraph::CompressedGraph(const MappedArray<float> &latitude, const MappedArray<float> &longitude,
+                                      const MappedArray<unsigned> &head, const MappedArray<unsigned> &first_out,
+                                      const MappedArray<unsigned> &default_travel_time,
+                                      const MappedArray<unsigned> &geo_distance)
+        : num_of_nodes(first_out.size()), num_of_edges(head.size())
+{
+    const unsigned num_of_blocks = (num_of_nodes + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+    // Adjacency
+    block_offset.reserve(num_of_blocks);
+    block_first_edge.reserve(num_of_blocks);
+    for(unsigned node = 0; node < num_of_nodes; node++)
+    {
+        unsigned first_edge = first_out[node];
+        unsigned last_edge = (node == num_of_nodes -1) ? num_of_edges : first_out[node + 1];
+        if(node % BLOCK_SIZE == 0)
+        {
+            block_offset.push_back(head_data.size());
+            block_first_edge.push_back(first_edge);
+        }
+
+        encode_varint(head_data, last_edge - first_edge);
+        unsigned previous_head = node;
+        for(unsigned edge = first_edge; edge < last_edge; edge++)
+        {
+            int32_t delta = (int32_t) (head[edge] - previous_head);
+            encode_varint(head_data, ((uint32_t) delta << 1) ^ (uint32_t) (delta >> 31));
+            previous_head = head[edge];
+        }
+    }
+    head_data.shrink_to_fit();
+
+    // Coordinates
+    block_latitude.resize(num_of_blocks);
+    block_longitude.resize(num_of_blocks);
+    block_latitude_scale.resize(num_of_blocks);
+    block_longitude_scale.resize(num_of_blocks);
+    latitude_offset.resize(num_of_nodes);
+    longitude_offset.resize(num_of_nodes);
+    for(unsigned block = 0; block < num_of_blocks; block++)
+    {
+        const unsigned first_node = block * BLOCK_SIZE;
+        const unsigned last_node = min(num_of_nodes, first_node + BLOCK_SIZE);
+        const float lat_min = *min_element(latitude.begin() + first_node, latitude.begin() + last_node);
+        const float lat_max = *max_element(latitude.begin() + first_node, latitude.begin() + last_node);
+        const float longi_min = *min_element(longitude.begin() + first_node, longitude.begin() + last_node);
+        const float longi_max = *max_element(longitude.begin() + first_node, longitude.begin() + last_node);
+
+        block_latitude[block] = lat_min;
+        block_longitude[block] = longi_min;
+        block_latitude_scale[block] = max(MIN_COORDINATE_SCALE, (lat_max - lat_min) / 65535.0);
+        block_longitude_scale[block] = max(MIN_COORDINATE_SCALE, (longi_max - longi_min) / 65535.0);
+        for(unsigned node = first_node; node < last_node; node++)
+        {
+            latitude_offset[node] = (uint16_t) min(65535.0, (double) round((latitude[node] - lat_min) / block_latitude_scale[block]));
+            longitude_offset[node] = (uint16_t) min(65535.0, (double) round((longitude[node] - longi_min) / block_longitude_scale[block]));
+        }
+    }
+
+    // Edge weights
+    encode_uint16(default_travel_time, travel_time, travel_time_overflow, OVERFLOW_MARK);
+    encode_uint16(geo_distance, this->geo_distance, geo_distance_overflow, OVERFLOW_MARK);
+}
+
+/* Memory used by the compressed arrays.
+ * Parameter(s): NIL
+ * Returns: size_t: bytes
+ */
+size_t IMS::CompressedGraph::get_memory_usage() const
+{
+    return block_offset.capacity() * sizeof(uint32_t) + block_first_edge.capacity() * sizeof(uint32_t)
+           + head_data.capacity() * sizeof(uint8_t)
+           + (block_latitude.capacity() + block_longitude.capacity()
+              + block_latitude_scale.capacity() + block_longitude_scale.capacity()) * sizeof(float)
+           + (latitude_offset.capacity() + longitude_offset.capacity()) * sizeof(uint16_t)
+           + (travel_time.capacity() + geo_distance.capacity()) * sizeof(uint16_t)
+           + (travel_time_overflow.capacity() + geo_distance_overflow.capacity()) * sizeof(pair<unsigned, unsigned>);
+}
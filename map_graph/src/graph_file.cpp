@@ -0,0 +1,337 @@
+/*
+ * Binary MapGraph format. All functions are free functions in IMS::GraphFile namespace.
+ * The file is mapped privately (copy-on-write), arrays of the MapGraph view their sections without copying.
+ * Libraries:
+ * Version: 1.0
+ * Author: Terence Chow
+ */
+
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "graph_file.h"
+#include "../include/ims/map_graph.h"
+
+using namespace std;
+using namespace IMS::GraphFile;
+
+// helper function
+/* Point an array at its section of the mapped file after checking the section bounds.
+ * Parameters: IMS::MappedArray<T> & array
+ *             char * file: start of the mapped file
+ *             const size_t & file_size
+ *             const section_t & section
+ * Return: when the array views the section
+ */
+template<class T>
+static void map_section(IMS::MappedArray<T> &array, char * file, const size_t &file_size, const section_t &section)
+{
+    if (section.element_size != sizeof(T) || section.offset % ALIGNMENT != 0
+        || section.offset > file_size || section.count > (file_size - section.offset) / sizeof(T))
+    {
+        throw runtime_error("Corrupted graph file: section " + to_string(section.id) + " out of bounds");
+    }
+    array.map(reinterpret_cast<T*>(file + section.offset), section.count);
+}
+
+/* Check whether a file starts with the magic of the binary format.
+ * Parameter: const string & file_path
+ * Return: bool: true for a binary graph file, false for any other file, e.g. a text archive
+ */
+bool IMS::GraphFile::is_graph_file(const string &file_path)
+{
+    char magic[sizeof(MAGIC)];
+    ifstream ifs(file_path, ios::binary);
+    return ifs.read(magic, sizeof(magic)) && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+/* Write a MapGraph with its flat distance tables in the binary format.
+ * Parameters: const IMS::MapGraph & graph: preprocessed graph
+ *             const string & output_file_path
+ * Return: when the file is written, throws runtime_error on failure.
+ */
+void IMS::GraphFile::write(const IMS::MapGraph &graph, const string &output_file_path)
+{
+    if (graph.compressed != nullptr)
+    {
+        throw runtime_error("Compressed MapGraph cannot be saved");
+    }
+    if (graph.flat_distance_tables == nullptr)
+    {
+        throw runtime_error("MapGraph must be preprocessed before writing graph file");
+    }
+    const IMS::Preprocess::flat_distance_table_t &tables = *graph.flat_distance_tables;
+    const IMS::Preprocess::boundary_distance_table_t no_boundary_distances;
+    const IMS::Preprocess::boundary_distance_table_t &boundary_distances = graph.boundary_distances != nullptr?
+                                                                           *graph.boundary_distances : no_boundary_distances;
+    const IMS::Preprocess::weight_profile_table_t no_weight_profiles;
+    const IMS::Preprocess::weight_profile_table_t &profiles = graph.weight_profiles != nullptr?
+                                                              *graph.weight_profiles : no_weight_profiles;
+
+    // Section ID order
+    vector<pair<const void*, section_t>> sections = {
+            {graph.longitude.data(), {LONGITUDE, sizeof(float), 0, graph.longitude.size()}},
+            {graph.latitude.data(), {LATITUDE, sizeof(float), 0, graph.latitude.size()}},
+            {graph.head.data(), {HEAD, sizeof(unsigned), 0, graph.head.size()}},
+            {graph.first_out.data(), {FIRST_OUT, sizeof(unsigned), 0, graph.first_out.size()}},
+            {graph.default_travel_time.data(), {DEFAULT_TRAVEL_TIME, sizeof(unsigned), 0, graph.default_travel_time.size()}},
+            {graph.geo_distance.data(), {GEO_DISTANCE, sizeof(unsigned), 0, graph.geo_distance.size()}},
+            {tables.layer_first.data(), {LAYER_FIRST, sizeof(unsigned), 0, tables.layer_first.size()}},
+            {tables.layer_parent.data(), {LAYER_PARENT, sizeof(unsigned), 0, tables.layer_parent.size()}},
+            {tables.outbound_distance.data(), {OUTBOUND_DISTANCE, sizeof(unsigned), 0, tables.outbound_distance.size()}},
+            {tables.inbound_distance.data(), {INBOUND_DISTANCE, sizeof(unsigned), 0, tables.inbound_distance.size()}},
+            {tables.distance_first.data(), {DISTANCE_FIRST, sizeof(unsigned), 0, tables.distance_first.size()}},
+            {tables.distance_target.data(), {DISTANCE_TARGET, sizeof(unsigned), 0, tables.distance_target.size()}},
+            {tables.distance_value.data(), {DISTANCE_VALUE, sizeof(unsigned), 0, tables.distance_value.size()}},
+            {boundary_distances.outbound_distance.data(),
+             {NODE_OUTBOUND_DISTANCE, sizeof(unsigned), 0, boundary_distances.outbound_distance.size()}},
+            {boundary_distances.inbound_distance.data(),
+             {NODE_INBOUND_DISTANCE, sizeof(unsigned), 0, boundary_distances.inbound_distance.size()}},
+            {&profiles.utc_offset, {PROFILE_UTC_OFFSET, sizeof(int), 0, graph.weight_profiles != nullptr? 1u : 0u}},
+            {profiles.start_time.data(), {PROFILE_START_TIME, sizeof(unsigned), 0, profiles.start_time.size()}},
+            {profiles.travel_time.data(), {PROFILE_TRAVEL_TIME, sizeof(unsigned), 0, profiles.travel_time.size()}},
+            {profiles.outbound_distance.data(),
+             {PROFILE_OUTBOUND_DISTANCE, sizeof(unsigned), 0, profiles.outbound_distance.size()}},
+            {profiles.inbound_distance.data(),
+             {PROFILE_INBOUND_DISTANCE, sizeof(unsigned), 0, profiles.inbound_distance.size()}},
+            {profiles.distance_value.data(),
+             {PROFILE_DISTANCE_VALUE, sizeof(unsigned), 0, profiles.distance_value.size()}}
+    };
+
+    // Layout
+    uint64_t position = align(sizeof(header_t) + NUM_OF_SECTIONS * sizeof(section_t));
+    for (auto & section : sections)
+    {
+        section.second.offset = position;
+        position = align(position + section.second.count * section.second.element_size);
+    }
+
+    header_t header;
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byte_order_mark = BYTE_ORDER_MARK;
+    header.num_of_sections = NUM_OF_SECTIONS;
+    header.reserved = 0;
+    header.file_size = position;
+    header.checksum = 0;
+
+    // Write sections, padding with zeros
+    ofstream ofs(output_file_path, ios::binary | ios::trunc);
+    const vector<char> padding(ALIGNMENT, 0);
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (auto & section : sections)
+    {
+        ofs.write(reinterpret_cast<const char*>(&section.second), sizeof(section_t));
+    }
+    uint64_t written = sizeof(header_t) + NUM_OF_SECTIONS * sizeof(section_t);
+    for (auto & section : sections)
+    {
+        ofs.write(padding.data(), section.second.offset - written);
+        ofs.write(reinterpret_cast<const char*>(section.first), section.second.count * section.second.element_size);
+        written = section.second.offset + section.second.count * section.second.element_size;
+    }
+    ofs.write(padding.data(), header.file_size - written);
+    ofs.close();
+    if (!ofs)
+    {
+        throw runtime_error("Cannot write graph file: " + output_file_path);
+    }
+
+    // Checksum the written file and complete the header
+    int fd = open(output_file_path.c_str(), O_RDWR);
+    void * file = fd < 0? MAP_FAILED : mmap(nullptr, header.file_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (file == MAP_FAILED)
+    {
+        if (fd >= 0) close(fd);
+        throw runtime_error("Cannot checksum graph file: " + output_file_path);
+    }
+    header.checksum = checksum(static_cast<char*>(file) + sizeof(header_t), header.file_size - sizeof(header_t));
+    munmap(file, header.file_size);
+    bool is_written = pwrite(fd, &header, sizeof(header), 0) == sizeof(header);
+    close(fd);
+    if (!is_written)
+    {
+        throw runtime_error("Cannot write graph file header: " + output_file_path);
+    }
+}
+
+/* Map a binary graph file and point the arrays and flat distance tables of a MapGraph at its sections.
+ * The mapping is private: pages are shared with the page cache until written.
+ * Parameters: IMS::MapGraph & graph
+ *             const string & input_file_path
+ *             size_t & mapped_size: output, size of the mapping
+ *             const bool & verify_checksum: false skips reading the whole file at startup
+ * Return: void *: start of the mapping, to be released with unmap. Throws runtime_error on invalid file.
+ */
+void * IMS::GraphFile::map(IMS::MapGraph &graph, const string &input_file_path, size_t &mapped_size,
+                           const bool &verify_checksum)
+{
+    int fd = open(input_file_path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw runtime_error("Cannot open graph file: " + input_file_path);
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || (size_t) file_stat.st_size < sizeof(header_t))
+    {
+        close(fd);
+        throw runtime_error("Corrupted graph file: " + input_file_path);
+    }
+    mapped_size = file_stat.st_size;
+    void * mapped_file = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped_file == MAP_FAILED)
+    {
+        throw runtime_error("Cannot map graph file: " + input_file_path);
+    }
+
+    char * file = static_cast<char*>(mapped_file);
+    const header_t * header = reinterpret_cast<const header_t*>(file);
+    string error;
+    if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        error = "Not a graph file: ";
+    }
+    else if (header->version < MIN_VERSION || header->version > VERSION)
+    {
+        error = "Unsupported graph file version " + to_string(header->version) + ": ";
+    }
+    else if (header->byte_order_mark != BYTE_ORDER_MARK)
+    {
+        error = "Graph file written with different byte order: ";
+    }
+    else if (header->file_size != mapped_size
+             || header->num_of_sections != (header->version == 1? NUM_OF_SECTIONS_V1
+                                            : header->version == 2? NUM_OF_SECTIONS_V2 : NUM_OF_SECTIONS)
+             || sizeof(header_t) + header->num_of_sections * sizeof(section_t) > mapped_size)
+    {
+        error = "Corrupted graph file: ";
+    }
+    else if (verify_checksum && checksum(file + sizeof(header_t), mapped_size - sizeof(header_t)) != header->checksum)
+    {
+        error = "Checksum mismatch in graph file: ";
+    }
+    if (!error.empty())
+    {
+        unmap(mapped_file, mapped_size);
+        throw runtime_error(error + input_file_path);
+    }
+
+    try
+    {
+        const section_t * sections = reinterpret_cast<const section_t*>(file + sizeof(header_t));
+        auto tables = new IMS::Preprocess::flat_distance_table_t();
+        graph.flat_distance_tables = tables;
+        map_section(graph.longitude, file, mapped_size, sections[LONGITUDE]);
+        map_section(graph.latitude, file, mapped_size, sections[LATITUDE]);
+        map_section(graph.head, file, mapped_size, sections[HEAD]);
+        map_section(graph.first_out, file, mapped_size, sections[FIRST_OUT]);
+        map_section(graph.default_travel_time, file, mapped_size, sections[DEFAULT_TRAVEL_TIME]);
+        map_section(graph.geo_distance, file, mapped_size, sections[GEO_DISTANCE]);
+        map_section(tables->layer_first, file, mapped_size, sections[LAYER_FIRST]);
+        map_section(tables->layer_parent, file, mapped_size, sections[LAYER_PARENT]);
+        map_section(tables->outbound_distance, file, mapped_size, sections[OUTBOUND_DISTANCE]);
+        map_section(tables->inbound_distance, file, mapped_size, sections[INBOUND_DISTANCE]);
+        map_section(tables->distance_first, file, mapped_size, sections[DISTANCE_FIRST]);
+        map_section(tables->distance_target, file, mapped_size, sections[DISTANCE_TARGET]);
+        map_section(tables->distance_value, file, mapped_size, sections[DISTANCE_VALUE]);
+        if (header->num_of_sections > NODE_INBOUND_DISTANCE && sections[NODE_OUTBOUND_DISTANCE].count > 0)
+        {
+            auto boundary_distances = new IMS::Preprocess::boundary_distance_table_t();
+            graph.boundary_distances = boundary_distances;
+            boundary_distances->num_of_nodes = graph.first_out.size();
+            map_section(boundary_distances->outbound_distance, file, mapped_size, sections[NODE_OUTBOUND_DISTANCE]);
+            map_section(boundary_distances->inbound_distance, file, mapped_size, sections[NODE_INBOUND_DISTANCE]);
+            const size_t num_of_entries = boundary_distances->num_of_nodes * (size_t)(tables->num_of_levels() - 2);
+            if (tables->num_of_levels() < 2 || boundary_distances->outbound_distance.size() != num_of_entries
+                || boundary_distances->inbound_distance.size() != num_of_entries)
+            {
+                throw runtime_error("Corrupted graph file: boundary distances do not match the layers");
+            }
+        }
+        if (header->num_of_sections > PROFILE_DISTANCE_VALUE && sections[PROFILE_START_TIME].count > 0)
+        {
+            auto profiles = new IMS::Preprocess::weight_profile_table_t();
+            graph.weight_profiles = profiles;
+            if (sections[PROFILE_UTC_OFFSET].element_size != sizeof(int) || sections[PROFILE_UTC_OFFSET].count != 1
+                || sections[PROFILE_UTC_OFFSET].offset > mapped_size - sizeof(int))
+            {
+                throw runtime_error("Corrupted graph file: section " + to_string(PROFILE_UTC_OFFSET) + " out of bounds");
+            }
+            memcpy(&profiles->utc_offset, file + sections[PROFILE_UTC_OFFSET].offset, sizeof(int));
+            map_section(profiles->start_time, file, mapped_size, sections[PROFILE_START_TIME]);
+            map_section(profiles->travel_time, file, mapped_size, sections[PROFILE_TRAVEL_TIME]);
+            map_section(profiles->outbound_distance, file, mapped_size, sections[PROFILE_OUTBOUND_DISTANCE]);
+            map_section(profiles->inbound_distance, file, mapped_size, sections[PROFILE_INBOUND_DISTANCE]);
+            map_section(profiles->distance_value, file, mapped_size, sections[PROFILE_DISTANCE_VALUE]);
+            const size_t num_of_profiles = profiles->num_of_profiles();
+            if (profiles->travel_time.size() != num_of_profiles * graph.head.size()
+                || profiles->outbound_distance.size() != num_of_profiles * tables->outbound_distance.size()
+                || profiles->inbound_distance.size() != num_of_profiles * tables->inbound_distance.size()
+                || profiles->distance_value.size() != num_of_profiles * tables->distance_value.size())
+            {
+                throw runtime_error("Corrupted graph file: weight profiles do not match the graph");
+            }
+        }
+    }
+    catch (runtime_error &e)
+    {
+        unmap(mapped_file, mapped_size);
+        throw;
+    }
+
+    return mapped_file;
+}
+
+/* Release a mapping created by map.
+ * Parameters: void * mapped_file
+ *             const size_t & mapped_size
+ * Return: when the mapping is released
+ */
+void IMS::GraphFile::unmap(void *mapped_file, const size_t &mapped_size)
+{
+    if (mapped_file != nullptr)
+    {
+        munmap(mapped_file, mapped_size);
+    }
+}
+
+/* 64-bit FNV-1a over 8-byte words, trailing bytes zero-padded.
+ * Parameters: const char * data
+ *             const size_t & size
+ * Return: uint64_t: checksum
+ */
+uint64_t IMS::GraphFile::checksum(const char *data, const size_t &size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ULL;
+    }
+    if (i < size)
+    {
+        uint64_t word = 0;
+        memcpy(&word, data + i, size - i);
+        hash = (hash ^ word) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/* Round up to the next multiple of ALIGNMENT
+ * Parameters: const uint64_t & position
+ * Return: uint64_t: aligned position
+ */
+uint64_t IMS::GraphFile::align(const uint64_t &position)
+{
+    return (position + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
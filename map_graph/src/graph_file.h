@@ -0,0 +1,101 @@
+/*
+ * Header file for graph_file module.
+ * Versioned, checksummed binary MapGraph format which is memory-mapped and used in place.
+ * Version: 1.0
+ * Author: Terence Chow
+ */
+
+#ifndef IMS_CPP_GRAPH_FILE_H
+#define IMS_CPP_GRAPH_FILE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+namespace IMS
+{
+
+class MapGraph;
+
+namespace GraphFile
+{
+
+/* File layout, in host byte order:
+ *   header_t
+ *   section_t[num_of_sections]
+ *   sections, each starting at a multiple of ALIGNMENT, file padded with zeros to a multiple of ALIGNMENT
+ * checksum covers everything after the header.
+ */
+const char MAGIC[8] = {'I', 'M', 'S', 'G', 'R', 'A', 'P', 'H'};
+const uint32_t VERSION = 3;
+const uint32_t MIN_VERSION = 1; // older versions lack the sections added since, and are still read
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+const uint64_t ALIGNMENT = 64;
+
+enum section_id_t : uint32_t
+{
+    LONGITUDE,
+    LATITUDE,
+    HEAD,
+    FIRST_OUT,
+    DEFAULT_TRAVEL_TIME,
+    GEO_DISTANCE,
+    LAYER_FIRST,
+    LAYER_PARENT,
+    OUTBOUND_DISTANCE,
+    INBOUND_DISTANCE,
+    DISTANCE_FIRST,
+    DISTANCE_TARGET,
+    DISTANCE_VALUE,
+    NODE_OUTBOUND_DISTANCE, // since version 2, empty if boundary distances are not preprocessed
+    NODE_INBOUND_DISTANCE,
+    PROFILE_UTC_OFFSET, // since version 3, empty without weight profiles
+    PROFILE_START_TIME,
+    PROFILE_TRAVEL_TIME,
+    PROFILE_OUTBOUND_DISTANCE,
+    PROFILE_INBOUND_DISTANCE,
+    PROFILE_DISTANCE_VALUE,
+    NUM_OF_SECTIONS
+};
+const uint32_t NUM_OF_SECTIONS_V1 = NODE_OUTBOUND_DISTANCE;
+const uint32_t NUM_OF_SECTIONS_V2 = PROFILE_UTC_OFFSET;
+
+struct header_t
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    uint32_t num_of_sections;
+    uint32_t reserved;
+    uint64_t file_size;
+    uint64_t checksum;
+};
+
+struct section_t
+{
+    uint32_t id;
+    uint32_t element_size;
+    uint64_t offset;
+    uint64_t count;
+};
+
+/* Binary format */
+bool is_graph_file(const string &file_path);
+
+void write(const IMS::MapGraph &graph, const string &output_file_path);
+
+void * map(IMS::MapGraph &graph, const string &input_file_path, size_t &mapped_size, const bool &verify_checksum = true);
+
+void unmap(void * mapped_file, const size_t &mapped_size);
+
+/* Util functions */
+uint64_t checksum(const char * data, const size_t &size);
+
+uint64_t align(const uint64_t &position);
+
+}
+}
+
+#endif //IMS_CPP_GRAPH_FILE_H
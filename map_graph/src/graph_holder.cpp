@@ -0,0 +1,253 @@
+/*
+ * Holds the MapGraph served with its live state, and hot-reloads a new MapGraph file without stopping the server.
+ * A reload loads and matches the new graph in the background, then pauses updates only while paths and incidents
+ * are migrated through the matched edge IDs and the new graph is swapped in.
+ * Libraries:
+ * Version: 1.0
+ * Author: Terence Chow
+ */
+
+#include <iostream>
+#include <chrono>
+
+#include "../include/ims/graph_holder.h"
+
+using namespace std;
+
+/* Destructor of graph_context_t, releases the graph and its live state.
+ * Parameter(s): NIL
+ * Return: when memory is released.
+ */
+IMS::graph_context_t::~graph_context_t()
+{
+    delete router;
+    delete path_manager;
+    delete incident_manager;
+    delete map_graph;
+    cout << "Released MapGraph version " << version << "." << endl;
+}
+
+/* Constructor of GraphHolder, takes ownership of the graph loaded at startup and its live state.
+ * Parameter(s): const string & file_path: file the graph is loaded from, default file for reloads
+ *               IMS::MapGraph * mg
+ *               IMS::IncidentManager * im
+ *               IMS::PathManager * pm
+ *               IMS::IncidentFeed * incident_feed: rebound on reload, caller keeps ownership, nullptr if none
+ *               const bool & is_compressed: compress reloaded graphs
+ *               const string & function_file_path: travel time functions loaded into reloaded graphs, empty if none
+ */
+IMS::GraphHolder::GraphHolder(const string &file_path, IMS::MapGraph *mg, IMS::IncidentManager *im,
+                              IMS::PathManager *pm, IMS::IncidentFeed *incident_feed, const bool &is_compressed,
+                              const string &function_file_path)
+        : incident_feed(incident_feed), is_compressed(is_compressed), function_file_path(function_file_path)
+{
+    auto context = make_shared<graph_context_t>();
+    context->file_path = file_path;
+    context->map_graph = mg;
+    context->incident_manager = im;
+    context->path_manager = pm;
+    context->router = new IMS::Router(mg, im);
+    current = context;
+}
+
+/* Take a handle to the current graph context. The context stays valid until the handle is released,
+ * even if a reload swaps in a new one meanwhile.
+ * Parameter(s): NIL
+ * Returns: graph_handle_t
+ */
+IMS::graph_handle_t IMS::GraphHolder::acquire() const
+{
+    return atomic_load(&current);
+}
+
+/* Access to be held in shared mode by updates of live state, see GraphHolder.
+ * Parameter(s): NIL
+ * Returns: boost::shared_mutex &
+ */
+boost::shared_mutex & IMS::GraphHolder::get_update_access()
+{
+    return update_access;
+}
+
+/* Load a MapGraph file and swap it in, migrating paths and incidents. Returns after the swap.
+ * Parameter(s): const string & file_path: empty for the file of the current graph
+ * Returns: reload_report_t: report of this reload, an error if another reload is in progress
+ */
+IMS::reload_report_t IMS::GraphHolder::reload(const string &file_path)
+{
+    if(!begin_reload(file_path))
+    {
+        reload_report_t report;
+        report.error = "Reload in progress";
+        return report;
+    }
+    return do_reload(file_path.empty()? acquire()->file_path : file_path);
+}
+
+/* Start reload in a background thread, see reload.
+ * Parameter(s): const string & file_path: empty for the file of the current graph
+ * Returns: bool: false if another reload is in progress
+ */
+bool IMS::GraphHolder::reload_in_background(const string &file_path)
+{
+    if(!begin_reload(file_path))
+    {
+        return false;
+    }
+    boost::thread reload_thread(&IMS::GraphHolder::do_reload, this,
+                                file_path.empty()? acquire()->file_path : file_path);
+    reload_thread.detach();
+    return true;
+}
+
+/* Report of the last reload, or of the reload in progress.
+ * Parameter(s): NIL
+ * Returns: reload_report_t
+ */
+IMS::reload_report_t IMS::GraphHolder::get_reload_report()
+{
+    boost::lock_guard<boost::mutex> lock(reload_access);
+    return last_report;
+}
+
+// helper function
+/* Mark a reload as started unless one is in progress.
+ * Parameter(s): const string & file_path
+ * Returns: bool: true if the caller may reload
+ */
+bool IMS::GraphHolder::begin_reload(const string &file_path)
+{
+    boost::lock_guard<boost::mutex> lock(reload_access);
+    if(is_reloading)
+    {
+        return false;
+    }
+    is_reloading = true;
+    last_report = reload_report_t();
+    last_report.is_reloading = true;
+    last_report.file_path = file_path;
+    return true;
+}
+
+// helper function
+/* Body of a reload. Loading and matching run alongside queries, migration runs with updates paused.
+ * Parameter(s): const string & file_path
+ * Returns: reload_report_t
+ */
+IMS::reload_report_t IMS::GraphHolder::do_reload(const string &file_path)
+{
+    reload_report_t report;
+    report.file_path = file_path;
+    auto start = chrono::steady_clock::now();
+
+    IMS::MapGraph * new_graph = nullptr;
+    try
+    {
+        new_graph = IMS::MapGraph::deserialize_and_initialize(file_path);
+        if(new_graph->flat_distance_tables == nullptr)
+        {
+            throw runtime_error("MapGraph is not preprocessed: " + file_path);
+        }
+        if(!function_file_path.empty())
+        {
+            // The side file is written for one graph, a rebuilt graph needs its functions rebuilt too
+            try
+            {
+                new_graph->load_travel_time_functions(function_file_path);
+            }
+            catch(runtime_error &e)
+            {
+                throw runtime_error("Cannot load travel time functions into the reloaded graph, rebuild them with "
+                                    "graph_builder --history: " + string(e.what()));
+            }
+        }
+    }
+    catch(exception &e)
+    {
+        delete new_graph;
+        report.error = e.what();
+        cout << "Reload of " << file_path << " failed: " << report.error << endl;
+
+        boost::lock_guard<boost::mutex> lock(reload_access);
+        is_reloading = false;
+        last_report = report;
+        return report;
+    }
+    auto loaded = chrono::steady_clock::now();
+
+    // Match against the current graph, which may still change by reloads only, i.e. not before this one ends
+    graph_handle_t old_context = acquire();
+    IMS::Renumbering matching = old_context->map_graph->match(*new_graph, MATCHING_RADIUS);
+    for(auto node : matching.new_node_id)
+    {
+        if(node != RoutingKit::invalid_id)
+        {
+            report.num_of_nodes_matched++;
+        }
+    }
+    for(auto edge : matching.new_edge_id)
+    {
+        if(edge != RoutingKit::invalid_id)
+        {
+            report.num_of_edges_matched++;
+        }
+    }
+    report.num_of_nodes_unmatched = matching.new_node_id.size() - report.num_of_nodes_matched;
+    report.num_of_edges_unmatched = matching.new_edge_id.size() - report.num_of_edges_matched;
+    if(is_compressed)
+    {
+        new_graph->compress();
+    }
+    auto matched = chrono::steady_clock::now();
+
+    {
+        // Pause updates, in-flight updates finish on the old context first
+        boost::unique_lock<boost::shared_mutex> update_lock(update_access);
+        boost::unique_lock<IMS::IncidentFeed> feed_lock;
+        if(incident_feed != nullptr)
+        {
+            feed_lock = boost::unique_lock<IMS::IncidentFeed>(*incident_feed);
+        }
+
+        auto context = make_shared<graph_context_t>();
+        context->version = old_context->version + 1;
+        context->file_path = file_path;
+        context->map_graph = new_graph;
+        context->incident_manager = old_context->incident_manager->migrate(matching.new_edge_id,
+                                                                           new_graph->get_num_of_edges());
+        context->path_manager = new IMS::PathManager(new_graph, old_context->path_manager->get_grace_period());
+        report.num_of_paths_migrated = context->path_manager->migrate_paths(*old_context->path_manager,
+                                                                            matching.new_edge_id);
+        context->router = new IMS::Router(new_graph, context->incident_manager);
+        if(incident_feed != nullptr)
+        {
+            incident_feed->rebind(new_graph, context->incident_manager);
+        }
+
+        report.num_of_incidents_migrated = context->incident_manager->get_num_of_incidents();
+        report.num_of_incidents_dropped = old_context->incident_manager->get_num_of_incidents()
+                                          - report.num_of_incidents_migrated;
+        report.num_of_paths_dropped = old_context->path_manager->get_num_of_active_paths()
+                                      - report.num_of_paths_migrated;
+        report.version = context->version;
+
+        atomic_store(&current, context);
+    }
+    auto migrated = chrono::steady_clock::now();
+
+    report.is_successful = true;
+    report.loading_time = chrono::duration<double, milli>(loaded - start).count();
+    report.matching_time = chrono::duration<double, milli>(matched - loaded).count();
+    report.migrating_time = chrono::duration<double, milli>(migrated - matched).count();
+    report.total_time = chrono::duration<double, milli>(migrated - start).count();
+    cout << "Reloaded MapGraph version " << report.version << " from " << file_path << ": "
+         << report.num_of_edges_matched << " edges matched, " << report.num_of_edges_unmatched << " unmatched | "
+         << report.num_of_incidents_migrated << " incidents, " << report.num_of_paths_migrated << " paths migrated | "
+         << "load " << report.loading_time << " ms, match " << report.matching_time << " ms, "
+         << "updates paused " << report.migrating_time << " ms" << endl;
+
+    boost::lock_guard<boost::mutex> lock(reload_access);
+    is_reloading = false;
+    last_report = report;
+    return report;
+}
@@ -0,0 +1,366 @@
+/*
+ * Bulk ingestion of incidents from a feed, e.g. a traffic authority feed or a local file / pipe standing in for it.
+ * Diffs each batch against the incidents of the feed which are live, snaps new locations to edges in parallel
+ * and applies all additions and removals in one writer critical section of IncidentManager.
+ * Libraries:
+ * Version: 1.0
+ * Author: Terence Chow
+ */
+
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+
+#include "../include/ims/incident_feed.h"
+
+using namespace std;
+
+/* Constructor of IncidentFeed.
+ * Parameter(s): IMS::MapGraph * mg
+ *               IMS::IncidentManager * im
+ *               const float & offset: offset for finding edges of incident locations
+ *               unsigned num_of_threads: threads for snapping locations, 0 for number of hardware threads
+ */
+IMS::IncidentFeed::IncidentFeed(IMS::MapGraph *mg, IMS::IncidentManager *im, const float &offset, unsigned num_of_threads)
+        : map_graph(mg), incident_manager(im), offset(offset), num_of_threads(num_of_threads)
+{
+    if(this->num_of_threads == 0)
+    {
+        this->num_of_threads = max(1u, boost::thread::hardware_concurrency());
+    }
+}
+
+/* Ingest the full set of incidents currently in the feed.
+ * Live incidents of the feed which are not in the snapshot are removed.
+ *
+ * Parameter(s): const vector<feed_incident_t> & snapshot
+ * Returns: ingestion_report_t
+ */
+IMS::ingestion_report_t IMS::IncidentFeed::ingest_snapshot(const vector<feed_incident_t> &snapshot)
+{
+    boost::lock_guard<boost::mutex> lock(access);
+
+    unordered_map<string, bool> in_snapshot;
+    for(auto & record : snapshot)
+    {
+        in_snapshot[record.key] = true;
+    }
+
+    vector<string> removed_keys;
+    for(auto & live_incident : live_incidents)
+    {
+        if(in_snapshot.count(live_incident.first) == 0)
+        {
+            removed_keys.push_back(live_incident.first);
+        }
+    }
+
+    return ingest(snapshot, removed_keys);
+}
+
+/* Ingest changes of the feed: added or updated incidents, and keys of incidents which are cleared.
+ *
+ * Parameter(s): const vector<feed_incident_t> & upserts
+ *               const vector<string> & removed_keys
+ * Returns: ingestion_report_t
+ */
+IMS::ingestion_report_t IMS::IncidentFeed::ingest_updates(const vector<feed_incident_t> &upserts,
+                                                          const vector<string> &removed_keys)
+{
+    boost::lock_guard<boost::mutex> lock(access);
+    return ingest(upserts, removed_keys);
+}
+
+/* Pause ingestion, e.g. while the live incidents are migrated to a reloaded MapGraph.
+ * Parameter(s): NIL
+ * Returns: when no batch is being ingested
+ */
+void IMS::IncidentFeed::lock()
+{
+    access.lock();
+}
+
+/* Resume ingestion after lock.
+ * Parameter(s): NIL
+ * Returns: when ingestion is resumed
+ */
+void IMS::IncidentFeed::unlock()
+{
+    access.unlock();
+}
+
+/* Switch to a reloaded MapGraph and the IncidentManager the incidents are migrated to. Caller must hold lock.
+ * Live incidents which are not migrated are forgotten, so the next batch snaps them to the new graph again.
+ *
+ * Parameter(s): IMS::MapGraph * mg
+ *               IMS::IncidentManager * im
+ * Returns: unsigned: number of live incidents forgotten
+ */
+unsigned IMS::IncidentFeed::rebind(IMS::MapGraph *mg, IMS::IncidentManager *im)
+{
+    map_graph = mg;
+    incident_manager = im;
+
+    unsigned num_of_forgotten = 0;
+    for(auto live_incident = live_incidents.begin(); live_incident != live_incidents.end();)
+    {
+        if(incident_manager->has_incident(live_incident->second.incident_id))
+        {
+            live_incident++;
+        }
+        else
+        {
+            live_incident = live_incidents.erase(live_incident);
+            num_of_forgotten++;
+        }
+    }
+    return num_of_forgotten;
+}
+
+/* Diff a batch against live incidents, snap changed locations in parallel and apply the batch.
+ * Caller must hold access.
+ *
+ * Parameter(s): const vector<feed_incident_t> & upserts: later records of the same key win
+ *               const vector<string> & removed_keys
+ * Returns: ingestion_report_t
+ */
+IMS::ingestion_report_t IMS::IncidentFeed::ingest(const vector<feed_incident_t> &upserts,
+                                                  const vector<string> &removed_keys)
+{
+    ingestion_report_t report;
+    report.num_of_received = upserts.size() + removed_keys.size();
+    auto start = chrono::steady_clock::now();
+
+    // Latest record of each key
+    unordered_map<string, unsigned> latest;
+    for(unsigned i = 0; i < upserts.size(); i++)
+    {
+        latest[upserts[i].key] = i;
+    }
+
+    // Diff against live incidents
+    vector<const feed_incident_t*> changed;
+    vector<unsigned> removals;
+    for(unsigned i = 0; i < upserts.size(); i++)
+    {
+        const feed_incident_t &record = upserts[i];
+        if(latest[record.key] != i)
+        {
+            continue;
+        }
+
+        auto live_incident = live_incidents.find(record.key);
+        if(live_incident != live_incidents.end())
+        {
+            const feed_incident_t &live_record = live_incident->second.record;
+            if(live_record.longitude == record.longitude && live_record.latitude == record.latitude
+               && live_record.impact == record.impact
+               && live_record.start_time == record.start_time && live_record.end_time == record.end_time)
+            {
+                report.num_of_unchanged++;
+                continue;
+            }
+            removals.push_back(live_incident->second.incident_id);
+            live_incidents.erase(live_incident);
+        }
+        changed.push_back(&record);
+    }
+    for(auto & key : removed_keys)
+    {
+        auto live_incident = live_incidents.find(key);
+        if(live_incident != live_incidents.end() && latest.count(key) == 0)
+        {
+            removals.push_back(live_incident->second.incident_id);
+            live_incidents.erase(live_incident);
+        }
+    }
+
+    // Snap locations to edges, each thread takes every num_of_threads-th record
+    vector< vector<unsigned> > affected_edges(changed.size());
+    boost::thread_group snapping_threads;
+    for(unsigned t = 0; t < num_of_threads && t < changed.size(); t++)
+    {
+        snapping_threads.create_thread([this, t, &changed, &affected_edges]()
+        {
+            for(unsigned i = t; i < changed.size(); i += num_of_threads)
+            {
+                affected_edges[i] = map_graph->find_nearest_edge_of_location(
+                        changed[i]->longitude, changed[i]->latitude, offset);
+            }
+        });
+    }
+    snapping_threads.join_all();
+    auto snapped = chrono::steady_clock::now();
+
+    // Apply in one critical section
+    vector<IMS::IncidentManager::new_incident_t> additions;
+    vector<const feed_incident_t*> added_records;
+    for(unsigned i = 0; i < changed.size(); i++)
+    {
+        if(affected_edges[i].empty())
+        {
+            report.num_of_unlocated++;
+            continue;
+        }
+        additions.emplace_back();
+        additions.back().affected_edges.swap(affected_edges[i]);
+        additions.back().impact = changed[i]->impact;
+        additions.back().start_time = changed[i]->start_time;
+        additions.back().end_time = changed[i]->end_time;
+        added_records.push_back(changed[i]);
+    }
+
+    vector<unsigned> incident_ids = incident_manager->apply_incidents(additions, removals);
+    for(unsigned i = 0; i < incident_ids.size(); i++)
+    {
+        live_incidents[added_records[i]->key] = {incident_ids[i], *added_records[i]};
+    }
+    auto applied = chrono::steady_clock::now();
+
+    report.num_of_added = incident_ids.size();
+    report.num_of_removed = removals.size();
+    report.snapping_time = chrono::duration<double, milli>(snapped - start).count();
+    report.applying_time = chrono::duration<double, milli>(applied - snapped).count();
+    report.total_time = chrono::duration<double, milli>(applied - start).count();
+    return report;
+}
+
+/* Consume a feed stream until its end. A snapshot is framed by marker lines:
+ *     snapshot <number of records>
+ *     key,longitude,latitude,impact[,start_time,end_time]
+ *     ...
+ *     end
+ * A snapshot is ingested with ingest_snapshot on its end line, if it has the number of record lines announced, so an
+ * empty snapshot "snapshot 0" clears all incidents of the feed. A snapshot cut short, e.g. by the end of the stream
+ * or another snapshot line, is dropped, so that a lost part of a snapshot does not remove incidents. A snapshot with
+ * a malformed record is dropped too, so that the live incident of its key is kept. As for the /incidents endpoint,
+ * a record is malformed if its impact is negative or it ends before it starts. Records outside a snapshot are
+ * ignored.
+ * Blank lines and lines starting with # are ignored.
+ * A report of each snapshot is printed.
+ *
+ * Parameter(s): istream & feed
+ * Returns: unsigned: number of snapshots ingested
+ */
+unsigned IMS::IncidentFeed::consume(istream &feed)
+{
+    unsigned num_of_snapshots = 0;
+    vector<feed_incident_t> snapshot;
+    string line;
+    bool is_in_snapshot = false;
+    unsigned num_of_announced = 0; // record lines announced by the snapshot line
+    unsigned num_of_lines = 0; // record lines of the snapshot so far
+    bool is_malformed = false; // whether a record line of the snapshot is malformed
+
+    while(getline(feed, line))
+    {
+        if(line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        istringstream marker(line);
+        string type;
+        marker >> type;
+        if(type == "snapshot")
+        {
+            if(is_in_snapshot)
+            {
+                cout << "Dropped feed snapshot without end line" << endl;
+            }
+            string extra;
+            is_in_snapshot = (marker >> num_of_announced) && !(marker >> extra);
+            if(!is_in_snapshot)
+            {
+                cout << "Skipped feed line \"" << line << "\": expected snapshot <number of records>" << endl;
+            }
+            snapshot.clear();
+            num_of_lines = 0;
+            is_malformed = false;
+            continue;
+        }
+        if(type == "end")
+        {
+            if(!is_in_snapshot)
+            {
+                cout << "Skipped feed line \"end\" outside a snapshot" << endl;
+                continue;
+            }
+            is_in_snapshot = false;
+            if(num_of_lines != num_of_announced)
+            {
+                cout << "Dropped feed snapshot of " << num_of_lines << " records, " << num_of_announced
+                     << " announced" << endl;
+                continue;
+            }
+            if(is_malformed)
+            {
+                cout << "Dropped feed snapshot with malformed records" << endl;
+                continue;
+            }
+            ingestion_report_t report = ingest_snapshot(snapshot);
+            num_of_snapshots++;
+            cout << "Feed snapshot: " << report.num_of_added << " added, " << report.num_of_removed << " removed, "
+                 << report.num_of_unchanged << " unchanged, " << report.num_of_unlocated << " not on any road | "
+                 << "snap " << report.snapping_time << " ms, apply " << report.applying_time << " ms, "
+                 << (report.total_time > 0? report.num_of_received / report.total_time * 1000 : 0)
+                 << " updates/s" << endl;
+            continue;
+        }
+        if(!is_in_snapshot)
+        {
+            cout << "Skipped feed record \"" << line << "\": outside a snapshot" << endl;
+            continue;
+        }
+        num_of_lines++;
+
+        feed_incident_t record;
+        record.start_time = 0;
+        record.end_time = IMS::IncidentManager::NO_END_TIME;
+        istringstream fields(line);
+        string field;
+        vector<string> values;
+        while(getline(fields, field, ','))
+        {
+            values.push_back(field);
+        }
+        try
+        {
+            if(values.size() != 4 && values.size() != 6)
+            {
+                throw invalid_argument("wrong number of fields");
+            }
+            record.key = values[0];
+            record.longitude = stof(values[1]);
+            record.latitude = stof(values[2]);
+            long impact = stol(values[3]);
+            if(impact < 0)
+            {
+                throw invalid_argument("negative impact");
+            }
+            record.impact = impact;
+            if(values.size() == 6)
+            {
+                record.start_time = stol(values[4]);
+                record.end_time = stol(values[5]);
+            }
+            if(record.end_time <= record.start_time)
+            {
+                throw invalid_argument("ends before it starts");
+            }
+        }
+        catch(exception &e)
+        {
+            cout << "Malformed feed record \"" << line << "\": " << e.what() << endl;
+            is_malformed = true;
+            continue;
+        }
+        snapshot.push_back(record);
+    }
+    if(is_in_snapshot)
+    {
+        cout << "Dropped feed snapshot without end line" << endl;
+    }
+
+    return num_of_snapshots;
+}
@@ -1,44 +1,43 @@
 /*
- * Manages incident information including IDs, impact and affected roads.
+ * Manages incident information including IDs, impact, validity window and affected roads.
  * Provides adding, removing and retrieval operations.
  * Libraries:
  * Version: 1.0
  * Author: Terence Chow
  */
 
-#include <unordered_map>
-#include <unordered_set>
 #include <vector>
+#include <unordered_map>
+#include <algorithm>
 
 #include "../include/ims/incident_manager.h"
 
 using namespace std;
 
-/* Stores incident with impact. Assign it with an ID and stores ID associated with edges.
+const time_t IMS::IncidentManager::NO_END_TIME;
+
+/* Stores incident with impact. Assign it with an ID and adds its impact to the affected edges.
+ * Unbounded incidents (start_time = 0, end_time = NO_END_TIME) are added to the per-edge impact.
+ * Time-windowed incidents are chained to each edge and scheduled to be purged at end_time.
  * Number of incident is incremented.
  *
  * Parameter(s): vector<unsigned> edge_id
  *               unsigned impact
+ *               time_t start_time: in milliseconds, optional
+ *               time_t end_time: in milliseconds, optional
  * Returns: unsigned: incident ID
  */
-unsigned IMS::IncidentManager::add_incident(vector<unsigned> affected_edges, unsigned impact)
+unsigned IMS::IncidentManager::add_incident(vector<unsigned> affected_edges, unsigned impact,
+                                            time_t start_time, time_t end_time)
 {
     // Lock exclusive writer access
     boost::upgrade_lock<boost::shared_mutex> writer_lock(access);
     boost::upgrade_to_unique_lock<boost::shared_mutex> unique_lock(writer_lock);
 
-    unsigned incident_id = num_of_incident;
-    incidents[incident_id] = impact;
-    for(auto & edge : affected_edges)
-    {
-        affected_roads[edge].insert(incident_id);
-    }
-    num_of_incident++;
-    return incident_id;
+    return insert_incident(affected_edges, impact, start_time, end_time);
 }
 
-/* Removes incident. Finds all roads affected by this incident and remove entries.
- * Removes also the affected road entry if the entry is empty.
+/* Removes incident. Subtracts its impact from the edges it affects.
  *
  * Parameter(s): unsigned incident_id
  * Returns: unsigned: number of incident removed -> 0 indicates incident ID not found
@@ -49,47 +48,262 @@ unsigned IMS::IncidentManager::remove_incident(unsigned incident_id)
     boost::upgrade_lock<boost::shared_mutex> writer_lock(access);
     boost::upgrade_to_unique_lock<boost::shared_mutex> unique_lock(writer_lock);
 
-    unsigned num_of_incidents_removed = incidents.erase(incident_id);
+    auto incident = incidents.find(incident_id);
+    if(incident == incidents.end())
+    {
+        return 0;
+    }
+
+    erase_incident(incident);
+    return 1;
+}
+
+/* Removes and adds a batch of incidents in one writer critical section.
+ * Removals are applied before additions. Affected edges of the additions are consumed.
+ *
+ * Parameter(s): vector<new_incident_t> & additions
+ *               const vector<unsigned> & removals: incident IDs, IDs not found are ignored
+ * Returns: vector<unsigned>: incident IDs of the additions, in order
+ */
+vector<unsigned> IMS::IncidentManager::apply_incidents(vector<new_incident_t> &additions, const vector<unsigned> &removals)
+{
+    vector<unsigned> incident_ids;
+    incident_ids.reserve(additions.size());
+
+    // Lock exclusive writer access
+    boost::upgrade_lock<boost::shared_mutex> writer_lock(access);
+    boost::upgrade_to_unique_lock<boost::shared_mutex> unique_lock(writer_lock);
+
+    for(auto incident_id : removals)
+    {
+        auto incident = incidents.find(incident_id);
+        if(incident != incidents.end())
+        {
+            erase_incident(incident);
+        }
+    }
+    for(auto & addition : additions)
+    {
+        incident_ids.push_back(insert_incident(addition.affected_edges, addition.impact,
+                                               addition.start_time, addition.end_time));
+    }
+    return incident_ids;
+}
+
+/* Removes all incidents whose end_time is at or before the specified time.
+ * Their timers are taken from the expiry wheel; incidents removed earlier are skipped.
+ *
+ * Parameter(s): const time_t & now: in milliseconds
+ * Returns: unsigned: number of incidents purged
+ */
+unsigned IMS::IncidentManager::purge_expired_incidents(const time_t &now)
+{
+    // Lock exclusive writer access
+    boost::upgrade_lock<boost::shared_mutex> writer_lock(access);
+    boost::upgrade_to_unique_lock<boost::shared_mutex> unique_lock(writer_lock);
+
+    vector<unsigned> expired_ids;
+    expiry_wheel.advance(now, expired_ids, expiry_wheel.size());
 
-    if(num_of_incidents_removed > 0)
+    unsigned num_of_incidents_purged = 0;
+    for(auto incident_id : expired_ids)
     {
-        vector<unordered_map<unsigned, unordered_set<unsigned> >::iterator>
-                affected_road_entries_to_be_removed;
-        for(auto itr = affected_roads.begin(); itr != affected_roads.end(); itr++)
+        auto incident = incidents.find(incident_id);
+        if(incident != incidents.end())
         {
-            if(itr->second.erase(incident_id) > 0 && itr->second.empty())
+            erase_incident(incident);
+            num_of_incidents_purged++;
+        }
+    }
+    return num_of_incidents_purged;
+}
+
+/* Count incidents which are not yet removed or purged.
+ * Parameter(s): NIL
+ * Returns: unsigned: number of incidents
+ */
+unsigned IMS::IncidentManager::get_num_of_incidents()
+{
+    // Lock reader access
+    boost::shared_lock<boost::shared_mutex> reader_lock(access);
+    return incidents.size();
+}
+
+/* Copies all incidents to a new IncidentManager of another graph, e.g. on reloading the MapGraph.
+ * Incidents keep their IDs, affected edges are translated and those not in the other graph are dropped.
+ * Incidents without any affected edge left are not copied.
+ *
+ * Parameter(s): const vector<unsigned> & new_edge_id: edge ID in the other graph, RoutingKit::invalid_id if none
+ *               unsigned num_of_edges: number of edges of the other graph
+ * Returns: IncidentManager *: new IncidentManager, owned by caller
+ */
+IMS::IncidentManager * IMS::IncidentManager::migrate(const vector<unsigned> &new_edge_id, unsigned num_of_edges)
+{
+    auto migrated = new IncidentManager(num_of_edges);
+
+    // Lock reader access
+    boost::shared_lock<boost::shared_mutex> reader_lock(access);
+
+    for(auto & incident : incidents)
+    {
+        vector<unsigned> affected_edges;
+        for(auto & edge : incident.second.affected_edges)
+        {
+            if(edge < new_edge_id.size() && new_edge_id[edge] < num_of_edges)
             {
-                // something is erased and set is empty after that
-                affected_road_entries_to_be_removed.push_back(itr);
+                affected_edges.push_back(new_edge_id[edge]);
             }
         }
-        for(auto entry : affected_road_entries_to_be_removed)
+        if(!affected_edges.empty())
         {
-            affected_roads.erase(entry);
+            migrated->num_of_incident = incident.first;
+            migrated->insert_incident(affected_edges, incident.second.impact,
+                                      incident.second.start_time, incident.second.end_time);
         }
     }
+    migrated->num_of_incident = num_of_incident;
+    return migrated;
+}
 
-    return num_of_incidents_removed;
+/* Check whether an incident is stored, i.e. not removed, purged or dropped.
+ * Parameter(s): unsigned incident_id
+ * Returns: bool
+ */
+bool IMS::IncidentManager::has_incident(unsigned incident_id)
+{
+    // Lock reader access
+    boost::shared_lock<boost::shared_mutex> reader_lock(access);
+    return incidents.count(incident_id) > 0;
 }
 
-/* Calculate total impact brought by incidents on the edge specified.
+/* Stores incident with impact, see add_incident. Caller must hold writer access.
+ * Affected edges are consumed.
+ *
+ * Parameter(s): vector<unsigned> & affected_edges
+ *               unsigned impact
+ *               time_t start_time
+ *               time_t end_time
+ * Returns: unsigned: incident ID
+ */
+unsigned IMS::IncidentManager::insert_incident(vector<unsigned> &affected_edges, unsigned impact,
+                                               time_t start_time, time_t end_time)
+{
+    // An edge is affected by an incident once
+    sort(affected_edges.begin(), affected_edges.end());
+    affected_edges.erase(unique(affected_edges.begin(), affected_edges.end()), affected_edges.end());
+
+    if(!affected_edges.empty() && affected_edges.back() >= edge_impact.size())
+    {
+        edge_impact.resize(affected_edges.back() + 1, 0);
+        edge_first_window.resize(affected_edges.back() + 1, NO_WINDOW);
+    }
+
+    unsigned incident_id = num_of_incident;
+    incident_t &incident = incidents[incident_id];
+    incident.impact = impact;
+    incident.start_time = start_time;
+    incident.end_time = end_time;
+
+    if(start_time == 0 && end_time == NO_END_TIME)
+    {
+        for(auto & edge : affected_edges)
+        {
+            edge_impact[edge] += impact;
+        }
+    }
+    else
+    {
+        for(auto & edge : affected_edges)
+        {
+            unsigned window = free_window;
+            if(window == NO_WINDOW)
+            {
+                window = windows.size();
+                windows.emplace_back();
+            }
+            else
+            {
+                free_window = windows[window].next;
+            }
+
+            windows[window].start_time = start_time;
+            windows[window].end_time = end_time;
+            windows[window].impact = impact;
+            windows[window].next = edge_first_window[edge];
+            edge_first_window[edge] = window;
+            incident.windows.push_back(window);
+        }
+
+        if(end_time != NO_END_TIME)
+        {
+            expiry_wheel.schedule(end_time, incident_id);
+        }
+    }
+
+    incident.affected_edges.swap(affected_edges);
+    num_of_incident++;
+    return incident_id;
+}
+
+/* Subtracts the impact of an incident from its edges, releases its windows and erases it.
+ * Caller must hold writer access.
+ *
+ * Parameter(s): unordered_map<unsigned, incident_t>::iterator incident
+ * Returns: when incident is erased
+ */
+void IMS::IncidentManager::erase_incident(unordered_map<unsigned, incident_t>::iterator incident)
+{
+    if(incident->second.windows.empty())
+    {
+        for(auto & edge : incident->second.affected_edges)
+        {
+            edge_impact[edge] -= incident->second.impact;
+        }
+    }
+    else
+    {
+        for(unsigned i = 0; i < incident->second.affected_edges.size(); i++)
+        {
+            unsigned window = incident->second.windows[i];
+
+            // Unlink window from the chain of its edge
+            unsigned *link = &edge_first_window[incident->second.affected_edges[i]];
+            while(*link != window)
+            {
+                link = &windows[*link].next;
+            }
+            *link = windows[window].next;
+
+            windows[window].next = free_window;
+            free_window = window;
+        }
+    }
+
+    incidents.erase(incident);
+}
+
+/* Retrieve total impact brought by incidents on the edge specified when entering it at the specified time.
  * Parameter(s): unsigned edge_id
+ *               time_t enter_time: in milliseconds
  * Returns: double: total incident impact
  */
-double IMS::IncidentManager::get_total_incident_impact(unsigned edge_id)
+double IMS::IncidentManager::get_total_incident_impact(unsigned edge_id, time_t enter_time)
 {
     // Lock reader access
     boost::shared_lock<boost::shared_mutex> reader_lock(access);
 
-    if(affected_roads.count(edge_id) == 0)
+    if(edge_id >= edge_impact.size())
     {
         return 0;
     }
 
-    double total_incident_impact = 0;
-    for(auto & incident : affected_roads[edge_id])
+    double total_incident_impact = edge_impact[edge_id];
+    for(unsigned window = edge_first_window[edge_id]; window != NO_WINDOW; window = windows[window].next)
     {
-        total_incident_impact += incidents[incident];
+        if(windows[window].start_time <= enter_time && enter_time < windows[window].end_time)
+        {
+            total_incident_impact += windows[window].impact;
+        }
     }
     return total_incident_impact;
-}
\ No newline at end of file
+}
@@ -11,17 +11,26 @@
 #include <queue>
 #include <algorithm>
 #include <cmath>
+#include <functional>
+#include <chrono>
+#include <set>
+#include <sstream>
+#include <tuple>
+#include <exception>
 
 #include <routingkit/geo_position_to_node.h>
 #include <boost/thread/thread.hpp>
 #include <boost/thread/shared_mutex.hpp>
 
 #include "../include/ims/map_graph.h"
+#include "graph_file.h"
 //#include "partition.h"
 //#include "preprocess.h"
 
 using namespace std;
 
+const unsigned IMS::MapGraph::NO_PROFILE;
+
 /* Destructor for releasing dynamic memory allocated to MapGraph.
  * Parameter(s): NIL
  * Return: when memory is released.
@@ -31,24 +40,131 @@ IMS::MapGraph::~MapGraph()
     delete inversed;
     delete layers;
     delete distance_tables;
+    delete flat_distance_tables;
+    delete boundary_distances;
+    delete weight_profiles;
+    delete compressed;
+    unload_travel_time_functions();
+    IMS::GraphFile::unmap(mapped_file, mapped_file_size);
 }
 
 /* Initialize dynamic fields: current_density, inversed, map_geo_location
+ * The stages are independent and run in parallel, the inversed graph is also built by several threads.
+ * Time of each stage is kept in initialization_timing, see get_initialization_timing.
  * MUST BE CALLED AFTER CREATING CLASS INSTANCE.
  * Parameter: NIL
- * Return: when the fields are initialized
+ * Return: initialization_timing_t: time of each stage. Throws the exception of the first stage that failed, after
+ *         all stages have finished.
  * */
-void IMS::MapGraph::initialize()
+IMS::initialization_timing_t IMS::MapGraph::initialize()
 {
-    for (unsigned i = 0; i < default_travel_time.size(); i++)
+    auto start = chrono::steady_clock::now();
+    auto elapsed_since = [](const chrono::steady_clock::time_point &stage_start)
+    {
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - stage_start).count();
+    };
+
+    // An exception escaping a thread terminates the process, so each stage keeps its own for the caller
+    vector<exception_ptr> errors(4);
+    boost::thread_group stages;
+    stages.create_thread([this, &elapsed_since, &errors]()
+    {
+        try
+        {
+            auto stage_start = chrono::steady_clock::now();
+            current_density.resize(get_num_of_edges());
+            initialization_timing.density_time = elapsed_since(stage_start);
+        }
+        catch (...)
+        {
+            errors[0] = current_exception();
+        }
+    });
+    stages.create_thread([this, &elapsed_since, &errors]()
+    {
+        try
+        {
+            auto stage_start = chrono::steady_clock::now();
+            inversed = inverse();
+            initialization_timing.inverse_time = elapsed_since(stage_start);
+        }
+        catch (...)
+        {
+            errors[1] = current_exception();
+        }
+    });
+    stages.create_thread([this, &elapsed_since, &errors]()
+    {
+        try
+        {
+            auto stage_start = chrono::steady_clock::now();
+            map_geo_position = RoutingKit::GeoPositionToNode(latitude.to_vector(), longitude.to_vector());
+            initialization_timing.geo_index_time = elapsed_since(stage_start);
+        }
+        catch (...)
+        {
+            errors[2] = current_exception();
+        }
+    });
+    if(flat_distance_tables == nullptr && layers != nullptr && distance_tables != nullptr)
     {
-        current_density.emplace_back();
-        current_density[i][0] = 0;
+        // Read from text archive
+        stages.create_thread([this, &elapsed_since, &errors]()
+        {
+            try
+            {
+                auto stage_start = chrono::steady_clock::now();
+                flat_distance_tables = IMS::Preprocess::flatten_distance_table(layers, distance_tables);
+                initialization_timing.distance_table_time = elapsed_since(stage_start);
+            }
+            catch (...)
+            {
+                errors[3] = current_exception();
+            }
+        });
     }
+    stages.join_all();
+    initialization_timing.total_time = elapsed_since(start);
 
-    inversed = inverse();
+    for(auto & error : errors)
+    {
+        if(error != nullptr)
+        {
+            rethrow_exception(error);
+        }
+    }
+    return initialization_timing;
+}
+
+/* Check whether a file is a binary graph file rather than a text archive.
+ * Parameter: const string & input_file_path
+ * Return: bool
+ */
+bool IMS::MapGraph::is_binary_file(const string &input_file_path)
+{
+    return IMS::GraphFile::is_graph_file(input_file_path);
+}
+
+/* Map a binary graph file and initialize. Arrays and distance tables are used in place without parsing or copying.
+ * Parameter: const string & input_file_path
+ *            const bool & verify_checksum
+ * Return: MapGraph *: initialized graph, throws runtime_error on invalid file.
+ */
+IMS::MapGraph * IMS::MapGraph::map_and_initialize(const string &input_file_path, const bool &verify_checksum)
+{
+    auto graph = new MapGraph();
+    try
+    {
+        graph->mapped_file = IMS::GraphFile::map(*graph, input_file_path, graph->mapped_file_size, verify_checksum);
+        graph->initialize();
+    }
+    catch (...)
+    {
+        delete graph;
+        throw;
+    }
 
-    map_geo_position = RoutingKit::GeoPositionToNode(latitude, longitude);
+    return graph;
 }
 
 /** Serialize MapGraph information into persistent file
@@ -63,83 +179,1149 @@ void IMS::MapGraph::serialize(const string &output_file_path)
     ofs.close();
 }
 
+/** Serialize MapGraph into binary graph file, which can be memory-mapped by map_and_initialize
+ * Parameter: const string & output_file_path
+ * Return: when file is written, throws runtime_error if not preprocessed or on failure
+ */
+void IMS::MapGraph::serialize_binary(const string &output_file_path) const
+{
+    IMS::GraphFile::write(*this, output_file_path);
+}
 
-/** Creates an inversed MapGraph for the current graph that contains edges pointing to the opposite side
+/** Replace the graph arrays with a compressed graph, releasing the arrays and the inversed graph.
+ * Routing, updating and reverse geocoding read the compressed graph afterwards,
+ * the graph can no longer be preprocessed, renumbered or serialized.
  * Parameter: NIL
+ * Return: when the graph is compressed
+ */
+void IMS::MapGraph::compress()
+{
+    if (compressed != nullptr)
+    {
+        return;
+    }
+    compressed = new IMS::CompressedGraph(latitude, longitude, head, first_out, default_travel_time, geo_distance);
+
+    latitude.clear();
+    longitude.clear();
+    head.clear();
+    first_out.clear();
+    default_travel_time.clear();
+    geo_distance.clear();
+    delete inversed;
+    inversed = nullptr;
+}
+
+
+/** Creates an inversed MapGraph for the current graph that contains edges pointing to the opposite side
+ * Built as CSR by counting sort on head: each thread counts and scatters the edges into a range of head nodes,
+ * reading all edges but writing only those of its range, so that the threads share one count per node. Inversed
+ * edges of a node are ordered by original edge ID.
+ * Parameter: unsigned num_of_threads: 0 for number of hardware threads, small graphs use one thread
  * Return: InversedGraph: inversed
  */
-IMS::InversedGraph* IMS::MapGraph::inverse()
+IMS::InversedGraph* IMS::MapGraph::inverse(unsigned num_of_threads)
 {
     auto inverse = new InversedGraph();
+    const unsigned num_of_nodes = this->first_out.size();
+    const unsigned num_of_edges = this->head.size();
 
-    // recalcuate inversed edges
-    vector <vector <pair <unsigned, unsigned>>> temp_edges;
-    for (unsigned int node = 0; node < this->first_out.size(); node ++)
+    if (num_of_threads == 0)
     {
-        vector< pair <unsigned, unsigned>> new_edge_container;
-        temp_edges.push_back(new_edge_container);
+        num_of_threads = max(1u, boost::thread::hardware_concurrency());
     }
-    for (unsigned int current_node = 0; current_node < this->first_out.size(); current_node++)
+    if (num_of_edges < PARALLEL_INVERSE_MIN_EDGES || num_of_nodes < num_of_threads)
     {
-        unsigned first_edge = this->first_out[current_node];
-        unsigned last_edge = (current_node == this->first_out.size() -1) ? (this->head.size()) : this->first_out[current_node + 1];
-        for (unsigned int current_edge = first_edge; current_edge < last_edge; current_edge ++)
+        num_of_threads = 1;
+    }
+
+    // Run a task per range of head nodes, [range_first[t], range_first[t + 1])
+    vector<unsigned> range_first(num_of_threads + 1, num_of_nodes);
+    auto run_per_range = [&](const function<void(unsigned, unsigned)> &task)
+    {
+        boost::thread_group threads;
+        for (unsigned t = 1; t < num_of_threads; t++)
         {
-            temp_edges[this->head[current_edge]].push_back(pair <unsigned, unsigned> (current_edge, current_node));
+            threads.create_thread(bind(task, range_first[t], range_first[t + 1]));
         }
+        task(range_first[0], range_first[1]);
+        threads.join_all();
+    };
+
+    // Count inward edges of each node, head nodes split evenly
+    vector<unsigned> position(num_of_nodes, 0);
+    for (unsigned t = 0; t < num_of_threads; t++)
+    {
+        range_first[t] = (unsigned long) num_of_nodes * t / num_of_threads;
     }
+    run_per_range([&](unsigned first_node, unsigned last_node)
+    {
+        for (unsigned current_edge = 0; current_edge < num_of_edges; current_edge++)
+        {
+            unsigned head_node = this->head[current_edge];
+            if (head_node >= first_node && head_node < last_node)
+            {
+                position[head_node]++;
+            }
+        }
+    });
 
-    // translate edges into MapGraph data structure
-    inverse->head.reserve(this->head.size());
-    inverse->first_out.reserve(this->first_out.size());
+    // Prefix sums, then head nodes split into ranges of about the same number of inward edges
+    inverse->first_out.resize(num_of_nodes);
+    fill(range_first.begin() + 1, range_first.end(), num_of_nodes);
     unsigned current_head_position = 0;
-    for (unsigned int new_origin = 0; new_origin < temp_edges.size(); new_origin ++)
+    for (unsigned node = 0, t = 1; node < num_of_nodes; node++)
     {
-        inverse->first_out.push_back(current_head_position);
-        for (unsigned int new_edge = 0; new_edge < temp_edges[new_origin].size(); new_edge ++)
+        while (t < num_of_threads && current_head_position >= (unsigned long) num_of_edges * t / num_of_threads)
         {
-            inverse->head.push_back(temp_edges[new_origin][new_edge].second);
-            inverse->relative_edge[current_head_position] = temp_edges[new_origin][new_edge].first;
-            current_head_position ++;
+            range_first[t++] = node;
         }
+        inverse->first_out[node] = current_head_position;
+        current_head_position += position[node];
+        position[node] = inverse->first_out[node];
     }
+
+    // Scatter, edges in order of ID
+    inverse->head.resize(num_of_edges);
+    inverse->relative_edge.resize(num_of_edges);
+    run_per_range([&](unsigned first_node, unsigned last_node)
+    {
+        for (unsigned current_node = 0; current_node < num_of_nodes; current_node++)
+        {
+            unsigned first_edge = this->first_out[current_node];
+            unsigned last_edge = (current_node == num_of_nodes -1) ? num_of_edges : this->first_out[current_node + 1];
+            for (unsigned current_edge = first_edge; current_edge < last_edge; current_edge++)
+            {
+                unsigned head_node = this->head[current_edge];
+                if (head_node >= first_node && head_node < last_node)
+                {
+                    unsigned inversed_edge = position[head_node]++;
+                    inverse->head[inversed_edge] = current_node;
+                    inverse->relative_edge[inversed_edge] = current_edge;
+                }
+            }
+        }
+    });
+
     return inverse;
 }
 
 
+/* Renumbering */
+
+/* Renumber nodes in partition order, such that nodes of a partition and their outward edges get contiguous IDs.
+ * Parameters: const int & k: number of partitions
+ *             const int & l: number of levels
+ *             const IMS::Partition::partition_scheme_t & scheme: see do_partition
+ * Return: Renumbering: old -> new node and edge IDs
+ */
+IMS::Renumbering IMS::MapGraph::renumber_by_partition(const unsigned &k, const unsigned &l,
+                                                      const IMS::Partition::partition_scheme_t &scheme)
+{
+    if (compressed != nullptr)
+    {
+        throw runtime_error("Compressed MapGraph cannot be renumbered");
+    }
+    latitude.materialize();
+    longitude.materialize();
+    head.materialize();
+    first_out.materialize();
+
+    vector<unsigned int> nodes(latitude.size());
+    for(unsigned i = 0; i < nodes.size(); i++) nodes[i] = i;
+
+    IMS::Partition::partition_tree_t* partitions = IMS::Partition::do_partition(
+            nodes, this->latitude , this->longitude,
+            this->head, this->first_out, this->inversed->head, this->inversed->first_out,
+            k, l, scheme);
+    vector<unsigned> order = IMS::Partition::partition_order(partitions, latitude, longitude);
+    delete partitions;
+
+    return renumber(order);
+}
+
+/* Renumber nodes in the specified order. Outward edges of each node keep their order.
+ * Preprocessed data and density are discarded, dynamic fields are re-initialized.
+ * Parameters: const vector<unsigned> & order: order[new node ID] = old node ID
+ * Return: Renumbering: old -> new node and edge IDs
+ */
+IMS::Renumbering IMS::MapGraph::renumber(const vector<unsigned> &order)
+{
+    Renumbering renumbering;
+    renumbering.new_node_id.resize(order.size());
+    renumbering.new_edge_id.resize(head.size());
+    for (unsigned new_node = 0; new_node < order.size(); new_node++)
+    {
+        renumbering.new_node_id[order[new_node]] = new_node;
+    }
+
+    vector<float> new_latitude(order.size()), new_longitude(order.size());
+    vector<unsigned> new_first_out(order.size());
+    vector<unsigned> new_head(head.size()), new_geo_distance(head.size()), new_default_travel_time(head.size());
+    unsigned current_edge = 0;
+    for (unsigned new_node = 0; new_node < order.size(); new_node++)
+    {
+        unsigned node = order[new_node];
+        new_latitude[new_node] = latitude[node];
+        new_longitude[new_node] = longitude[node];
+        new_first_out[new_node] = current_edge;
+
+        unsigned first_edge = first_out[node];
+        unsigned last_edge = (node == first_out.size() -1) ? (head.size()) : first_out[node + 1];
+        for (unsigned edge = first_edge; edge < last_edge; edge++)
+        {
+            renumbering.new_edge_id[edge] = current_edge;
+            new_head[current_edge] = renumbering.new_node_id[head[edge]];
+            new_geo_distance[current_edge] = geo_distance[edge];
+            new_default_travel_time[current_edge] = default_travel_time[edge];
+            current_edge++;
+        }
+    }
+
+    latitude = move(new_latitude);
+    longitude = move(new_longitude);
+    first_out = move(new_first_out);
+    head = move(new_head);
+    geo_distance = move(new_geo_distance);
+    default_travel_time = move(new_default_travel_time);
+
+    // Discard data of the old numbering
+    delete inversed;
+    delete layers;
+    delete distance_tables;
+    delete flat_distance_tables;
+    delete boundary_distances;
+    delete weight_profiles;
+    inversed = nullptr;
+    layers = nullptr;
+    distance_tables = nullptr;
+    flat_distance_tables = nullptr;
+    boundary_distances = nullptr;
+    weight_profiles = nullptr;
+    unload_travel_time_functions();
+    current_density.clear();
+    initialize();
+
+    return renumbering;
+}
+
+/* Match nodes and edges of this graph to another graph of the same region, e.g. a rebuilt or renumbered map.
+ * A node matches the nearest node of the other graph within radius, an edge matches the edge between the matches
+ * of its tail and head.
+ * Parameters: MapGraph & other: initialized graph
+ *             const float & radius: meter
+ * Return: Renumbering: this -> other node and edge IDs, RoutingKit::invalid_id for nodes and edges not matched
+ */
+IMS::Renumbering IMS::MapGraph::match(MapGraph &other, const float &radius) const
+{
+    Renumbering matching;
+    const unsigned num_of_nodes = get_num_of_nodes();
+    matching.new_node_id.resize(num_of_nodes);
+    matching.new_edge_id.resize(get_num_of_edges(), RoutingKit::invalid_id);
+    for (unsigned node = 0; node < num_of_nodes; node++)
+    {
+        matching.new_node_id[node] = other.find_nearest_node_of_location(get_longitude(node), get_latitude(node), radius);
+    }
+
+    for (unsigned node = 0; node < num_of_nodes; node++)
+    {
+        const unsigned other_tail = matching.new_node_id[node];
+        if (other_tail == RoutingKit::invalid_id)
+        {
+            continue;
+        }
+        for_each_out_edge(node, [&](const unsigned &edge, const unsigned &head)
+        {
+            const unsigned other_head = matching.new_node_id[head];
+            if (other_head != RoutingKit::invalid_id)
+            {
+                unsigned other_edge = other.find_edge(other_tail, other_head);
+                if (other_edge != (unsigned) INFINITY)
+                {
+                    matching.new_edge_id[edge] = other_edge;
+                }
+            }
+        });
+    }
+    return matching;
+}
+
 /* Pre-processing */
 
 /* Entrance function of preprocessing of this MapGraph
  * Parameters: const int & k: number of partitions
  *             const int & l: number of levels
+ *             const unsigned & num_of_threads: see do_preprocess
+ *             const IMS::Partition::partition_scheme_t & scheme: see do_partition
  * Return: when preprocess is done
  */
-void IMS::MapGraph::preprocess(const unsigned &k, const unsigned &l)
+void IMS::MapGraph::preprocess(const unsigned &k, const unsigned &l, const unsigned &num_of_threads,
+                               const IMS::Partition::partition_scheme_t &scheme)
+{
+    IMS::Partition::partition_tree_t* partitions = partition(k, l, scheme);
+    preprocess(partitions, num_of_threads);
+
+    // Release memory
+    delete partitions;
+}
+
+/* Partition this MapGraph, first stage of preprocess.
+ * Parameters: const int & k: number of partitions
+ *             const int & l: number of levels
+ *             const IMS::Partition::partition_scheme_t & scheme: see do_partition
+ * Return: IMS::Partition::partition_tree_t*: indexed partition tree, to be deleted by caller
+ */
+IMS::Partition::partition_tree_t* IMS::MapGraph::partition(const unsigned &k, const unsigned &l,
+                                                      const IMS::Partition::partition_scheme_t &scheme)
 {
+    if (compressed != nullptr)
+    {
+        throw runtime_error("Compressed MapGraph cannot be preprocessed");
+    }
+    // Partitioning and preprocessing take arrays as vectors
+    latitude.materialize();
+    longitude.materialize();
+    head.materialize();
+    first_out.materialize();
+
     // Prepare node information
     vector<unsigned int> nodes(latitude.size());
     for(unsigned i = 0; i < nodes.size(); i++) nodes[i] = i;
 
     // Partition
-    IMS::Partition::partition_t* partitions = IMS::Partition::do_partition(
+    IMS::Partition::partition_tree_t* partitions = IMS::Partition::do_partition(
             nodes, this->latitude , this->longitude,
             this->head, this->first_out, this->inversed->head, this->inversed->first_out,
-            k, l, 0);
+            k, l, scheme);
     IMS::Partition::index_partition(partitions);
-    IMS::Partition::layer_t* layers = IMS::Partition::build_layer(partitions, latitude.size());
+    return partitions;
+}
+
+/* Preprocess the distance tables of a partition of this MapGraph, second stage of preprocess.
+ * Parameters: IMS::Partition::partition_tree_t* partitions: indexed partition tree from partition(k, l)
+ *             const unsigned & num_of_threads: see do_preprocess
+ * Return: when preprocess is done, caller keeps the partition tree
+ */
+void IMS::MapGraph::preprocess(IMS::Partition::partition_tree_t* partitions, const unsigned &num_of_threads)
+{
+    if (compressed != nullptr)
+    {
+        throw runtime_error("Compressed MapGraph cannot be preprocessed");
+    }
+    head.materialize();
+    first_out.materialize();
+    default_travel_time.materialize();
+
+    IMS::Partition::layer_t* layers;
+    IMS::Preprocess::distance_table_t* distance_tables;
+    build_preprocessed(partitions, num_of_threads, layers, distance_tables);
+    set_preprocessed(layers, distance_tables);
+}
+
+/* Build layers and distance tables of a partition without keeping them, e.g. for several (k, l) variants
+ * of this MapGraph in parallel. Arrays must be materialized, see preprocess.
+ * Parameters: IMS::Partition::partition_tree_t* partitions: indexed partition tree from partition(k, l)
+ *             const unsigned & num_of_threads: see do_preprocess
+ *             IMS::Partition::layer_t*& layers: set to the layers built, owned by caller
+ *             IMS::Preprocess::distance_table_t*& distance_tables: set to the distance tables built, owned by caller
+ * Return: when built
+ */
+void IMS::MapGraph::build_preprocessed(IMS::Partition::partition_tree_t* partitions, const unsigned &num_of_threads,
+                                       IMS::Partition::layer_t*& layers,
+                                       IMS::Preprocess::distance_table_t*& distance_tables) const
+{
+    vector<unsigned int> nodes(first_out.size());
+    for(unsigned i = 0; i < nodes.size(); i++) nodes[i] = i;
+
+    layers = IMS::Partition::build_layer(partitions, first_out.size());
 
     // Preprocessing
-    auto distance_tables = IMS::Preprocess::do_preprocess(
+    distance_tables = IMS::Preprocess::do_preprocess(
             nodes,
             this->head, this->first_out, this->default_travel_time,
-            partitions, layers);
-    
-    // save information
+            this->inversed->head, this->inversed->first_out, this->inversed->relative_edge,
+            partitions, layers, num_of_threads);
+}
+
+/* Take preprocessed layers and distance tables, e.g. from preprocess or a checkpoint, and flatten them for routing.
+ * Boundary distances and weight profiles of the replaced partitions are discarded.
+ * Parameters: IMS::Partition::layer_t* layers
+ *             IMS::Preprocess::distance_table_t* distance_tables
+ * Return: when saved, this MapGraph owns both
+ */
+void IMS::MapGraph::set_preprocessed(IMS::Partition::layer_t* layers, IMS::Preprocess::distance_table_t* distance_tables)
+{
+    delete this->layers;
+    delete this->distance_tables;
+    delete this->flat_distance_tables;
+    delete this->boundary_distances;
+    delete this->weight_profiles;
     this->layers = layers;
     this->distance_tables = distance_tables;
+    this->flat_distance_tables = IMS::Preprocess::flatten_distance_table(layers, distance_tables);
+    this->boundary_distances = nullptr;
+    this->weight_profiles = nullptr;
+}
 
-    // Release memory
-    delete partitions;
+/* Preprocess the optional boundary distances of the partitions of this MapGraph, which tighten the heuristic of the
+ * router at the cost of 2 unsigned per node and level, see IMS::Preprocess::boundary_distance_table_t.
+ * Parameters: const IMS::Partition::partition_tree_t* partitions: indexed partition tree this MapGraph is
+ *                                                                 preprocessed with, from partition(k, l)
+ *             const unsigned & num_of_threads: see do_preprocess
+ * Return: when preprocessed, throws runtime_error if this MapGraph is not preprocessed with the partitions
+ */
+void IMS::MapGraph::preprocess_boundary_distances(const IMS::Partition::partition_tree_t* partitions,
+                                                  const unsigned &num_of_threads)
+{
+    if (compressed != nullptr)
+    {
+        throw runtime_error("Compressed MapGraph cannot be preprocessed");
+    }
+    if (layers == nullptr || layers->size() != partitions->num_of_levels() + 1)
+    {
+        throw runtime_error("MapGraph must be preprocessed with the partitions before its boundary distances");
+    }
+    head.materialize();
+    first_out.materialize();
+    default_travel_time.materialize();
+
+    delete boundary_distances;
+    boundary_distances = IMS::Preprocess::do_preprocess_boundary_distances(
+            this->head, this->first_out, this->default_travel_time,
+            this->inversed->head, this->inversed->first_out, this->inversed->relative_edge,
+            partitions, layers, num_of_threads);
+}
+
+/* Set travel time profiles by time of day, which replace the default travel time as base weight of routing, and
+ * preprocess their heuristic, see IMS::Preprocess::weight_profile_table_t. The heuristic takes one set of distance
+ * table entries per profile, routes taking up to max_trip_duration are optimal.
+ * Parameters: const vector<unsigned> & start_times: seconds since local midnight of each profile, ascending
+ *             const vector< vector<unsigned> > & travel_times: travel time (ms) of each edge in each profile
+ *             const int & utc_offset: seconds, local time = UTC + utc_offset
+ *             const IMS::Partition::partition_tree_t* partitions: indexed partition tree this MapGraph is
+ *                                                                 preprocessed with, from partition(k, l)
+ *             const unsigned & num_of_threads: see do_preprocess
+ *             const unsigned & max_trip_duration: seconds, see IMS::Preprocess::preprocess_weight_profiles
+ * Return: when preprocessed, throws runtime_error for invalid profiles or if this MapGraph is not preprocessed
+ *         with the partitions
+ */
+void IMS::MapGraph::set_weight_profiles(const vector<unsigned> &start_times,
+                                        const vector< vector<unsigned> > &travel_times, const int &utc_offset,
+                                        const IMS::Partition::partition_tree_t* partitions,
+                                        const unsigned &num_of_threads, const unsigned &max_trip_duration)
+{
+    if (compressed != nullptr)
+    {
+        throw runtime_error("Compressed MapGraph cannot be preprocessed");
+    }
+    if (flat_distance_tables == nullptr)
+    {
+        throw runtime_error("MapGraph must be preprocessed before its weight profiles");
+    }
+    if (start_times.empty() || start_times.size() != travel_times.size())
+    {
+        throw runtime_error("Each weight profile needs a start time and travel times");
+    }
+    for (unsigned profile = 0; profile < start_times.size(); profile++)
+    {
+        if (start_times[profile] >= 86400 || (profile > 0 && start_times[profile] <= start_times[profile - 1]))
+        {
+            throw runtime_error("Start times of weight profiles must be ascending within a day");
+        }
+        if (travel_times[profile].size() != head.size())
+        {
+            throw runtime_error("Weight profile " + to_string(profile) + " does not have a travel time per edge");
+        }
+    }
+    head.materialize();
+    first_out.materialize();
+
+    auto profiles = new IMS::Preprocess::weight_profile_table_t();
+    profiles->utc_offset = utc_offset;
+    profiles->start_time = start_times;
+    vector<unsigned> travel_time;
+    travel_time.reserve(start_times.size() * (size_t)head.size());
+    for (auto & profile_travel_time : travel_times)
+    {
+        travel_time.insert(travel_time.end(), profile_travel_time.begin(), profile_travel_time.end());
+    }
+    profiles->travel_time = move(travel_time);
+    try
+    {
+        IMS::Preprocess::preprocess_weight_profiles(this->head, this->first_out,
+                                                    this->inversed->head, this->inversed->first_out,
+                                                    this->inversed->relative_edge,
+                                                    partitions, flat_distance_tables, profiles, num_of_threads,
+                                                    max_trip_duration);
+    }
+    catch (runtime_error &e)
+    {
+        delete profiles;
+        throw;
+    }
+    delete weight_profiles;
+    weight_profiles = profiles;
+}
+
+/* Read travel time profiles by time of day from a text file, nodes by ID:
+ *   utc_offset <seconds>              (optional, before the first profile, default 0)
+ *   profile <start time, HH:MM local> [<factor>]
+ *   <from> <to> <travel time (ms)>    (all edges from -> to, in the profile above)
+ * Edges not given in a profile take their default travel time times the factor of the profile, 1 by default.
+ * Profiles must be given in order of start time.
+ * Empty lines and lines starting with # are skipped.
+ * Parameters: const string & input_file_path
+ *             vector<unsigned> & start_times: set to the start times, seconds since local midnight
+ *             vector< vector<unsigned> > & travel_times: set to the travel times of each profile
+ *             int & utc_offset: set to the offset given, 0 otherwise
+ * Return: when read, throws runtime_error for an invalid line, see set_weight_profiles for the use
+ */
+void IMS::MapGraph::read_weight_profiles(const string &input_file_path, vector<unsigned> &start_times,
+                                         vector< vector<unsigned> > &travel_times, int &utc_offset)
+{
+    ifstream ifs(input_file_path);
+    if (!ifs)
+    {
+        throw runtime_error("Cannot read weight profiles: " + input_file_path);
+    }
+    const unsigned num_of_nodes = get_num_of_nodes();
+    start_times.clear();
+    travel_times.clear();
+    utc_offset = 0;
+    string line;
+    unsigned line_number = 0;
+    while (getline(ifs, line))
+    {
+        line_number++;
+        istringstream fields(line);
+        string type;
+        if (!(fields >> type) || type[0] == '#')
+        {
+            continue;
+        }
+        bool is_valid;
+        if (type == "utc_offset")
+        {
+            is_valid = static_cast<bool>(fields >> utc_offset) && start_times.empty();
+        }
+        else if (type == "profile")
+        {
+            unsigned hour, minute;
+            char separator;
+            double factor;
+            is_valid = (fields >> hour >> separator >> minute) && separator == ':' && hour < 24 && minute < 60;
+            if (!(fields >> factor))
+            {
+                is_valid = is_valid && fields.eof();
+                factor = 1;
+            }
+            is_valid = is_valid && factor > 0;
+            start_times.push_back(hour * 3600 + minute * 60);
+            travel_times.push_back(vector<unsigned>(get_num_of_edges()));
+            for (unsigned edge = 0; edge < travel_times.back().size(); edge++)
+            {
+                travel_times.back()[edge] = round(get_travel_time(edge) * factor);
+            }
+        }
+        else
+        {
+            unsigned from, to, travel_time = 0;
+            istringstream edge_fields(line);
+            is_valid = (edge_fields >> from >> to >> travel_time) && !start_times.empty() && from < num_of_nodes
+                       && to < num_of_nodes;
+            bool is_found = false;
+            if (is_valid)
+            {
+                for_each_out_edge(from, [&](const unsigned &edge, const unsigned &head)
+                {
+                    if (head == to)
+                    {
+                        travel_times.back()[edge] = travel_time;
+                        is_found = true;
+                    }
+                });
+            }
+            is_valid = is_valid && is_found;
+        }
+        if (!is_valid)
+        {
+            throw runtime_error("Invalid weight profile at line " + to_string(line_number) + " of " + input_file_path);
+        }
+    }
+}
+
+/* Map historical travel time functions of this MapGraph from a side file, replacing the current ones. They replace
+ * the weight profiles as base travel time of routing, which then uses the heuristic of the default travel time.
+ * Must be called before compress().
+ * Parameters: const string & input_file_path: written by graph_builder --history, see IMS::TravelTimeFunction::write
+ * Return: when mapped, throws runtime_error for an invalid file or one written for another graph
+ */
+void IMS::MapGraph::load_travel_time_functions(const string &input_file_path)
+{
+    auto table = new IMS::TravelTimeFunction::travel_time_function_table_t();
+    size_t mapped_size = 0;
+    void * file = nullptr;
+    try
+    {
+        file = IMS::TravelTimeFunction::map(*table, input_file_path, get_checksum(), head.size(), mapped_size);
+    }
+    catch (runtime_error &e)
+    {
+        delete table;
+        throw;
+    }
+    unload_travel_time_functions();
+    travel_time_functions = table;
+    mapped_functions_file = file;
+    mapped_functions_file_size = mapped_size;
+}
+
+// helper function
+/* Release the travel time functions and their side file, if any.
+ * Parameter: NIL
+ * Return: when released
+ */
+void IMS::MapGraph::unload_travel_time_functions()
+{
+    delete travel_time_functions;
+    travel_time_functions = nullptr;
+    IMS::GraphFile::unmap(mapped_functions_file, mapped_functions_file_size);
+    mapped_functions_file = nullptr;
+    mapped_functions_file_size = 0;
+}
+
+/* Read historical travel times from a text file, nodes by ID:
+ *   utc_offset <seconds>                                 (optional, before the first sample, default 0)
+ *   <from> <to> <time, HH:MM local> <travel time (ms)>   (all edges from -> to)
+ * Edges without samples keep their default travel time all day.
+ * Empty lines and lines starting with # are skipped.
+ * Parameters: const string & input_file_path
+ *             vector< vector< pair<unsigned, unsigned> > > & samples: set to (seconds since local midnight, travel
+ *                                                                    time (ms)) of each edge
+ *             int & utc_offset: set to the offset given, 0 otherwise
+ * Return: when read, throws runtime_error for an invalid line, see IMS::TravelTimeFunction::build for the use
+ */
+void IMS::MapGraph::read_travel_time_history(const string &input_file_path,
+                                             vector< vector< pair<unsigned, unsigned> > > &samples, int &utc_offset)
+{
+    ifstream ifs(input_file_path);
+    if (!ifs)
+    {
+        throw runtime_error("Cannot read travel time history: " + input_file_path);
+    }
+    const unsigned num_of_nodes = get_num_of_nodes();
+    samples.assign(get_num_of_edges(), vector< pair<unsigned, unsigned> >());
+    utc_offset = 0;
+    bool has_samples = false;
+    string line;
+    unsigned line_number = 0;
+    while (getline(ifs, line))
+    {
+        line_number++;
+        istringstream fields(line);
+        string type;
+        if (!(fields >> type) || type[0] == '#')
+        {
+            continue;
+        }
+        bool is_valid;
+        if (type == "utc_offset")
+        {
+            is_valid = static_cast<bool>(fields >> utc_offset) && !has_samples;
+        }
+        else
+        {
+            unsigned from, to, hour, minute, travel_time;
+            char separator;
+            istringstream sample_fields(line);
+            is_valid = (sample_fields >> from >> to >> hour >> separator >> minute >> travel_time) && separator == ':'
+                       && hour < 24 && minute < 60 && from < num_of_nodes && to < num_of_nodes;
+            bool is_found = false;
+            if (is_valid)
+            {
+                for_each_out_edge(from, [&](const unsigned &edge, const unsigned &head)
+                {
+                    if (head == to)
+                    {
+                        samples[edge].push_back(make_pair(hour * 3600 + minute * 60, travel_time));
+                        is_found = true;
+                    }
+                });
+            }
+            is_valid = is_valid && is_found;
+            has_samples = true;
+        }
+        if (!is_valid)
+        {
+            throw runtime_error("Invalid travel time sample at line " + to_string(line_number) + " of "
+                                + input_file_path);
+        }
+    }
+}
+
+/* Incremental pre-processing */
+
+/* Apply changes of edges to this MapGraph and update its preprocessed data for them only.
+ * Nodes keep their IDs and partitions, as partitions depend on node locations only. Boundaries change only for
+ * the partitions containing the end nodes of a changed edge, and distances towards and from the boundary of a parent
+ * only for the children of those partitions, i.e. partitions under the same parent as one containing an end node.
+ * Distances between siblings are found by unbounded searches, so an added or faster edge u -> v may shorten them under
+ * any parent: elsewhere only the siblings of entries a lower bound through u -> v beats are searched again, found by
+ * one search towards u and one from v per such edge. Removed and slower edges only lengthen them, the kept entries
+ * stay lower bounds.
+ * Boundary distances, if preprocessed, are recomputed for the partitions containing an end node.
+ * Edge IDs change, density of kept edges moves to their new IDs. Graphs with weight profiles are not updated.
+ * Parameters: const vector<edge_change_t> & changes: applied in order, see read_edge_changes
+ *             IMS::Partition::partition_tree_t* partitions: indexed partition tree of this MapGraph, from
+ *                                                           partition(k, l) or a build checkpoint, its boundaries
+ *                                                           are updated. Required if this MapGraph is preprocessed
+ *             const unsigned & num_of_threads: see do_preprocess
+ * Return: update_report_t, throws runtime_error without changing this MapGraph if a change is invalid
+ */
+IMS::update_report_t IMS::MapGraph::apply_edge_changes(const vector<edge_change_t> &changes,
+                                                       IMS::Partition::partition_tree_t* partitions,
+                                                       const unsigned &num_of_threads)
+{
+    if (compressed != nullptr)
+    {
+        throw runtime_error("Compressed MapGraph cannot be changed");
+    }
+    if (flat_distance_tables != nullptr && (layers == nullptr || distance_tables == nullptr))
+    {
+        throw runtime_error("MapGraph read from binary graph file cannot be updated, use the text archive");
+    }
+    if (layers != nullptr && (partitions == nullptr || layers->back().size() != first_out.size()))
+    {
+        throw runtime_error("Partitions of the preprocessed MapGraph are required for updating");
+    }
+    if (weight_profiles != nullptr)
+    {
+        throw runtime_error("MapGraph with weight profiles cannot be updated, their travel times are kept by edge ID");
+    }
+    if (travel_time_functions != nullptr)
+    {
+        throw runtime_error("MapGraph with travel time functions cannot be updated, their functions are kept by edge ID");
+    }
+    update_report_t report;
+    auto start = chrono::steady_clock::now();
+
+    // Group changes by tail node, keeping their order
+    const unsigned num_of_nodes = first_out.size();
+    map<unsigned, vector<const edge_change_t*> > changes_of_node;
+    for (auto & change : changes)
+    {
+        if (change.from >= num_of_nodes || change.to >= num_of_nodes)
+        {
+            throw runtime_error("Edge " + to_string(change.from) + " -> " + to_string(change.to)
+                                + " has an unknown node, new nodes need a full build");
+        }
+        changes_of_node[change.from].push_back(&change);
+    }
+
+    // Rebuild the arrays, only edges of changed nodes are touched
+    vector<unsigned> new_head, new_first_out(num_of_nodes), new_travel_time, new_geo_distance;
+    new_head.reserve(head.size() + changes.size());
+    new_travel_time.reserve(head.size() + changes.size());
+    new_geo_distance.reserve(head.size() + changes.size());
+    vector<unsigned> new_edge(head.size(), (unsigned)INFINITY);
+    // (tail, head, travel time) of added and faster edges, the only ones that may shorten a distance
+    vector<tuple<unsigned, unsigned, unsigned> > improved_edges;
+    auto next_changed = changes_of_node.begin();
+    for (unsigned node = 0; node < num_of_nodes; node++)
+    {
+        new_first_out[node] = new_head.size();
+        unsigned first_edge = first_out[node];
+        unsigned last_edge = (node == num_of_nodes - 1) ? (head.size()) : first_out[node + 1];
+        if (next_changed == changes_of_node.end() || next_changed->first != node)
+        {
+            new_head.insert(new_head.end(), head.begin() + first_edge, head.begin() + last_edge);
+            new_travel_time.insert(new_travel_time.end(), default_travel_time.begin() + first_edge,
+                                   default_travel_time.begin() + last_edge);
+            new_geo_distance.insert(new_geo_distance.end(), geo_distance.begin() + first_edge,
+                                    geo_distance.begin() + last_edge);
+            for (unsigned edge = first_edge; edge < last_edge; edge++)
+            {
+                new_edge[edge] = new_first_out[node] + (edge - first_edge);
+            }
+            continue;
+        }
+
+        // (head, travel time, geo distance, current edge ID) of the edges of this node
+        vector<tuple<unsigned, unsigned, unsigned, unsigned> > edges;
+        for (unsigned edge = first_edge; edge < last_edge; edge++)
+        {
+            edges.emplace_back(head[edge], default_travel_time[edge], geo_distance[edge], edge);
+        }
+        for (auto change : next_changed->second)
+        {
+            if (change->type == edge_change_t::ADD)
+            {
+                edges.emplace_back(change->to, change->travel_time, change->geo_distance, (unsigned)INFINITY);
+                report.num_of_edges_added++;
+                improved_edges.emplace_back(change->from, change->to, change->travel_time);
+                continue;
+            }
+            unsigned num_of_matches = 0;
+            for (auto edge = edges.begin(); edge != edges.end();)
+            {
+                if (get<0>(*edge) != change->to)
+                {
+                    edge++;
+                    continue;
+                }
+                num_of_matches++;
+                if (change->type == edge_change_t::REMOVE)
+                {
+                    edge = edges.erase(edge);
+                    continue;
+                }
+                if (change->travel_time < get<1>(*edge))
+                {
+                    improved_edges.emplace_back(change->from, change->to, change->travel_time);
+                }
+                get<1>(*edge) = change->travel_time;
+                edge++;
+            }
+            if (num_of_matches == 0)
+            {
+                throw runtime_error("No edge " + to_string(change->from) + " -> " + to_string(change->to)
+                                    + " to " + (change->type == edge_change_t::REMOVE? "remove" : "retime"));
+            }
+            (change->type == edge_change_t::REMOVE? report.num_of_edges_removed : report.num_of_edges_retimed)
+                    += num_of_matches;
+        }
+        for (auto & edge : edges)
+        {
+            if (get<3>(edge) != (unsigned)INFINITY)
+            {
+                new_edge[get<3>(edge)] = new_head.size();
+            }
+            new_head.push_back(get<0>(edge));
+            new_travel_time.push_back(get<1>(edge));
+            new_geo_distance.push_back(get<2>(edge));
+        }
+        next_changed++;
+    }
+
+    head = move(new_head);
+    first_out = move(new_first_out);
+    default_travel_time = move(new_travel_time);
+    geo_distance = move(new_geo_distance);
+    delete inversed;
+    inversed = inverse();
+    current_density.remap(new_edge, head.size());
+    report.edge_time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    if (layers == nullptr)
+    {
+        return report;
+    }
+    start = chrono::steady_clock::now();
+
+    // Partition at each level containing a node, level 0 is the root
+    const unsigned num_of_levels = layers->size() - 1;
+    auto find_partition = [&](const unsigned &node, const unsigned &level)
+    {
+        unsigned id = layers->back()[node];
+        for (unsigned i = num_of_levels - 1; i > level; i--)
+        {
+            id = (*layers)[i][id];
+        }
+        // Partitions are stored level by level, IDs are positions within the level
+        return partitions->level_first[level] + id;
+    };
+    auto is_in = [&](const unsigned &node, const unsigned &p)
+    {
+        return find_partition(node, partitions->layer[p]) == p;
+    };
+    // Boundaries being updated, copied from the partition tree on first change
+    map<unsigned, vector<unsigned> > boundary_outwards, boundary_inwards;
+    auto boundary_of = [](map<unsigned, vector<unsigned> > &boundaries, const unsigned &p,
+                          const IMS::Partition::span_t &current) -> vector<unsigned> &
+    {
+        auto found = boundaries.find(p);
+        if (found == boundaries.end())
+        {
+            found = boundaries.insert(make_pair(p, vector<unsigned>(current.begin(), current.end()))).first;
+        }
+        return found->second;
+    };
+    // Add or remove node in a sorted boundary, returns whether it changed
+    auto update_boundary = [](vector<unsigned> &boundary, const unsigned &node, const bool &is_boundary)
+    {
+        auto position = lower_bound(boundary.begin(), boundary.end(), node);
+        bool was_boundary = position != boundary.end() && *position == node;
+        if (is_boundary && !was_boundary)
+        {
+            boundary.insert(position, node);
+        }
+        else if (!is_boundary && was_boundary)
+        {
+            boundary.erase(position);
+        }
+        return is_boundary != was_boundary;
+    };
+
+    set<unsigned> changed_nodes;
+    for (auto & change : changes)
+    {
+        changed_nodes.insert(change.from);
+        changed_nodes.insert(change.to);
+    }
+    set<unsigned> changed_boundaries;
+    set<unsigned> changed_parents;
+    vector<unsigned> changed_partitions;
+    for (auto node : changed_nodes)
+    {
+        for (unsigned level = 1; level < num_of_levels; level++)
+        {
+            unsigned p = find_partition(node, level);
+            bool is_outward = false;
+            for_each_out_edge(node, [&](const unsigned &, const unsigned &head)
+            {
+                is_outward = is_outward || !is_in(head, p);
+            });
+            bool is_inward = false;
+            unsigned last_edge = (node == num_of_nodes - 1) ? (inversed->head.size()) : inversed->first_out[node + 1];
+            for (unsigned edge = inversed->first_out[node]; edge < last_edge && !is_inward; edge++)
+            {
+                is_inward = !is_in(inversed->head[edge], p);
+            }
+            if (update_boundary(boundary_of(boundary_outwards, p, partitions->outwards_of(p)), node, is_outward)
+                | update_boundary(boundary_of(boundary_inwards, p, partitions->inwards_of(p)), node, is_inward))
+            {
+                changed_boundaries.insert(p);
+            }
+            // Entries of children depend on the parent boundaries and the edges within the parent
+            changed_parents.insert(partitions->parent[p]);
+            changed_partitions.push_back(p);
+        }
+    }
+    IMS::Partition::replace_boundaries(partitions, boundary_outwards, boundary_inwards);
+    report.num_of_boundaries_changed = changed_boundaries.size();
+
+    vector<unsigned> to_preprocess;
+    for (auto parent : changed_parents)
+    {
+        for (unsigned sp = partitions->child_first[parent]; sp < partitions->child_first[parent + 1]; sp++)
+        {
+            to_preprocess.push_back(sp);
+        }
+    }
+
+    // Distances of every node towards (is_backward) or from a node in the changed graph
+    auto search = [&](const unsigned &source, const bool &is_backward)
+    {
+        const vector<unsigned> &search_head = is_backward? inversed->head : (const vector<unsigned> &)head;
+        const vector<unsigned> &search_first_out = is_backward? inversed->first_out
+                                                               : (const vector<unsigned> &)first_out;
+        vector<unsigned> dist(num_of_nodes, (unsigned)INFINITY);
+        priority_queue<pair<unsigned, unsigned>, vector<pair<unsigned, unsigned>>, greater<pair<unsigned, unsigned>>> q;
+        dist[source] = 0;
+        q.push(make_pair(0, source));
+        while (!q.empty())
+        {
+            unsigned u = q.top().second;
+            unsigned dist_u = q.top().first;
+            q.pop();
+            if (dist_u > dist[u])
+            {
+                continue;
+            }
+            unsigned last_edge = (u == num_of_nodes - 1) ? (search_head.size()) : search_first_out[u + 1];
+            for (unsigned edge = search_first_out[u]; edge < last_edge; edge++)
+            {
+                unsigned travel_time = default_travel_time[is_backward? inversed->relative_edge[edge] : edge];
+                unsigned v = search_head[edge];
+                if (dist[v] > dist_u + travel_time)
+                {
+                    dist[v] = dist_u + travel_time;
+                    q.push(make_pair(dist[v], v));
+                }
+            }
+        }
+        return dist;
+    };
+
+    // Sibling distances elsewhere change only if a path through an improved edge u -> v beats them, their lower
+    // bound is the distance from the outward boundary of A to u, the edge and the distance from v into B
+    set<unsigned> to_resweep;
+    for (auto & edge : improved_edges)
+    {
+        vector<unsigned> towards_tail = search(get<0>(edge), true);
+        vector<unsigned> from_head = search(get<1>(edge), false);
+        vector<unsigned> best_from(partitions->num_of_partitions(), (unsigned)INFINITY);
+        vector<unsigned> best_to(partitions->num_of_partitions(), (unsigned)INFINITY);
+        for (unsigned node = 0; node < num_of_nodes; node++)
+        {
+            for (unsigned level = 1; level < num_of_levels; level++)
+            {
+                unsigned p = find_partition(node, level);
+                IMS::Partition::span_t outwards = partitions->outwards_of(p);
+                if (towards_tail[node] < best_from[p] && binary_search(outwards.begin(), outwards.end(), node))
+                {
+                    best_from[p] = towards_tail[node];
+                }
+                best_to[p] = min(best_to[p], from_head[node]);
+            }
+        }
+        for (unsigned sp = 1; sp < partitions->num_of_partitions(); sp++)
+        {
+            const unsigned parent = partitions->parent[sp];
+            if (best_from[sp] == (unsigned)INFINITY || changed_parents.count(parent) > 0)
+            {
+                continue;
+            }
+            const IMS::Preprocess::entry_t &entry = (*distance_tables)[partitions->layer[sp]][partitions->id[sp]];
+            for (unsigned target = partitions->child_first[parent]; target < partitions->child_first[parent + 1];
+                 target++)
+            {
+                auto stored = entry.partition_distance.find(partitions->id[target]);
+                if (best_to[target] != (unsigned)INFINITY
+                    && (stored == entry.partition_distance.end()
+                        || (uint64_t)best_from[sp] + get<2>(edge) + best_to[target] < stored->second))
+                {
+                    to_resweep.insert(sp);
+                    break;
+                }
+            }
+        }
+    }
+
+    IMS::Preprocess::preprocess_partitions(head, first_out, default_travel_time,
+                                           inversed->head, inversed->first_out, inversed->relative_edge,
+                                           partitions, to_preprocess, layers, distance_tables, num_of_threads);
+    if (!to_resweep.empty())
+    {
+        // Their parents are unchanged, the bound distances are kept
+        IMS::Preprocess::preprocess_partitions(head, first_out, default_travel_time,
+                                               inversed->head, inversed->first_out, inversed->relative_edge,
+                                               partitions, vector<unsigned>(to_resweep.begin(), to_resweep.end()),
+                                               layers, distance_tables, num_of_threads, false);
+    }
+    delete flat_distance_tables;
+    flat_distance_tables = IMS::Preprocess::flatten_distance_table(layers, distance_tables);
+    if (boundary_distances != nullptr)
+    {
+        // Boundary distances within a partition depend on its boundaries and its edges only
+        sort(changed_partitions.begin(), changed_partitions.end());
+        changed_partitions.erase(unique(changed_partitions.begin(), changed_partitions.end()),
+                                 changed_partitions.end());
+        IMS::Preprocess::preprocess_boundary_distances(head, first_out, default_travel_time,
+                                                       inversed->head, inversed->first_out, inversed->relative_edge,
+                                                       partitions, changed_partitions, layers, boundary_distances,
+                                                       num_of_threads);
+    }
+
+    report.num_of_entries_recomputed = to_preprocess.size() + to_resweep.size();
+    for (auto & level : *distance_tables)
+    {
+        report.num_of_entries += level.size();
+    }
+    // Entries of the root are not computed
+    report.num_of_entries -= (*distance_tables)[0].size();
+    report.preprocess_time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return report;
+}
+
+/* Read changes of edges from a text file, one per line, nodes by ID:
+ *   add <from> <to> <travel time (ms)> <geo distance (m)>
+ *   remove <from> <to>        (all edges from -> to)
+ *   retime <from> <to> <travel time (ms)>
+ * Empty lines and lines starting with # are skipped.
+ * Parameters: const string & input_file_path
+ * Return: vector<edge_change_t>, throws runtime_error for an invalid line
+ */
+vector<IMS::edge_change_t> IMS::MapGraph::read_edge_changes(const string &input_file_path)
+{
+    ifstream ifs(input_file_path);
+    if (!ifs)
+    {
+        throw runtime_error("Cannot read edge changes: " + input_file_path);
+    }
+    vector<edge_change_t> changes;
+    string line;
+    unsigned line_number = 0;
+    while (getline(ifs, line))
+    {
+        line_number++;
+        istringstream fields(line);
+        string type;
+        if (!(fields >> type) || type[0] == '#')
+        {
+            continue;
+        }
+        edge_change_t change;
+        bool is_valid = static_cast<bool>(fields >> change.from >> change.to);
+        if (type == "add")
+        {
+            change.type = edge_change_t::ADD;
+            is_valid = is_valid && (fields >> change.travel_time >> change.geo_distance);
+        }
+        else if (type == "remove")
+        {
+            change.type = edge_change_t::REMOVE;
+        }
+        else if (type == "retime")
+        {
+            change.type = edge_change_t::RETIME;
+            is_valid = is_valid && (fields >> change.travel_time);
+        }
+        else
+        {
+            is_valid = false;
+        }
+        if (!is_valid)
+        {
+            throw runtime_error("Invalid edge change at line " + to_string(line_number) + " of " + input_file_path);
+        }
+        changes.push_back(change);
+    }
+    return changes;
+}
+
+/* Read the preprocessed data of a (k, l) variant of this MapGraph from overlay file, replacing the current one.
+ * Parameters: const string & input_file_path: written by serialize_overlay or graph_builder
+ * Return: when read, throws runtime_error if the overlay is written for another graph
+ */
+void IMS::MapGraph::load_overlay(const string &input_file_path)
+{
+    IMS::Partition::layer_t* layers;
+    IMS::Preprocess::distance_table_t* distance_tables;
+    IMS::Preprocess::read_overlay(input_file_path, get_checksum(), layers, distance_tables);
+    set_preprocessed(layers, distance_tables);
+}
+
+/* Write the preprocessed data of this MapGraph as overlay file.
+ * Parameters: const string & output_file_path
+ * Return: when written
+ */
+void IMS::MapGraph::serialize_overlay(const string &output_file_path) const
+{
+    if (layers == nullptr || distance_tables == nullptr)
+    {
+        throw runtime_error("MapGraph read from binary graph file cannot be saved as overlay");
+    }
+    IMS::Preprocess::write_overlay(output_file_path, get_checksum(), layers, distance_tables);
+}
+
+/* Checksum of the arrays preprocessed data depends on: head, first_out and default_travel_time.
+ * Parameters: NIL
+ * Return: uint64_t
+ */
+uint64_t IMS::MapGraph::get_checksum() const
+{
+    if (compressed != nullptr)
+    {
+        throw runtime_error("Compressed MapGraph has no checksum");
+    }
+    uint64_t checksum = IMS::GraphFile::checksum(reinterpret_cast<const char*>(head.data()),
+                                                  head.size() * sizeof(unsigned));
+    checksum = (checksum ^ IMS::GraphFile::checksum(reinterpret_cast<const char*>(first_out.data()),
+                                                    first_out.size() * sizeof(unsigned))) * 1099511628211ULL;
+    checksum = (checksum ^ IMS::GraphFile::checksum(reinterpret_cast<const char*>(default_travel_time.data()),
+                                                    default_travel_time.size() * sizeof(unsigned))) * 1099511628211ULL;
+    return checksum;
 }
 
 /* Routing */
@@ -151,16 +1333,15 @@ void IMS::MapGraph::preprocess(const unsigned &k, const unsigned &l)
  */
 unsigned IMS::MapGraph::find_edge(const unsigned &from, const unsigned &to)
 {
-    unsigned first_edge = first_out[from];
-    unsigned last_edge = (from == first_out.size() -1) ? (head.size()) : first_out[from + 1];
-    for (unsigned int current_edge = first_edge; current_edge < last_edge; current_edge ++)
+    unsigned found_edge = (unsigned) INFINITY;
+    for_each_out_edge(from, [&found_edge, &to](const unsigned &edge, const unsigned &head)
     {
-        if (head[current_edge] == to)
+        if (head == to && found_edge == (unsigned) INFINITY)
         {
-            return current_edge;
+            found_edge = edge;
         }
-    }
-    return INFINITY;
+    });
+    return found_edge;
 }
 
 /* Find latest effective density: that with time less than or equal to the enter time.
@@ -173,8 +1354,13 @@ double IMS::MapGraph::find_current_density(unsigned edge, time_t enter_time)
     // Lock reader access
     boost::shared_lock<boost::shared_mutex> reader_lock(access);
 
-    auto latest_density = current_density[edge].lower_bound(enter_time);
-    if(latest_density->first == enter_time)
+    const map<time_t, double> * density = current_density.find(edge);
+    if(density == nullptr)
+    {
+        return 0;
+    }
+    auto latest_density = density->lower_bound(enter_time);
+    if(latest_density != density->end() && latest_density->first == enter_time)
     {
         return latest_density->second;
     }
@@ -208,7 +1394,7 @@ void IMS::MapGraph::inject_impact_of_routed_path(IMS::Path *path)
         edge = enter_time_edge.second;
         enter_time = enter_time_edge.first;
         leave_time = next_enter_time_edge == path->enter_times.end()? path->end_time : next_enter_time_edge->first;
-        density_delta = geo_distance[edge] == 0? max_density : 1.0 / geo_distance[edge];
+        density_delta = get_geo_distance(edge) == 0? max_density : 1.0 / get_geo_distance(edge);
 
         if(enter_time == 0 || leave_time == 0)
         {
@@ -218,7 +1404,7 @@ void IMS::MapGraph::inject_impact_of_routed_path(IMS::Path *path)
         // When vehicle leaves edge, restore density
         // Case where leave_time exists can be skipped as traffic density will be retained as the same anyways
         auto before_leave_time = current_density[edge].lower_bound(leave_time);
-        if(before_leave_time->first != leave_time)
+        if(before_leave_time == current_density[edge].end() || before_leave_time->first != leave_time)
         {
             current_density[edge].insert(make_pair(leave_time, (--before_leave_time)->second));
         }
@@ -254,6 +1440,44 @@ void IMS::MapGraph::remove_impact_of_routed_path(IMS::Path *path)
     boost::upgrade_lock<boost::shared_mutex> writer_lock(access);
     boost::upgrade_to_unique_lock<boost::shared_mutex> unique_lock(writer_lock);
 
+    subtract_impact_of_routed_path(path);
+}
+
+/* Remove the impact of a batch of paths under a single writer lock, then compact the density
+ * of every touched edge: critical times before compact_before are folded into the initial entry
+ * and entries which no longer change the density are dropped.
+ * Parameter(s): const vector<IMS::Path *> & paths
+ *               const time_t & compact_before: density before this time is no longer needed
+ * Returns: when update is done.
+ */
+void IMS::MapGraph::remove_impact_of_routed_paths(const vector<IMS::Path *> &paths, const time_t &compact_before)
+{
+    // Lock exclusive writer access
+    boost::upgrade_lock<boost::shared_mutex> writer_lock(access);
+    boost::upgrade_to_unique_lock<boost::shared_mutex> unique_lock(writer_lock);
+
+    vector<unsigned> touched_edges;
+    for(auto path : paths)
+    {
+        subtract_impact_of_routed_path(path, &touched_edges);
+    }
+
+    sort(touched_edges.begin(), touched_edges.end());
+    touched_edges.erase(unique(touched_edges.begin(), touched_edges.end()), touched_edges.end());
+    for(auto edge : touched_edges)
+    {
+        compact_density(edge, compact_before);
+    }
+}
+
+/* Subtract the density brought by the specified path. Caller must hold writer access.
+ * Critical times of the path are restored first if they have been compacted away.
+ * Parameter(s): IMS::Path * path
+ *               vector<unsigned> * touched_edges: optional, edges of the path are appended
+ * Returns: when update is done.
+ */
+void IMS::MapGraph::subtract_impact_of_routed_path(IMS::Path *path, vector<unsigned> *touched_edges)
+{
     unsigned edge;
     time_t enter_time, leave_time;
     double density_delta;
@@ -265,7 +1489,19 @@ void IMS::MapGraph::remove_impact_of_routed_path(IMS::Path *path)
         edge = enter_time_edge.second;
         enter_time = enter_time_edge.first;
         leave_time = next_enter_time_edge == path->enter_times.end()? path->end_time : next_enter_time_edge->first;
-        density_delta = geo_distance[edge] == 0? max_density : 1.0 / geo_distance[edge];
+        density_delta = get_geo_distance(edge) == 0? max_density : 1.0 / get_geo_distance(edge);
+
+        // Restore critical times when vehicle leaves and enters edge
+        auto before_leave_time = current_density[edge].lower_bound(leave_time);
+        if(before_leave_time == current_density[edge].end() || before_leave_time->first != leave_time)
+        {
+            current_density[edge].insert(make_pair(leave_time, (--before_leave_time)->second));
+        }
+        auto before_enter_time = current_density[edge].lower_bound(enter_time);
+        if(before_enter_time->first != enter_time)
+        {
+            current_density[edge].insert(make_pair(enter_time, (--before_enter_time)->second));
+        }
 
         // When vehicle enters edge
         current_density[edge][enter_time] -= density_delta;
@@ -276,10 +1512,59 @@ void IMS::MapGraph::remove_impact_of_routed_path(IMS::Path *path)
             intermediate->second -= density_delta;
         }
 
+        if(touched_edges != NULL)
+        {
+            touched_edges->push_back(edge);
+        }
+
         next_enter_time_edge++;
     }
 }
 
+/* Fold critical times before the specified time into the initial entry (time 0) of the edge,
+ * and drop critical times which do not change the density. An edge left with density 0 all the time is released.
+ * Caller must hold writer access.
+ * Density at or after the specified time is unchanged.
+ * Parameter(s): const unsigned & edge
+ *               const time_t & before
+ * Returns: when compaction is done.
+ */
+void IMS::MapGraph::compact_density(const unsigned &edge, const time_t &before)
+{
+    // Tolerance for rounding errors accumulated by adding and subtracting density deltas
+    const double epsilon = 1e-12;
+    map<time_t, double> &density = current_density[edge];
+
+    auto effective = density.upper_bound(before);
+    --effective;
+    density.begin()->second = effective->second;
+    density.erase(++density.begin(), ++effective);
+
+    double previous = density.begin()->second;
+    if(fabs(previous) < epsilon)
+    {
+        density.begin()->second = previous = 0;
+    }
+    for(auto entry = ++density.begin(); entry != density.end();)
+    {
+        if(fabs(entry->second - previous) < epsilon)
+        {
+            entry = density.erase(entry);
+        }
+        else
+        {
+            previous = entry->second;
+            entry++;
+        }
+    }
+
+    // No vehicle left on the edge
+    if(density.size() == 1 && density.begin()->second == 0)
+    {
+        current_density.release(edge);
+    }
+}
+
 /* Reverse Geocoding */
 
 /* Determine if point q is in range / linear with line formed by points p1 and p2
@@ -330,17 +1615,18 @@ vector<unsigned> IMS::MapGraph::find_nearest_edge_of_location(const float &longi
                                                                   const float &offset)
 {
     vector<unsigned> nearest_edges;
-    for(unsigned tail = 0; tail < first_out.size(); tail++)
+    const unsigned num_of_nodes = get_num_of_nodes();
+    for(unsigned tail = 0; tail < num_of_nodes; tail++)
     {
-        for(unsigned edge = first_out[tail];
-            (tail+1 < first_out.size() && edge < first_out[tail+1]) || (tail+1 == first_out.size() && edge < head.size());
-            edge++)
+        const float tail_longi = get_longitude(tail);
+        const float tail_lat = get_latitude(tail);
+        for_each_out_edge(tail, [&](const unsigned &edge, const unsigned &head)
         {
-            if(is_in_line_range(longitude[tail], latitude[tail], longitude[head[edge]], latitude[head[edge]], longi, lat, offset))
+            if(is_in_line_range(tail_longi, tail_lat, get_longitude(head), get_latitude(head), longi, lat, offset))
             {
                 nearest_edges.push_back(edge);
             }
-        }
+        });
     }
 
     return nearest_edges;
@@ -367,15 +1653,13 @@ unsigned IMS::MapGraph::find_nearest_node_of_location(const float &longi, const
  */
 void IMS::MapGraph::print_graph()
 {
-    for (unsigned node = 0; node < this->first_out.size(); node ++)
+    for (unsigned node = 0; node < get_num_of_nodes(); node ++)
     {
         cout << "[" << node << "] -> ";
-        unsigned first_edge = this->first_out[node];
-        unsigned last_edge = (node == this->first_out.size() -1) ? (this->head.size()) : this->first_out[node + 1];
-        for (unsigned edge = first_edge; edge < last_edge; edge ++)
+        for_each_out_edge(node, [](const unsigned &, const unsigned &head)
         {
-            cout << this->head[edge] << ", ";
-        }
+            cout << head << ", ";
+        });
         cout << endl;
     }
 }
@@ -8,7 +8,8 @@
 #include <iostream>
 #include <cmath>
 #include <queue>
-#include <unordered_set>
+#include <algorithm>
+#include <cstdint>
 
 #include "partition.h"
 
@@ -69,8 +70,371 @@ unordered_map<long, vector<unsigned> > IMS::Partition::grid_partition
 }
 
 
-/* Recursive function of partitioning
+// helper function
+/* Bisect nodes by inertial flow: nodes are projected onto a line, the first and last INERTIAL_FLOW_BALANCE of them
+ * are fixed to either side, and a minimum cut between them is found by max flow over the roads among the nodes,
+ * each with capacity 1 in both directions. More nodes are fixed where the size bounds of the source side require,
+ * so the cut falls within them. Of the cuts of 4 lines, also with INERTIAL_FLOW_TIGHT_BALANCE fixed, the one with
+ * the fewest cut roads per node of its smaller side is taken, ties by balance.
+ * Parameters: const vector<unsigned> & nodes: at least 2
+ *             const vector<float> & latitude
+ *             const vector<float> & longitude
+ *             const vector<unsigned> & head
+ *             const vector<unsigned> & first_out
+ *             const unsigned & min_source_side, max_source_side: bounds of the source side, 1 <= min <= max < n
+ * Return: vector<bool>: whether nodes[i] is on the source side, which has min_source_side to max_source_side nodes
+ */
+static vector<bool> inertial_flow_bisect
+        (const vector<unsigned> &nodes,
+         const vector<float> &latitude,
+         const vector<float> &longitude,
+         const vector<unsigned> &head,
+         const vector<unsigned> &first_out,
+         const unsigned &min_source_side,
+         const unsigned &max_source_side)
+{
+    const unsigned n = nodes.size();
+    const unsigned source = n, sink = n + 1;
+    unordered_map<unsigned, unsigned> local;
+    double lat_sum = 0;
+    for (unsigned i = 0; i < n; i++)
+    {
+        local[nodes[i]] = i;
+        lat_sum += latitude[nodes[i]];
+    }
+
+    // residual network, arc a and a ^ 1 are reverse of each other
+    vector<unsigned> arc_head, arc_capacity;
+    vector< vector<unsigned> > arcs(n + 2);
+    auto add_arc = [&](const unsigned &from, const unsigned &to, const unsigned &capacity, const unsigned &reverse_capacity)
+    {
+        arcs[from].push_back(arc_head.size());
+        arc_head.push_back(to);
+        arc_capacity.push_back(capacity);
+        arcs[to].push_back(arc_head.size());
+        arc_head.push_back(from);
+        arc_capacity.push_back(reverse_capacity);
+    };
+    for (unsigned i = 0; i < n; i++)
+    {
+        unsigned node = nodes[i];
+        unsigned last_edge = (node == first_out.size() -1) ? (head.size()) : first_out[node + 1];
+        for (unsigned edge = first_out[node]; edge < last_edge; edge++)
+        {
+            auto to = local.find(head[edge]);
+            if (to == local.end() || to->second == i)
+            {
+                continue;
+            }
+            // a road in both directions is added once, by its edge from the smaller node
+            bool is_two_way = false;
+            unsigned other = head[edge];
+            unsigned other_last_edge = (other == first_out.size() -1) ? (head.size()) : first_out[other + 1];
+            for (unsigned other_edge = first_out[other]; other_edge < other_last_edge && !is_two_way; other_edge++)
+            {
+                is_two_way = head[other_edge] == node;
+            }
+            if (!is_two_way || node < other)
+            {
+                add_arc(i, to->second, 1, 1);
+            }
+        }
+    }
+    const unsigned num_of_graph_arcs = arc_head.size();
+
+    // longitude scaled to the length of a degree of latitude
+    const double longitude_scale = cos(lat_sum / n * M_PI / 180);
+    const double directions[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
+    const double shares[2] = {INERTIAL_FLOW_BALANCE, INERTIAL_FLOW_TIGHT_BALANCE};
+
+    vector<bool> best_side;
+    unsigned best_cut = (unsigned)INFINITY;
+    unsigned best_min_side = 1;
+    unsigned best_imbalance = (unsigned)INFINITY;
+    for (auto & direction : directions)
+    {
+        vector<unsigned> order(n);
+        vector<double> projection(n);
+        for (unsigned i = 0; i < n; i++)
+        {
+            order[i] = i;
+            projection[i] = direction[0] * longitude[nodes[i]] * longitude_scale + direction[1] * latitude[nodes[i]];
+        }
+        stable_sort(order.begin(), order.end(), [&projection](const unsigned &a, const unsigned &b)
+        {
+            return projection[a] < projection[b];
+        });
+
+        for (auto share : shares)
+        {
+            // reset the network, then fix the ends of the projection to the source and the sink
+            arc_head.resize(num_of_graph_arcs);
+            arc_capacity.resize(num_of_graph_arcs);
+            for (unsigned a = 0; a < num_of_graph_arcs; a++)
+            {
+                arc_capacity[a] = 1;
+            }
+            for (auto & node_arcs : arcs)
+            {
+                while (!node_arcs.empty() && node_arcs.back() >= num_of_graph_arcs)
+                {
+                    node_arcs.pop_back();
+                }
+            }
+            // fixed nodes cannot be cut off, their arcs take more than all roads
+            const unsigned num_of_fixed = min(max(1u, (unsigned) ceil(n * share)), n / 2);
+            unsigned num_of_source_fixed = max(num_of_fixed, min_source_side);
+            unsigned num_of_sink_fixed = max(num_of_fixed, n - max_source_side);
+            if (num_of_source_fixed + num_of_sink_fixed > n)
+            {
+                // only one of them exceeds num_of_fixed, as min_source_side <= max_source_side
+                if (num_of_source_fixed > num_of_fixed) num_of_sink_fixed = n - num_of_source_fixed;
+                else num_of_source_fixed = n - num_of_sink_fixed;
+            }
+            for (unsigned i = 0; i < num_of_source_fixed; i++)
+            {
+                add_arc(source, order[i], num_of_graph_arcs + 1, 0);
+            }
+            for (unsigned i = 0; i < num_of_sink_fixed; i++)
+            {
+                add_arc(order[n - 1 - i], sink, num_of_graph_arcs + 1, 0);
+            }
+
+            // Dinic: augment along a blocking flow of shortest paths, until the sink is cut off
+            unsigned cut = 0;
+            vector<int> level(n + 2);
+            vector<unsigned> next_arc(n + 2);
+            vector<unsigned> path;
+            while (true)
+            {
+                fill(level.begin(), level.end(), -1);
+                queue<unsigned> frontier;
+                frontier.push(source);
+                level[source] = 0;
+                while (!frontier.empty())
+                {
+                    unsigned u = frontier.front();
+                    frontier.pop();
+                    for (auto a : arcs[u])
+                    {
+                        if (arc_capacity[a] > 0 && level[arc_head[a]] < 0)
+                        {
+                            level[arc_head[a]] = level[u] + 1;
+                            frontier.push(arc_head[a]);
+                        }
+                    }
+                }
+                if (level[sink] < 0)
+                {
+                    break;
+                }
+
+                fill(next_arc.begin(), next_arc.end(), 0);
+                path.clear();
+                unsigned u = source;
+                while (true)
+                {
+                    if (u == sink)
+                    {
+                        // graph arcs have capacity 1, so every path carries 1 unit
+                        for (auto a : path)
+                        {
+                            arc_capacity[a]--;
+                            arc_capacity[a ^ 1]++;
+                        }
+                        cut++;
+                        path.clear();
+                        u = source;
+                        continue;
+                    }
+                    while (next_arc[u] < arcs[u].size())
+                    {
+                        unsigned a = arcs[u][next_arc[u]];
+                        if (arc_capacity[a] > 0 && level[arc_head[a]] == level[u] + 1)
+                        {
+                            break;
+                        }
+                        next_arc[u]++;
+                    }
+                    if (next_arc[u] < arcs[u].size())
+                    {
+                        unsigned a = arcs[u][next_arc[u]];
+                        path.push_back(a);
+                        u = arc_head[a];
+                    }
+                    else if (u == source)
+                    {
+                        break;
+                    }
+                    else
+                    {
+                        // dead end, retreat
+                        level[u] = -1;
+                        u = arc_head[path.back() ^ 1];
+                        path.pop_back();
+                        next_arc[u]++;
+                    }
+                }
+            }
+
+            // nodes reached from the source in the residual network are the source side of the minimum cut nearest the
+            // source, nodes reaching the sink are the sink side of the one nearest the sink
+            vector<bool> reached(n + 2, false);
+            vector<bool> reaching(n + 2, false);
+            queue<unsigned> frontier;
+            frontier.push(source);
+            reached[source] = true;
+            while (!frontier.empty())
+            {
+                unsigned u = frontier.front();
+                frontier.pop();
+                for (auto a : arcs[u])
+                {
+                    if (arc_capacity[a] > 0 && !reached[arc_head[a]])
+                    {
+                        reached[arc_head[a]] = true;
+                        frontier.push(arc_head[a]);
+                    }
+                }
+            }
+            frontier.push(sink);
+            reaching[sink] = true;
+            while (!frontier.empty())
+            {
+                unsigned u = frontier.front();
+                frontier.pop();
+                for (auto a : arcs[u])
+                {
+                    if (arc_capacity[a ^ 1] > 0 && !reaching[arc_head[a]])
+                    {
+                        reaching[arc_head[a]] = true;
+                        frontier.push(arc_head[a]);
+                    }
+                }
+            }
+
+            // take the more balanced of both cuts
+            for (unsigned side = 0; side < 2; side++)
+            {
+                vector<bool> is_source_side(n);
+                unsigned num_of_source_side = 0;
+                for (unsigned i = 0; i < n; i++)
+                {
+                    is_source_side[i] = side == 0? reached[i] : !reaching[i];
+                    num_of_source_side += is_source_side[i]? 1 : 0;
+                }
+                // fewest cut edges per node of the smaller side, then the more balanced
+                unsigned min_side = min(num_of_source_side, n - num_of_source_side);
+                unsigned imbalance = num_of_source_side * 2 > n? num_of_source_side * 2 - n : n - num_of_source_side * 2;
+                uint64_t score = (uint64_t) cut * best_min_side;
+                uint64_t best_score = (uint64_t) best_cut * min_side;
+                if (best_side.empty() || score < best_score || (score == best_score && imbalance < best_imbalance))
+                {
+                    best_cut = cut;
+                    best_min_side = min_side;
+                    best_imbalance = imbalance;
+                    best_side = is_source_side;
+                }
+            }
+        }
+    }
+    return best_side;
+}
+
+// helper function
+/* Recursively bisect nodes by inertial flow into a number of cells, see inertial_flow_bisect. Each side is bounded
+ * to fit its cells with at most max_cell_size nodes each, so no cell exceeds it however the cuts fall.
+ * Parameters: const vector<unsigned> & nodes: at most num_of_cells x max_cell_size
+ *             const vector<float> & latitude
+ *             const vector<float> & longitude
+ *             const vector<unsigned> & head
+ *             const vector<unsigned> & first_out
+ *             const unsigned & num_of_cells: the source side takes half of them, rounded down
+ *             const unsigned & max_cell_size
+ *             vector< vector<unsigned> > & cells: cells found are added, nodes in ascending order
+ * Return: when nodes are partitioned, into fewer cells if there are fewer nodes
+ */
+static void inertial_flow_cells
+        (const vector<unsigned> &nodes,
+         const vector<float> &latitude,
+         const vector<float> &longitude,
+         const vector<unsigned> &head,
+         const vector<unsigned> &first_out,
+         const unsigned &num_of_cells,
+         const unsigned &max_cell_size,
+         vector< vector<unsigned> > &cells)
+{
+    const unsigned n = nodes.size();
+    if (num_of_cells <= 1 || n <= 1)
+    {
+        cells.push_back(nodes);
+        sort(cells.back().begin(), cells.back().end());
+        return;
+    }
+
+    // the source side must fit its cells, and leave no more than the sink side cells fit
+    const unsigned source_cells = num_of_cells / 2, sink_cells = num_of_cells - source_cells;
+    const uint64_t sink_capacity = (uint64_t) sink_cells * max_cell_size;
+    const unsigned balanced = min(max(1u, (unsigned) round((double) n * source_cells / num_of_cells)), n - 1);
+    unsigned min_source_side = n > sink_capacity? n - sink_capacity : 1;
+    unsigned max_source_side = min<uint64_t>((uint64_t) source_cells * max_cell_size, n - 1);
+    min_source_side = min(max(min_source_side, 1u), balanced);
+    max_source_side = max(max_source_side, balanced);
+
+    vector<bool> is_source_side = inertial_flow_bisect(nodes, latitude, longitude, head, first_out,
+                                                       min_source_side, max_source_side);
+    vector<unsigned> source_side, sink_side;
+    for (unsigned i = 0; i < n; i++)
+    {
+        (is_source_side[i]? source_side : sink_side).push_back(nodes[i]);
+    }
+    inertial_flow_cells(source_side, latitude, longitude, head, first_out, source_cells, max_cell_size, cells);
+    inertial_flow_cells(sink_side, latitude, longitude, head, first_out, sink_cells, max_cell_size, cells);
+}
+
+/* Partition nodes into k x k cells of bounded size with few edges between them, by recursive inertial flow
+ * bisection. Unlike grid_partition, cell borders follow sparse parts of the graph, e.g. water and parks, rather
+ * than coordinates.
  * Parameters: const vector<unsigned> & nodes
+ *             const vector<float> & latitude
+ *             const vector<float> & longitude
+ *             const vector<unsigned> & head
+ *             const vector<unsigned> & first_out
+ *             const int & k: number of rows / columns of the equivalent grid
+ *             const unsigned & max_cell_size: at least the nodes over k x k, 0 for INERTIAL_FLOW_MAX_IMBALANCE
+ *                                             times that
+ * Return: unordered_map<long, vector<unsigned> >: key: cell ID (disposable); value: list of nodes in the cell
+ */
+unordered_map<long, vector<unsigned> > IMS::Partition::inertial_flow_partition
+        (const vector<unsigned> &nodes,
+         const vector<float> &latitude,
+         const vector<float> &longitude,
+         const vector<unsigned> &head,
+         const vector<unsigned> &first_out,
+         const int &k,
+         const unsigned &max_cell_size)
+{
+    const unsigned num_of_cells = k * k;
+    const unsigned min_cell_size = (nodes.size() + num_of_cells - 1) / num_of_cells;
+    unsigned cell_size = max_cell_size != 0? max_cell_size
+                                           : (unsigned) ceil(INERTIAL_FLOW_MAX_IMBALANCE * nodes.size() / num_of_cells);
+    vector< vector<unsigned> > cells;
+    inertial_flow_cells(nodes, latitude, longitude, head, first_out, num_of_cells, max(cell_size, min_cell_size),
+                        cells);
+
+    unordered_map<long, vector<unsigned> > node_partition;
+    for (unsigned i = 0; i < cells.size(); i++)
+    {
+        node_partition[i].swap(cells[i]);
+    }
+    return node_partition;
+}
+
+
+/* Partition nodes into a tree of l levels, level by level from the root. Each partition of a level but the last one
+ * is split into up to k x k sub-partitions by the scheme. Boundaries of the partitions of a level are found with the
+ * partition of each node in that level.
+ * Parameters: const vector<unsigned> & nodes: ascending
  *             const vector<float> &latitude, 
  *             const vector<float> &longitude, 
  *             const vector<unsgiend> & head
@@ -79,11 +443,11 @@ unordered_map<long, vector<unsigned> > IMS::Partition::grid_partition
  *             const vector<unsigned> & furst_out_inversed
  *             const int & k
  *             const int & l
- *             const long & partition_id
- *             const unsigned layer = 0
- * Return: partition_t
+ *             const partition_scheme_t scheme = GRID_PARTITION: scheme splitting each partition into sub-partitions
+ * Return: partition_tree_t*: to be indexed with index_partition, and deleted by caller. With INERTIAL_FLOW_PARTITION
+ *         no partition of a level exceeds INERTIAL_FLOW_MAX_IMBALANCE times the mean size of the level.
  */
-partition_t * IMS::Partition::do_partition
+partition_tree_t * IMS::Partition::do_partition
         (const vector<unsigned> &nodes, 
          const vector<float> &latitude, 
          const vector<float> &longitude,
@@ -93,229 +457,347 @@ partition_t * IMS::Partition::do_partition
          const vector<unsigned> &first_out_inversed, 
          const int &k, 
          const int &l,
-         const unsigned &partition_id,
-        const unsigned layer)
+        const partition_scheme_t scheme)
 {
-    auto p = new IMS::Partition::partition_t();
-    p->id = partition_id;
-    p->layer = layer;
-    p->is_node = false;
-    p->parent_partition = NULL;
-    
-    // Determine boundary nodes of the partition
-    unordered_set<unsigned> node_set;
-    for (unsigned node : nodes)
-    {
-        node_set.insert(node);
-    }
-    // Finding outward boundaries
-    for (unsigned node : nodes)
+    auto p = new IMS::Partition::partition_tree_t();
+    p->level_first.push_back(0);
+    p->layer.push_back(0);
+    p->parent.push_back((unsigned)INFINITY);
+    p->node_first.push_back(0);
+    p->node_last.push_back(nodes.size());
+    p->nodes = nodes;
+
+    // Partition of each node in the current level, INFINITY for nodes not partitioned
+    vector<unsigned> partition_of(first_out.size(), (unsigned)INFINITY);
+    for (unsigned level = 0; ; level++)
     {
-        unsigned first_edge = first_out[node];
-        unsigned last_edge = (node == first_out.size() -1) ? (head.size()) : first_out[node + 1];
-        for (unsigned edge = first_edge; edge < last_edge; edge++)
+        const unsigned first = p->level_first.back();
+        const unsigned last = p->parent.size();
+        p->level_first.push_back(last);
+
+        // Determine boundary nodes of the partitions
+        for (unsigned curr = first; curr < last; curr++)
         {
-            if (node_set.count(head[edge]) == 0)
+            for (unsigned node : p->nodes_of(curr))
             {
-                p->boundary_outwards.push_back(node);
-                break;
+                partition_of[node] = curr;
             }
         }
-    }
-    // Finding inward boundaries
-    for (unsigned node : nodes)
-    {
-        unsigned first_edge = first_out_inversed[node];
-        unsigned last_edge = (node == first_out_inversed.size() -1) ? (head.size()) : first_out_inversed[node + 1];
-        for (unsigned edge = first_edge; edge < last_edge; edge++)
+        for (unsigned curr = first; curr < last; curr++)
         {
-            if (node_set.count(head_inversed[edge]) == 0)
+            // Finding outward boundaries
+            p->boundary_outwards_first.push_back(p->boundary_outwards.size());
+            for (unsigned node : p->nodes_of(curr))
+            {
+                unsigned first_edge = first_out[node];
+                unsigned last_edge = (node == first_out.size() -1) ? (head.size()) : first_out[node + 1];
+                for (unsigned edge = first_edge; edge < last_edge; edge++)
+                {
+                    if (partition_of[head[edge]] != curr)
+                    {
+                        p->boundary_outwards.push_back(node);
+                        break;
+                    }
+                }
+            }
+            // Finding inward boundaries
+            p->boundary_inwards_first.push_back(p->boundary_inwards.size());
+            for (unsigned node : p->nodes_of(curr))
             {
-                p->boundary_inwards.push_back(node);
-                break;
+                unsigned first_edge = first_out_inversed[node];
+                unsigned last_edge = (node == first_out_inversed.size() -1) ? (head.size()) : first_out_inversed[node + 1];
+                for (unsigned edge = first_edge; edge < last_edge; edge++)
+                {
+                    if (partition_of[head_inversed[edge]] != curr)
+                    {
+                        p->boundary_inwards.push_back(node);
+                        break;
+                    }
+                }
             }
         }
+
+        if (level + 1 >= (unsigned)l)
+        {
+            break;
+        }
+
+        // Split each partition into the next level, children of a partition take its range of nodes.
+        // Cells are bounded by the mean of the whole level, so that imbalance does not compound over levels
+        const unsigned max_cell_size = ceil(INERTIAL_FLOW_MAX_IMBALANCE * nodes.size() / pow((double) k * k, level + 1));
+        vector<unsigned> next_nodes;
+        next_nodes.reserve(p->nodes.size());
+        for (unsigned curr = first; curr < last; curr++)
+        {
+            p->child_first.push_back(p->parent.size());
+            span_t curr_nodes = p->nodes_of(curr);
+            vector<unsigned> cell_nodes(curr_nodes.begin(), curr_nodes.end());
+            unordered_map<long, vector<unsigned> > sub_partitions = scheme == INERTIAL_FLOW_PARTITION
+                    ? inertial_flow_partition(cell_nodes, latitude, longitude, head, first_out, k, max_cell_size)
+                    : grid_partition(cell_nodes, latitude, longitude, k);
+            // Visit cells in order of their smallest node, which is the first one as nodes stay in ascending order,
+            // so that partition IDs follow node IDs when nodes are numbered by partition
+            vector<vector<unsigned>*> cells;
+            for (auto & sub_partition : sub_partitions)
+            {
+                cells.push_back(&sub_partition.second);
+            }
+            sort(cells.begin(), cells.end(), [](const vector<unsigned>* a, const vector<unsigned>* b)
+            {
+                return a->front() < b->front();
+            });
+            for (auto cell : cells)
+            {
+                p->layer.push_back(level + 1);
+                p->parent.push_back(curr);
+                p->node_first.push_back(next_nodes.size());
+                next_nodes.insert(next_nodes.end(), cell->begin(), cell->end());
+                p->node_last.push_back(next_nodes.size());
+            }
+        }
+        p->nodes.swap(next_nodes);
     }
 
-    if(l == 1)
+    // Partitions of the last level hold nodes only
+    p->child_first.resize(p->parent.size() + 1, p->parent.size());
+    p->boundary_outwards_first.push_back(p->boundary_outwards.size());
+    p->boundary_inwards_first.push_back(p->boundary_inwards.size());
+    return p;
+}
+
+
+// helper function
+/* Position of a point on a Hilbert curve over a 65536 x 65536 grid
+ * Parameters: uint32_t x
+ *             uint32_t y
+ * Return: uint32_t: distance along the curve
+ */
+static uint32_t hilbert_index(uint32_t x, uint32_t y)
+{
+    const uint32_t n = 1u << 16;
+    uint32_t d = 0;
+    for (uint32_t s = n / 2; s > 0; s /= 2)
     {
-        vector<IMS::Partition::partition_t*> leaves(nodes.size());
-        for(unsigned i = 0; i < nodes.size(); i++)
+        uint32_t rx = (x & s) > 0;
+        uint32_t ry = (y & s) > 0;
+        d += s * s * ((3 * rx) ^ ry);
+        // Rotate quadrant
+        if (ry == 0)
         {
-            auto leaf = new IMS::Partition::partition_t;
-            leaf->id = nodes[i];
-            leaf->layer = layer + 1;
-            leaf->is_node = true;
-            leaf->parent_partition = p;
-            leaves[i] = leaf;
+            if (rx == 1)
+            {
+                x = n - 1 - x;
+                y = n - 1 - y;
+            }
+            swap(x, y);
         }
-
-        p->sub_partition = leaves;
-        return p;
     }
+    return d;
+}
 
-    unordered_map<long, vector<unsigned> > sub_partitions = grid_partition(nodes, latitude, longitude, k);
-    long next_pid = 0;
-    for (auto & sub_partition : sub_partitions) {
-        partition_t * sp = do_partition(sub_partition.second, latitude, longitude, head, first_out, head_inversed, first_out_inversed, k, l - 1, next_pid, layer + 1);
-        sp->parent_partition = p;
-        p->sub_partition.push_back(sp);
-        next_pid++;
+// helper function
+/* Recursively list nodes of a partition in partition order. A partition holds either nodes or sub-partitions.
+ * Parameters: const partition_tree_t * p
+ *             const unsigned & partition
+ *             const vector<uint32_t> & key: Hilbert index of each node
+ * Return: vector<unsigned>: nodes, first one has the smallest key in the partition
+ */
+static vector<unsigned> order_partition(const partition_tree_t * p, const unsigned &partition,
+                                        const vector<uint32_t> &key)
+{
+    vector<unsigned> order;
+    vector< vector<unsigned> > sub_orders;
+    if (p->num_of_children(partition) == 0)
+    {
+        span_t nodes = p->nodes_of(partition);
+        order.assign(nodes.begin(), nodes.end());
+    }
+    for (unsigned sp = p->child_first[partition]; sp < p->child_first[partition + 1]; sp++)
+    {
+        sub_orders.push_back(order_partition(p, sp, key));
     }
 
-    return p;
+    // Nodes within a cell along the curve
+    sort(order.begin(), order.end(), [&key](const unsigned &a, const unsigned &b)
+    {
+        return key[a] < key[b];
+    });
+    // Sub-partitions along the curve by their first node
+    sort(sub_orders.begin(), sub_orders.end(), [&key](const vector<unsigned> &a, const vector<unsigned> &b)
+    {
+        return key[a.front()] < key[b.front()];
+    });
+    for (auto & sub_order : sub_orders)
+    {
+        order.insert(order.end(), sub_order.begin(), sub_order.end());
+    }
+    return order;
 }
 
+/* Order nodes such that every partition is a contiguous range, sub-partitions and nodes within a cell
+ * follow a Hilbert curve over the bounding box.
+ * Parameters: const partition_tree_t * p
+ *             const vector<float> & latitude
+ *             const vector<float> & longitude
+ * Return: vector<unsigned>: order[new node ID] = old node ID
+ */
+vector<unsigned> IMS::Partition::partition_order
+        (const partition_tree_t * p,
+         const vector<float> &latitude,
+         const vector<float> &longitude)
+{
+    float lat_min = *min_element(latitude.begin(), latitude.end());
+    float lat_max = *max_element(latitude.begin(), latitude.end());
+    float longi_min = *min_element(longitude.begin(), longitude.end());
+    float longi_max = *max_element(longitude.begin(), longitude.end());
+    double lat_scale = lat_max > lat_min? 65535 / (double) (lat_max - lat_min) : 0;
+    double longi_scale = longi_max > longi_min? 65535 / (double) (longi_max - longi_min) : 0;
+
+    vector<uint32_t> key(latitude.size());
+    for (unsigned n = 0; n < key.size(); n++)
+    {
+        key[n] = hilbert_index((uint32_t) ((longitude[n] - longi_min) * longi_scale),
+                               (uint32_t) ((latitude[n] - lat_min) * lat_scale));
+    }
+
+    return order_partition(p, 0, key);
+}
 
 /* Put unique numbering into partition_id of each level of the partition. Partition_id is unique only within the level.
- * Parameter: partition_t * p
+ * Partitions are stored level by level, so the ID is the position within the level.
+ * Parameter: partition_tree_t * p
  * Return: when indexing is done
  */
-void IMS::Partition::index_partition(partition_t * p)
+void IMS::Partition::index_partition(partition_tree_t * p)
 {
-    unsigned pid = 0;
-    int level_node_count = 1;
-    int new_level_node_count = 0;
-    queue<partition_t*> frontier;
-    IMS::Partition::partition_t * curr;
-    frontier.push(p);
-
-    while(!frontier.empty())
+    p->id.resize(p->num_of_partitions());
+    for (unsigned curr = 0; curr < p->num_of_partitions(); curr++)
     {
-        for(int i = 0; i < level_node_count; i++)
-        {
-            // Get current node
-            curr = frontier.front();
-            frontier.pop();
-
-            // Do stuff with current node
-            curr->id = pid++;
+        p->id[curr] = curr - p->level_first[p->layer[curr]];
+    }
+}
 
-            // Expand neighbours
-            for(auto sp : curr->sub_partition)
+/* Replace the boundaries of some partitions, the boundary arrays are rebuilt once for all of them.
+ * Parameters: partition_tree_t * p
+ *             const map<unsigned, vector<unsigned> > & boundary_outwards: new outward boundary of each partition
+ *             const map<unsigned, vector<unsigned> > & boundary_inwards: new inward boundary of each partition
+ * Return: when the boundaries are replaced
+ */
+void IMS::Partition::replace_boundaries
+        (partition_tree_t * p,
+         const map<unsigned, vector<unsigned> > &boundary_outwards,
+         const map<unsigned, vector<unsigned> > &boundary_inwards)
+{
+    auto replace = [&](vector<unsigned> &first, vector<unsigned> &boundary,
+                       const map<unsigned, vector<unsigned> > &replacement)
+    {
+        if (replacement.empty())
+        {
+            return;
+        }
+        vector<unsigned> new_first(first.size()), new_boundary;
+        new_boundary.reserve(boundary.size());
+        for (unsigned curr = 0; curr < p->num_of_partitions(); curr++)
+        {
+            new_first[curr] = new_boundary.size();
+            auto found = replacement.find(curr);
+            if (found != replacement.end())
             {
-                if(!sp->is_node)
-                {
-                    frontier.push(sp);
-                }
+                new_boundary.insert(new_boundary.end(), found->second.begin(), found->second.end());
+            }
+            else
+            {
+                new_boundary.insert(new_boundary.end(), boundary.begin() + first[curr], boundary.begin() + first[curr + 1]);
             }
-            new_level_node_count += curr->sub_partition.size();
         }
-        level_node_count = new_level_node_count;
-        new_level_node_count = 0;
-        pid = 0;
-    }
+        new_first.back() = new_boundary.size();
+        first.swap(new_first);
+        boundary.swap(new_boundary);
+    };
+    replace(p->boundary_outwards_first, p->boundary_outwards, boundary_outwards);
+    replace(p->boundary_inwards_first, p->boundary_inwards, boundary_inwards);
 }
 
-/* Build layer_t with partition information in partition_t layer-by-layer.
- * Parameter: partition_t * p
+/* Build layer_t with partition information in partition_tree_t layer-by-layer.
+ * Parameter: const partition_tree_t * p: indexed
  *            const unsigned long & num_of_nodes
  * Return: layer_t
  * */
-layer_t* IMS::Partition::build_layer(IMS::Partition::partition_t *p, const unsigned long &num_of_nodes)
+layer_t* IMS::Partition::build_layer(const IMS::Partition::partition_tree_t *p, const unsigned long &num_of_nodes)
 {
     auto layer = new IMS::Partition::layer_t(1);
     (*layer)[0].push_back(INFINITY);
 
-    int level_node_count = 1;
-    int new_level_node_count = 0;
-    vector<unsigned> nodes(num_of_nodes);
-    queue<IMS::Partition::partition_t*> frontier;
-    IMS::Partition::partition_t * curr;
-    frontier.push(p);
-
-    while(!frontier.empty())
+    const unsigned num_of_levels = p->num_of_levels();
+    for (unsigned level = 1; level < num_of_levels; level++)
     {
-        vector<unsigned> next_level;
-        for (int i = 0; i < level_node_count; i++)
+        vector<unsigned> parents;
+        parents.reserve(p->level_first[level + 1] - p->level_first[level]);
+        for (unsigned curr = p->level_first[level]; curr < p->level_first[level + 1]; curr++)
         {
-            // Get current node
-            curr = frontier.front();
-            frontier.pop();
-
-            // Expand neighbour
-            for (auto sp : curr->sub_partition)
-            {
-                if(sp->is_node)
-                {
-                    // Nodes
-                    nodes[sp->id] = curr->id;
-                }
-                else
-                {
-                    // Partition
-                    frontier.push(sp);
-                    next_level.push_back(curr->id);
-                }
-            }
-            new_level_node_count += curr->sub_partition.size();
+            parents.push_back(p->id[p->parent[curr]]);
         }
+        (*layer).push_back(parents);
+    }
 
-        if(!frontier.empty())
+    // Nodes
+    vector<unsigned> nodes(num_of_nodes);
+    for (unsigned curr = p->level_first[num_of_levels - 1]; curr < p->level_first[num_of_levels]; curr++)
+    {
+        for (unsigned node : p->nodes_of(curr))
         {
-            (*layer).push_back(next_level);
+            nodes[node] = p->id[curr];
         }
-        level_node_count = new_level_node_count;
-        new_level_node_count = 0;
     }
     (*layer).push_back(nodes);
 
     return layer;
 }
 
-/* Print the partition structure. Each partition / node is in format of | partition_id (# of children) |.
- * Parameter: partition_t * p
+/* Print the partition structure. Each partition is in format of | partition_id p(parent_id @ level) (# of children) |,
+ * and the nodes in the last level.
+ * Parameter: const partition_tree_t * p: indexed
  * Return: when partition is printed
  */
-void IMS::Partition::print_partition(IMS::Partition::partition_t * p)
+void IMS::Partition::print_partition(const IMS::Partition::partition_tree_t * p)
 {
-    int level_node_count = 1;
-    int new_level_node_count = 0;
-    queue<IMS::Partition::partition_t*> frontier;
-    IMS::Partition::partition_t * curr;
-    frontier.push(p);
-
-    while(!frontier.empty())
+    for (unsigned level = 0; level < p->num_of_levels(); level++)
     {
-        for(int i = 0; i < level_node_count; i++)
+        for (unsigned curr = p->level_first[level]; curr < p->level_first[level + 1]; curr++)
         {
-            // Get current node
-            curr = frontier.front();
-            frontier.pop();
-
-            // Do stuff with current node
-            cout << curr->id << " ";
-            //cout << "[" << curr->id << " @ " << curr->layer << "] ";
-            if (curr->parent_partition != NULL)
+            cout << p->id[curr] << " ";
+            if (p->parent[curr] != (unsigned)INFINITY)
             {
-                cout << "p(" << curr-> parent_partition->id << " @ " << curr->parent_partition->layer << ") ";
+                cout << "p(" << p->id[p->parent[curr]] << " @ " << p->layer[p->parent[curr]] << ") ";
             }
-            cout << "(" << curr->sub_partition.size() << ") ";
+            bool is_last_level = level + 1 == p->num_of_levels();
+            cout << "(" << (is_last_level? p->nodes_of(curr).size() : p->num_of_children(curr)) << ") ";
             cout << "out(";
-            for(int i = 0; i < curr->boundary_outwards.size(); i++)
+            span_t outwards = p->outwards_of(curr);
+            for(unsigned i = 0; i < outwards.size(); i++)
             {
-                cout << curr->boundary_outwards[i];
-                cout << (i == curr->boundary_outwards.size()-1? "" : ", ");
+                cout << outwards.first[i];
+                cout << (i == outwards.size()-1? "" : ", ");
             }
             cout << ") in(";
-            for(int i = 0; i < curr->boundary_inwards.size(); i++)
+            span_t inwards = p->inwards_of(curr);
+            for(unsigned i = 0; i < inwards.size(); i++)
             {
-                cout << curr->boundary_inwards[i];
-                cout << (i == curr->boundary_inwards.size()-1? "" : ", ");
+                cout << inwards.first[i];
+                cout << (i == inwards.size()-1? "" : ", ");
             }
             cout << ") | ";
-
-            // Expand neighbour
-            for(auto sp : curr->sub_partition)
-            {
-                frontier.push(sp);
-            }
-            new_level_node_count += curr->sub_partition.size();
         }
-        cout << endl << endl;;
-        level_node_count = new_level_node_count;
-        new_level_node_count = 0;
+        cout << endl << endl;
+    }
+    for (unsigned curr = p->level_first[p->num_of_levels() - 1]; curr < p->num_of_partitions(); curr++)
+    {
+        for (unsigned node : p->nodes_of(curr))
+        {
+            cout << node << " p(" << p->id[curr] << " @ " << p->layer[curr] << ") | ";
+        }
     }
+    cout << endl << endl;
 }
 
 /* Print layer structure.
@@ -360,21 +842,13 @@ long IMS::Partition::find_parent(const IMS::Partition::layer_t* layer, const lon
     return parent;
 }
 
-/* Recursively releases memory allocated to a partition.
- * Parameters: IMS::Partition::partition_t *& p:
+/* Releases memory allocated to a partition tree.
+ * Parameters: IMS::Partition::partition_tree_t *& p:
  *                     Pointer p must be passed by reference such that the value of the pointer itself can be changed
  * Return: when partition memory is released.
  */
-void IMS::Partition::delete_partition(IMS::Partition::partition_t *& p)
+void IMS::Partition::delete_partition(IMS::Partition::partition_tree_t *& p)
 {
-    if(p != nullptr)
-    {
-        for(auto sp : p->sub_partition)
-        {
-            delete_partition(sp);
-        }
-
-        delete p;
-        p = nullptr;
-    }
-}
\ No newline at end of file
+    delete p;
+    p = nullptr;
+}
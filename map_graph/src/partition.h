@@ -12,6 +12,7 @@
 #include <boost/serialization/vector.hpp>
 #include <vector>
 #include <unordered_map>
+#include <map>
 
 using namespace std;
 
@@ -20,33 +21,101 @@ namespace IMS
 namespace Partition
 {
 
-/* Stores a partition:
- * Fields: unsigned id: partition / node id
- *         bool is_node
- *         vector<unsigned> boundary_outwards: list of nodes with outward edges
- *         vector<unsigned> boundary_inwards: list of nodes with inward edges
- *         partition_t* parent partition: pointer to parent
- *         vector<partition_t*> sub_partition: list of pointers to all children
+/* Contiguous range of unsigned values in one of the arrays of partition_tree_t
  */
-struct partition_t
+struct span_t
 {
-    unsigned id;
-    unsigned layer;
-    bool is_node;
+    const unsigned * first;
+    const unsigned * last;
+
+    const unsigned * begin() const { return first; }
+    const unsigned * end() const { return last; }
+    size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+};
+
+/* Stores a partition tree in flat arrays, level-major, in the same way as head / first_out stores the graph.
+ * Partitions are numbered level by level from the root, 0, and children of a partition are consecutive, in order
+ * of their smallest node. Nodes are not stored as partitions, the partitions of the last level hold them.
+ * Fields: vector<unsigned> level_first: partitions of level x are [level_first[x], level_first[x + 1])
+ *         vector<unsigned> layer: level of each partition
+ *         vector<unsigned> id: partition ID within its level, set by index_partition
+ *         vector<unsigned> parent: parent of each partition, INFINITY for the root
+ *         vector<unsigned> child_first: children of p are [child_first[p], child_first[p + 1]), none in the last level
+ *         vector<unsigned> node_first, node_last: nodes of p are nodes[node_first[p], node_last[p]), in each level
+ *                                                  the partitions cover nodes in order
+ *         vector<unsigned> nodes: nodes in order of the cells of the last level, ascending within a cell
+ *         vector<unsigned> boundary_outwards_first: outward boundary of p is
+ *                                                   boundary_outwards[boundary_outwards_first[p], [p + 1])
+ *         vector<unsigned> boundary_outwards: nodes with outward edges of each partition, ascending
+ *         vector<unsigned> boundary_inwards_first, boundary_inwards: likewise for nodes with inward edges
+ * Serializable with Boost.Serialization, e.g. for checkpoints of a build.
+ */
+struct partition_tree_t
+{
+    vector<unsigned> level_first;
+    vector<unsigned> layer;
+    vector<unsigned> id;
+    vector<unsigned> parent;
+    vector<unsigned> child_first;
+    vector<unsigned> node_first;
+    vector<unsigned> node_last;
+    vector<unsigned> nodes;
+    vector<unsigned> boundary_outwards_first;
     vector<unsigned> boundary_outwards;
+    vector<unsigned> boundary_inwards_first;
     vector<unsigned> boundary_inwards;
-    partition_t* parent_partition;
-    vector<partition_t*> sub_partition;
 
-    ~partition_t()
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & level_first;
+        archive & layer;
+        archive & id;
+        archive & parent;
+        archive & child_first;
+        archive & node_first;
+        archive & node_last;
+        archive & nodes;
+        archive & boundary_outwards_first;
+        archive & boundary_outwards;
+        archive & boundary_inwards_first;
+        archive & boundary_inwards;
+    }
+
+    unsigned num_of_partitions() const
+    {
+        return parent.size();
+    }
+
+    unsigned num_of_levels() const
+    {
+        return level_first.empty()? 0 : level_first.size() - 1;
+    }
+
+    unsigned num_of_children(const unsigned &p) const
+    {
+        return child_first[p + 1] - child_first[p];
+    }
+
+    span_t nodes_of(const unsigned &p) const
+    {
+        return span_t{nodes.data() + node_first[p], nodes.data() + node_last[p]};
+    }
+
+    span_t outwards_of(const unsigned &p) const
     {
-        for(auto sp : sub_partition)
-        {
-            delete sp;
-        }
+        return span_t{boundary_outwards.data() + boundary_outwards_first[p],
+                      boundary_outwards.data() + boundary_outwards_first[p + 1]};
+    }
+
+    span_t inwards_of(const unsigned &p) const
+    {
+        return span_t{boundary_inwards.data() + boundary_inwards_first[p],
+                      boundary_inwards.data() + boundary_inwards_first[p + 1]};
     }
 };
-typedef struct partition_t partition_t;
+typedef struct partition_tree_t partition_tree_t;
 
 
 /* Records parent of each node / partition in the partition hierarchy
@@ -55,15 +124,39 @@ typedef struct partition_t partition_t;
 typedef vector< vector<unsigned> > layer_t;
 
 
-/* Partition Scheme */
+/* Partition Scheme
+ * GRID_PARTITION: k x k grid over the coordinates, see grid_partition
+ * INERTIAL_FLOW_PARTITION: k x k cells by recursive min-cut bisection with bounded cell sizes, see
+ *                          inertial_flow_partition
+ */
+enum partition_scheme_t
+{
+    GRID_PARTITION,
+    INERTIAL_FLOW_PARTITION
+};
+
 unordered_map<long, vector<unsigned> > grid_partition
         (const vector<unsigned> &nodes, 
          const vector<float> &latitude, 
          const vector<float> &longitude, 
          const int &k);
 
+unordered_map<long, vector<unsigned> > inertial_flow_partition
+        (const vector<unsigned> &nodes,
+         const vector<float> &latitude,
+         const vector<float> &longitude,
+         const vector<unsigned> &head,
+         const vector<unsigned> &first_out,
+         const int &k,
+         const unsigned &max_cell_size = 0);
+
+const double INERTIAL_FLOW_MAX_IMBALANCE = 1.2; // largest cell of a level over the mean cell size of the level
+const double INERTIAL_FLOW_BALANCE = 0.25; // share of nodes at each end of a projection fixed to either side of a cut
+const double INERTIAL_FLOW_TIGHT_BALANCE = 0.4; // cuts are also tried with this share fixed, as on even road grids
+                                                // all cuts are minimal and the one found would be least balanced
+
 /* Partitioning & Layering */
-partition_t * do_partition
+partition_tree_t * do_partition
         (const vector<unsigned> &nodes, 
          const vector<float> &latitude, 
          const vector<float> &longitude,
@@ -73,21 +166,30 @@ partition_t * do_partition
          const vector<unsigned> &first_out_inversed, 
          const int &k, 
          const int &l,
-         const unsigned &partition_id,
-        const unsigned layer = 0);
+        const partition_scheme_t scheme = GRID_PARTITION);
+
+void index_partition(partition_tree_t * p);
+
+void replace_boundaries
+        (partition_tree_t * p,
+         const map<unsigned, vector<unsigned> > &boundary_outwards,
+         const map<unsigned, vector<unsigned> > &boundary_inwards);
 
-void index_partition(partition_t * p);
+vector<unsigned> partition_order
+        (const partition_tree_t * p,
+         const vector<float> &latitude,
+         const vector<float> &longitude);
 
-layer_t* build_layer(IMS::Partition::partition_t * p, const unsigned long & num_of_nodes);
+layer_t* build_layer(const IMS::Partition::partition_tree_t * p, const unsigned long & num_of_nodes);
 
 /* Util functions */
-void print_partition(partition_t * p);
+void print_partition(const partition_tree_t * p);
 
 void print_layer(const layer_t* layer);
 
 long find_parent(const layer_t* layer, const long &node, const long &level = -1);
 
-void delete_partition(partition_t *& p);
+void delete_partition(partition_tree_t *& p);
 
 }
 }
@@ -0,0 +1,184 @@
+/*
+ * Manages paths handed out by routing, including IDs and expiry.
+ * Injects the density of new paths and retires paths whose vehicles are overdue,
+ * such that abandoned trips do not keep adding congestion to the MapGraph.
+ * Libraries:
+ * Version: 1.0
+ * Author: Terence Chow
+ */
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#include "../include/ims/path_manager.h"
+
+using namespace std;
+
+const time_t IMS::PathManager::DEFAULT_GRACE_PERIOD;
+const unsigned IMS::PathManager::DEFAULT_BATCH_SIZE;
+
+/* Constructor of PathManager.
+ * Parameter(s): IMS::MapGraph * mg
+ *               const time_t & grace_period: time in milliseconds after end_time before a path is retired
+ */
+IMS::PathManager::PathManager(IMS::MapGraph *mg, const time_t &grace_period)
+        : map_graph(mg), grace_period(grace_period), expiry_wheel(EXPIRY_TICK, EXPIRY_SLOTS)
+{
+}
+
+/* Destructor for releasing the stored copies of active paths.
+ * Density of active paths is left in the MapGraph.
+ * Parameter(s): NIL
+ * Return: when memory is released.
+ */
+IMS::PathManager::~PathManager()
+{
+    for(auto & active_path : active_paths)
+    {
+        delete active_path.second;
+    }
+}
+
+/* Injects the impact of a routed path into the MapGraph, stores a copy of its timing and
+ * schedules it to be retired at end_time + grace period. Number of path is incremented.
+ *
+ * Parameter(s): IMS::Path * path: caller keeps ownership
+ * Returns: unsigned: path ID
+ */
+unsigned IMS::PathManager::add_path(IMS::Path *path)
+{
+    auto stored_path = new IMS::Path();
+    stored_path->start_time = path->start_time;
+    stored_path->end_time = path->end_time;
+    stored_path->enter_times = path->enter_times;
+
+    boost::lock_guard<boost::mutex> lock(access);
+
+    map_graph->inject_impact_of_routed_path(stored_path);
+
+    unsigned path_id = num_of_path;
+    active_paths[path_id] = stored_path;
+    expiry_wheel.schedule(stored_path->end_time + grace_period, path_id);
+    num_of_path++;
+    return path_id;
+}
+
+/* Removes path, e.g. on reroute or on arrival. Density of the path is removed from the MapGraph.
+ * Its timer is left in the wheel and ignored on expiry.
+ *
+ * Parameter(s): unsigned path_id
+ * Returns: unsigned: number of path removed -> 0 indicates path ID not found or already retired
+ */
+unsigned IMS::PathManager::remove_path(unsigned path_id)
+{
+    boost::lock_guard<boost::mutex> lock(access);
+
+    auto active_path = active_paths.find(path_id);
+    if(active_path == active_paths.end())
+    {
+        return 0;
+    }
+
+    map_graph->remove_impact_of_routed_path(active_path->second);
+    delete active_path->second;
+    active_paths.erase(active_path);
+    return 1;
+}
+
+/* Retires all paths overdue at the specified time. Paths are removed from the MapGraph in batches,
+ * each batch taking the writer access of the MapGraph once and compacting the density before now.
+ *
+ * Parameter(s): const time_t & now: in milliseconds
+ *               const unsigned & batch_size: max number of paths removed per batch
+ * Returns: unsigned: number of paths retired
+ */
+unsigned IMS::PathManager::retire_expired_paths(const time_t &now, const unsigned &batch_size)
+{
+    unsigned num_of_paths_retired = 0;
+    vector<unsigned> expired_ids;
+    vector<IMS::Path*> expired_paths;
+
+    do
+    {
+        expired_ids.clear();
+        expired_paths.clear();
+
+        boost::lock_guard<boost::mutex> lock(access);
+        expiry_wheel.advance(now, expired_ids, batch_size);
+        for(auto path_id : expired_ids)
+        {
+            auto active_path = active_paths.find(path_id);
+            if(active_path != active_paths.end())
+            {
+                // Path is not removed already
+                expired_paths.push_back(active_path->second);
+                active_paths.erase(active_path);
+            }
+        }
+
+        if(!expired_paths.empty())
+        {
+            map_graph->remove_impact_of_routed_paths(expired_paths, now);
+        }
+        for(auto path : expired_paths)
+        {
+            delete path;
+        }
+        num_of_paths_retired += expired_paths.size();
+    } while(expired_ids.size() == batch_size);
+
+    return num_of_paths_retired;
+}
+
+/* Takes over the active paths of the PathManager of another graph, e.g. on reloading the MapGraph.
+ * Paths keep their IDs and expiry, edges are translated and those not in this graph are skipped.
+ * Density of the paths is injected into the MapGraph of this PathManager.
+ *
+ * Parameter(s): PathManager & old_manager: left unchanged
+ *               const vector<unsigned> & new_edge_id: edge ID in this graph, RoutingKit::invalid_id if none
+ * Returns: unsigned: number of paths migrated
+ */
+unsigned IMS::PathManager::migrate_paths(PathManager &old_manager, const vector<unsigned> &new_edge_id)
+{
+    boost::lock_guard<boost::mutex> old_lock(old_manager.access);
+    boost::lock_guard<boost::mutex> lock(access);
+
+    const unsigned num_of_edges = map_graph->get_num_of_edges();
+    unsigned num_of_paths_migrated = 0;
+    for(auto & active_path : old_manager.active_paths)
+    {
+        auto migrated_path = new IMS::Path();
+        migrated_path->start_time = active_path.second->start_time;
+        migrated_path->end_time = active_path.second->end_time;
+        for(auto & enter_time : active_path.second->enter_times)
+        {
+            if(enter_time.second < new_edge_id.size() && new_edge_id[enter_time.second] < num_of_edges)
+            {
+                migrated_path->enter_times[enter_time.first] = new_edge_id[enter_time.second];
+            }
+        }
+        if(migrated_path->enter_times.empty())
+        {
+            delete migrated_path;
+            continue;
+        }
+
+        map_graph->inject_impact_of_routed_path(migrated_path);
+        active_paths[active_path.first] = migrated_path;
+        expiry_wheel.schedule(migrated_path->end_time + grace_period, active_path.first);
+        num_of_paths_migrated++;
+    }
+    num_of_path = max(num_of_path, old_manager.num_of_path);
+    return num_of_paths_migrated;
+}
+
+/* Count paths which are not yet removed or retired.
+ * Parameter(s): NIL
+ * Returns: unsigned: number of active paths
+ */
+unsigned IMS::PathManager::get_num_of_active_paths()
+{
+    boost::lock_guard<boost::mutex> lock(access);
+    return active_paths.size();
+}
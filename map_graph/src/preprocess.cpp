@@ -8,76 +8,410 @@
 #include <iostream>
 #include <cmath>
 #include <queue>
-#include <set>
 #include <map>
+#include <algorithm>
+#include <fstream>
+#include <deque>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
 
 #include "preprocess.h"
 
 using namespace std;
 using namespace IMS::Preprocess;
 
+namespace
+{
+/* Scratch storage of one preprocessing worker, reused by all its searches instead of being allocated for each.
+ * Entries are versioned: an entry is valid only if stamped with the version of the current search, so starting
+ * a search costs O(1) instead of O(|V|).
+ * Fields: vector<unsigned> dist: indexed by node, with room for the temporary vm node
+ *         vector<unsigned> reached: version of the search that set dist of a node
+ *         vector<unsigned> target: version of the search the node is a target of, i.e. a flat target bitmap
+ */
+struct search_scratch_t
+{
+    vector<unsigned> dist;
+    vector<unsigned> reached;
+    vector<unsigned> target;
+    unsigned version = 0;
+
+    /* Start a new search over size nodes, invalidating all entries */
+    void start(const size_t &size)
+    {
+        if (reached.size() < size)
+        {
+            dist.resize(size);
+            reached.resize(size, 0);
+            target.resize(size, 0);
+        }
+        if (++version == 0)
+        {
+            // stamps wrapped around, reset them once
+            reached.assign(reached.size(), 0);
+            target.assign(target.size(), 0);
+            version = 1;
+        }
+    }
+
+    unsigned get_dist(const unsigned &node) const
+    {
+        return reached[node] == version? dist[node] : (unsigned)INFINITY;
+    }
+
+    void set_dist(const unsigned &node, const unsigned &distance)
+    {
+        dist[node] = distance;
+        reached[node] = version;
+    }
+};
+}
+
 // helper function
-/* Perform single source shortest distance search from a set of nodes to a set nof nodes
- * Parameters: const vector<unsigned>& head
- *             const vector<unsigned>& first_out
+/* Check whether a node lies within a partition, by walking up the layers from the node.
+ * Parameters: const unsigned & node
+ *             const IMS::Partition::partition_tree_t* partitions
+ *             const unsigned & partition
+ *             const IMS::Partition::layer_t* layers
+ * Return: bool: true for all nodes if partition is the root
+ */
+static bool is_in_partition(const unsigned &node, const IMS::Partition::partition_tree_t* partitions,
+                            const unsigned &partition, const IMS::Partition::layer_t* layers)
+{
+    if (partitions->parent[partition] == (unsigned)INFINITY)
+    {
+        return true;
+    }
+    unsigned c = node;
+    for (int layer = layers->size() - 1; layer > (int)partitions->layer[partition]; layer --)
+    {
+        c = (*layers)[layer][c];
+    }
+    return c == partitions->id[partition];
+}
+
+// helper function
+/* Perform multi source shortest distance search from a set of nodes within a bounding partition. The search must be
+ * started on the scratch storage, see search_scratch_t::start.
+ * Parameters: const vector<unsigned>& head: of the graph searched, i.e. inversed for distances towards the origins
+ *             const vector<unsigned>& first_out: of the graph searched
  *             const vector<unsigned>& default_travel_time
- *             const vector<unsigned>* from_nodes : origin node set
- *             const vector<unsigned>* to_nodes : target node set
+ *             const vector<unsigned>* relative_edge: edge ID in default_travel_time of each edge searched,
+ *                                                    NULL if the graph searched is not inversed
+ *             const IMS::Partition::span_t & from_nodes: origin node set
+ *             const IMS::Partition::partition_tree_t* partitions
+ *             const unsigned & bound: nodes outside are not expanded
+ *             const IMS::Partition::layer_t* layers
+ *             search_scratch_t & scratch: of the calling worker, holds the distances found
+ *             Settle settle: called with each node and its distance when settled, returns false to end the search
+ * Return: when the search ends
  */
-unsigned nodeset_shortest_destance
+template<class Settle>
+void bounded_search
     (const vector<unsigned>& head,
      const vector<unsigned>& first_out,
      const vector<unsigned>& default_travel_time,
-     const vector<unsigned>& from_nodes, 
-     const vector<unsigned>& to_nodes)
-{    
-    // create node set for to nodes
-    set<unsigned> to_set;
-    for(auto n : to_nodes)
-    {
-        to_set.insert(n);
-    }
-
-    // prepare storage for single source graph search
-    vector<unsigned> dist(first_out.size() + 2, INFINITY);
-    vector<unsigned> prev(first_out.size() + 2, INFINITY); // infinity defined as nil here
+     const vector<unsigned>* relative_edge,
+     const IMS::Partition::span_t& from_nodes,
+     const IMS::Partition::partition_tree_t* partitions,
+     const unsigned &bound,
+     const IMS::Partition::layer_t* layers,
+     search_scratch_t& scratch,
+     Settle settle)
+{
     priority_queue<pair<unsigned, unsigned>, vector<pair<unsigned, unsigned>>, greater<pair<unsigned, unsigned>>> q;
 
     for (auto n : from_nodes)
     {
         q.push(make_pair(0, n));
-        dist[n] = 0;
+        scratch.set_dist(n, 0);
     }
 
     // process the node u with minimum dist[u]
     while (!q.empty())
     {
         unsigned u = q.top().second;
+        unsigned dist_u = q.top().first;
         q.pop();
-        
-        // premature end the graph search if target reached
-        if (to_set.count(u) > 0)
+        if (dist_u > scratch.get_dist(u))
+        {
+            continue;
+        }
+        if (!settle(u, dist_u))
         {
-            return dist[u];
+            break;
         }
 
-        // expand neighbours
+        // expand neighbours within the bound
         unsigned first_edge = first_out[u];
         unsigned last_edge = (u == first_out.size() -1) ? (head.size()) : first_out[u + 1];
         for (unsigned int current_edge = first_edge; current_edge < last_edge; current_edge ++)
         {
             unsigned v = head[current_edge];
-            if (dist[v] > dist[u] + default_travel_time[current_edge])
+            unsigned travel_time = default_travel_time[relative_edge == NULL? current_edge : (*relative_edge)[current_edge]];
+            if (scratch.get_dist(v) > dist_u + travel_time && is_in_partition(v, partitions, bound, layers))
             {
-                dist[v] = dist[u] + default_travel_time[current_edge];
-                prev[v] = u;
-                q.push(make_pair(dist[v], v));
+                scratch.set_dist(v, dist_u + travel_time);
+                q.push(make_pair(dist_u + travel_time, v));
             }
         }
     }
-    return INFINITY;
 }
 
+// helper function
+/* Perform multi source shortest distance search from a set of nodes towards a boundary of each of a set of partitions
+ * within a bounding partition, i.e. the distance of the nearest node of each boundary.
+ * Paths are restricted to the bound, which is exact for distances towards the outward boundary of the bound, and
+ * from its inward boundary: a shortest path reaches the outward boundary before leaving the bound, and re-enters
+ * the bound at an origin.
+ * Parameters: const vector<unsigned>& head: of the graph searched, i.e. inversed for distances towards the origins
+ *             const vector<unsigned>& first_out: of the graph searched
+ *             const vector<unsigned>& default_travel_time
+ *             const vector<unsigned>* relative_edge: edge ID in default_travel_time of each edge searched,
+ *                                                    NULL if the graph searched is not inversed
+ *             const IMS::Partition::span_t & from_nodes: origin node set
+ *             const IMS::Partition::partition_tree_t* partitions
+ *             const vector<unsigned>& to_partitions: children of bound
+ *             const bool & is_outwards: search towards outward boundaries of to_partitions, else inward ones
+ *             const unsigned & bound: nodes outside are not expanded
+ *             const IMS::Partition::layer_t* layers
+ *             search_scratch_t & scratch: of the calling worker
+ * Return: vector<unsigned>: distance of each of to_partitions, INFINITY if not reached
+ */
+vector<unsigned> bounded_nodeset_search
+    (const vector<unsigned>& head,
+     const vector<unsigned>& first_out,
+     const vector<unsigned>& default_travel_time,
+     const vector<unsigned>* relative_edge,
+     const IMS::Partition::span_t& from_nodes,
+     const IMS::Partition::partition_tree_t* partitions,
+     const vector<unsigned>& to_partitions,
+     const bool &is_outwards,
+     const unsigned &bound,
+     const IMS::Partition::layer_t* layers,
+     search_scratch_t& scratch)
+{
+    vector<unsigned> distances(to_partitions.size(), INFINITY);
+    if (from_nodes.empty())
+    {
+        return distances;
+    }
+
+    // prepare storage for single source graph search, and mark the to nodes
+    scratch.start(first_out.size());
+    map<unsigned, size_t> to_index;
+    size_t num_of_unfilled = 0;
+    for (size_t i = 0; i < to_partitions.size(); i++)
+    {
+        IMS::Partition::span_t to_nodes = is_outwards? partitions->outwards_of(to_partitions[i])
+                                                      : partitions->inwards_of(to_partitions[i]);
+        for (auto n : to_nodes)
+        {
+            scratch.target[n] = scratch.version;
+        }
+        to_index[partitions->id[to_partitions[i]]] = i;
+        num_of_unfilled += to_nodes.empty()? 0 : 1;
+    }
+
+    bounded_search(head, first_out, default_travel_time, relative_edge, from_nodes, partitions, bound, layers, scratch,
+                   [&](const unsigned &u, const unsigned &dist_u)
+    {
+        // the first target reached of a partition is its nearest
+        if (scratch.target[u] == scratch.version)
+        {
+            unsigned c = u;
+            for (int layer = layers->size() - 1; layer > (int)partitions->layer[bound] + 1; layer --)
+            {
+                c = (*layers)[layer][c];
+            }
+            unsigned & distance = distances[to_index[c]];
+            if (distance == (unsigned)INFINITY)
+            {
+                distance = dist_u;
+                num_of_unfilled--;
+            }
+        }
+        return num_of_unfilled > 0;
+    });
+    return distances;
+}
+
+// helper function
+/* Precompute the distances of the children of a partition towards its outward boundary and from its inward boundary,
+ * with one backward search from the outward boundary and one forward search from the inward boundary.
+ * Parameters: const vector<unsigned>& head
+ *             const vector<unsigned>& first_out
+ *             const vector<unsigned>& default_travel_time
+ *             const vector<unsigned>& head_inversed
+ *             const vector<unsigned>& first_out_inversed
+ *             const vector<unsigned>& relative_edge: edge ID of each inversed edge
+ *             const IMS::Partition::partition_tree_t* partitions
+ *             const unsigned & parent
+ *             const vector<unsigned>& children: of parent, only their entries are written
+ *             const IMS::Partition::layer_t* layers
+ *             distance_table_t* distance_table
+ *             search_scratch_t & scratch: of the calling worker
+ * Return: when outbound_distance and inbound_distance of the children are written
+ */
+void preprocess_bound_distances
+        (const vector<unsigned>& head,
+         const vector<unsigned>& first_out,
+         const vector<unsigned>& default_travel_time,
+         const vector<unsigned>& head_inversed,
+         const vector<unsigned>& first_out_inversed,
+         const vector<unsigned>& relative_edge,
+         const IMS::Partition::partition_tree_t* partitions,
+         const unsigned &parent,
+         const vector<unsigned>& children,
+         const IMS::Partition::layer_t* layers,
+         distance_table_t* distance_table,
+         search_scratch_t& scratch)
+{
+    // distance towards the bound border, e.g. none for the root
+    vector<unsigned> outbound = bounded_nodeset_search(head_inversed, first_out_inversed, default_travel_time,
+                                                       &relative_edge, partitions->outwards_of(parent), partitions,
+                                                       children, true, parent, layers, scratch);
+    // distance from the bound border
+    vector<unsigned> inbound = bounded_nodeset_search(head, first_out, default_travel_time, NULL,
+                                                      partitions->inwards_of(parent), partitions,
+                                                      children, false, parent, layers, scratch);
+    for (size_t i = 0; i < children.size(); i++)
+    {
+        entry_t & entry = (*distance_table)[partitions->layer[children[i]]][partitions->id[children[i]]];
+        entry.outbound_distance = outbound[i];
+        entry.inbound_distance = inbound[i];
+    }
+}
+
+// helper function
+/* Precompute the distances of one partition towards the partitions within the same bound into its entry of the
+ * distance table.
+ * Parameters: const vector<unsigned>& head
+ *             const vector<unsigned>& first_out
+ *             const vector<unsigned>& default_travel_time
+ *             const IMS::Partition::partition_tree_t* partitions
+ *             const unsigned & curr: partition to be preprocessed
+ *             const IMS::Partition::layer_t* layers
+ *             distance_table_t* distance_table: only the entry of curr is written
+ *             search_scratch_t & scratch: of the calling worker
+ */
+void preprocess_partition
+        (const vector<unsigned>& head,
+         const vector<unsigned>& first_out,
+         const vector<unsigned>& default_travel_time,
+         const IMS::Partition::partition_tree_t* partitions,
+         const unsigned &curr,
+         const IMS::Partition::layer_t* layers,
+         distance_table_t* distance_table,
+         search_scratch_t& scratch)
+{
+    // inject new temporary vm nodes and edges
+    unsigned vm = first_out.size();
+    IMS::Partition::span_t vm_head = partitions->outwards_of(curr);
+    const unsigned parent = partitions->parent[curr];
+
+    // find distance between partition within same bound
+    // the search is not bounded, as a shortest path between them may leave the bound
+    // prepare storage for single source graph search
+    scratch.start(first_out.size() + 1);
+    map<unsigned, unsigned> rep;
+    for (unsigned sp = partitions->child_first[parent]; sp < partitions->child_first[parent + 1]; sp++)
+    {
+        rep[partitions->id[sp]] = INFINITY;
+    }
+    size_t num_of_unfilled = rep.size();
+    priority_queue<pair<unsigned, unsigned>, vector<pair<unsigned, unsigned>>, greater<pair<unsigned, unsigned>>> q;
+
+    // insert new temp node into q
+    unsigned origin = vm;
+    q.push(make_pair(0, origin));
+    scratch.set_dist(origin, 0);
+
+    // process the node u with minimum dist[u]
+    while (!q.empty())
+    {
+        unsigned u = q.top().second;
+        unsigned dist_u = q.top().first;
+        q.pop();
+        if (dist_u > scratch.get_dist(u))
+        {
+            continue;
+        }
+
+        // regiester partition distances
+        if (u != vm)
+        {
+            unsigned c = u;
+            for (int layer = layers->size() - 1; layer > (int)partitions->layer[curr]; layer --)
+            {
+                c = (*layers)[layer][c];
+            }
+            auto entry = rep.find(c);
+            if (entry != rep.end() && entry->second == (unsigned)INFINITY)
+            {
+                entry->second = u;
+                num_of_unfilled--;
+            }
+        }
+
+        // premature end the graph search when all partition within the same bound searched
+        if (num_of_unfilled == 0)
+        {
+            break;
+        }
+
+        // expand neighbours
+        if (u != vm)
+        {
+            unsigned first_edge = first_out[u];
+            unsigned last_edge = (u == first_out.size() -1) ? (head.size()) : first_out[u + 1];
+            for (unsigned int current_edge = first_edge; current_edge < last_edge; current_edge ++)
+            {
+                unsigned v = head[current_edge];
+                if (scratch.get_dist(v) > dist_u + default_travel_time[current_edge])
+                {
+                    scratch.set_dist(v, dist_u + default_travel_time[current_edge]);
+                    q.push(make_pair(dist_u + default_travel_time[current_edge], v));
+                }
+            }
+        }
+        else
+        {
+            for (unsigned int current_edge = 0; current_edge < vm_head.size(); current_edge ++)
+            {
+                unsigned v = vm_head.first[current_edge];
+                if (scratch.get_dist(v) > dist_u + 0)
+                {
+                    scratch.set_dist(v, dist_u + 0);
+                    q.push(make_pair(dist_u + 0, v));
+                }
+            }
+        }
+    }
+
+    // all distance information towards partitions within the same bound into distance table
+    // the entry is a slot of its own, written without locking
+    entry_t & entry = (*distance_table)[partitions->layer[curr]][partitions->id[curr]];
+    for (unsigned sp = partitions->child_first[parent]; sp < partitions->child_first[parent + 1]; sp++)
+    {
+        const unsigned id = partitions->id[sp];
+        if (rep[id] != (unsigned)INFINITY)
+        {
+            entry.partition_distance[id] = scratch.get_dist(rep[id]);
+        }
+    }
+
+    // distance to and from the bound borde are found for all partitions within the same bound at once,
+    // see preprocess_bound_distances
+    // remove temp node and vertex
+    // -- due to implementation, nothing need to be done
+}
 
 
 /* Precompute all distance information of partitions
@@ -85,8 +419,12 @@ unsigned nodeset_shortest_destance
  *             const vector<unsigned>& head
  *             const vector<unsigned>& first_out
  *             const vector<unsigned>& default_travel_time
- *             const IMS::Partition::partition_t* partitions
+ *             const vector<unsigned>& head_inversed
+ *             const vector<unsigned>& first_out_inversed
+ *             const vector<unsigned>& relative_edge: edge ID of each inversed edge
+ *             const IMS::Partition::partition_tree_t* partitions: indexed
  *             const IMS::Pratition::layer_t* layers
+ *             const unsigned & num_of_threads: partitions are preprocessed in this many threads, 0 for all cores
  * Return: distance_table_t: distance table fully filled with distance information
  */
 distance_table_t* IMS::Preprocess::do_preprocess 
@@ -94,8 +432,12 @@ distance_table_t* IMS::Preprocess::do_preprocess
          const vector<unsigned>& head,
          const vector<unsigned>& first_out,
          const vector<unsigned>& default_travel_time,
-         IMS::Partition::partition_t* partitions, 
-         IMS::Partition::layer_t* layers)
+         const vector<unsigned>& head_inversed,
+         const vector<unsigned>& first_out_inversed,
+         const vector<unsigned>& relative_edge,
+         const IMS::Partition::partition_tree_t* partitions, 
+         IMS::Partition::layer_t* layers,
+         const unsigned &num_of_threads)
 {    
     // initialize distance table
     distance_table_t* distance_table = new distance_table_t;
@@ -114,151 +456,537 @@ distance_table_t* IMS::Preprocess::do_preprocess
         distance_table->push_back(dti);
     }
 
-    // extra information for partition traversal
-    int level_node_count = partitions->sub_partition.size();
-    int new_level_node_count = 0;
-    queue<IMS::Partition::partition_t*> frontier;
-    IMS::Partition::partition_t * curr;
-    for (auto p : partitions->sub_partition)
+    // all partitions below the root level by level, each writes its own entry only and can be preprocessed independently
+    vector<unsigned> to_preprocess;
+    for (unsigned curr = 1; curr < partitions->num_of_partitions(); curr++)
     {
-        frontier.push(p);
+        to_preprocess.push_back(curr);
     }
 
-    // traverse the partitions
-    while(!frontier.empty())
+    preprocess_partitions(head, first_out, default_travel_time, head_inversed, first_out_inversed, relative_edge,
+                          partitions, to_preprocess, layers, distance_table, num_of_threads);
+
+    return distance_table;
+}
+
+namespace
+{
+/* Queue of tasks of one preprocessing worker, see preprocess_partitions. The worker takes from the front, in the
+ * order of do_preprocess, i.e. larger partitions first. Idle workers steal from the back.
+ */
+struct task_queue_t
+{
+    boost::mutex access;
+    deque<size_t> tasks;
+};
+}
+
+// helper function
+/* Take the next task of a worker, or steal one from another worker.
+ * Parameters: vector<task_queue_t> & queues
+ *             const unsigned & worker
+ *             size_t & task: set to the task taken
+ * Return: bool: false if all queues are empty, i.e. all tasks are taken
+ */
+static bool take_task(vector<task_queue_t> &queues, const unsigned &worker, size_t &task)
+{
     {
-        for(int i = 0; i < level_node_count; i++)
+        boost::lock_guard<boost::mutex> lock(queues[worker].access);
+        if (!queues[worker].tasks.empty())
         {
-            // Get current node
-            curr = frontier.front(); // m
-            frontier.pop();
-
-            // inject new temporary vm nodes and edges
-            unsigned vm = first_out.size();
-            vector<unsigned> vm_head;
-            for (unsigned bound_node : curr->boundary_outwards)
-            {
-                vm_head.push_back(bound_node);
-            }
+            task = queues[worker].tasks.front();
+            queues[worker].tasks.pop_front();
+            return true;
+        }
+    }
+    for (unsigned offset = 1; offset < queues.size(); offset++)
+    {
+        task_queue_t & victim = queues[(worker + offset) % queues.size()];
+        boost::lock_guard<boost::mutex> lock(victim.access);
+        if (!victim.tasks.empty())
+        {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+// helper function
+/* Run tasks [0, num_of_tasks) in a pool of workers. Tasks are dealt to the workers round robin and balanced by work
+ * stealing, each worker keeps its own scratch storage. Progress is printed at most every PROGRESS_INTERVAL.
+ * Parameters: const size_t & num_of_tasks
+ *             const unsigned & num_of_threads: 0 for all cores
+ *             function<void(const size_t &, search_scratch_t &)> run: runs a task with the scratch of its worker
+ * Return: unsigned: number of threads used
+ */
+static unsigned run_tasks(const size_t &num_of_tasks, const unsigned &num_of_threads,
+                          function<void(const size_t &, search_scratch_t &)> run)
+{
+    unsigned threads = num_of_threads != 0? num_of_threads : max(1u, boost::thread::hardware_concurrency());
+    threads = min<size_t>(threads, max<size_t>(1, num_of_tasks));
 
-            // find distance between partition within same bound
-            // prepare storage for single source graph search
-            vector<unsigned> dist(first_out.size() + 1, INFINITY);
-            vector<unsigned> prev(first_out.size() + 1, INFINITY); // infinity defined as nil here
-            map<unsigned, unsigned> rep;
-            for (auto partition_same_bound : curr->parent_partition->sub_partition)
+    vector<task_queue_t> queues(threads);
+    for (size_t i = 0; i < num_of_tasks; i++)
+    {
+        queues[i % threads].tasks.push_back(i);
+    }
+
+    const auto start = chrono::steady_clock::now();
+    boost::atomic<size_t> num_of_done(0);
+    boost::atomic<long long> last_progress(0); // milliseconds since start
+    auto work = [&](const unsigned worker)
+    {
+        search_scratch_t scratch;
+        size_t task;
+        while (take_task(queues, worker, task))
+        {
+            run(task, scratch);
+            size_t done = ++num_of_done;
+
+            // one worker prints when the interval has passed
+            long long now = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+            long long last = last_progress.load();
+            if (now - last >= PROGRESS_INTERVAL && last_progress.compare_exchange_strong(last, now))
             {
-                rep[partition_same_bound->id] = INFINITY;
-                //cout << "initial reg p: " << partition_same_bound->id << " = " << rep[partition_same_bound->id] << endl;
+                printf("Preprocessed %zu / %zu tasks (%.0f%%) in %.1f s\n", done, num_of_tasks,
+                       100.0 * done / num_of_tasks, now / 1000.0);
+                fflush(stdout);
             }
-            priority_queue<pair<unsigned, unsigned>, vector<pair<unsigned, unsigned>>, greater<pair<unsigned, unsigned>>> q;
+        }
+    };
 
-            // insert new temp node into q
-            unsigned origin = vm;
-            q.push(make_pair(0, origin));
-            dist[origin] = 0;
+    boost::thread_group workers;
+    for (unsigned t = 1; t < threads; t++)
+    {
+        workers.create_thread(boost::bind<void>(work, t));
+    }
+    work(0);
+    workers.join_all();
+    return threads;
+}
 
-            // process the node u with minimum dist[u]
-            while (!q.empty())
-            {
-                unsigned u = q.top().second;
-                q.pop();
+/* Compute the distance table entries of a set of partitions, replacing their current values.
+ * Used by do_preprocess for all partitions, and for the partitions affected by changed edges.
+ * There are two kinds of tasks: the distances of all children of a parent towards and from its boundary, found by two
+ * searches per parent, and the distances of each partition towards the partitions within the same bound. Tasks run
+ * in a work-stealing pool, see run_tasks, and write the entries of their partitions without locking, as no two tasks
+ * write the same field of an entry.
+ * Parameters: const vector<unsigned>& head
+ *             const vector<unsigned>& first_out
+ *             const vector<unsigned>& default_travel_time
+ *             const vector<unsigned>& head_inversed
+ *             const vector<unsigned>& first_out_inversed
+ *             const vector<unsigned>& relative_edge: edge ID of each inversed edge
+ *             const IMS::Partition::partition_tree_t* partitions: indexed
+ *             const vector<unsigned>& to_preprocess: partitions below the root
+ *             const IMS::Partition::layer_t* layers
+ *             distance_table_t* distance_table: sized for layers, only entries of to_preprocess are written
+ *             const unsigned & num_of_threads: partitions are preprocessed in this many threads, 0 for all cores
+ *             const bool & is_bound_computed: false to keep the distances towards and from the boundary of the parents
+ *                                             and compute the distances towards the partitions within the same
+ *                                             bound only
+ * Return: when the entries are computed
+ */
+void IMS::Preprocess::preprocess_partitions
+        (const vector<unsigned>& head,
+         const vector<unsigned>& first_out,
+         const vector<unsigned>& default_travel_time,
+         const vector<unsigned>& head_inversed,
+         const vector<unsigned>& first_out_inversed,
+         const vector<unsigned>& relative_edge,
+         const IMS::Partition::partition_tree_t* partitions,
+         const vector<unsigned>& to_preprocess,
+         const IMS::Partition::layer_t* layers,
+         distance_table_t* distance_table,
+         const unsigned &num_of_threads,
+         const bool &is_bound_computed)
+{
+    // group partitions by parent, in order of first appearance, none if the bound distances are kept
+    vector<unsigned> parents;
+    vector< vector<unsigned> > children;
+    map<unsigned, size_t> parent_index;
+    for (auto p : to_preprocess)
+    {
+        if (!is_bound_computed)
+        {
+            continue;
+        }
+        auto found = parent_index.insert(make_pair(partitions->parent[p], parents.size()));
+        if (found.second)
+        {
+            parents.push_back(partitions->parent[p]);
+            children.emplace_back();
+        }
+        children[found.first->second].push_back(p);
+    }
 
-                // regiester partition distances
-                if (u != vm)
-                {
-                    unsigned c = u;
-                    for (int layer = layers->size() - 1; layer > curr->layer; layer --)
-                    {
-                        c = (*layers)[layer][c];
-                    }
-                    if (rep[c] == (unsigned)INFINITY) 
-                    {
-                        //cout << "regestered p: " << c << endl;
-                        rep[c] = u;
-                    } 
-                }
-                
-                // premature end the graph search when all partition within the same bound searched
-                bool all_filled = true;
-                for (map<unsigned, unsigned>::iterator entry = rep.begin(); entry != rep.end(); entry++)
-                {
-                    if (entry->second != INFINITY)
-                    {
-                        all_filled = false;
-                        break;
-                    }
-                }
-                if (all_filled)
-                {
-                    break;
-                }
+    // tasks [0, parents.size()) are parents, the rest are partitions of to_preprocess
+    const auto start = chrono::steady_clock::now();
+    unsigned threads = run_tasks(parents.size() + to_preprocess.size(), num_of_threads,
+                                 [&](const size_t &task, search_scratch_t &scratch)
+    {
+        if (task < parents.size())
+        {
+            preprocess_bound_distances(head, first_out, default_travel_time,
+                                       head_inversed, first_out_inversed, relative_edge,
+                                       partitions, parents[task], children[task], layers, distance_table,
+                                       scratch);
+        }
+        else
+        {
+            const unsigned curr = to_preprocess[task - parents.size()];
+            entry_t & entry = (*distance_table)[partitions->layer[curr]][partitions->id[curr]];
+            entry.partition_distance.clear();
+            preprocess_partition(head, first_out, default_travel_time, partitions, curr, layers, distance_table,
+                                 scratch);
+        }
+    });
+    cout << "Preprocessed " << to_preprocess.size() << " partitions of " << parents.size() << " parents in "
+         << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s with " << threads
+         << " threads." << endl;
+}
 
-                // expand neighbours
-                if (u != vm)
-                {
-                    unsigned first_edge = first_out[u];
-                    unsigned last_edge = (u == first_out.size() -1) ? (head.size()) : first_out[u + 1];
-                    for (unsigned int current_edge = first_edge; current_edge < last_edge; current_edge ++)
-                    {
-                        unsigned v = head[current_edge];
-                        if (dist[v] > dist[u] + default_travel_time[current_edge])
-                        {
-                            dist[v] = dist[u] + default_travel_time[current_edge];
-                            prev[v] = u;
-                            q.push(make_pair(dist[v], v));
-                        }
-                    }
-                }
-                else
-                {
-                    for (unsigned int current_edge = 0; current_edge < vm_head.size(); current_edge ++)
-                    {
-                        unsigned v = vm_head[current_edge];
-                        if (dist[v] > dist[u] + 0)
-                        {
-                            dist[v] = dist[u] + 0;
-                            prev[v] = u;
-                            q.push(make_pair(dist[v], v));
-                        }
-                    }
-                }
-            }
+/* Compute the distances of every node towards the outward boundary and from the inward boundary of its partition in
+ * each level below the root, for the precise heuristic. Memory use is num_of_nodes x (levels - 1) x 2 unsigned,
+ * see boundary_distance_table_t::memory_size.
+ * Parameters: const vector<unsigned>& head
+ *             const vector<unsigned>& first_out
+ *             const vector<unsigned>& default_travel_time
+ *             const vector<unsigned>& head_inversed
+ *             const vector<unsigned>& first_out_inversed
+ *             const vector<unsigned>& relative_edge: edge ID of each inversed edge
+ *             const IMS::Partition::partition_tree_t* partitions: indexed
+ *             const IMS::Partition::layer_t* layers
+ *             const unsigned & num_of_threads: partitions are searched in this many threads, 0 for all cores
+ * Return: boundary_distance_table_t*: owned by caller
+ */
+boundary_distance_table_t* IMS::Preprocess::do_preprocess_boundary_distances
+        (const vector<unsigned>& head,
+         const vector<unsigned>& first_out,
+         const vector<unsigned>& default_travel_time,
+         const vector<unsigned>& head_inversed,
+         const vector<unsigned>& first_out_inversed,
+         const vector<unsigned>& relative_edge,
+         const IMS::Partition::partition_tree_t* partitions,
+         const IMS::Partition::layer_t* layers,
+         const unsigned &num_of_threads)
+{
+    auto table = new boundary_distance_table_t();
+    table->num_of_nodes = first_out.size();
+    table->outbound_distance = vector<unsigned>(table->num_of_nodes * (size_t)(layers->size() - 2), INFINITY);
+    table->inbound_distance = vector<unsigned>(table->outbound_distance.size(), INFINITY);
 
-            // all distance information towards partitions within the same bound into distance table
-            for (auto partition_same_bound : curr->parent_partition->sub_partition)
+    // all partitions below the root
+    vector<unsigned> to_preprocess;
+    for (unsigned curr = 1; curr < partitions->num_of_partitions(); curr++)
+    {
+        to_preprocess.push_back(curr);
+    }
+    preprocess_boundary_distances(head, first_out, default_travel_time, head_inversed, first_out_inversed,
+                                  relative_edge, partitions, to_preprocess, layers, table, num_of_threads);
+    return table;
+}
+
+/* Compute the boundary distances of the nodes of a set of partitions, replacing their current values. Each partition
+ * is a task of two searches restricted to it, one backward from its outward boundary and one forward from its inward
+ * boundary, as a path within the partition reaches a boundary node before leaving it. Tasks run in a work-stealing
+ * pool, see run_tasks, and write the entries of their own nodes without locking.
+ * Parameters: const vector<unsigned>& head
+ *             const vector<unsigned>& first_out
+ *             const vector<unsigned>& default_travel_time
+ *             const vector<unsigned>& head_inversed
+ *             const vector<unsigned>& first_out_inversed
+ *             const vector<unsigned>& relative_edge: edge ID of each inversed edge
+ *             const IMS::Partition::partition_tree_t* partitions: indexed
+ *             const vector<unsigned>& to_preprocess: partitions below the root
+ *             const IMS::Partition::layer_t* layers
+ *             boundary_distance_table_t* table: sized for layers, only entries of nodes of to_preprocess are written
+ *             const unsigned & num_of_threads: partitions are searched in this many threads, 0 for all cores
+ * Return: when the entries are computed
+ */
+void IMS::Preprocess::preprocess_boundary_distances
+        (const vector<unsigned>& head,
+         const vector<unsigned>& first_out,
+         const vector<unsigned>& default_travel_time,
+         const vector<unsigned>& head_inversed,
+         const vector<unsigned>& first_out_inversed,
+         const vector<unsigned>& relative_edge,
+         const IMS::Partition::partition_tree_t* partitions,
+         const vector<unsigned>& to_preprocess,
+         const IMS::Partition::layer_t* layers,
+         boundary_distance_table_t* table,
+         const unsigned &num_of_threads)
+{
+    const unsigned num_of_nodes = first_out.size();
+    const auto start = chrono::steady_clock::now();
+    unsigned threads = run_tasks(to_preprocess.size(), num_of_threads,
+                                 [&](const size_t &task, search_scratch_t &scratch)
+    {
+        const unsigned curr = to_preprocess[task];
+        const size_t level_offset = (partitions->layer[curr] - 1) * (size_t)num_of_nodes;
+        auto settle_all = [](const unsigned &, const unsigned &)
+        {
+            return true;
+        };
+
+        scratch.start(num_of_nodes);
+        bounded_search(head_inversed, first_out_inversed, default_travel_time, &relative_edge,
+                       partitions->outwards_of(curr), partitions, curr, layers, scratch, settle_all);
+        for (auto node : partitions->nodes_of(curr))
+        {
+            table->outbound_distance[level_offset + node] = scratch.get_dist(node);
+        }
+
+        scratch.start(num_of_nodes);
+        bounded_search(head, first_out, default_travel_time, NULL,
+                       partitions->inwards_of(curr), partitions, curr, layers, scratch, settle_all);
+        for (auto node : partitions->nodes_of(curr))
+        {
+            table->inbound_distance[level_offset + node] = scratch.get_dist(node);
+        }
+    });
+    cout << "Preprocessed boundary distances of " << to_preprocess.size() << " partitions in "
+         << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s with " << threads
+         << " threads, " << table->memory_size() / 1024 << " KiB in total." << endl;
+}
+
+/* Flatten layers and distance tables into the form used for routing.
+ * Parameters: const IMS::Partition::layer_t* layers
+ *             const distance_table_t* distance_table
+ * Return: flat_distance_table_t*: flat tables, entries without partition distances get an empty range
+ */
+flat_distance_table_t* IMS::Preprocess::flatten_distance_table
+        (const IMS::Partition::layer_t* layers,
+         const distance_table_t* distance_table)
+{
+    auto flat = new flat_distance_table_t();
+
+    vector<unsigned> layer_first(1, 0);
+    vector<unsigned> layer_parent;
+    for (auto & level : *layers)
+    {
+        layer_parent.insert(layer_parent.end(), level.begin(), level.end());
+        layer_first.push_back(layer_parent.size());
+    }
+
+    vector<unsigned> outbound_distance, inbound_distance, distance_first, distance_target, distance_value;
+    for (auto & level : *distance_table)
+    {
+        for (auto & entry : level)
+        {
+            outbound_distance.push_back(entry.outbound_distance);
+            inbound_distance.push_back(entry.inbound_distance);
+            distance_first.push_back(distance_target.size());
+            // map iterates in key order, targets are sorted
+            for (auto & target : entry.partition_distance)
             {
-                //cout << "saving at level " << curr->layer << ", from p: " << curr->id << ", to p: " << partition_same_bound->id << ", dist: " << rep[partition_same_bound->id] << endl;
-                if (rep[partition_same_bound->id] != (unsigned)INFINITY)
-                {   
-                    (*distance_table)[curr->layer][curr->id].partition_distance[partition_same_bound->id] = dist[rep[partition_same_bound->id]];
-                }
+                distance_target.push_back(target.first);
+                distance_value.push_back(target.second);
             }
+        }
+    }
+    distance_first.push_back(distance_target.size());
 
-            // find distance to and from the bound borde
-            (*distance_table)[curr->layer][curr->id].outbound_distance = nodeset_shortest_destance(head, first_out, default_travel_time, curr->boundary_outwards ,curr->parent_partition->boundary_outwards);
-            (*distance_table)[curr->layer][curr->id].inbound_distance = nodeset_shortest_destance(head, first_out, default_travel_time, curr->parent_partition->boundary_inwards, curr->boundary_inwards);
-            cout << "Added distance table for partition " << curr->id << " at level " << curr->layer << "." << endl;
+    flat->layer_first = move(layer_first);
+    flat->layer_parent = move(layer_parent);
+    flat->outbound_distance = move(outbound_distance);
+    flat->inbound_distance = move(inbound_distance);
+    flat->distance_first = move(distance_first);
+    flat->distance_target = move(distance_target);
+    flat->distance_value = move(distance_value);
+    return flat;
+}
 
-            // remove temp node and vertex
-            // -- due to implementation, nothing need to be done
+/* Precomputed distance between two partitions under the same parent.
+ * Parameters: const unsigned & level
+ *             const unsigned & from: partition in level
+ *             const unsigned & to: partition in level
+ * Return: unsigned: distance, 0 if not precomputed
+ */
+unsigned IMS::Preprocess::flat_distance_table_t::distance(const unsigned &level, const unsigned &from,
+                                                          const unsigned &to) const
+{
+    size_t index = find_distance(level, from, to);
+    return index == distance_value.size()? 0 : distance_value[index];
+}
+
+/* Position of the precomputed distance between two partitions under the same parent, e.g. for the distances of
+ * weight profiles laid out as distance_value.
+ * Parameters: const unsigned & level
+ *             const unsigned & from: partition in level
+ *             const unsigned & to: partition in level
+ * Return: size_t: index in distance_value, distance_value.size() if not precomputed
+ */
+size_t IMS::Preprocess::flat_distance_table_t::find_distance(const unsigned &level, const unsigned &from,
+                                                             const unsigned &to) const
+{
+    unsigned entry = layer_first[level] + from;
+    const unsigned * first = distance_target.data() + distance_first[entry];
+    const unsigned * last = distance_target.data() + distance_first[entry + 1];
+    const unsigned * target = lower_bound(first, last, to);
+    if (target == last || *target != to)
+    {
+        return distance_value.size();
+    }
+    return target - distance_target.data();
+}
 
-            // Expand neighbour
-            for(auto sp : curr->sub_partition)
+/* Profile applying at a time, the last one starting at or before its local time of day.
+ * Parameters: const time_t & time: milliseconds since epoch
+ * Return: unsigned: profile, the last one of the day before the first start time
+ */
+unsigned IMS::Preprocess::weight_profile_table_t::find_profile(const time_t &time) const
+{
+    const long long SECONDS_PER_DAY = 86400;
+    long long local_time = time / 1000 + utc_offset;
+    unsigned time_of_day = ((local_time % SECONDS_PER_DAY) + SECONDS_PER_DAY) % SECONDS_PER_DAY;
+    const unsigned * next = upper_bound(start_time.data(), start_time.data() + start_time.size(), time_of_day);
+    return next == start_time.data()? num_of_profiles() - 1 : next - start_time.data() - 1;
+}
+
+/* Preprocess the heuristic entries of weight profiles, see weight_profile_table_t. Each profile is preprocessed as
+ * the graph with its bound weights, the lowest travel time of the profiles applying from its start time until
+ * max_trip_duration after it ends. Its entries must take the same places as in the flat distance tables.
+ * Parameters: const vector<unsigned>& head
+ *             const vector<unsigned>& first_out
+ *             const vector<unsigned>& head_inversed
+ *             const vector<unsigned>& first_out_inversed
+ *             const vector<unsigned>& relative_edge: edge ID of each inversed edge
+ *             const IMS::Partition::partition_tree_t* partitions: indexed, the flat distance tables are built from
+ *             const flat_distance_table_t* tables
+ *             weight_profile_table_t* profiles: with start_time and travel_time, the heuristic entries are replaced
+ *             const unsigned & num_of_threads: see do_preprocess
+ *             const unsigned & max_trip_duration: seconds, routes up to this long are optimal, a day or more takes
+ *                                                 the lowest travel time of all profiles
+ * Return: when preprocessed, throws runtime_error if the tables are not built from the partitions
+ */
+void IMS::Preprocess::preprocess_weight_profiles
+        (const vector<unsigned>& head,
+         const vector<unsigned>& first_out,
+         const vector<unsigned>& head_inversed,
+         const vector<unsigned>& first_out_inversed,
+         const vector<unsigned>& relative_edge,
+         const IMS::Partition::partition_tree_t* partitions,
+         const flat_distance_table_t* tables,
+         weight_profile_table_t* profiles,
+         const unsigned &num_of_threads,
+         const unsigned &max_trip_duration)
+{
+    const unsigned SECONDS_PER_DAY = 86400;
+    const unsigned num_of_profiles = profiles->num_of_profiles();
+    const unsigned num_of_edges = head.size();
+    vector<unsigned> nodes(first_out.size());
+    for (unsigned i = 0; i < nodes.size(); i++) nodes[i] = i;
+    IMS::Partition::layer_t* layers = IMS::Partition::build_layer(partitions, first_out.size());
+
+    vector<unsigned> outbound_distance, inbound_distance, distance_value;
+    for (unsigned profile = 0; profile < num_of_profiles; profile++)
+    {
+        // lower bound of the weights of the profiles starting before max_trip_duration after this one ends,
+        // start times counted from the start of this one
+        auto starts_after = [&](const unsigned &other)
+        {
+            return (profiles->start_time[other] + SECONDS_PER_DAY - profiles->start_time[profile]) % SECONDS_PER_DAY;
+        };
+        const unsigned next = (profile + 1) % num_of_profiles;
+        const unsigned long long window_end = (next == profile? SECONDS_PER_DAY : starts_after(next))
+                                              + (unsigned long long)max_trip_duration;
+        vector<unsigned> bound_travel_time(profiles->travel_time.begin() + profile * (size_t)num_of_edges,
+                                           profiles->travel_time.begin() + (profile + 1) * (size_t)num_of_edges);
+        for (unsigned other = 0; other < num_of_profiles; other++)
+        {
+            if (other == profile || starts_after(other) >= window_end)
             {
-                if (sp->is_node == false)
-                {
-                    frontier.push(sp);
-                    new_level_node_count += 1;
-                }
+                continue;
+            }
+            for (unsigned edge = 0; edge < num_of_edges; edge++)
+            {
+                bound_travel_time[edge] = min(bound_travel_time[edge], profiles->get_travel_time(other, edge));
             }
         }
 
-        level_node_count = new_level_node_count;
-        new_level_node_count = 0;
+        distance_table_t* distance_table = do_preprocess(nodes, head, first_out, bound_travel_time, head_inversed,
+                                                         first_out_inversed, relative_edge, partitions, layers,
+                                                         num_of_threads);
+        flat_distance_table_t* flat = flatten_distance_table(layers, distance_table);
+        delete distance_table;
+        bool is_matched = tables->layer_parent == flat->layer_parent.get_vector()
+                          && tables->distance_first == flat->distance_first.get_vector()
+                          && tables->distance_target == flat->distance_target.get_vector();
+        if (!is_matched)
+        {
+            delete flat;
+            delete layers;
+            throw runtime_error("Weight profiles must be preprocessed with the partitions of the distance tables");
+        }
+        outbound_distance.insert(outbound_distance.end(), flat->outbound_distance.begin(), flat->outbound_distance.end());
+        inbound_distance.insert(inbound_distance.end(), flat->inbound_distance.begin(), flat->inbound_distance.end());
+        distance_value.insert(distance_value.end(), flat->distance_value.begin(), flat->distance_value.end());
+        delete flat;
+    }
+    delete layers;
+
+    profiles->outbound_distance = move(outbound_distance);
+    profiles->inbound_distance = move(inbound_distance);
+    profiles->distance_value = move(distance_value);
+}
+
+/* Write layers and distance tables of a graph as overlay file, in Boost text archive.
+ * Parameters: const string & output_file_path
+ *             const uint64_t & graph_checksum: identifies the graph, see MapGraph::get_checksum
+ *             const IMS::Partition::layer_t* layers
+ *             const distance_table_t* distance_table
+ * Return: when the overlay file is written
+ */
+void IMS::Preprocess::write_overlay
+        (const string &output_file_path,
+         const uint64_t &graph_checksum,
+         const IMS::Partition::layer_t* layers,
+         const distance_table_t* distance_table)
+{
+    ofstream ofs(output_file_path);
+    if (!ofs)
+    {
+        throw runtime_error("Cannot write overlay file: " + output_file_path);
     }
-    
-    return distance_table;
+    boost::archive::text_oarchive output_archive_stream(ofs);
+    const unsigned long long checksum = graph_checksum;
+    output_archive_stream << checksum;
+    output_archive_stream << *layers;
+    output_archive_stream << *distance_table;
+}
+
+/* Read layers and distance tables from overlay file.
+ * Parameters: const string & input_file_path
+ *             const uint64_t & graph_checksum: overlay must be written for the graph with this checksum
+ *             IMS::Partition::layer_t*& layers: set to the layers read, owned by caller
+ *             distance_table_t*& distance_table: set to the distance tables read, owned by caller
+ * Return: when read, throws runtime_error if the overlay is written for another graph
+ */
+void IMS::Preprocess::read_overlay
+        (const string &input_file_path,
+         const uint64_t &graph_checksum,
+         IMS::Partition::layer_t*& layers,
+         distance_table_t*& distance_table)
+{
+    ifstream ifs(input_file_path);
+    if (!ifs)
+    {
+        throw runtime_error("Cannot read overlay file: " + input_file_path);
+    }
+    boost::archive::text_iarchive input_archive_stream(ifs);
+    unsigned long long checksum;
+    input_archive_stream >> checksum;
+    if (checksum != graph_checksum)
+    {
+        throw runtime_error("Overlay file is written for another graph: " + input_file_path);
+    }
+    layers = new IMS::Partition::layer_t();
+    distance_table = new distance_table_t();
+    input_archive_stream >> *layers;
+    input_archive_stream >> *distance_table;
 }
 
 /* Print the distance table structure.
@@ -8,9 +8,13 @@
 #define IMS_CPP_PREPROCESS_H
 
 #include <boost/serialization/map.hpp>
+#include <boost/serialization/split_member.hpp>
 
 #include <vector>
+#include <string>
+#include <cstdint>
 #include "partition.h"
+#include "../include/ims/mapped_array.h"
 
 using namespace std;
 
@@ -47,14 +51,270 @@ typedef struct entry_t entry_t;
  */
 typedef vector< vector< entry_t>> distance_table_t;
 
+/* Flat form of layers and distance tables used for routing. Arrays can view a memory-mapped graph file in place.
+ * Entry y of level x is at index i = layer_first[x] + y:
+ *   layer_parent[i] = (*layers)[x][y]
+ *   outbound_distance[i], inbound_distance[i] = (*distance_table)[x][y].outbound_distance, .inbound_distance
+ *   partition distances of entry i are distance_target[j] -> distance_value[j] for j in
+ *   [distance_first[i], distance_first[i + 1]), sorted by target.
+ * Distance entries exist for all levels but the last one, as in distance_table_t.
+ */
+struct flat_distance_table_t
+{
+    MappedArray<unsigned> layer_first;
+    MappedArray<unsigned> layer_parent;
+    MappedArray<unsigned> outbound_distance;
+    MappedArray<unsigned> inbound_distance;
+    MappedArray<unsigned> distance_first;
+    MappedArray<unsigned> distance_target;
+    MappedArray<unsigned> distance_value;
+
+    unsigned num_of_levels() const
+    {
+        return layer_first.empty()? 0 : layer_first.size() - 1;
+    }
+
+    unsigned parent(const unsigned &level, const unsigned &id) const
+    {
+        return layer_parent[layer_first[level] + id];
+    }
+
+    unsigned outbound(const unsigned &level, const unsigned &id) const
+    {
+        return outbound_distance[layer_first[level] + id];
+    }
+
+    unsigned inbound(const unsigned &level, const unsigned &id) const
+    {
+        return inbound_distance[layer_first[level] + id];
+    }
+
+    unsigned entry(const unsigned &level, const unsigned &id) const
+    {
+        return layer_first[level] + id;
+    }
+
+    unsigned distance(const unsigned &level, const unsigned &from, const unsigned &to) const;
+    size_t find_distance(const unsigned &level, const unsigned &from, const unsigned &to) const;
+
+    /* Bytes of all arrays */
+    size_t memory_size() const
+    {
+        return (layer_first.size() + layer_parent.size() + outbound_distance.size() + inbound_distance.size()
+                + distance_first.size() + distance_target.size() + distance_value.size()) * sizeof(unsigned);
+    }
+};
+
+/* Optional precise heuristic data: distance of each node towards the outward boundary and from the inward boundary
+ * of its partition in each level below the root, INFINITY if the boundary is not reachable within the partition.
+ * Arrays can view a memory-mapped graph file in place.
+ * Entry of node n in level x, 1 <= x < number of partition levels, is at index (x - 1) * num_of_nodes + n.
+ */
+struct boundary_distance_table_t
+{
+    unsigned num_of_nodes = 0;
+    MappedArray<unsigned> outbound_distance;
+    MappedArray<unsigned> inbound_distance;
+
+    template<class Archive>
+    void save(Archive & archive, const unsigned int version) const
+    {
+        archive << num_of_nodes;
+        archive << outbound_distance.to_vector();
+        archive << inbound_distance.to_vector();
+    }
+
+    template<class Archive>
+    void load(Archive & archive, const unsigned int version)
+    {
+        vector<unsigned> outbound, inbound;
+        archive >> num_of_nodes;
+        archive >> outbound;
+        archive >> inbound;
+        outbound_distance = move(outbound);
+        inbound_distance = move(inbound);
+    }
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+    unsigned outbound(const unsigned &level, const unsigned &node) const
+    {
+        return outbound_distance[(level - 1) * (size_t)num_of_nodes + node];
+    }
+
+    unsigned inbound(const unsigned &level, const unsigned &node) const
+    {
+        return inbound_distance[(level - 1) * (size_t)num_of_nodes + node];
+    }
+
+    /* Bytes of all arrays */
+    size_t memory_size() const
+    {
+        return (outbound_distance.size() + inbound_distance.size()) * sizeof(unsigned);
+    }
+};
+
+/* Travel time profiles by time of day, e.g. hourly, replacing the default travel time as base weight of routing.
+ * Profile p applies from its start time until the start time of the next one, the last one until the first one of
+ * the next day. Its heuristic entries are built on the lowest travel time of the profiles applying from its start time
+ * until a maximum trip duration after it ends, so they stay admissible for the rest of any route reaching a node
+ * within the profile and taking up to that duration. Routing takes the entries of the profile applying when a node is
+ * reached, see Router::route.
+ * Heuristic entries take the place of outbound_distance, inbound_distance and distance_value of the flat distance
+ * tables the profiles are preprocessed with, whose other arrays they share, as only the distances depend on weights.
+ * Element i of profile p is at p * n + i, n being the size of the array of one profile.
+ * Arrays can view a memory-mapped graph file in place.
+ */
+struct weight_profile_table_t
+{
+    int utc_offset = 0; // seconds, local time = UTC + utc_offset
+    MappedArray<unsigned> start_time; // seconds since local midnight, ascending
+    MappedArray<unsigned> travel_time; // milliseconds, edges of each profile
+    MappedArray<unsigned> outbound_distance;
+    MappedArray<unsigned> inbound_distance;
+    MappedArray<unsigned> distance_value;
+
+    template<class Archive>
+    void save(Archive & archive, const unsigned int version) const
+    {
+        archive << utc_offset;
+        archive << start_time.to_vector();
+        archive << travel_time.to_vector();
+        archive << outbound_distance.to_vector();
+        archive << inbound_distance.to_vector();
+        archive << distance_value.to_vector();
+    }
+
+    template<class Archive>
+    void load(Archive & archive, const unsigned int version)
+    {
+        vector<unsigned> start, time, outbound, inbound, value;
+        archive >> utc_offset;
+        archive >> start >> time >> outbound >> inbound >> value;
+        start_time = move(start);
+        travel_time = move(time);
+        outbound_distance = move(outbound);
+        inbound_distance = move(inbound);
+        distance_value = move(value);
+    }
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+    unsigned num_of_profiles() const
+    {
+        return start_time.size();
+    }
+
+    unsigned find_profile(const time_t &time) const;
+
+    unsigned get_travel_time(const unsigned &profile, const unsigned &edge) const
+    {
+        return travel_time[profile * (travel_time.size() / num_of_profiles()) + edge];
+    }
+
+    unsigned outbound(const unsigned &profile, const unsigned &entry) const
+    {
+        return outbound_distance[profile * (outbound_distance.size() / num_of_profiles()) + entry];
+    }
+
+    unsigned inbound(const unsigned &profile, const unsigned &entry) const
+    {
+        return inbound_distance[profile * (inbound_distance.size() / num_of_profiles()) + entry];
+    }
+
+    unsigned distance(const unsigned &profile, const size_t &index) const
+    {
+        return distance_value[profile * (distance_value.size() / num_of_profiles()) + index];
+    }
+
+    /* Bytes of all arrays */
+    size_t memory_size() const
+    {
+        return (start_time.size() + travel_time.size() + outbound_distance.size() + inbound_distance.size()
+                + distance_value.size()) * sizeof(unsigned);
+    }
+};
+
 /* Preprocessing */
+const long long PROGRESS_INTERVAL = 1000; // milliseconds between progress lines of preprocessing
+const unsigned MAX_TRIP_DURATION = 3 * 3600; // seconds, default bound of routes optimal with weight profiles
+
 distance_table_t* do_preprocess 
         (const vector<unsigned> &nodes, 
          const vector<unsigned>& head,
          const vector<unsigned>& first_out,
          const vector<unsigned>& default_travel_time,
-         IMS::Partition::partition_t* partitions, 
-         IMS::Partition::layer_t* layers);
+         const vector<unsigned>& head_inversed,
+         const vector<unsigned>& first_out_inversed,
+         const vector<unsigned>& relative_edge,
+         const IMS::Partition::partition_tree_t* partitions, 
+         IMS::Partition::layer_t* layers,
+         const unsigned &num_of_threads = 1);
+
+void preprocess_partitions
+        (const vector<unsigned>& head,
+         const vector<unsigned>& first_out,
+         const vector<unsigned>& default_travel_time,
+         const vector<unsigned>& head_inversed,
+         const vector<unsigned>& first_out_inversed,
+         const vector<unsigned>& relative_edge,
+         const IMS::Partition::partition_tree_t* partitions,
+         const vector<unsigned>& to_preprocess,
+         const IMS::Partition::layer_t* layers,
+         distance_table_t* distance_table,
+         const unsigned &num_of_threads = 1,
+         const bool &is_bound_computed = true);
+
+boundary_distance_table_t* do_preprocess_boundary_distances
+        (const vector<unsigned>& head,
+         const vector<unsigned>& first_out,
+         const vector<unsigned>& default_travel_time,
+         const vector<unsigned>& head_inversed,
+         const vector<unsigned>& first_out_inversed,
+         const vector<unsigned>& relative_edge,
+         const IMS::Partition::partition_tree_t* partitions,
+         const IMS::Partition::layer_t* layers,
+         const unsigned &num_of_threads = 1);
+
+void preprocess_boundary_distances
+        (const vector<unsigned>& head,
+         const vector<unsigned>& first_out,
+         const vector<unsigned>& default_travel_time,
+         const vector<unsigned>& head_inversed,
+         const vector<unsigned>& first_out_inversed,
+         const vector<unsigned>& relative_edge,
+         const IMS::Partition::partition_tree_t* partitions,
+         const vector<unsigned>& to_preprocess,
+         const IMS::Partition::layer_t* layers,
+         boundary_distance_table_t* table,
+         const unsigned &num_of_threads = 1);
+
+flat_distance_table_t* flatten_distance_table
+        (const IMS::Partition::layer_t* layers,
+         const distance_table_t* distance_table);
+
+void preprocess_weight_profiles
+        (const vector<unsigned>& head,
+         const vector<unsigned>& first_out,
+         const vector<unsigned>& head_inversed,
+         const vector<unsigned>& first_out_inversed,
+         const vector<unsigned>& relative_edge,
+         const IMS::Partition::partition_tree_t* partitions,
+         const flat_distance_table_t* tables,
+         weight_profile_table_t* profiles,
+         const unsigned &num_of_threads = 1,
+         const unsigned &max_trip_duration = MAX_TRIP_DURATION);
+
+/* Overlay files, preprocessed data of one (k, l) variant stored apart from the graph it belongs to */
+void write_overlay
+        (const string &output_file_path,
+         const uint64_t &graph_checksum,
+         const IMS::Partition::layer_t* layers,
+         const distance_table_t* distance_table);
+
+void read_overlay
+        (const string &input_file_path,
+         const uint64_t &graph_checksum,
+         IMS::Partition::layer_t*& layers,
+         distance_table_t*& distance_table);
 
 /* Util functions */
 void print_distance_table (distance_table_t * distance_table);
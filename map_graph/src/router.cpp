@@ -10,52 +10,85 @@
 #include <stack>
 #include <vector>
 #include <queue>
+#include <algorithm>
 
 #include "../include/ims/router.h"
 
 const unsigned INF  = ((int)INFINITY);
 
 /* Future weight retrieval function, calculate the estimated future weight (heuristics) between two nodes.
+ * With boundary distances preprocessed, the bound at the level where both nodes are in partitions A != B of the same
+ * bound is also taken as the distance of u to the outward boundary of A, plus the distance between A and B, plus the
+ * distance from the inward boundary of B to t, as a path leaves A and enters B through their boundaries.
+ * The larger of both is returned.
+ * With a weight profile, distances are taken from its heuristic entries instead, and boundary distances, which are
+ * preprocessed with the default travel time, are not used.
  * Parameters: const unsigned from_node
  *             const unsigned to_node
+ *             const unsigned profile: weight profile applying when from_node is reached, see
+ *                                     MapGraph::find_weight_profile, NO_PROFILE for the default travel time
  * Return: h(u, t) -> estimated time needed to travel from u to t
  */
-unsigned IMS::Router::retrieve_future_weight(const unsigned &from_node, const unsigned &to_node)
+unsigned IMS::Router::retrieve_future_weight(const unsigned &from_node, const unsigned &to_node,
+                                             const unsigned &profile)
 {
-    IMS::Preprocess::distance_table_t* distance_table = map_graph->distance_tables;
-    IMS::Partition::layer_t* layers = map_graph->layers;
+    const IMS::Preprocess::flat_distance_table_t* tables = map_graph->flat_distance_tables;
+    const IMS::Preprocess::weight_profile_table_t* profiles = profile != IMS::MapGraph::NO_PROFILE?
+                                                              map_graph->weight_profiles : nullptr;
     unsigned future_weight = 0;
     // retrieve first partition
-    unsigned from_partition = (*layers)[layers->size()-1][from_node];
-    unsigned to_partition = (*layers)[layers->size()-1][to_node];
-    for (unsigned i = layers->size()-2; i > 0; i--)
+    unsigned from_partition = tables->parent(tables->num_of_levels()-1, from_node);
+    unsigned to_partition = tables->parent(tables->num_of_levels()-1, to_node);
+    for (unsigned i = tables->num_of_levels()-2; i > 0; i--)
     { 
-        //cout << "checking i: " << i << ", " << (*layers)[i][from_partition] << " == " << (*layers)[i][to_partition] << endl;
-        if ((*layers)[i][from_partition] != (*layers)[i][to_partition])
+        if (tables->parent(i, from_partition) != tables->parent(i, to_partition))
         {
-            //cout << "i: " << i << ", from: " << from_partition << ", to: " << to_partition << endl;
-            //cout << "+ " << (*distance_table)[i][from_partition].outbound_distance << endl;
-            //cout << "+ " << (*distance_table)[i][to_partition].inbound_distance << endl;
             // both nodes are in partitions in separate bound at level i
-            future_weight += (*distance_table)[i][from_partition].outbound_distance;
-            future_weight += (*distance_table)[i][to_partition].inbound_distance;
+            if (profiles != nullptr)
+            {
+                future_weight += profiles->outbound(profile, tables->entry(i, from_partition));
+                future_weight += profiles->inbound(profile, tables->entry(i, to_partition));
+            }
+            else
+            {
+                future_weight += tables->outbound(i, from_partition);
+                future_weight += tables->inbound(i, to_partition);
+            }
         }
         else
         {
             // both nodes are in partitions in the same bound at level i
-            //cout << "+ " << (*distance_table)[i][from_partition].partition_distance[to_partition] << endl;
-            future_weight += (*distance_table)[i][from_partition].partition_distance[to_partition];
+            unsigned partition_distance = 0;
+            size_t distance_index = tables->find_distance(i, from_partition, to_partition);
+            if (distance_index != tables->distance_value.size())
+            {
+                partition_distance = profiles != nullptr? profiles->distance(profile, distance_index)
+                                                        : tables->distance_value[distance_index];
+            }
+            future_weight += partition_distance;
+
+            const IMS::Preprocess::boundary_distance_table_t* boundary_distances = map_graph->boundary_distances;
+            if (boundary_distances != nullptr && profiles == nullptr && from_partition != to_partition)
+            {
+                unsigned outbound = boundary_distances->outbound(i, from_node);
+                unsigned inbound = boundary_distances->inbound(i, to_node);
+                if (outbound != (unsigned)INFINITY && inbound != (unsigned)INFINITY)
+                {
+                    future_weight = max(future_weight, outbound + partition_distance + inbound);
+                }
+            }
             break;
         }
         // move up one level       
-        from_partition = (*layers)[i][from_partition];
-        to_partition = (*layers)[i][to_partition];
+        from_partition = tables->parent(i, from_partition);
+        to_partition = tables->parent(i, to_partition);
     }
     return future_weight;
 }
 
 /*
  * Weight retrieval function calculating realized weight created by travelling an edge starting at a time.
+ * The base travel time is that of the weight profile applying at the time, if any.
  * Parameters: const unsigned & edge
  *             const time_t & enter_time
  * Return: w'(e, t) -> expected time needed to finish travelling this edge
@@ -64,15 +97,16 @@ unsigned int IMS::Router::retrieve_realized_weight(const unsigned &edge, const t
 {
     // travel-time w.r.t. current traffic density ONLY
     double occupancy = map_graph->find_current_density(edge, enter_time) / map_graph->max_density;
+    unsigned travel_time = map_graph->get_travel_time(edge, enter_time);
     if(occupancy >= 0.8)
     {
-        return 5 * map_graph->default_travel_time[edge];
+        return 5 * travel_time;
     }
 
-    double basic_weight = map_graph->default_travel_time[edge] / (1 - occupancy);
+    double basic_weight = travel_time / (1 - occupancy);
 
-    // a(e): incident detection
-    double time_dependent_modifier = incident_manager->get_total_incident_impact(edge);
+    // a(e, t): incidents valid at enter time
+    double time_dependent_modifier = incident_manager->get_total_incident_impact(edge, enter_time);
 
     return round(basic_weight + time_dependent_modifier);
 }
@@ -81,8 +115,8 @@ IMS::Path* IMS::Router::route(const unsigned &origin, const unsigned &destinatio
 {
     // A* search
     // prepare storage for single source graph search
-    vector<unsigned> dist(map_graph->first_out.size(), INFINITY);
-    vector<unsigned> prev(map_graph->first_out.size(), INFINITY); // infinity defined as nil here
+    vector<unsigned> dist(map_graph->get_num_of_nodes(), INFINITY);
+    vector<unsigned> prev(map_graph->get_num_of_nodes(), INFINITY); // infinity defined as nil here
     priority_queue<
             pair<unsigned, pair<unsigned, time_t>>,
             vector<pair<unsigned, pair<unsigned, time_t>>>,
@@ -123,18 +157,15 @@ IMS::Path* IMS::Router::route(const unsigned &origin, const unsigned &destinatio
                 layer_info[i] = -1;
             }
             unsigned l = current_node;
-            //unsigned l = (*(map_graph->layers))[layers->size()-1][current_node];
-            for (unsigned i = map_graph->layers->size()-1; i > 0; i--)
+            for (unsigned i = map_graph->flat_distance_tables->num_of_levels()-1; i > 0; i--)
             { 
-                //cout << i << ", " << l << endl;
                 layer_info[i] = l;
-                //layer_info.emplace_back(i, (*(map_graph->layers))[i][l]);
                 // move up one level       
-                l = (*(map_graph->layers))[i][l];
+                l = map_graph->flat_distance_tables->parent(i, l);
             }        
 
-            log->expanded_nodes[pass_node] = make_pair(map_graph->latitude[pass_node], map_graph->longitude[pass_node]);
-            log->expanded_nodes[current_node] = make_pair(map_graph->latitude[current_node], map_graph->longitude[current_node]);
+            log->expanded_nodes[pass_node] = make_pair(map_graph->get_latitude(pass_node), map_graph->get_longitude(pass_node));
+            log->expanded_nodes[current_node] = make_pair(map_graph->get_latitude(current_node), map_graph->get_longitude(current_node));
             log->expanded_edges.emplace_back(pass_node, current_node, g, h, w, f, layer_info[0], layer_info[1], layer_info[2], layer_info[3], layer_info[4]);
             open_log.pop();
         }
@@ -166,7 +197,7 @@ IMS::Path* IMS::Router::route(const unsigned &origin, const unsigned &destinatio
                 unsigned next_node = node_stack.top();
                 unsigned edge = map_graph->find_edge(this_node, next_node);
 
-                path->nodes.emplace_back(map_graph->longitude[this_node], map_graph->latitude[this_node]);
+                path->nodes.emplace_back(map_graph->get_longitude(this_node), map_graph->get_latitude(this_node));
                 path->enter_times[time] = edge;
 
                 time = time + retrieve_realized_weight(edge, time);
@@ -178,23 +209,22 @@ IMS::Path* IMS::Router::route(const unsigned &origin, const unsigned &destinatio
                 }
             }
             path->end_time = time;
-            path->nodes.emplace_back(map_graph->longitude[destination], map_graph->latitude[destination]);
+            path->nodes.emplace_back(map_graph->get_longitude(destination), map_graph->get_latitude(destination));
             //cout << node_stack.top() << "|" << endl;
 
             return path;
         }
   
 
-        // expand neighbours
-        unsigned first_edge = map_graph->first_out[current_node];
-        unsigned last_edge = (current_node == map_graph->first_out.size() -1) ? (map_graph->head.size()) : map_graph->first_out[current_node + 1];;
-        for (unsigned int current_edge = first_edge; current_edge < last_edge; current_edge ++)
+        // expand neighbours, directly from the compressed graph if any
+        map_graph->for_each_out_edge(current_node, [&](const unsigned &current_edge, const unsigned &next_node)
         {
-            unsigned next_node = map_graph->head[current_edge];
             unsigned g = dist[current_node];
-            unsigned h = retrieve_future_weight(next_node, destination);
             unsigned w = retrieve_realized_weight(current_edge, current_node_time);
-//            unsigned w = map_graph->default_travel_time[current_edge];
+            // heuristic of the weight profile applying when next_node is reached, if any
+            unsigned h = retrieve_future_weight(next_node, destination,
+                                                map_graph->find_weight_profile(current_node_time + w));
+//            unsigned w = map_graph->get_travel_time(current_edge);
 
             unsigned f = g + h + w;
             if (dist[next_node] > g + w)
@@ -210,7 +240,7 @@ IMS::Path* IMS::Router::route(const unsigned &origin, const unsigned &destinatio
                     open_log.push(make_pair(f, make_tuple(next_node, current_node, g, h, w)));
                 }
             }
-        }
+        });
     }
 
     return NULL;
@@ -0,0 +1,452 @@
+/*
+ * Generation of synthetic road graphs. All functions are free functions in IMS::SyntheticGraph namespace.
+ * Junctions are placed in a plane in metres around the centre, then joined by roads: a random spanning tree first,
+ * whose roads run in both directions so that every junction reaches every other, then further roads up to the mean
+ * degree, some of them one-way. Runs in time about linear in the number of nodes, for up to ~10M nodes.
+ * Libraries:
+ * Version: 1.0
+ * Author: Terence Chow
+ */
+
+#include <cmath>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+#include "../include/ims/synthetic_graph.h"
+
+using namespace std;
+using namespace IMS::SyntheticGraph;
+
+const double METRES_PER_DEGREE = 111320;
+
+// helper function
+/* Root of a node in a union-find forest, halving the path on the way
+ * Parameters: vector<unsigned> & parent
+ *             unsigned node
+ * Return: unsigned: root
+ */
+static unsigned find_root(vector<unsigned> &parent, unsigned node)
+{
+    while(parent[node] != node)
+    {
+        parent[node] = parent[parent[node]];
+        node = parent[node];
+    }
+    return node;
+}
+
+namespace
+{
+/* A road between two junctions before it is turned into edges */
+struct road_t
+{
+    unsigned from;
+    unsigned to;
+    uint8_t road_class;
+    bool is_one_way;
+};
+}
+
+// helper function
+/* Keep a spanning tree of the candidate roads, taking the candidates in order, then further candidates at random
+ * until there are mean_degree / 2 roads per junction. Further local streets are one-way at random.
+ * Parameters: const vector<road_t> & candidates: in order of preference for the tree
+ *             const unsigned & num_of_nodes
+ *             const options_t & options
+ *             vector<unsigned> & component: output, union-find forest of the roads kept
+ *             mt19937 & generator
+ * Return: vector<road_t>: roads kept
+ */
+static vector<road_t> select_roads(const vector<road_t> &candidates, const unsigned &num_of_nodes,
+                                   const options_t &options, vector<unsigned> &component,
+                                   mt19937 &generator)
+{
+    component.resize(num_of_nodes);
+    iota(component.begin(), component.end(), 0);
+    vector<road_t> roads;
+    vector<bool> is_kept(candidates.size(), false);
+    for(unsigned i = 0; i < candidates.size(); i++)
+    {
+        unsigned from_root = find_root(component, candidates[i].from);
+        unsigned to_root = find_root(component, candidates[i].to);
+        if(from_root != to_root)
+        {
+            component[from_root] = to_root;
+            roads.push_back(candidates[i]);
+            is_kept[i] = true;
+        }
+    }
+
+    // Roads other than local streets are kept whole, as they carry the through traffic
+    double num_of_extra_roads = options.mean_degree * num_of_nodes / 2 - roads.size();
+    unsigned num_of_extra_streets = 0;
+    for(unsigned i = 0; i < candidates.size(); i++)
+    {
+        num_of_extra_roads -= !is_kept[i] && candidates[i].road_class != LOCAL? 1 : 0;
+        num_of_extra_streets += !is_kept[i] && candidates[i].road_class == LOCAL? 1 : 0;
+    }
+    const double extra_share = num_of_extra_streets > 0? num_of_extra_roads / num_of_extra_streets : 0;
+    uniform_real_distribution<double> random_share(0, 1);
+    for(unsigned i = 0; i < candidates.size(); i++)
+    {
+        if(is_kept[i] || (candidates[i].road_class == LOCAL && random_share(generator) >= extra_share))
+        {
+            continue;
+        }
+        road_t road = candidates[i];
+        road.is_one_way = road.road_class == LOCAL && random_share(generator) < options.one_way_share;
+        if(road.is_one_way && random_share(generator) < 0.5)
+        {
+            swap(road.from, road.to);
+        }
+        roads.push_back(road);
+    }
+    return roads;
+}
+
+// helper function
+/* Junctions on a jittered, gently curved grid, joined to their right and upper neighbours.
+ * Parameters: const options_t & options
+ *             vector<double> & x, y: output, position of each junction, m
+ *             mt19937 & generator
+ * Return: vector<road_t>: candidate roads, roads along arterial rows and columns first, then shuffled
+ */
+static vector<road_t> place_perturbed_grid(const options_t &options, vector<double> &x, vector<double> &y,
+                                           mt19937 &generator)
+{
+    const unsigned n = options.num_of_nodes;
+    const unsigned columns = ceil(sqrt((double) n));
+    const double s = options.spacing;
+    uniform_real_distribution<double> random_jitter(-0.3 * s, 0.3 * s);
+    x.resize(n);
+    y.resize(n);
+    for(unsigned node = 0; node < n; node++)
+    {
+        const double column = node % columns;
+        const double row = node / columns;
+        // Curved streets: columns bend along rows and rows along columns, by a few spacings over ~40 spacings
+        x[node] = column * s + 2 * s * sin(row / 40) + random_jitter(generator);
+        y[node] = row * s + 2 * s * sin(column / 55) + random_jitter(generator);
+    }
+
+    // Class of the road along a row or column
+    auto line_class = [](const unsigned &line)
+    {
+        return line % 64 == 32? EXPRESSWAY : line % 16 == 8? PRIMARY : line % 8 == 4? SECONDARY : LOCAL;
+    };
+    vector<road_t> arterials, streets;
+    for(unsigned node = 0; node < n; node++)
+    {
+        const unsigned column = node % columns;
+        const unsigned row = node / columns;
+        if(column + 1 < columns && node + 1 < n)
+        {
+            road_t road = {node, node + 1, (uint8_t) line_class(row), false};
+            (road.road_class == LOCAL? streets : arterials).push_back(road);
+        }
+        if(node + columns < n)
+        {
+            road_t road = {node, node + columns, (uint8_t) line_class(column), false};
+            (road.road_class == LOCAL? streets : arterials).push_back(road);
+        }
+    }
+    shuffle(streets.begin(), streets.end(), generator);
+    arterials.insert(arterials.end(), streets.begin(), streets.end());
+    return arterials;
+}
+
+// helper function
+/* Junctions placed uniformly in a square, each joined to its nearest neighbours within 2 spacings. Junctions are
+ * numbered by cell of one spacing, row by row, so that neighbours are close in memory.
+ * Parameters: const options_t & options
+ *             vector<double> & x, y: output, position of each junction, m
+ *             vector<unsigned> & cell_first: output, junctions of cell c are [cell_first[c], cell_first[c + 1])
+ *             unsigned & num_of_cells: output, cells per side
+ *             mt19937 & generator
+ * Return: vector<road_t>: candidate local roads, shortest first
+ */
+static vector<road_t> place_random_geometric(const options_t &options, vector<double> &x, vector<double> &y,
+                                             vector<unsigned> &cell_first, unsigned &num_of_cells,
+                                             mt19937 &generator)
+{
+    const unsigned n = options.num_of_nodes;
+    const double s = options.spacing;
+    num_of_cells = max(1.0, ceil(sqrt((double) n)));
+    const double side = num_of_cells * s;
+    uniform_real_distribution<double> random_position(0, side);
+    vector< pair<double, double> > positions(n);
+    vector<unsigned> cell_of_position(n);
+    cell_first.assign((size_t) num_of_cells * num_of_cells + 1, 0);
+    for(unsigned i = 0; i < n; i++)
+    {
+        positions[i].first = random_position(generator);
+        positions[i].second = random_position(generator);
+        unsigned column = min<unsigned>(positions[i].first / s, num_of_cells - 1);
+        unsigned row = min<unsigned>(positions[i].second / s, num_of_cells - 1);
+        cell_of_position[i] = row * num_of_cells + column;
+        cell_first[cell_of_position[i] + 1]++;
+    }
+    partial_sum(cell_first.begin(), cell_first.end(), cell_first.begin());
+    vector<unsigned> cell_of_node(n);
+    vector<unsigned> next_node(cell_first.begin(), cell_first.end() - 1);
+    x.resize(n);
+    y.resize(n);
+    for(unsigned i = 0; i < n; i++)
+    {
+        const unsigned node = next_node[cell_of_position[i]]++;
+        x[node] = positions[i].first;
+        y[node] = positions[i].second;
+        cell_of_node[node] = cell_of_position[i];
+    }
+
+    // Nearest 4 neighbours of each node within 2 spacings, as (length, road from the lower node)
+    const unsigned num_of_neighbours = 4;
+    vector< pair<float, road_t> > candidates;
+    vector< pair<double, unsigned> > neighbours; // squared length, node
+    for(unsigned node = 0; node < n; node++)
+    {
+        neighbours.clear();
+        const int column = cell_of_node[node] % num_of_cells;
+        const int row = cell_of_node[node] / num_of_cells;
+        for(int r = max(0, row - 2); r <= min<int>(num_of_cells - 1, row + 2); r++)
+        {
+            for(int c = max(0, column - 2); c <= min<int>(num_of_cells - 1, column + 2); c++)
+            {
+                const unsigned cell = r * num_of_cells + c;
+                for(unsigned i = cell_first[cell]; i < cell_first[cell + 1]; i++)
+                {
+                    const double dx = x[i] - x[node], dy = y[i] - y[node];
+                    const double squared_length = dx * dx + dy * dy;
+                    if(i != node && squared_length <= 4 * s * s)
+                    {
+                        neighbours.push_back(make_pair(squared_length, i));
+                    }
+                }
+            }
+        }
+        const unsigned num_of_nearest = min<unsigned>(num_of_neighbours, neighbours.size());
+        partial_sort(neighbours.begin(), neighbours.begin() + num_of_nearest, neighbours.end());
+        for(unsigned i = 0; i < num_of_nearest; i++)
+        {
+            candidates.push_back(make_pair(sqrt(neighbours[i].first),
+                                           road_t{min(node, neighbours[i].second),
+                                                  max(node, neighbours[i].second), LOCAL, false}));
+        }
+    }
+
+    // Shortest first, mutual neighbours once
+    sort(candidates.begin(), candidates.end(), [](const pair<float, road_t> &a, const pair<float, road_t> &b)
+    {
+        return a.first < b.first || (a.first == b.first && make_pair(a.second.from, a.second.to)
+                                                           < make_pair(b.second.from, b.second.to));
+    });
+    vector<road_t> roads;
+    for(unsigned i = 0; i < candidates.size(); i++)
+    {
+        if(i == 0 || candidates[i].second.from != candidates[i - 1].second.from
+           || candidates[i].second.to != candidates[i - 1].second.to)
+        {
+            roads.push_back(candidates[i].second);
+        }
+    }
+    return roads;
+}
+
+// helper function
+/* Join the components of a random geometric graph: each component other than that of node 0 is joined from the
+ * first node found of it to the nearest node of another component, in the nearest ring of cells holding one.
+ * Parameters: const vector<double> & x, y
+ *             const vector<unsigned> & cell_first, const unsigned & num_of_cells: see place_random_geometric
+ *             const double & spacing
+ *             vector<unsigned> & component: union-find forest, updated
+ *             vector<road_t> & roads: roads added
+ * Return: when all nodes are in one component
+ */
+static void join_components(const vector<double> &x, const vector<double> &y, const vector<unsigned> &cell_first,
+                            const unsigned &num_of_cells, const double &spacing,
+                            vector<unsigned> &component, vector<road_t> &roads)
+{
+    const unsigned n = x.size();
+    bool is_joined = false;
+    while(!is_joined)
+    {
+        is_joined = true;
+        vector<bool> is_visited(n, false);
+        for(unsigned node = 0; node < n; node++)
+        {
+            unsigned root = find_root(component, node);
+            if(is_visited[root] || root == find_root(component, 0))
+            {
+                continue;
+            }
+            is_visited[root] = true;
+            is_joined = false;
+            const int column = min<int>(x[node] / spacing, num_of_cells - 1);
+            const int row = min<int>(y[node] / spacing, num_of_cells - 1);
+            unsigned nearest = n;
+            double nearest_length = INFINITY;
+            for(int ring = 0; nearest == n && ring < (int) num_of_cells; ring++)
+            {
+                for(int r = row - ring; r <= row + ring; r++)
+                {
+                    for(int c = column - ring; c <= column + ring; c++)
+                    {
+                        if(r < 0 || c < 0 || r >= (int) num_of_cells || c >= (int) num_of_cells
+                           || (abs(r - row) != ring && abs(c - column) != ring))
+                        {
+                            continue;
+                        }
+                        const unsigned cell = r * num_of_cells + c;
+                        for(unsigned i = cell_first[cell]; i < cell_first[cell + 1]; i++)
+                        {
+                            const double length = hypot(x[i] - x[node], y[i] - y[node]);
+                            if(length < nearest_length && find_root(component, i) != root)
+                            {
+                                nearest = i;
+                                nearest_length = length;
+                            }
+                        }
+                    }
+                }
+            }
+            component[root] = find_root(component, nearest);
+            roads.push_back(road_t{node, nearest, LOCAL, false});
+        }
+    }
+}
+
+/* Generate a synthetic road graph.
+ * Travel time of a road is its length at the speed of its class, varied by up to SPEED_NOISE. Coordinates are
+ * positions in metres around the centre of the options.
+ * Parameters: const options_t & options
+ * Return: road_graph_t, throws runtime_error for invalid options
+ */
+road_graph_t IMS::SyntheticGraph::generate(const options_t &options)
+{
+    if(options.num_of_nodes < 2 || options.spacing <= 0 || options.mean_degree < 2 || options.mean_degree > 4
+       || options.one_way_share < 0 || options.one_way_share > 1)
+    {
+        throw runtime_error("Synthetic graph needs at least 2 nodes, positive spacing, mean degree in [2, 4]"
+                            " and one-way share in [0, 1]");
+    }
+    const unsigned n = options.num_of_nodes;
+    mt19937 generator(options.seed);
+    vector<double> x, y;
+    vector<unsigned> component;
+    vector<road_t> roads;
+    if(options.topology == PERTURBED_GRID)
+    {
+        roads = select_roads(place_perturbed_grid(options, x, y, generator), n, options, component, generator);
+    }
+    else
+    {
+        vector<unsigned> cell_first;
+        unsigned num_of_cells;
+        roads = select_roads(place_random_geometric(options, x, y, cell_first, num_of_cells, generator), n, options,
+                             component, generator);
+        join_components(x, y, cell_first, num_of_cells, options.spacing, component, roads);
+
+        // Longer links are faster roads
+        uniform_real_distribution<double> random_share(0, 1);
+        for(auto & road : roads)
+        {
+            const double length = hypot(x[road.to] - x[road.from], y[road.to] - y[road.from]);
+            road.road_class = length > 1.5 * options.spacing? PRIMARY : random_share(generator) < 0.2? SECONDARY : LOCAL;
+        }
+    }
+
+    // Edges by tail
+    vector<unsigned> num_of_out_edges(n + 1, 0); // of node - 1
+    for(auto & road : roads)
+    {
+        num_of_out_edges[road.from + 1]++;
+        num_of_out_edges[road.to + 1] += road.is_one_way? 0 : 1;
+    }
+    partial_sum(num_of_out_edges.begin(), num_of_out_edges.end(), num_of_out_edges.begin());
+    road_graph_t graph;
+    graph.first_out.assign(num_of_out_edges.begin(), num_of_out_edges.end() - 1);
+    const unsigned num_of_edges = num_of_out_edges.back();
+    graph.head.resize(num_of_edges);
+    graph.travel_time.resize(num_of_edges);
+    graph.geo_distance.resize(num_of_edges);
+    graph.road_class.resize(num_of_edges);
+    vector<unsigned> next_edge(graph.first_out);
+    uniform_real_distribution<double> random_speed(1 - SPEED_NOISE, 1 + SPEED_NOISE);
+    for(auto & road : roads)
+    {
+        const unsigned distance = max(1.0, round(hypot(x[road.to] - x[road.from], y[road.to] - y[road.from])));
+        const double speed = SPEED[road.road_class] * random_speed(generator) / 3.6; // m/s
+        const unsigned travel_time = max(1.0, round(distance / speed * 1000));
+        for(unsigned direction = 0; direction < (road.is_one_way? 1u : 2u); direction++)
+        {
+            const unsigned tail = direction == 0? road.from : road.to;
+            const unsigned edge = next_edge[tail]++;
+            graph.head[edge] = direction == 0? road.to : road.from;
+            graph.travel_time[edge] = travel_time;
+            graph.geo_distance[edge] = distance;
+            graph.road_class[edge] = road.road_class;
+        }
+    }
+
+    // Coordinates, centred
+    const double centre_x = accumulate(x.begin(), x.end(), 0.0) / n;
+    const double centre_y = accumulate(y.begin(), y.end(), 0.0) / n;
+    const double metres_per_longitude = METRES_PER_DEGREE * cos(options.latitude * M_PI / 180);
+    graph.longitude.resize(n);
+    graph.latitude.resize(n);
+    for(unsigned node = 0; node < n; node++)
+    {
+        graph.longitude[node] = options.longitude + (x[node] - centre_x) / metres_per_longitude;
+        graph.latitude[node] = options.latitude + (y[node] - centre_y) / METRES_PER_DEGREE;
+    }
+    return graph;
+}
+
+/* Generate a synthetic road graph as initialized and preprocessed MapGraph, ready for routing.
+ * Parameters: const options_t & options
+ *             const unsigned & k, l: partition, see MapGraph::preprocess
+ *             const unsigned & num_of_threads
+ *             const IMS::Partition::partition_scheme_t & scheme
+ * Return: MapGraph*: owned by caller, throws runtime_error for invalid options
+ */
+IMS::MapGraph * IMS::SyntheticGraph::build_map_graph(const options_t &options, const unsigned &k, const unsigned &l,
+                                                     const unsigned &num_of_threads,
+                                                     const IMS::Partition::partition_scheme_t &scheme)
+{
+    road_graph_t road_graph = generate(options);
+    auto map_graph = new IMS::MapGraph();
+    map_graph->longitude = move(road_graph.longitude);
+    map_graph->latitude = move(road_graph.latitude);
+    map_graph->first_out = move(road_graph.first_out);
+    map_graph->head = move(road_graph.head);
+    map_graph->default_travel_time = move(road_graph.travel_time);
+    map_graph->geo_distance = move(road_graph.geo_distance);
+    map_graph->initialize();
+    map_graph->preprocess(k, l, num_of_threads, scheme);
+    return map_graph;
+}
+
+/* Read the topology and size of a synthetic graph, e.g. grid:100000 or random:1000000.
+ * Parameters: const string & description: <grid|random>:<number of nodes>
+ *             options_t & options: topology and num_of_nodes set, others kept
+ * Return: bool: false if the description is invalid
+ */
+bool IMS::SyntheticGraph::parse_options(const string &description, options_t &options)
+{
+    size_t separator = description.find(':');
+    if(separator == string::npos || separator + 1 == description.size()
+       || description.find_first_not_of("0123456789", separator + 1) != string::npos)
+    {
+        return false;
+    }
+    const string topology = description.substr(0, separator);
+    if(topology != "grid" && topology != "random")
+    {
+        return false;
+    }
+    options.topology = topology == "grid"? PERTURBED_GRID : RANDOM_GEOMETRIC;
+    options.num_of_nodes = stoul(description.substr(separator + 1));
+    return true;
+}
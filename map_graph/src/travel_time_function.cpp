@@ -0,0 +1,268 @@
+/*
+ * Travel time functions of edges by time of day. All functions are free functions in IMS::TravelTimeFunction
+ * namespace.
+ * The side file is mapped privately (copy-on-write), the arrays of the table view it without copying.
+ * Libraries:
+ * Version: 1.0
+ * Author: Terence Chow
+ */
+
+#include <fstream>
+#include <cstring>
+#include <cmath>
+#include <climits>
+#include <map>
+#include <stdexcept>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "travel_time_function.h"
+#include "graph_file.h"
+
+using namespace std;
+using namespace IMS::TravelTimeFunction;
+
+// helper function
+/* Travel time at a time of day, linear between the samples around it, which wrap around midnight.
+ * Parameters: const vector<pair<unsigned, unsigned>> & samples: (seconds since local midnight, travel time (ms)),
+ *                                                              sorted, not empty
+ *             const unsigned & time: seconds since local midnight
+ * Return: double: travel time (ms)
+ */
+static double interpolate_samples(const vector< pair<unsigned, unsigned> > &samples, const unsigned &time)
+{
+    auto next = upper_bound(samples.begin(), samples.end(), make_pair(time, UINT_MAX));
+    const pair<unsigned, unsigned> &before = next == samples.begin()? samples.back() : *(next - 1);
+    const pair<unsigned, unsigned> &after = next == samples.end()? samples.front() : *next;
+    const double before_time = next == samples.begin()? before.first - 86400.0 : before.first;
+    const double after_time = next == samples.end()? after.first + 86400.0 : after.first;
+    if (after_time == before_time)
+    {
+        return before.second;
+    }
+    return before.second + ((double)after.second - before.second) * (time - before_time) / (after_time - before_time);
+}
+
+/* Build the travel time functions of all edges from historical samples.
+ * The travel time of an edge at each breakpoint is interpolated from its samples, quantized as factor of its
+ * default travel time and raised where needed to keep factors at least FACTOR_ONE and the FIFO property, see
+ * travel_time_function_table_t. Identical functions are then stored once.
+ * Parameters: const vector<unsigned> & default_travel_time: of each edge, ms
+ *             const vector< vector< pair<unsigned, unsigned> > > & samples: of each edge, (seconds since local
+ *                                                                          midnight, travel time (ms)), empty for
+ *                                                                          the default travel time all day
+ *             const unsigned & interval: seconds between breakpoints, a day must be a multiple of it
+ *             const int & utc_offset: seconds, local time = UTC + utc_offset
+ * Return: travel_time_function_table_t*: owned by caller, throws runtime_error for invalid samples or interval
+ */
+travel_time_function_table_t* IMS::TravelTimeFunction::build
+        (const vector<unsigned> &default_travel_time,
+         const vector< vector< pair<unsigned, unsigned> > > &samples,
+         const unsigned &interval,
+         const int &utc_offset)
+{
+    if (interval == 0 || 86400 % interval != 0)
+    {
+        throw runtime_error("Interval of travel time functions must divide a day, got " + to_string(interval) + " s");
+    }
+    if (samples.size() != default_travel_time.size())
+    {
+        throw runtime_error("Travel time function samples must be given for each edge");
+    }
+    const unsigned num_of_breakpoints = 86400 / interval;
+    const uint64_t interval_time = interval * 1000ULL;
+
+    vector<unsigned> function_of_edge(default_travel_time.size(), 0);
+    vector<uint16_t> function(num_of_breakpoints, FACTOR_ONE);
+    std::map<vector<uint16_t>, unsigned> function_id;
+    function_id[function] = 0;
+    for (unsigned edge = 0; edge < default_travel_time.size(); edge++)
+    {
+        if (samples[edge].empty() || default_travel_time[edge] == 0)
+        {
+            continue;
+        }
+        vector< pair<unsigned, unsigned> > edge_samples = samples[edge];
+        sort(edge_samples.begin(), edge_samples.end());
+        if (edge_samples.back().first >= 86400)
+        {
+            throw runtime_error("Travel time sample of edge " + to_string(edge) + " is not within a day");
+        }
+
+        // Quantize
+        for (unsigned breakpoint = 0; breakpoint < num_of_breakpoints; breakpoint++)
+        {
+            double factor = round(interpolate_samples(edge_samples, breakpoint * interval) * FACTOR_ONE
+                                  / default_travel_time[edge]);
+            function[breakpoint] = max<double>(FACTOR_ONE, min<double>(UINT16_MAX, factor));
+        }
+
+        // Raise factors dropping faster than time passes, around the day until none does.
+        // Dropping by less than interval keeps the truncated travel time FIFO too.
+        const unsigned max_drop = min<uint64_t>(UINT16_MAX,
+                                                (interval_time - 1) * FACTOR_ONE / default_travel_time[edge]);
+        bool is_raised = true;
+        while (is_raised)
+        {
+            is_raised = false;
+            for (unsigned breakpoint = 0; breakpoint < num_of_breakpoints; breakpoint++)
+            {
+                uint16_t &next = function[breakpoint + 1 == num_of_breakpoints? 0 : breakpoint + 1];
+                if (function[breakpoint] > next + max_drop)
+                {
+                    next = function[breakpoint] - max_drop;
+                    is_raised = true;
+                }
+            }
+        }
+
+        auto inserted = function_id.insert(make_pair(function, (unsigned)function_id.size()));
+        function_of_edge[edge] = inserted.first->second;
+    }
+
+    vector<uint16_t> factor(function_id.size() * (size_t)num_of_breakpoints);
+    for (auto & stored_function : function_id)
+    {
+        copy(stored_function.first.begin(), stored_function.first.end(),
+             factor.begin() + stored_function.second * (size_t)num_of_breakpoints);
+    }
+    auto table = new travel_time_function_table_t();
+    table->interval = interval_time;
+    table->utc_offset = utc_offset;
+    table->function_of_edge = move(function_of_edge);
+    table->factor = move(factor);
+    return table;
+}
+
+/* Write travel time functions as side file of a graph.
+ * Parameters: const travel_time_function_table_t & table
+ *             const uint64_t & graph_checksum: identifies the graph, see MapGraph::get_checksum
+ *             const string & output_file_path
+ * Return: when the file is written, throws runtime_error on failure.
+ */
+void IMS::TravelTimeFunction::write(const travel_time_function_table_t &table, const uint64_t &graph_checksum,
+                                    const string &output_file_path)
+{
+    header_t header;
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byte_order_mark = BYTE_ORDER_MARK;
+    header.graph_checksum = graph_checksum;
+    header.interval = table.interval;
+    header.utc_offset = table.utc_offset;
+    header.num_of_edges = table.function_of_edge.size();
+    header.num_of_functions = table.num_of_functions();
+    const uint64_t function_of_edge_offset = IMS::GraphFile::align(sizeof(header_t));
+    const uint64_t factor_offset = IMS::GraphFile::align(function_of_edge_offset
+                                                         + table.function_of_edge.size() * sizeof(unsigned));
+    header.file_size = IMS::GraphFile::align(factor_offset + table.factor.size() * sizeof(uint16_t));
+
+    vector<char> file(header.file_size, 0);
+    memcpy(file.data() + function_of_edge_offset, table.function_of_edge.data(),
+           table.function_of_edge.size() * sizeof(unsigned));
+    memcpy(file.data() + factor_offset, table.factor.data(), table.factor.size() * sizeof(uint16_t));
+    header.checksum = IMS::GraphFile::checksum(file.data() + sizeof(header_t), file.size() - sizeof(header_t));
+    memcpy(file.data(), &header, sizeof(header_t));
+
+    ofstream ofs(output_file_path, ios::binary | ios::trunc);
+    ofs.write(file.data(), file.size());
+    ofs.close();
+    if (!ofs)
+    {
+        throw runtime_error("Cannot write travel time function file: " + output_file_path);
+    }
+}
+
+/* Map a travel time function file and point the arrays of a table at it.
+ * The mapping is private: pages are shared with the page cache until written.
+ * Parameters: travel_time_function_table_t & table
+ *             const string & input_file_path
+ *             const uint64_t & graph_checksum: the file must be written for the graph with this checksum
+ *             const size_t & num_of_edges: of the graph
+ *             size_t & mapped_size: output, size of the mapping
+ * Return: void *: start of the mapping, to be released with IMS::GraphFile::unmap. Throws runtime_error on invalid
+ *         file or a file written for another graph.
+ */
+void * IMS::TravelTimeFunction::map(travel_time_function_table_t &table, const string &input_file_path,
+                                    const uint64_t &graph_checksum, const size_t &num_of_edges, size_t &mapped_size)
+{
+    int fd = open(input_file_path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw runtime_error("Cannot open travel time function file: " + input_file_path);
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || (size_t) file_stat.st_size < sizeof(header_t))
+    {
+        close(fd);
+        throw runtime_error("Corrupted travel time function file: " + input_file_path);
+    }
+    mapped_size = file_stat.st_size;
+    void * mapped_file = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped_file == MAP_FAILED)
+    {
+        throw runtime_error("Cannot map travel time function file: " + input_file_path);
+    }
+
+    char * file = static_cast<char*>(mapped_file);
+    const header_t * header = reinterpret_cast<const header_t*>(file);
+    const uint64_t function_of_edge_offset = IMS::GraphFile::align(sizeof(header_t));
+    const uint64_t factor_offset = IMS::GraphFile::align(function_of_edge_offset
+                                                         + header->num_of_edges * sizeof(unsigned));
+    const uint64_t num_of_factors = header->interval == 0? 0 : header->num_of_functions * (DAY / header->interval);
+    string error;
+    if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        error = "Not a travel time function file: ";
+    }
+    else if (header->version != VERSION)
+    {
+        error = "Unsupported travel time function file version " + to_string(header->version) + ": ";
+    }
+    else if (header->byte_order_mark != BYTE_ORDER_MARK)
+    {
+        error = "Travel time function file written with different byte order: ";
+    }
+    else if (header->graph_checksum != graph_checksum || header->num_of_edges != num_of_edges)
+    {
+        error = "Travel time function file is written for another graph: ";
+    }
+    else if (header->file_size != mapped_size || header->interval == 0 || DAY % header->interval != 0
+             || header->num_of_functions == 0 || num_of_edges > mapped_size / sizeof(unsigned)
+             || factor_offset > mapped_size || num_of_factors > (mapped_size - factor_offset) / sizeof(uint16_t))
+    {
+        error = "Corrupted travel time function file: ";
+    }
+    else if (IMS::GraphFile::checksum(file + sizeof(header_t), mapped_size - sizeof(header_t)) != header->checksum)
+    {
+        error = "Checksum mismatch in travel time function file: ";
+    }
+    else
+    {
+        table.interval = header->interval;
+        table.utc_offset = header->utc_offset;
+        table.function_of_edge.map(reinterpret_cast<unsigned*>(file + function_of_edge_offset), num_of_edges);
+        table.factor.map(reinterpret_cast<uint16_t*>(file + factor_offset), num_of_factors);
+        for (auto function : table.function_of_edge)
+        {
+            if (function >= header->num_of_functions)
+            {
+                table.function_of_edge.clear();
+                table.factor.clear();
+                error = "Corrupted travel time function file: ";
+                break;
+            }
+        }
+    }
+    if (!error.empty())
+    {
+        IMS::GraphFile::unmap(mapped_file, mapped_size);
+        throw runtime_error(error + input_file_path);
+    }
+    return mapped_file;
+}
@@ -0,0 +1,119 @@
+/*
+ * Header file for travel_time_function module.
+ * Historical travel time of each edge by time of day as piecewise linear function, stored in a side file of the
+ * graph which is memory-mapped and used in place.
+ * Version: 1.0
+ * Author: Terence Chow
+ */
+
+#ifndef IMS_CPP_TRAVEL_TIME_FUNCTION_H
+#define IMS_CPP_TRAVEL_TIME_FUNCTION_H
+
+#include <cstdint>
+#include <cstddef>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "../include/ims/mapped_array.h"
+
+using namespace std;
+
+namespace IMS
+{
+namespace TravelTimeFunction
+{
+
+const long long DAY = 86400000; // milliseconds
+const unsigned FACTOR_ONE = 1024; // factor of the default travel time
+
+/* Travel time functions of all edges, sharing their breakpoints: every interval milliseconds from local midnight.
+ * A function is given by a factor of the default travel time at each breakpoint, in 1 / FACTOR_ONE, and is linear
+ * between breakpoints, the last breakpoint going back to the first one of the next day.
+ * Factors are at least FACTOR_ONE, so the heuristics preprocessed with the default travel time stay admissible.
+ * Factors drop by less than interval * FACTOR_ONE / default travel time between breakpoints, i.e. travel time drops
+ * slower than time passes, so an edge entered later is never left earlier (FIFO property).
+ * Identical functions are stored once, factors of function f are at [f * n, (f + 1) * n), n breakpoints.
+ * Function 0 is constant FACTOR_ONE, i.e. the default travel time, for edges without history.
+ * Arrays can view a memory-mapped side file in place.
+ */
+struct travel_time_function_table_t
+{
+    unsigned interval = 0; // milliseconds, a day is a multiple of it
+    int utc_offset = 0; // seconds, local time = UTC + utc_offset
+    MappedArray<unsigned> function_of_edge;
+    MappedArray<uint16_t> factor;
+
+    unsigned num_of_breakpoints() const
+    {
+        return DAY / interval;
+    }
+
+    unsigned num_of_functions() const
+    {
+        return factor.size() / num_of_breakpoints();
+    }
+
+    /* Travel time of an edge entered at a time (ms), interpolated between the breakpoints around it */
+    unsigned evaluate(const unsigned &edge, const unsigned &default_travel_time, const time_t &time) const
+    {
+        long long local_time = (time + utc_offset * 1000LL) % DAY;
+        local_time += local_time < 0? DAY : 0;
+        const unsigned breakpoint = local_time / interval;
+        const unsigned offset = local_time - (long long)breakpoint * interval;
+        const unsigned n = DAY / interval;
+        const uint16_t * function = factor.data() + function_of_edge[edge] * (size_t)n;
+        const int slope = function[breakpoint + 1 == n? 0 : breakpoint + 1] - function[breakpoint];
+        return default_travel_time * ((double)function[breakpoint] * interval + (double)slope * offset)
+               / ((double)interval * FACTOR_ONE);
+    }
+
+    /* Bytes of all arrays */
+    size_t memory_size() const
+    {
+        return function_of_edge.size() * sizeof(unsigned) + factor.size() * sizeof(uint16_t);
+    }
+};
+
+/* Side file layout, in host byte order:
+ *   header_t
+ *   function_of_edge, then factor, each starting at a multiple of IMS::GraphFile::ALIGNMENT, file padded with zeros
+ *   to a multiple of IMS::GraphFile::ALIGNMENT
+ * checksum covers everything after the header, graph_checksum identifies the graph, see MapGraph::get_checksum.
+ */
+const char MAGIC[8] = {'I', 'M', 'S', 'T', 'T', 'F', 'N', 'S'};
+const uint32_t VERSION = 1;
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct header_t
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    uint64_t graph_checksum;
+    uint32_t interval;
+    int32_t utc_offset;
+    uint64_t num_of_edges;
+    uint64_t num_of_functions;
+    uint64_t file_size;
+    uint64_t checksum;
+};
+
+/* Building */
+travel_time_function_table_t* build
+        (const vector<unsigned> &default_travel_time,
+         const vector< vector< pair<unsigned, unsigned> > > &samples,
+         const unsigned &interval,
+         const int &utc_offset);
+
+/* Side file */
+void write(const travel_time_function_table_t &table, const uint64_t &graph_checksum, const string &output_file_path);
+
+void * map(travel_time_function_table_t &table, const string &input_file_path, const uint64_t &graph_checksum,
+           const size_t &num_of_edges, size_t &mapped_size);
+
+}
+}
+
+#endif //IMS_CPP_TRAVEL_TIME_FUNCTION_H
@@ -0,0 +1,66 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+
+#include "../include/ims/router.h"
+#include "../include/ims/synthetic_graph.h"
+
+using namespace std;
+
+/* Benchmark of routing on the array and the compressed graph.
+ * Usage: compressed_graph_benchmark [grid side] [number of routes]
+ */
+int main(int argc, char ** argv)
+{
+    unsigned side = argc > 1? stoul(argv[1]) : 100;
+    unsigned num_of_routes = argc > 2? stoul(argv[2]) : 200;
+
+    cout << "==== Compressed Graph Benchmark ====" << endl;
+    IMS::SyntheticGraph::options_t options; // perturbed grid of side x side nodes
+    options.num_of_nodes = side * side;
+    auto map_graph = IMS::SyntheticGraph::build_map_graph(options, 4, 3);
+    cout << map_graph->get_num_of_nodes() << " nodes, " << map_graph->get_num_of_edges() << " edges" << endl;
+
+    size_t array_memory = (map_graph->latitude.size() + map_graph->longitude.size()) * sizeof(float)
+                          + (map_graph->head.size() + map_graph->first_out.size()
+                             + map_graph->default_travel_time.size() + map_graph->geo_distance.size()) * sizeof(unsigned)
+                          + (map_graph->inversed->head.size() + map_graph->inversed->first_out.size()
+                             + map_graph->inversed->relative_edge.size()) * sizeof(unsigned);
+    auto compressed_graph = IMS::SyntheticGraph::build_map_graph(options, 4, 3);
+    compressed_graph->compress();
+    size_t compressed_memory = compressed_graph->compressed->get_memory_usage();
+    cout << "Arrays: " << array_memory / 1024 << " KiB, compressed: " << compressed_memory / 1024 << " KiB ("
+         << 100.0 * compressed_memory / array_memory << "%)" << endl;
+
+    mt19937 generator(7);
+    uniform_int_distribution<unsigned> random_node(0, side * side - 1);
+    vector<pair<unsigned, unsigned> > od_pairs(num_of_routes);
+    for(auto & od_pair : od_pairs)
+    {
+        od_pair = make_pair(random_node(generator), random_node(generator));
+    }
+
+    auto incident_manager = new IMS::IncidentManager(map_graph->get_num_of_edges());
+    for(auto graph : {map_graph, compressed_graph})
+    {
+        IMS::Router router(graph, incident_manager);
+        double checksum = 0;
+        auto start = chrono::steady_clock::now();
+        for(auto & od_pair : od_pairs)
+        {
+            auto path = router.route(od_pair.first, od_pair.second, 0);
+            checksum += path->end_time;
+            delete path;
+        }
+        auto route_time = chrono::steady_clock::now() - start;
+        cout << (graph == map_graph? "Array" : "Compressed") << " route: "
+             << chrono::duration_cast<chrono::microseconds>(route_time).count() / (double) num_of_routes
+             << " us / route (checksum " << checksum << ")" << endl;
+    }
+
+    delete incident_manager;
+    delete map_graph;
+    delete compressed_graph;
+    return 0;
+}
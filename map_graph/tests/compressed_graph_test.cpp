@@ -0,0 +1,90 @@
+#include <iostream>
+#include <cassert>
+#include <cmath>
+
+#include "map_graph_test_data.h"
+#include "../include/ims/router.h"
+
+using namespace std;
+
+IMS::MapGraph * build_graph()
+{
+    auto map_graph = build_graph16();
+    map_graph->default_travel_time[7] = 100000; // beyond 16 bits
+    map_graph->geo_distance[29] = 70000;
+    map_graph->initialize();
+    map_graph->preprocess(2, 3);
+    return map_graph;
+}
+
+int main()
+{
+    auto map_graph = build_graph();
+    auto compressed_graph = build_graph();
+    compressed_graph->compress();
+
+    cout << "==== Compressed Graph Test ====" << endl;
+    assert(compressed_graph->compressed != nullptr);
+    assert(compressed_graph->head.empty() && compressed_graph->inversed == nullptr);
+    assert(compressed_graph->get_num_of_nodes() == 16);
+    assert(compressed_graph->get_num_of_edges() == 30);
+
+    // Same adjacency, weights and (within quantization) coordinates
+    for(unsigned node = 0; node < 16; node++)
+    {
+        vector<pair<unsigned, unsigned> > edges, compressed_edges;
+        map_graph->for_each_out_edge(node, [&edges](const unsigned &edge, const unsigned &head)
+        {
+            edges.emplace_back(edge, head);
+        });
+        compressed_graph->for_each_out_edge(node, [&compressed_edges](const unsigned &edge, const unsigned &head)
+        {
+            compressed_edges.emplace_back(edge, head);
+        });
+        assert(edges == compressed_edges);
+        assert(fabs(map_graph->get_latitude(node) - compressed_graph->get_latitude(node)) < 1e-5);
+        assert(fabs(map_graph->get_longitude(node) - compressed_graph->get_longitude(node)) < 1e-5);
+        for(unsigned to = 0; to < 16; to++)
+        {
+            assert(map_graph->find_edge(node, to) == compressed_graph->find_edge(node, to));
+        }
+    }
+    for(unsigned edge = 0; edge < 30; edge++)
+    {
+        assert(map_graph->get_travel_time(edge) == compressed_graph->get_travel_time(edge));
+        assert(map_graph->get_geo_distance(edge) == compressed_graph->get_geo_distance(edge));
+    }
+    assert(compressed_graph->get_travel_time(7) == 100000);
+    assert(compressed_graph->get_geo_distance(29) == 70000);
+
+    // Same paths
+    auto incident_manager = new IMS::IncidentManager();
+    IMS::Router router(map_graph, incident_manager);
+    IMS::Router compressed_router(compressed_graph, incident_manager);
+    for(unsigned from = 0; from < 16; from++)
+    {
+        for(unsigned to = 0; to < 16; to++)
+        {
+            auto path = router.route(from, to, 0);
+            auto compressed_path = compressed_router.route(from, to, 0);
+            assert((path == NULL) == (compressed_path == NULL));
+            if(path != NULL)
+            {
+                assert(path->enter_times == compressed_path->enter_times);
+                assert(path->end_time == compressed_path->end_time);
+            }
+        }
+    }
+
+    // Updates read the compressed graph
+    auto path = compressed_router.route(4, 0, 0);
+    compressed_graph->inject_impact_of_routed_path(path);
+    assert(compressed_graph->find_current_density(path->enter_times.begin()->second,
+                                                  path->enter_times.begin()->first) > 0);
+
+    // Reverse geocoding
+    assert(map_graph->find_nearest_edge_of_location(coordinates16[0][0], coordinates16[0][1], 0.0008)
+           == compressed_graph->find_nearest_edge_of_location(coordinates16[0][0], coordinates16[0][1], 0.0008));
+
+    cout << "==== All Compressed Graph Test passed ====" << endl;
+}
@@ -0,0 +1,125 @@
+#include <iostream>
+#include <fstream>
+#include <cassert>
+#include <cstdio>
+
+#include "map_graph_test_data.h"
+#include "../include/ims/router.h"
+
+using namespace std;
+
+int main()
+{
+    const string text_file_path = "graph_file_test.graph";
+    const string binary_file_path = "graph_file_test.bin";
+
+    auto map_graph = build_graph16();
+    map_graph->initialize();
+    map_graph->preprocess(2, 3);
+
+    cout << "==== Graph File Test ====" << endl;
+    // Text archive -> binary graph file, as the converter does
+    map_graph->serialize(text_file_path);
+    assert(!IMS::MapGraph::is_binary_file(text_file_path));
+    auto text_graph = IMS::MapGraph::deserialize_and_initialize(text_file_path);
+    text_graph->serialize_binary(binary_file_path);
+    assert(IMS::MapGraph::is_binary_file(binary_file_path));
+
+    // Arrays are viewed in place
+    auto mapped_graph = IMS::MapGraph::deserialize_and_initialize(binary_file_path);
+    assert(mapped_graph->head.is_mapped());
+    assert(mapped_graph->flat_distance_tables->distance_value.is_mapped());
+    assert(mapped_graph->head == map_graph->head.get_vector());
+    assert(mapped_graph->first_out == map_graph->first_out.get_vector());
+    assert(mapped_graph->latitude == map_graph->latitude.get_vector());
+    assert(mapped_graph->longitude == map_graph->longitude.get_vector());
+    assert(mapped_graph->default_travel_time == map_graph->default_travel_time.get_vector());
+    assert(mapped_graph->geo_distance == map_graph->geo_distance.get_vector());
+    assert(mapped_graph->current_density.size() == 30);
+
+    // Same heuristics and paths as the built graph
+    auto incident_manager = new IMS::IncidentManager();
+    IMS::Router router(map_graph, incident_manager);
+    IMS::Router mapped_router(mapped_graph, incident_manager);
+    for(unsigned from = 0; from < 16; from++)
+    {
+        for(unsigned to = 0; to < 16; to++)
+        {
+            assert(router.retrieve_future_weight(from, to) == mapped_router.retrieve_future_weight(from, to));
+        }
+    }
+    auto path = router.route(4, 0, 0);
+    auto mapped_path = mapped_router.route(4, 0, 0);
+    assert(path->enter_times == mapped_path->enter_times);
+    assert(path->end_time == mapped_path->end_time);
+
+    // Optional boundary distances and weight profiles are kept by both formats
+    assert(mapped_graph->boundary_distances == nullptr && mapped_graph->weight_profiles == nullptr);
+    auto partitions = map_graph->partition(2, 3);
+    map_graph->preprocess_boundary_distances(partitions);
+    vector< vector<unsigned> > travel_times(2, map_graph->default_travel_time.to_vector());
+    travel_times[1][0] *= 4;
+    map_graph->set_weight_profiles({0, 8 * 3600}, travel_times, 8 * 3600, partitions);
+    delete partitions;
+    map_graph->serialize(text_file_path);
+    auto precise_text_graph = IMS::MapGraph::deserialize_and_initialize(text_file_path);
+    assert(precise_text_graph->boundary_distances->outbound_distance
+           == map_graph->boundary_distances->outbound_distance.get_vector());
+    precise_text_graph->serialize_binary(binary_file_path);
+    auto precise_mapped_graph = IMS::MapGraph::deserialize_and_initialize(binary_file_path);
+    assert(precise_mapped_graph->boundary_distances->outbound_distance.is_mapped());
+    assert(precise_mapped_graph->boundary_distances->outbound_distance
+           == map_graph->boundary_distances->outbound_distance.get_vector());
+    assert(precise_mapped_graph->boundary_distances->inbound_distance
+           == map_graph->boundary_distances->inbound_distance.get_vector());
+    assert(precise_mapped_graph->weight_profiles->travel_time.is_mapped());
+    assert(precise_mapped_graph->weight_profiles->utc_offset == 8 * 3600);
+    assert(precise_mapped_graph->weight_profiles->start_time == map_graph->weight_profiles->start_time.get_vector());
+    assert(precise_mapped_graph->weight_profiles->travel_time == map_graph->weight_profiles->travel_time.get_vector());
+    assert(precise_mapped_graph->weight_profiles->distance_value
+           == precise_text_graph->weight_profiles->distance_value.get_vector());
+    IMS::Router precise_mapped_router(precise_mapped_graph, incident_manager);
+    for(unsigned from = 0; from < 16; from++)
+    {
+        for(unsigned to = 0; to < 16; to++)
+        {
+            assert(router.retrieve_future_weight(from, to) == precise_mapped_router.retrieve_future_weight(from, to));
+            assert(router.retrieve_future_weight(from, to, 1)
+                   == precise_mapped_router.retrieve_future_weight(from, to, 1));
+        }
+    }
+    auto profile_path = router.route(0, 15, 0);
+    auto mapped_profile_path = precise_mapped_router.route(0, 15, 0);
+    assert(profile_path->enter_times == mapped_profile_path->enter_times);
+    assert(profile_path->end_time == mapped_profile_path->end_time);
+    delete profile_path;
+    delete mapped_profile_path;
+    delete precise_text_graph;
+    delete precise_mapped_graph;
+
+    // Modifying a mapped array copies it
+    mapped_graph->head.push_back(0);
+    assert(!mapped_graph->head.is_mapped());
+    assert(mapped_graph->head.size() == 31);
+
+    // Corruption is detected
+    {
+        fstream file(binary_file_path, ios::in | ios::out | ios::binary);
+        file.seekp(-1, ios::end);
+        file.put(1);
+    }
+    bool is_rejected = false;
+    try
+    {
+        delete IMS::MapGraph::map_and_initialize(binary_file_path);
+    }
+    catch(runtime_error &e)
+    {
+        is_rejected = true;
+    }
+    assert(is_rejected);
+
+    remove(text_file_path.c_str());
+    remove(binary_file_path.c_str());
+    cout << "==== All Graph File Test passed ====" << endl;
+}
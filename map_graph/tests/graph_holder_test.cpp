@@ -0,0 +1,139 @@
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <memory>
+
+#include "map_graph_test_data.h"
+#include "../include/ims/graph_holder.h"
+
+using namespace std;
+
+int main()
+{
+    const string file_path = "graph_holder_test.graph";
+    const string renumbered_file_path = "graph_holder_test_renumbered.graph";
+
+    // Same map, numbered differently as after a rebuild
+    auto renumbered_graph = build_graph16();
+    renumbered_graph->initialize();
+    IMS::Renumbering renumbering = renumbered_graph->renumber_by_partition(2, 3);
+    renumbered_graph->preprocess(2, 3);
+    renumbered_graph->serialize(renumbered_file_path);
+    delete renumbered_graph;
+
+    auto map_graph = build_graph16();
+    map_graph->initialize();
+    map_graph->preprocess(2, 3);
+    map_graph->serialize(file_path);
+
+    auto incident_manager = new IMS::IncidentManager(30);
+    auto path_manager = new IMS::PathManager(map_graph);
+    auto incident_feed = new IMS::IncidentFeed(map_graph, incident_manager, 0.0008, 1);
+    IMS::GraphHolder graph_holder(file_path, map_graph, incident_manager, path_manager, incident_feed);
+
+    cout << "==== Graph Holder Test ====" << endl;
+    // Live state on the graph loaded at startup
+    unsigned incident_id = incident_manager->add_incident({3, 5}, 60000, 1000, 5000000);
+    incident_manager->add_incident({7}, 30000);
+    IMS::feed_incident_t record = {"feed-1", 114.05f, 22.00f, 90000, 0, IMS::IncidentManager::NO_END_TIME};
+    assert(incident_feed->ingest_updates({record}, {}).num_of_added == 1);
+    auto path = graph_holder.acquire()->router->route(4, 0, 0);
+    unsigned path_id = path_manager->add_path(path);
+
+    vector<double> density(30), impact(30);
+    for(unsigned edge = 0; edge < 30; edge++)
+    {
+        density[edge] = map_graph->find_current_density(edge, path->enter_times.begin()->first);
+        impact[edge] = incident_manager->get_total_incident_impact(edge, 2000);
+    }
+
+    // In-flight query keeps the old graph
+    IMS::graph_handle_t old_handle = graph_holder.acquire();
+    weak_ptr<IMS::graph_context_t> old_context = old_handle;
+    assert(old_handle->version == 1);
+
+    IMS::reload_report_t report = graph_holder.reload(renumbered_file_path);
+    assert(report.is_successful);
+    assert(report.version == 2);
+    assert(report.num_of_nodes_matched == 16 && report.num_of_nodes_unmatched == 0);
+    assert(report.num_of_edges_matched == 30 && report.num_of_edges_unmatched == 0);
+    assert(report.num_of_incidents_migrated == 3 && report.num_of_incidents_dropped == 0);
+    assert(report.num_of_paths_migrated == 1 && report.num_of_paths_dropped == 0);
+
+    IMS::graph_handle_t handle = graph_holder.acquire();
+    assert(handle->version == 2);
+    assert(handle->map_graph != map_graph);
+    assert(!old_context.expired());
+    assert(old_handle->map_graph->find_current_density(0, 0) == density[0]);
+
+    // Density and incidents follow the edges to their new IDs
+    for(unsigned edge = 0; edge < 30; edge++)
+    {
+        unsigned new_edge = renumbering.new_edge_id[edge];
+        assert(handle->map_graph->find_current_density(new_edge, path->enter_times.begin()->first) == density[edge]);
+        assert(handle->incident_manager->get_total_incident_impact(new_edge, 2000) == impact[edge]);
+    }
+
+    // IDs handed out before the reload stay valid
+    assert(handle->incident_manager->remove_incident(incident_id) == 1);
+    assert(handle->path_manager->remove_path(path_id) == 1);
+    for(unsigned edge = 0; edge < 30; edge++)
+    {
+        assert(handle->map_graph->find_current_density(edge, path->enter_times.begin()->first) == 0);
+    }
+
+    // Feed writes to the new graph, its live incident is not added again
+    assert(incident_feed->ingest_snapshot({record}).num_of_unchanged == 1);
+    assert(incident_feed->ingest_snapshot({}).num_of_removed == 1);
+    assert(handle->incident_manager->get_num_of_incidents() == 1);
+
+    // Old graph is released with its last handle
+    old_handle.reset();
+    assert(old_context.expired());
+
+    // Failed reload keeps the current graph
+    report = graph_holder.reload("graph_holder_test_missing.graph");
+    assert(!report.is_successful && !report.error.empty());
+    assert(graph_holder.acquire()->version == 2);
+
+    // Background reload of the current file
+    assert(graph_holder.reload_in_background(""));
+    while(graph_holder.get_reload_report().is_reloading)
+    {
+        boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+    }
+    report = graph_holder.get_reload_report();
+    assert(report.is_successful && report.version == 3);
+    assert(report.file_path == renumbered_file_path);
+    assert(graph_holder.acquire()->incident_manager->get_num_of_incidents() == 1);
+
+    // Travel time functions given at startup are loaded into reloaded graphs
+    const string function_file_path = "graph_holder_test.ttf";
+    auto function_graph = IMS::MapGraph::deserialize_and_initialize(file_path);
+    vector< vector< pair<unsigned, unsigned> > > samples(30);
+    samples[0] = {{8 * 3600, 300}, {20 * 3600, 100}};
+    unique_ptr<IMS::TravelTimeFunction::travel_time_function_table_t> table(
+            IMS::TravelTimeFunction::build(function_graph->default_travel_time.to_vector(), samples, 1800, 0));
+    IMS::TravelTimeFunction::write(*table, function_graph->get_checksum(), function_file_path);
+    function_graph->load_travel_time_functions(function_file_path);
+    IMS::GraphHolder function_holder(file_path, function_graph, new IMS::IncidentManager(30),
+                                     new IMS::PathManager(function_graph), nullptr, false, function_file_path);
+    report = function_holder.reload("");
+    assert(report.is_successful && report.version == 2);
+    handle = function_holder.acquire();
+    assert(handle->map_graph->travel_time_functions != nullptr);
+    assert(handle->map_graph->get_travel_time(0, 8 * 3600000LL) == 300);
+    // Functions written for another graph fail the reload
+    report = function_holder.reload(renumbered_file_path);
+    assert(!report.is_successful);
+    assert(report.error.find("travel time functions") != string::npos);
+    assert(function_holder.acquire()->version == 2);
+    handle.reset();
+
+    delete path;
+    delete incident_feed;
+    remove(file_path.c_str());
+    remove(renumbered_file_path.c_str());
+    remove(function_file_path.c_str());
+    cout << "==== All Graph Holder Test passed ====" << endl;
+}
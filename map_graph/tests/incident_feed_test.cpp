@@ -0,0 +1,116 @@
+#include <iostream>
+#include <sstream>
+#include <cassert>
+#include <vector>
+
+#include "map_graph_test_data.h"
+#include "../include/ims/incident_feed.h"
+
+using namespace std;
+
+int main()
+{
+    auto map_graph = new IMS::MapGraph();
+    for(int i = 0; i < 4; i++) {
+        map_graph->longitude.push_back(coordinates4[i][0]);
+        map_graph->latitude.push_back(coordinates4[i][1]);
+    }
+    map_graph->first_out.assign(first_out4, first_out4 + 4);
+    map_graph->head.assign(head4, head4 + 5);
+    map_graph->geo_distance.assign(geo_distance4, geo_distance4 + 5);
+    map_graph->default_travel_time.assign(default_travel_time4, default_travel_time4 + 5);
+    map_graph->initialize();
+
+    auto incident_manager = new IMS::IncidentManager(map_graph->head.size());
+    auto incident_feed = new IMS::IncidentFeed(map_graph, incident_manager, 0, 2);
+
+    cout << "==== Incident Feed Test ====" << endl;
+    // Edge 0: (0, 0) -> (0, 1), edge 4: (1, 1) -> (0, 0)
+    IMS::feed_incident_t on_edge_0 = {"a", 0, 0.5, 10, 0, IMS::IncidentManager::NO_END_TIME};
+    IMS::feed_incident_t on_edge_4 = {"b", 0.5, 0.5, 20, 0, IMS::IncidentManager::NO_END_TIME};
+    IMS::feed_incident_t off_road = {"c", -0.5, 0.5, 30, 0, IMS::IncidentManager::NO_END_TIME};
+
+    /* Test snapshot adds located incidents */
+    vector<IMS::feed_incident_t> snapshot{on_edge_0, on_edge_4, off_road};
+    IMS::ingestion_report_t report = incident_feed->ingest_snapshot(snapshot);
+    assert(report.num_of_received == 3);
+    assert(report.num_of_added == 2);
+    assert(report.num_of_unlocated == 1);
+    assert(incident_manager->get_total_incident_impact(0, 0) == 10);
+    assert(incident_manager->get_total_incident_impact(4, 0) == 20);
+
+    /* Test unchanged incidents are skipped, changed ones replaced and missing ones removed */
+    on_edge_0.impact = 15;
+    snapshot = {on_edge_0, off_road};
+    report = incident_feed->ingest_snapshot(snapshot);
+    assert(report.num_of_unchanged == 0);
+    assert(report.num_of_added == 1);
+    assert(report.num_of_removed == 2);
+    assert(incident_manager->get_total_incident_impact(0, 0) == 15);
+    assert(incident_manager->get_total_incident_impact(4, 0) == 0);
+    report = incident_feed->ingest_snapshot(snapshot);
+    assert(report.num_of_unchanged == 1);
+    assert(report.num_of_added == 0 && report.num_of_removed == 0);
+
+    /* Test updates */
+    vector<IMS::feed_incident_t> upserts{on_edge_4};
+    vector<string> removed_keys{"a", "unknown"};
+    report = incident_feed->ingest_updates(upserts, removed_keys);
+    assert(report.num_of_added == 1 && report.num_of_removed == 1);
+    assert(incident_manager->get_total_incident_impact(0, 0) == 0);
+    assert(incident_manager->get_total_incident_impact(4, 0) == 20);
+
+    /* Test consuming a stream, snapshots are framed by marker lines */
+    stringstream feed;
+    feed << "# key,longitude,latitude,impact[,start_time,end_time]" << endl;
+    feed << "snapshot 2" << endl;
+    feed << "a,0,0.5,10" << endl;
+    feed << endl;
+    feed << "bad record" << endl;
+    feed << "end" << endl;
+    // A snapshot with a malformed record is dropped, its incidents stay live
+    assert(incident_feed->consume(feed) == 0);
+    assert(incident_manager->get_total_incident_impact(4, 0) == 20);
+    feed.clear();
+    feed << "snapshot 2" << endl;
+    feed << "a,0,0.5,10" << endl;
+    feed << "d,0,0.5,5,100,200" << endl;
+    feed << "end" << endl;
+    assert(incident_feed->consume(feed) == 1);
+    assert(incident_manager->get_total_incident_impact(0, 0) == 10);
+    assert(incident_manager->get_total_incident_impact(0, 150) == 15);
+    assert(incident_manager->get_total_incident_impact(4, 0) == 0);
+
+    // Blank lines, truncated snapshots, negative impacts, incidents ending before they start and records outside a
+    // snapshot do not remove incidents
+    feed.clear();
+    feed << endl << endl;
+    feed << "b,1,0.5,20" << endl;
+    feed << "end" << endl;
+    feed << "snapshot 3" << endl;
+    feed << "a,0,0.5,10" << endl;
+    feed << "end" << endl;
+    feed << "snapshot 1" << endl;
+    feed << "a,0,0.5,-10" << endl;
+    feed << "end" << endl;
+    feed << "snapshot 1" << endl;
+    feed << "a,0,0.5,10,200,100" << endl;
+    feed << "end" << endl;
+    feed << "snapshot 1" << endl;
+    feed << "a,0,0.5,10" << endl;
+    assert(incident_feed->consume(feed) == 0);
+    assert(incident_manager->get_total_incident_impact(0, 150) == 15);
+
+    // An empty snapshot clears the incidents of the feed
+    feed.clear();
+    feed << "snapshot 0" << endl;
+    feed << "end" << endl;
+    assert(incident_feed->consume(feed) == 1);
+    assert(incident_manager->get_total_incident_impact(0, 150) == 0);
+
+    delete incident_feed;
+    delete incident_manager;
+    delete map_graph;
+
+    cout << "==== All Incident Feed Test passed ====" << endl;
+}
@@ -0,0 +1,79 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+
+#include "../include/ims/incident_manager.h"
+
+using namespace std;
+
+/* Benchmark of IncidentManager with many live incidents.
+ * Usage: incidents_benchmark [number of incidents] [number of edges]
+ */
+int main(int argc, char ** argv)
+{
+    unsigned num_of_incidents = argc > 1? stoul(argv[1]) : 10000;
+    unsigned num_of_edges = argc > 2? stoul(argv[2]) : 800000; // approx. edge count of HK.graph
+    const unsigned lookup_rounds = 10;
+
+    cout << "==== Incident Manager Benchmark ====" << endl;
+    cout << num_of_incidents << " incidents on " << num_of_edges << " edges" << endl;
+
+    mt19937 generator(42);
+    uniform_int_distribution<unsigned> random_edge(0, num_of_edges - 1);
+    uniform_int_distribution<unsigned> random_edge_count(1, 8);
+    uniform_int_distribution<unsigned> random_impact(60000, 1800000);
+
+    vector< vector<unsigned> > affected_edges(num_of_incidents);
+    for(auto & edges : affected_edges)
+    {
+        unsigned edge = random_edge(generator);
+        unsigned count = random_edge_count(generator);
+        for(unsigned i = 0; i < count && edge + i < num_of_edges; i++)
+        {
+            edges.push_back(edge + i);
+        }
+    }
+
+    auto incident_manager = new IMS::IncidentManager(num_of_edges);
+    vector<unsigned> incident_ids(num_of_incidents);
+
+    /* Adding */
+    auto start = chrono::steady_clock::now();
+    for(unsigned i = 0; i < num_of_incidents; i++)
+    {
+        incident_ids[i] = incident_manager->add_incident(affected_edges[i], random_impact(generator));
+    }
+    auto add_time = chrono::steady_clock::now() - start;
+
+    /* Lookup on every edge, as done by edge relaxations */
+    double checksum = 0;
+    start = chrono::steady_clock::now();
+    for(unsigned round = 0; round < lookup_rounds; round++)
+    {
+        for(unsigned edge = 0; edge < num_of_edges; edge++)
+        {
+            checksum += incident_manager->get_total_incident_impact(edge, 0);
+        }
+    }
+    auto lookup_time = chrono::steady_clock::now() - start;
+
+    /* Removing */
+    start = chrono::steady_clock::now();
+    for(auto incident_id : incident_ids)
+    {
+        incident_manager->remove_incident(incident_id);
+    }
+    auto remove_time = chrono::steady_clock::now() - start;
+
+    cout << "Add: " << chrono::duration_cast<chrono::nanoseconds>(add_time).count() / num_of_incidents
+         << " ns / incident" << endl;
+    cout << "Lookup: " << chrono::duration_cast<chrono::nanoseconds>(lookup_time).count() / ((double) lookup_rounds * num_of_edges)
+         << " ns / edge" << endl;
+    cout << "Remove: " << chrono::duration_cast<chrono::nanoseconds>(remove_time).count() / num_of_incidents
+         << " ns / incident" << endl;
+    cout << "(checksum " << checksum << ")" << endl;
+
+    delete incident_manager;
+    return 0;
+}
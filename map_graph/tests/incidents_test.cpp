@@ -19,15 +19,71 @@ int main()
 
     /* Test can insert to more than 1 edge */
     incidentManager->add_incident(edge2, 4);
-    assert(incidentManager->get_total_incident_impact(0) == 4);
-    assert(incidentManager->get_total_incident_impact(1) == 4);
+    assert(incidentManager->get_total_incident_impact(0, 0) == 4);
+    assert(incidentManager->get_total_incident_impact(1, 0) == 4);
 
     /* Test can add to affected_roads */
-    assert(incidentManager->get_total_incident_impact(42) == 6);
+    assert(incidentManager->get_total_incident_impact(42, 0) == 6);
 
     /* Test can remove incident */
     incidentManager->remove_incident(1);
-    assert(incidentManager->get_total_incident_impact(42) == 2);
+    assert(incidentManager->get_total_incident_impact(42, 0) == 2);
+    assert(incidentManager->remove_incident(1) == 0);
+
+    /* Test edges out of range and removed edges have no impact */
+    assert(incidentManager->get_total_incident_impact(43, 0) == 0);
+    assert(incidentManager->get_total_incident_impact(1000, 0) == 0);
+    incidentManager->remove_incident(2);
+    assert(incidentManager->get_total_incident_impact(0, 0) == 0);
+
+    /* Test repeated edges are affected once */
+    vector<unsigned> edge3{7, 7};
+    unsigned incident_id = incidentManager->add_incident(edge3, 3);
+    assert(incidentManager->get_total_incident_impact(7, 0) == 3);
+    incidentManager->remove_incident(incident_id);
+    assert(incidentManager->get_total_incident_impact(7, 0) == 0);
+
+    /* Test pre-sized manager */
+    auto sizedIncidentManager = new IMS::IncidentManager(100);
+    assert(sizedIncidentManager->get_total_incident_impact(99, 0) == 0);
+    sizedIncidentManager->add_incident(edge2, 5);
+    assert(sizedIncidentManager->get_total_incident_impact(1, 0) == 5);
+
+    /* Test time-windowed incidents apply within [start_time, end_time) only */
+    unsigned windowed_id = sizedIncidentManager->add_incident(edge1, 10, 1000, 2000);
+    sizedIncidentManager->add_incident(edge1, 20, 1500, 3000);
+    sizedIncidentManager->add_incident(edge1, 40);
+    assert(sizedIncidentManager->get_total_incident_impact(42, 999) == 40);
+    assert(sizedIncidentManager->get_total_incident_impact(42, 1000) == 50);
+    assert(sizedIncidentManager->get_total_incident_impact(42, 1500) == 70);
+    assert(sizedIncidentManager->get_total_incident_impact(42, 2000) == 60);
+    assert(sizedIncidentManager->get_total_incident_impact(42, 3000) == 40);
+
+    /* Test can remove time-windowed incident */
+    assert(sizedIncidentManager->remove_incident(windowed_id) == 1);
+    assert(sizedIncidentManager->get_total_incident_impact(42, 1500) == 60);
+
+    /* Test open-ended incident starting later */
+    unsigned open_ended_id = sizedIncidentManager->add_incident(edge2, 7, 5000);
+    assert(sizedIncidentManager->get_total_incident_impact(1, 4999) == 5);
+    assert(sizedIncidentManager->get_total_incident_impact(1, 100000000) == 12);
+
+    /* Test expired incidents are purged, unbounded and open-ended ones are kept */
+    assert(sizedIncidentManager->purge_expired_incidents(2999) == 0);
+    assert(sizedIncidentManager->purge_expired_incidents(3000) == 1);
+    assert(sizedIncidentManager->get_total_incident_impact(42, 1500) == 40);
+    assert(sizedIncidentManager->purge_expired_incidents(100000000) == 0);
+    assert(sizedIncidentManager->remove_incident(open_ended_id) == 1);
+    assert(sizedIncidentManager->get_total_incident_impact(1, 100000000) == 5);
+
+    /* Test windows are reused after removal, and incidents added after their end are purged next time */
+    sizedIncidentManager->add_incident(edge2, 1, 0, 10);
+    assert(sizedIncidentManager->get_total_incident_impact(0, 5) == 6);
+    assert(sizedIncidentManager->purge_expired_incidents(100000000) == 1);
+    assert(sizedIncidentManager->get_total_incident_impact(0, 5) == 5);
+
+    delete incidentManager;
+    delete sizedIncidentManager;
 
     cout << "==== All Incident Manager Tests passed ====" << endl;
 }
@@ -0,0 +1,432 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <random>
+#include <chrono>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+
+#include "../include/ims/router.h"
+#include "../include/ims/synthetic_graph.h"
+#include "exp_report.h"
+
+using namespace std;
+
+/* A hot path measured in batches: setup is run before each batch and not timed, run performs num_of_operations
+ * operations and returns a checksum of their results, so that they are not optimized away.
+ */
+struct benchmark_t
+{
+    string name;
+    unsigned num_of_operations;
+    function<void()> setup;
+    function<unsigned long long()> run;
+};
+
+/* Statistics of the time per operation over the measured batches, in ns */
+struct benchmark_result_t
+{
+    string name;
+    unsigned num_of_operations = 0;
+    unsigned num_of_batches = 0;
+    double min = 0;
+    double median = 0;
+    double mean = 0;
+    double p90 = 0;
+    double max = 0;
+    double stddev = 0;
+    unsigned long long checksum = 0;
+};
+
+/* Run the warm-up batches, then the measured batches of a benchmark */
+benchmark_result_t run_benchmark(const benchmark_t &benchmark, const unsigned &num_of_warmups,
+                                 const unsigned &num_of_batches)
+{
+    benchmark_result_t result;
+    result.name = benchmark.name;
+    result.num_of_operations = benchmark.num_of_operations;
+    result.num_of_batches = num_of_batches;
+    vector<double> times;
+    for(unsigned batch = 0; batch < num_of_warmups + num_of_batches; batch++)
+    {
+        if(benchmark.setup)
+        {
+            benchmark.setup();
+        }
+        auto start = chrono::steady_clock::now();
+        unsigned long long checksum = benchmark.run();
+        double time = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+        if(batch >= num_of_warmups)
+        {
+            times.push_back(time / benchmark.num_of_operations);
+            result.checksum = checksum;
+        }
+    }
+
+    sort(times.begin(), times.end());
+    result.min = times.front();
+    result.max = times.back();
+    result.median = times.size() % 2 == 1? times[times.size() / 2]
+                                          : (times[times.size() / 2 - 1] + times[times.size() / 2]) / 2;
+    result.p90 = times[(times.size() * 90 + 99) / 100 - 1]; // nearest rank
+    for(auto time : times)
+    {
+        result.mean += time / times.size();
+    }
+    for(auto time : times)
+    {
+        result.stddev += (time - result.mean) * (time - result.mean) / times.size();
+    }
+    result.stddev = sqrt(result.stddev);
+    return result;
+}
+
+/* Median time per operation of each benchmark in a results file written before, by name */
+map<string, double> read_baseline(const string &input_file_path)
+{
+    map<string, double> baseline;
+    ifstream ifs(input_file_path);
+    if(!ifs)
+    {
+        throw runtime_error("Cannot read baseline: " + input_file_path);
+    }
+    string line;
+    while(getline(ifs, line))
+    {
+        size_t name = line.find("\"name\": \"");
+        size_t median = line.find("\"median_ns\": ");
+        if(name == string::npos || median == string::npos)
+        {
+            continue;
+        }
+        name += 9;
+        baseline[line.substr(name, line.find('"', name) - name)] = stod(line.substr(median + 13));
+    }
+    return baseline;
+}
+
+/* Straight distance in degrees, only to order OD pairs by length */
+double get_coordinate_distance(IMS::MapGraph &graph, const unsigned &from, const unsigned &to)
+{
+    return hypot(graph.get_longitude(from) - graph.get_longitude(to), graph.get_latitude(from) - graph.get_latitude(to));
+}
+
+/* Print the flags of the benchmark */
+void print_usage(const char * program)
+{
+    cout << "Usage: " << program << " [--graph <MapGraph file> | --side <grid side>"
+         << " | --synthetic <grid|random>:<nodes>] [-k <k>] [-l <l>] [--threads <preprocessing threads>]"
+         << " [--routes <per length>] [--warmup <batches>] [--batches <batches>] [--seed <n>] [--label <text>]"
+         << " [-o <results file>] [--compare <results file>]" << endl;
+}
+
+/* Benchmark of the hot paths of routing and density tracking, with warm-up, statistics over batches and results
+ * as JSON, for comparing builds. Routes are short, medium and long by thirds of random OD pairs ordered by
+ * straight distance. Density lookups and realized weights run with the routed paths injected.
+ * Graphs generated here are preprocessed with -k and -l, 4 and 3 by default, --side <n> is a synthetic grid of
+ * n x n nodes.
+ * Usage: see print_usage
+ */
+int main(int argc, char ** argv)
+{
+    string graph_file_path;
+    unsigned side = 100;
+    string synthetic_graph;
+    unsigned k = 4, l = 3, num_of_threads = 1;
+    unsigned num_of_routes = 50;
+    unsigned num_of_warmups = 2;
+    unsigned num_of_batches = 10;
+    unsigned seed = 7;
+    string label;
+    string output_file_path = "map_graph_benchmark.json";
+    string baseline_file_path;
+    for(int i = 1; i < argc; i += 2)
+    {
+        string flag = argv[i];
+        if(i + 1 == argc)
+        {
+            cout << "Missing value of " << flag << endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+        if(flag == "--graph") graph_file_path = argv[i + 1];
+        else if(flag == "--side") side = stoul(argv[i + 1]);
+        else if(flag == "--synthetic") synthetic_graph = argv[i + 1];
+        else if(flag == "-k") k = stoul(argv[i + 1]);
+        else if(flag == "-l") l = stoul(argv[i + 1]);
+        else if(flag == "--threads") num_of_threads = stoul(argv[i + 1]);
+        else if(flag == "--routes") num_of_routes = stoul(argv[i + 1]);
+        else if(flag == "--warmup") num_of_warmups = stoul(argv[i + 1]);
+        else if(flag == "--batches") num_of_batches = max(1ul, stoul(argv[i + 1]));
+        else if(flag == "--seed") seed = stoul(argv[i + 1]);
+        else if(flag == "--label") label = argv[i + 1];
+        else if(flag == "-o") output_file_path = argv[i + 1];
+        else if(flag == "--compare") baseline_file_path = argv[i + 1];
+        else
+        {
+            cout << "Unknown flag " << flag << endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    cout << "==== MapGraph Benchmark ====" << endl;
+    unique_ptr<IMS::MapGraph> map_graph;
+    if(!graph_file_path.empty())
+    {
+        map_graph.reset(IMS::MapGraph::deserialize_and_initialize(graph_file_path));
+    }
+    else
+    {
+        if(synthetic_graph.empty())
+        {
+            synthetic_graph = "grid:" + to_string(side * side);
+        }
+        IMS::SyntheticGraph::options_t options;
+        if(!IMS::SyntheticGraph::parse_options(synthetic_graph, options))
+        {
+            cout << "Invalid synthetic graph " << synthetic_graph << ", expected <grid|random>:<nodes>" << endl;
+            return 1;
+        }
+        options.seed = seed;
+        map_graph.reset(IMS::SyntheticGraph::build_map_graph(options, k, l, num_of_threads));
+    }
+    const unsigned num_of_nodes = map_graph->get_num_of_nodes();
+    const unsigned num_of_edges = map_graph->get_num_of_edges();
+    cout << num_of_nodes << " nodes, " << num_of_edges << " edges" << endl;
+    auto incident_manager = new IMS::IncidentManager(num_of_edges);
+    IMS::Router router(map_graph.get(), incident_manager);
+    const time_t departure = 1546300800; // 2019-01-01 08:00 HKT
+
+    // Inputs, drawn once so that every batch does the same work
+    mt19937 generator(seed);
+    uniform_int_distribution<unsigned> random_node(0, num_of_nodes - 1);
+    uniform_int_distribution<unsigned> random_edge(0, num_of_edges - 1);
+    vector<pair<unsigned, unsigned> > od_pairs;
+    while(od_pairs.size() < num_of_routes * 3)
+    {
+        auto od_pair = make_pair(random_node(generator), random_node(generator));
+        if(od_pair.first == od_pair.second)
+        {
+            continue;
+        }
+        IMS::Path * path = router.route(od_pair.first, od_pair.second, departure);
+        if(path != nullptr && !path->enter_times.empty())
+        {
+            od_pairs.push_back(od_pair);
+        }
+        delete path;
+    }
+    sort(od_pairs.begin(), od_pairs.end(), [&](const pair<unsigned, unsigned> &a, const pair<unsigned, unsigned> &b)
+    {
+        return get_coordinate_distance(*map_graph, a.first, a.second) < get_coordinate_distance(*map_graph, b.first, b.second);
+    });
+    vector<IMS::Path *> paths;
+    for(auto & od_pair : od_pairs)
+    {
+        paths.push_back(router.route(od_pair.first, od_pair.second, departure));
+    }
+
+    const unsigned num_of_lookups = 100000;
+    vector<pair<unsigned, unsigned> > node_pairs(num_of_lookups);
+    for(auto & node_pair : node_pairs)
+    {
+        node_pair = make_pair(random_node(generator), random_node(generator));
+    }
+    // Edges at times within the routed paths, so that lookups find density entries
+    vector<pair<unsigned, time_t> > edge_times(num_of_lookups);
+    uniform_int_distribution<unsigned> random_path(0, paths.size() - 1);
+    for(auto & edge_time : edge_times)
+    {
+        IMS::Path * path = paths[random_path(generator)];
+        uniform_int_distribution<time_t> random_time(path->start_time, path->end_time);
+        time_t time = random_time(generator);
+        auto entered = path->enter_times.upper_bound(time);
+        edge_time = make_pair(entered == path->enter_times.begin()? random_edge(generator) : prev(entered)->second,
+                              time);
+    }
+    float min_long = map_graph->get_longitude(0), max_long = min_long;
+    float min_lat = map_graph->get_latitude(0), max_lat = min_lat;
+    for(unsigned node = 1; node < num_of_nodes; node++)
+    {
+        min_long = min(min_long, map_graph->get_longitude(node));
+        max_long = max(max_long, map_graph->get_longitude(node));
+        min_lat = min(min_lat, map_graph->get_latitude(node));
+        max_lat = max(max_lat, map_graph->get_latitude(node));
+    }
+    uniform_real_distribution<float> random_long(min_long, max_long);
+    uniform_real_distribution<float> random_lat(min_lat, max_lat);
+    vector<pair<float, float> > locations(10000);
+    for(auto & location : locations)
+    {
+        location = make_pair(random_long(generator), random_lat(generator));
+    }
+
+    vector<benchmark_t> benchmarks;
+    const char * lengths[] = {"short", "medium", "long"};
+    for(unsigned length = 0; length < 3; length++)
+    {
+        benchmarks.push_back({string("route_") + lengths[length], num_of_routes, nullptr, [&, length]()
+        {
+            unsigned long long checksum = 0;
+            for(unsigned i = length * num_of_routes; i < (length + 1) * num_of_routes; i++)
+            {
+                IMS::Path * path = router.route(od_pairs[i].first, od_pairs[i].second, departure);
+                checksum += path->end_time - path->start_time;
+                delete path;
+            }
+            return checksum;
+        }});
+    }
+    benchmarks.push_back({"retrieve_future_weight", num_of_lookups, nullptr, [&]()
+    {
+        unsigned long long checksum = 0;
+        for(auto & node_pair : node_pairs)
+        {
+            checksum += router.retrieve_future_weight(node_pair.first, node_pair.second);
+        }
+        return checksum;
+    }});
+    benchmarks.push_back({"retrieve_realized_weight", num_of_lookups, nullptr, [&]()
+    {
+        unsigned long long checksum = 0;
+        for(auto & edge_time : edge_times)
+        {
+            checksum += router.retrieve_realized_weight(edge_time.first, edge_time.second);
+        }
+        return checksum;
+    }});
+    benchmarks.push_back({"find_current_density", num_of_lookups, nullptr, [&]()
+    {
+        double checksum = 0;
+        for(auto & edge_time : edge_times)
+        {
+            checksum += map_graph->find_current_density(edge_time.first, edge_time.second);
+        }
+        return (unsigned long long) checksum;
+    }});
+    // Injected once for the density benchmarks above, then removed and injected again by the ones below
+    bool is_injected = false;
+    auto inject_paths = [&]()
+    {
+        unsigned long long checksum = 0;
+        for(auto path : paths)
+        {
+            map_graph->inject_impact_of_routed_path(path);
+            checksum += path->enter_times.size();
+        }
+        is_injected = true;
+        return checksum;
+    };
+    auto remove_paths = [&]()
+    {
+        unsigned long long checksum = 0;
+        for(auto path : paths)
+        {
+            map_graph->remove_impact_of_routed_path(path);
+            checksum += path->enter_times.size();
+        }
+        is_injected = false;
+        return checksum;
+    };
+    benchmarks.push_back({"inject_impact_of_routed_path", (unsigned) paths.size(), [&]()
+    {
+        if(is_injected) remove_paths();
+    }, inject_paths});
+    benchmarks.push_back({"remove_impact_of_routed_path", (unsigned) paths.size(), [&]()
+    {
+        if(!is_injected) inject_paths();
+    }, remove_paths});
+    benchmarks.push_back({"find_nearest_node_of_location", (unsigned) locations.size(), nullptr, [&]()
+    {
+        unsigned long long checksum = 0;
+        for(auto & location : locations)
+        {
+            checksum += map_graph->find_nearest_node_of_location(location.first, location.second, 100);
+        }
+        return checksum;
+    }});
+    // Scans all edges, so a few locations only
+    benchmarks.push_back({"find_nearest_edge_of_location", 20, nullptr, [&]()
+    {
+        unsigned long long checksum = 0;
+        for(unsigned i = 0; i < 20; i++)
+        {
+            checksum += map_graph->find_nearest_edge_of_location(locations[i].first, locations[i].second, 0.0008).size();
+        }
+        return checksum;
+    }});
+
+    inject_paths();
+    vector<benchmark_result_t> results;
+    printf("%-32s %10s %12s %12s %12s %10s\n", "benchmark", "ops/batch", "median (ns)", "p90 (ns)", "min (ns)",
+           "stddev %");
+    for(auto & benchmark : benchmarks)
+    {
+        results.push_back(run_benchmark(benchmark, num_of_warmups, num_of_batches));
+        const benchmark_result_t &r = results.back();
+        printf("%-32s %10u %12.1f %12.1f %12.1f %10.1f\n", r.name.c_str(), r.num_of_operations, r.median, r.p90,
+               r.min, 100 * r.stddev / r.mean);
+    }
+    if(is_injected)
+    {
+        remove_paths();
+    }
+
+    ofstream json(output_file_path);
+    json << fixed << setprecision(1);
+    json << "{\n  \"benchmark\": \"map_graph\",\n  \"label\": \"" << escape_json(label) << "\",\n"
+#ifdef __OPTIMIZE__
+         << "  \"optimized\": true,\n"
+#else
+         << "  \"optimized\": false,\n"
+#endif
+         << "  \"compiler\": \"" << escape_json(__VERSION__) << "\",\n"
+         << "  \"graph\": \"" << escape_json(!graph_file_path.empty()? graph_file_path : "synthetic " + synthetic_graph)
+         << "\",\n"
+         << "  \"nodes\": " << num_of_nodes << ",\n  \"edges\": " << num_of_edges << ",\n"
+         << "  \"warmup_batches\": " << num_of_warmups << ",\n  \"seed\": " << seed << ",\n"
+         << "  \"results\": [\n";
+    for(unsigned i = 0; i < results.size(); i++)
+    {
+        const benchmark_result_t &r = results[i];
+        json << "    {\"name\": \"" << r.name << "\", \"operations\": " << r.num_of_operations
+             << ", \"batches\": " << r.num_of_batches << ", \"median_ns\": " << r.median
+             << ", \"mean_ns\": " << r.mean << ", \"min_ns\": " << r.min << ", \"p90_ns\": " << r.p90
+             << ", \"max_ns\": " << r.max << ", \"stddev_ns\": " << r.stddev << ", \"checksum\": " << r.checksum
+             << "}" << (i + 1 < results.size()? "," : "") << "\n";
+    }
+    json << "  ]\n}\n";
+    json.close();
+    cout << "Results are stored at " << output_file_path << endl;
+
+    if(!baseline_file_path.empty())
+    {
+        map<string, double> baseline = read_baseline(baseline_file_path);
+        cout << "Median against " << baseline_file_path << ":" << endl;
+        for(auto & r : results)
+        {
+            auto base = baseline.find(r.name);
+            if(base == baseline.end() || base->second <= 0)
+            {
+                printf("%-32s %12s\n", r.name.c_str(), "new");
+                continue;
+            }
+            printf("%-32s %12.1f -> %10.1f ns (%+.1f%%)\n", r.name.c_str(), base->second, r.median,
+                   100 * (r.median - base->second) / base->second);
+        }
+    }
+
+    for(auto path : paths)
+    {
+        delete path;
+    }
+    delete incident_manager;
+    return 0;
+}
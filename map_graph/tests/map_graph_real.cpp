@@ -2,6 +2,7 @@
 #include <unordered_set>
 
 #include <chrono>
+#include <fstream>
 #include <ctime>
 
 #include "../src/partition.h"
@@ -17,6 +18,21 @@ int main()
 
     auto graph = IMS::MapGraph::deserialize_and_initialize("HK.graph");
 
+    auto initialized_time = chrono::system_clock::now();
+    cout << "Initialized in " << chrono::duration<double>(initialized_time - start_time).count() << "s." << endl;
+    auto inverse_start_time = chrono::system_clock::now();
+    delete graph->inverse();
+    cout << "Inverse built in " << chrono::duration<double, milli>(chrono::system_clock::now() - inverse_start_time).count() << "ms." << endl;
+    ifstream status("/proc/self/status");
+    string line;
+    while(getline(status, line))
+    {
+        if(line.compare(0, 6, "VmHWM:") == 0 || line.compare(0, 6, "VmRSS:") == 0)
+        {
+            cout << line << endl;
+        }
+    }
+
     return 0; 
 
     /*
@@ -35,8 +51,8 @@ int main()
     cout << "Start partitioning @ \t" << ctime(&now);
 
     /*
-    IMS::Partition::partition_t * p = IMS::Partition::do_partition(nodes, graph->latitude, graph->longitude,
-            graph->head, graph->first_out, graph->inversed->head, graph->inversed->first_out, k, lvl, 0);
+    IMS::Partition::partition_tree_t * p = IMS::Partition::do_partition(nodes, graph->latitude, graph->longitude,
+            graph->head, graph->first_out, graph->inversed->head, graph->inversed->first_out, k, lvl);
     IMS::Partition::index_partition(p);
     IMS::Partition::layer_t* l = IMS::Partition::build_layer(p, nodes.size());
     */
@@ -1,8 +1,13 @@
 #include <iostream>
 #include <cmath>
+#include <cassert>
 #include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <set>
 
 #include "../include/ims/map_graph.h"
+#include "../include/ims/synthetic_graph.h"
 #include "../src/partition.h"
 #include "../src/preprocess.h"
 #include "map_graph_test_data.h"
@@ -62,7 +67,9 @@ int main()
         mapGraph->geo_distance.assign(geo_distance16, geo_distance16 + 30);
         mapGraph->default_travel_time.assign(default_travel_time16, default_travel_time16 + 30);
     #endif
-    mapGraph->initialize();
+    IMS::initialization_timing_t timing = mapGraph->initialize();
+    assert(timing.total_time >= timing.inverse_time && timing.total_time >= timing.geo_index_time);
+    assert(mapGraph->get_initialization_timing().total_time == timing.total_time);
 
     /* Graph tests */
     cout << "==== Graph Test ====" << endl;
@@ -76,6 +83,44 @@ int main()
     
     cout << endl;
 
+    /* Inverse tests: counting sort in parallel on a graph large enough for threads */
+    {
+        IMS::MapGraph large_graph;
+        const unsigned num_of_nodes = 50000;
+        vector<unsigned> large_first_out, large_head;
+        srand(42);
+        for(unsigned node = 0; node < num_of_nodes; node++)
+        {
+            large_first_out.push_back(large_head.size());
+            unsigned degree = rand() % 8;
+            for(unsigned i = 0; i < degree; i++)
+            {
+                large_head.push_back(rand() % num_of_nodes);
+            }
+        }
+        large_graph.first_out = large_first_out;
+        large_graph.head = large_head;
+
+        auto serial = large_graph.inverse(1);
+        auto parallel = large_graph.inverse(4);
+        assert(serial->first_out == parallel->first_out);
+        assert(serial->head == parallel->head);
+        assert(serial->relative_edge == parallel->relative_edge);
+        for(unsigned node = 0; node < num_of_nodes; node++)
+        {
+            unsigned last_edge = node == num_of_nodes - 1? large_head.size() : parallel->first_out[node + 1];
+            for(unsigned edge = parallel->first_out[node]; edge < last_edge; edge++)
+            {
+                unsigned original_edge = parallel->relative_edge[edge];
+                assert(large_head[original_edge] == node);
+                assert(large_first_out[parallel->head[edge]] <= original_edge);
+                assert(edge == parallel->first_out[node] || parallel->relative_edge[edge - 1] < original_edge);
+            }
+        }
+        delete serial;
+        delete parallel;
+    }
+
     /* Partition + Layer tests */
     int k = 2;
     int l = 3;
@@ -83,7 +128,7 @@ int main()
     cout << "==== Partition & Layer Test ====" << endl;
     
     auto p = IMS::Partition::do_partition(nodes, mapGraph->latitude, mapGraph->longitude,
-            mapGraph->head, mapGraph->first_out, mapGraph->inversed->head, mapGraph->inversed->first_out, k, l, 0);
+            mapGraph->head, mapGraph->first_out, mapGraph->inversed->head, mapGraph->inversed->first_out, k, l);
     IMS::Partition::index_partition(p);
     auto layer = IMS::Partition::build_layer(p, lat.size());
 
@@ -100,9 +145,71 @@ int main()
     cout << IMS::Partition::find_parent(layer, 4); // expected: 4 for N=12, k=2, l=3
     cout << endl;
 
+    // Flat layout: l levels, children of a partition are consecutive and take its range of nodes
+    assert(p->num_of_levels() == (unsigned)l && p->parent[0] == (unsigned)INFINITY && p->nodes.size() == nodes.size());
+    for(unsigned level = 0; level < p->num_of_levels(); level++)
+    {
+        unsigned next_node = 0;
+        for(unsigned curr = p->level_first[level]; curr < p->level_first[level + 1]; curr++)
+        {
+            assert(p->layer[curr] == level && p->id[curr] == curr - p->level_first[level]);
+            assert(p->node_first[curr] == next_node && p->node_last[curr] > next_node);
+            next_node = p->node_last[curr];
+            for(unsigned sp = p->child_first[curr]; sp < p->child_first[curr + 1]; sp++)
+            {
+                assert(p->parent[sp] == curr && p->layer[sp] == level + 1);
+            }
+            if(p->num_of_children(curr) > 0)
+            {
+                assert(p->node_first[p->child_first[curr]] == p->node_first[curr]);
+                assert(p->node_last[p->child_first[curr + 1] - 1] == p->node_last[curr]);
+            }
+        }
+        assert(next_node == nodes.size());
+    }
+    for(unsigned node : nodes)
+    {
+        unsigned cell = p->level_first[l - 1] + (*layer)[l][node];
+        IMS::Partition::span_t cell_nodes = p->nodes_of(cell);
+        assert(find(cell_nodes.begin(), cell_nodes.end(), node) != cell_nodes.end());
+    }
+
     delete p;
     delete layer;
 
+    cout << "==== Inertial Flow Partition Test ====" << endl;
+    // k x k cells covering every node once, nodes ascending within a cell
+    auto cells = IMS::Partition::inertial_flow_partition(nodes, mapGraph->latitude, mapGraph->longitude,
+                                                         mapGraph->head, mapGraph->first_out, k);
+    assert(cells.size() == (unsigned)(k * k));
+    vector<unsigned> covered;
+    for(auto & cell : cells)
+    {
+        assert(!cell.second.empty() && is_sorted(cell.second.begin(), cell.second.end()));
+        assert(cell.second.size() <= ceil(IMS::Partition::INERTIAL_FLOW_MAX_IMBALANCE * nodes.size() / (k * k)));
+        covered.insert(covered.end(), cell.second.begin(), cell.second.end());
+    }
+    sort(covered.begin(), covered.end());
+    assert(covered == nodes);
+
+    auto p_flow = IMS::Partition::do_partition(nodes, mapGraph->latitude, mapGraph->longitude,
+            mapGraph->head, mapGraph->first_out, mapGraph->inversed->head, mapGraph->inversed->first_out, k, l,
+            IMS::Partition::INERTIAL_FLOW_PARTITION);
+    // l levels of at most k x k sub-partitions, each node in one cell of the last level
+    assert(p_flow->num_of_levels() == (unsigned)l);
+    for(unsigned curr = 0; curr < p_flow->num_of_partitions(); curr++)
+    {
+        assert(p_flow->num_of_children(curr) <= (unsigned)(k * k));
+        // bounded by the mean size of the level, not of the parent
+        double mean_size = nodes.size() / pow(k * k, p_flow->layer[curr]);
+        assert(p_flow->nodes_of(curr).size() <= ceil(IMS::Partition::INERTIAL_FLOW_MAX_IMBALANCE * mean_size));
+    }
+    vector<unsigned> leaves(p_flow->nodes);
+    sort(leaves.begin(), leaves.end());
+    assert(leaves == nodes);
+    delete p_flow;
+    cout << "==== All Inertial Flow Partition Test passed ====" << endl;
+
     /* Preprocess tests */
     cout << "==== Preprocess Test ====" << endl;
     mapGraph->preprocess(k, l);
@@ -110,6 +217,319 @@ int main()
     IMS::Preprocess::print_distance_table(mapGraph->distance_tables);
     cout << endl;
 
+    /* Renumbering tests */
+    cout << "==== Renumbering Test ====" << endl;
+    auto mapGraph_renumbered = build_graph16();
+    mapGraph_renumbered->initialize();
+    IMS::Renumbering renumbering = mapGraph_renumbered->renumber_by_partition(2, 3);
+
+    // Nodes and edges are permuted, not changed
+    vector<unsigned> new_node_id = renumbering.new_node_id;
+    sort(new_node_id.begin(), new_node_id.end());
+    for(unsigned i = 0; i < 16; i++)
+    {
+        assert(new_node_id[i] == i);
+        assert(mapGraph_renumbered->longitude[renumbering.new_node_id[i]] == coordinates16[i][0]);
+        assert(mapGraph_renumbered->latitude[renumbering.new_node_id[i]] == coordinates16[i][1]);
+    }
+    for(unsigned tail = 0; tail < 16; tail++)
+    {
+        unsigned last_edge = tail == 15? 30 : first_out16[tail + 1];
+        for(unsigned edge = first_out16[tail]; edge < last_edge; edge++)
+        {
+            unsigned new_edge = renumbering.new_edge_id[edge];
+            assert(mapGraph_renumbered->head[new_edge] == renumbering.new_node_id[head16[edge]]);
+            assert(mapGraph_renumbered->find_edge(renumbering.new_node_id[tail], renumbering.new_node_id[head16[edge]]) == new_edge);
+            assert(mapGraph_renumbered->default_travel_time[new_edge] == default_travel_time16[edge]);
+            assert(mapGraph_renumbered->geo_distance[new_edge] == geo_distance16[edge]);
+        }
+    }
+
+    // Cells are contiguous ID ranges
+    mapGraph_renumbered->preprocess(2, 3);
+    auto & cell_of_node = mapGraph_renumbered->layers->back();
+    assert(is_sorted(cell_of_node.begin(), cell_of_node.end()));
+
+    // Overlay of a variant replaces the preprocessed data, of the graph it is written for only
+    mapGraph_renumbered->serialize_overlay("map_graph_test.overlay");
+    IMS::Partition::layer_t layers_2_3 = *mapGraph_renumbered->layers;
+    vector<unsigned> distance_value_2_3 = mapGraph_renumbered->flat_distance_tables->distance_value.to_vector();
+    mapGraph_renumbered->preprocess(4, 2);
+    mapGraph_renumbered->load_overlay("map_graph_test.overlay");
+    assert(*mapGraph_renumbered->layers == layers_2_3);
+    assert(mapGraph_renumbered->flat_distance_tables->distance_value == distance_value_2_3);
+    bool is_overlay_rejected = false;
+    try
+    {
+        mapGraph->load_overlay("map_graph_test.overlay");
+    }
+    catch(runtime_error &e)
+    {
+        is_overlay_rejected = true;
+    }
+    assert(is_overlay_rejected);
+    remove("map_graph_test.overlay");
+    delete mapGraph_renumbered;
+    cout << "==== All Renumbering Test passed ====" << endl;
+
+    /* Incremental preprocessing tests */
+    cout << "==== Edge Change Test ====" << endl;
+    // Every boundary, boundary distance and bound distance the same as preprocessing the changed graph from scratch
+    auto assert_rebuilt = [&](IMS::MapGraph * changed, IMS::Partition::partition_tree_t * partitions,
+                              const vector<IMS::edge_change_t> &changes)
+    {
+        auto partitions_rebuilt = changed->partition(2, 3);
+        assert(partitions->id == partitions_rebuilt->id && partitions->child_first == partitions_rebuilt->child_first);
+        assert(partitions->boundary_outwards_first == partitions_rebuilt->boundary_outwards_first
+               && partitions->boundary_outwards == partitions_rebuilt->boundary_outwards);
+        assert(partitions->boundary_inwards_first == partitions_rebuilt->boundary_inwards_first
+               && partitions->boundary_inwards == partitions_rebuilt->boundary_inwards);
+        auto rebuilt = build_graph16();
+        rebuilt->initialize();
+        rebuilt->apply_edge_changes(changes);
+        rebuilt->preprocess(partitions_rebuilt);
+        rebuilt->preprocess_boundary_distances(partitions_rebuilt);
+        assert(changed->boundary_distances->outbound_distance
+               == rebuilt->boundary_distances->outbound_distance.get_vector());
+        assert(changed->boundary_distances->inbound_distance
+               == rebuilt->boundary_distances->inbound_distance.get_vector());
+        for(unsigned level = 1; level < 3; level++)
+        {
+            for(unsigned id = 0; id < (*changed->distance_tables)[level].size(); id++)
+            {
+                auto & entry = (*changed->distance_tables)[level][id];
+                auto & rebuilt_entry = (*rebuilt->distance_tables)[level][id];
+                // Entries kept after a removed or slower edge stay lower bounds
+                assert(entry.partition_distance.size() == rebuilt_entry.partition_distance.size());
+                for(auto & distance : entry.partition_distance)
+                {
+                    assert(distance.second <= rebuilt_entry.partition_distance.at(distance.first));
+                }
+                assert(entry.outbound_distance == rebuilt_entry.outbound_distance);
+                assert(entry.inbound_distance == rebuilt_entry.inbound_distance);
+            }
+        }
+        delete partitions_rebuilt;
+        delete rebuilt;
+    };
+    auto mapGraph_changed = build_graph16();
+    mapGraph_changed->initialize();
+    auto partitions_changed = mapGraph_changed->partition(2, 3);
+    mapGraph_changed->preprocess(partitions_changed);
+    mapGraph_changed->preprocess_boundary_distances(partitions_changed);
+    // Density of a kept edge moves with it, density of a removed edge is dropped
+    const unsigned kept_head = mapGraph_changed->head[mapGraph_changed->first_out[4]];
+    mapGraph_changed->current_density[mapGraph_changed->first_out[4]][100] = 0.1;
+    mapGraph_changed->current_density[mapGraph_changed->find_edge(5, 9)][100] = 0.1;
+
+    vector<IMS::edge_change_t> changes(3);
+    changes[0].type = IMS::edge_change_t::RETIME;
+    changes[0].from = 0, changes[0].to = 5, changes[0].travel_time = 500;
+    changes[1].type = IMS::edge_change_t::REMOVE;
+    changes[1].from = 5, changes[1].to = 9;
+    changes[2].type = IMS::edge_change_t::ADD;
+    changes[2].from = 3, changes[2].to = 12, changes[2].travel_time = 50, changes[2].geo_distance = 5;
+    IMS::update_report_t update_report = mapGraph_changed->apply_edge_changes(changes, partitions_changed);
+    assert(update_report.num_of_edges_added == 1);
+    assert(update_report.num_of_edges_removed == 1);
+    assert(update_report.num_of_edges_retimed == 1);
+    assert(update_report.num_of_entries_recomputed <= update_report.num_of_entries);
+    assert(mapGraph_changed->get_num_of_edges() == 30);
+    assert(mapGraph_changed->default_travel_time[mapGraph_changed->find_edge(0, 5)] == 500);
+    assert(mapGraph_changed->find_edge(5, 9) == (unsigned)INFINITY);
+    assert(mapGraph_changed->default_travel_time[mapGraph_changed->find_edge(3, 12)] == 50);
+    assert(mapGraph_changed->current_density.get_num_of_allocated() == 1);
+    assert(mapGraph_changed->find_current_density(mapGraph_changed->find_edge(4, kept_head), 150) == 0.1);
+    assert_rebuilt(mapGraph_changed, partitions_changed, changes);
+    auto applied_changes = changes;
+
+    // A faster edge alone
+    changes.resize(1);
+    changes[0].type = IMS::edge_change_t::RETIME;
+    changes[0].from = 15, changes[0].to = mapGraph_changed->head[mapGraph_changed->first_out[15]];
+    changes[0].travel_time = 1;
+    update_report = mapGraph_changed->apply_edge_changes(changes, partitions_changed);
+    assert(update_report.num_of_entries_recomputed <= update_report.num_of_entries);
+    applied_changes.push_back(changes[0]);
+    assert_rebuilt(mapGraph_changed, partitions_changed, applied_changes);
+
+    // A slower edge only lengthens distances, kept entries stay lower bounds
+    changes[0].travel_time = 900000;
+    update_report = mapGraph_changed->apply_edge_changes(changes, partitions_changed);
+    assert(update_report.num_of_entries_recomputed < update_report.num_of_entries);
+    applied_changes.push_back(changes[0]);
+    auto mapGraph_rebuilt = build_graph16();
+    mapGraph_rebuilt->initialize();
+    mapGraph_rebuilt->apply_edge_changes(applied_changes);
+    auto partitions_rebuilt = mapGraph_rebuilt->partition(2, 3);
+    mapGraph_rebuilt->preprocess(partitions_rebuilt);
+    for(unsigned level = 1; level < 3; level++)
+    {
+        for(unsigned id = 0; id < (*mapGraph_changed->distance_tables)[level].size(); id++)
+        {
+            auto & entry = (*mapGraph_changed->distance_tables)[level][id];
+            auto & rebuilt_entry = (*mapGraph_rebuilt->distance_tables)[level][id];
+            assert(entry.outbound_distance == rebuilt_entry.outbound_distance);
+            assert(entry.inbound_distance == rebuilt_entry.inbound_distance);
+            assert(entry.partition_distance.size() == rebuilt_entry.partition_distance.size());
+            for(auto & distance : entry.partition_distance)
+            {
+                assert(distance.second <= rebuilt_entry.partition_distance.at(distance.first));
+            }
+        }
+    }
+
+    // Invalid change leaves the graph unchanged
+    changes.resize(1);
+    changes[0].type = IMS::edge_change_t::REMOVE;
+    changes[0].from = 5, changes[0].to = 9;
+    bool is_change_rejected = false;
+    try
+    {
+        mapGraph_changed->apply_edge_changes(changes, partitions_changed);
+    }
+    catch(runtime_error &e)
+    {
+        is_change_rejected = true;
+    }
+    assert(is_change_rejected && mapGraph_changed->get_num_of_edges() == 30);
+
+    // Weight profiles, edges not given keep their default travel time
+    const string profiles_file_path = "map_graph_test_profiles.txt";
+    {
+        ofstream profiles_file(profiles_file_path);
+        profiles_file << "# Hong Kong time\nutc_offset 28800\nprofile 00:00\n\nprofile 07:30 1.5\n0 5 1500\n3 12 150\n";
+    }
+    vector<unsigned> start_times;
+    vector< vector<unsigned> > travel_times;
+    int utc_offset;
+    mapGraph_rebuilt->read_weight_profiles(profiles_file_path, start_times, travel_times, utc_offset);
+    assert(utc_offset == 28800);
+    assert(start_times == vector<unsigned>({0, 7 * 3600 + 30 * 60}));
+    assert(mapGraph_rebuilt->default_travel_time == travel_times[0]);
+    assert(travel_times[1][mapGraph_rebuilt->find_edge(0, 5)] == 1500);
+    assert(travel_times[1][mapGraph_rebuilt->find_edge(3, 12)] == 150);
+    assert(2 * travel_times[1][mapGraph_rebuilt->find_edge(0, 1)] == 3 * travel_times[0][mapGraph_rebuilt->find_edge(0, 1)]);
+    mapGraph_rebuilt->set_weight_profiles(start_times, travel_times, utc_offset, partitions_rebuilt);
+    assert(mapGraph_rebuilt->weight_profiles->num_of_profiles() == 2);
+    {
+        ofstream profiles_file(profiles_file_path);
+        profiles_file << "profile 07:30\n5 9 1500\n";
+    }
+    bool is_profile_rejected = false;
+    try
+    {
+        mapGraph_rebuilt->read_weight_profiles(profiles_file_path, start_times, travel_times, utc_offset);
+    }
+    catch(runtime_error &e)
+    {
+        is_profile_rejected = true;
+    }
+    assert(is_profile_rejected);
+    remove(profiles_file_path.c_str());
+    // Travel times of profiles are kept by edge ID
+    changes[0].type = IMS::edge_change_t::RETIME;
+    changes[0].from = 0, changes[0].to = 5, changes[0].travel_time = 600;
+    is_change_rejected = false;
+    try
+    {
+        mapGraph_rebuilt->apply_edge_changes(changes, partitions_rebuilt);
+    }
+    catch(runtime_error &e)
+    {
+        is_change_rejected = true;
+    }
+    assert(is_change_rejected);
+    delete partitions_changed;
+    delete partitions_rebuilt;
+    delete mapGraph_changed;
+    delete mapGraph_rebuilt;
+
+    // A short cut between nearby nodes of a larger graph only recomputes the entries it can improve
+    IMS::SyntheticGraph::options_t options;
+    options.num_of_nodes = 2500;
+    auto build_synthetic = [&](const vector<IMS::edge_change_t> &changes)
+    {
+        auto road_graph = IMS::SyntheticGraph::generate(options);
+        auto synthetic = new IMS::MapGraph();
+        synthetic->longitude = road_graph.longitude;
+        synthetic->latitude = road_graph.latitude;
+        synthetic->first_out = road_graph.first_out;
+        synthetic->head = road_graph.head;
+        synthetic->default_travel_time = road_graph.travel_time;
+        synthetic->geo_distance = road_graph.geo_distance;
+        synthetic->initialize();
+        synthetic->apply_edge_changes(changes);
+        return synthetic;
+    };
+    auto mapGraph_synthetic = build_synthetic(vector<IMS::edge_change_t>());
+    auto partitions_synthetic = mapGraph_synthetic->partition(4, 3);
+    mapGraph_synthetic->preprocess(partitions_synthetic);
+    // Two edges away from node 1000, the cut not already in the graph
+    changes.resize(1);
+    changes[0].type = IMS::edge_change_t::ADD;
+    changes[0].from = 1000, changes[0].travel_time = 1, changes[0].geo_distance = 1;
+    changes[0].to = changes[0].from;
+    mapGraph_synthetic->for_each_out_edge(changes[0].from, [&](const unsigned &, const unsigned &next)
+    {
+        mapGraph_synthetic->for_each_out_edge(next, [&](const unsigned &, const unsigned &two_away)
+        {
+            if(two_away != changes[0].from && mapGraph_synthetic->find_edge(changes[0].from, two_away)
+                                              == (unsigned)INFINITY)
+            {
+                changes[0].to = two_away;
+            }
+        });
+    });
+    assert(changes[0].to != changes[0].from);
+    update_report = mapGraph_synthetic->apply_edge_changes(changes, partitions_synthetic);
+    assert(update_report.num_of_entries_recomputed < update_report.num_of_entries / 4);
+    auto applied_synthetic_changes = changes;
+    // A fast bypass from the cell east of a top level cell to the cell south of it shortens distances between the
+    // children of that cell, whose entries are searched again though none of its nodes changed
+    auto nearest_node = [&](const float &longitude, const float &latitude)
+    {
+        unsigned nearest = 0;
+        for(unsigned node = 1; node < mapGraph_synthetic->get_num_of_nodes(); node++)
+        {
+            if(hypot(mapGraph_synthetic->longitude[node] - longitude, mapGraph_synthetic->latitude[node] - latitude)
+               < hypot(mapGraph_synthetic->longitude[nearest] - longitude,
+                       mapGraph_synthetic->latitude[nearest] - latitude))
+            {
+                nearest = node;
+            }
+        }
+        return nearest;
+    };
+    auto longitude_range = minmax_element(mapGraph_synthetic->longitude.begin(), mapGraph_synthetic->longitude.end());
+    auto latitude_range = minmax_element(mapGraph_synthetic->latitude.begin(), mapGraph_synthetic->latitude.end());
+    const float west = *longitude_range.first, east = *longitude_range.second;
+    const float south = *latitude_range.first, north = *latitude_range.second;
+    changes[0].from = nearest_node(west + (east - west) * 0.55, south + (north - south) * 0.72);
+    changes[0].to = nearest_node(west + (east - west) * 0.28, south + (north - south) * 0.45);
+    update_report = mapGraph_synthetic->apply_edge_changes(changes, partitions_synthetic);
+    assert(update_report.num_of_entries_recomputed < update_report.num_of_entries);
+    applied_synthetic_changes.push_back(changes[0]);
+    auto mapGraph_synthetic_rebuilt = build_synthetic(applied_synthetic_changes);
+    auto partitions_synthetic_rebuilt = mapGraph_synthetic_rebuilt->partition(4, 3);
+    mapGraph_synthetic_rebuilt->preprocess(partitions_synthetic_rebuilt);
+    for(unsigned level = 1; level < 3; level++)
+    {
+        for(unsigned id = 0; id < (*mapGraph_synthetic->distance_tables)[level].size(); id++)
+        {
+            auto & entry = (*mapGraph_synthetic->distance_tables)[level][id];
+            auto & rebuilt_entry = (*mapGraph_synthetic_rebuilt->distance_tables)[level][id];
+            assert(entry.partition_distance == rebuilt_entry.partition_distance);
+            assert(entry.outbound_distance == rebuilt_entry.outbound_distance);
+            assert(entry.inbound_distance == rebuilt_entry.inbound_distance);
+        }
+    }
+    delete partitions_synthetic;
+    delete partitions_synthetic_rebuilt;
+    delete mapGraph_synthetic;
+    delete mapGraph_synthetic_rebuilt;
+    cout << "==== All Edge Change Test passed ====" << endl;
+
     /* Test graph for Reverse Geocoding and Update Tests */
     auto mapGraph_square = new IMS::MapGraph();
     for(int i = 0; i < 4; i++) {
@@ -126,6 +546,10 @@ int main()
     cout << "==== Miscellaneous test ====" << endl;
     assert(mapGraph_square->find_edge(0, 1) == 1);
     assert(mapGraph_square->find_edge(0, 3) == (unsigned)INFINITY);
+    // Density is allocated on first injection only
+    assert(mapGraph_square->current_density.size() == 5);
+    assert(mapGraph_square->current_density.get_num_of_allocated() == 0);
+    assert(mapGraph_square->find_current_density(2, 50) == 0);
 
     /* Routing tests */
     cout << "==== Reverse Geocoding Test ====" << endl;
@@ -2,6 +2,8 @@
  * Test Data
  * */
 
+#include "../include/ims/map_graph.h"
+
 /* Square Data set */
 float coordinates4[4][2] = {{0, 0},
                             {1, 0},
@@ -243,4 +245,19 @@ unsigned geo_distance16[30] = {10,
                                10,
                                10,
                                10,
-};
\ No newline at end of file
+};
+
+/* Graph of the Hand2 data set, arrays filled in, to be adjusted and initialized by the caller */
+IMS::MapGraph * build_graph16()
+{
+    auto map_graph = new IMS::MapGraph();
+    for(int i = 0; i < 16; i++) {
+        map_graph->longitude.push_back(coordinates16[i][0]);
+        map_graph->latitude.push_back(coordinates16[i][1]);
+    }
+    map_graph->first_out.assign(first_out16, first_out16 + 16);
+    map_graph->head.assign(head16, head16 + 30);
+    map_graph->geo_distance.assign(geo_distance16, geo_distance16 + 30);
+    map_graph->default_travel_time.assign(default_travel_time16, default_travel_time16 + 30);
+    return map_graph;
+}
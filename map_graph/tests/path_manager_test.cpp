@@ -0,0 +1,117 @@
+#include <iostream>
+#include <cassert>
+#include <vector>
+
+#include "map_graph_test_data.h"
+#include "../include/ims/timer_wheel.h"
+#include "../include/ims/path_manager.h"
+
+using namespace std;
+
+int main()
+{
+    cout << "==== Timer Wheel Test ====" << endl;
+    IMS::TimerWheel<unsigned> wheel(10, 4);
+    wheel.schedule(15, 0);
+    wheel.schedule(25, 1);
+    wheel.schedule(105, 2); // beyond one rotation, shares slot with 25
+    assert(wheel.size() == 3);
+
+    vector<unsigned> expired;
+    /* Test nothing expires before deadline */
+    assert(wheel.advance(14, expired, 10) == 0);
+    /* Test items expire on deadline and items of later rotations are kept */
+    assert(wheel.advance(30, expired, 10) == 2);
+    assert(expired[0] == 0 && expired[1] == 1);
+    assert(wheel.size() == 1);
+    /* Test overdue items are scheduled to next tick */
+    wheel.schedule(5, 3);
+    expired.clear();
+    assert(wheel.advance(40, expired, 10) == 1);
+    assert(expired[0] == 3);
+    /* Test jumping more than one rotation */
+    expired.clear();
+    assert(wheel.advance(1000, expired, 10) == 1);
+    assert(expired[0] == 2);
+    assert(wheel.size() == 0);
+    /* Test batch limit keeps remaining overdue items */
+    for(unsigned i = 0; i < 5; i++)
+    {
+        wheel.schedule(1001, i);
+    }
+    expired.clear();
+    assert(wheel.advance(2000, expired, 3) == 3);
+    assert(wheel.advance(2000, expired, 3) == 2);
+    assert(wheel.size() == 0);
+    cout << "==== All Timer Wheel Test passed ====" << endl;
+
+    cout << "==== Path Manager Test ====" << endl;
+    auto map_graph = new IMS::MapGraph();
+    for(int i = 0; i < 4; i++) {
+        map_graph->longitude.push_back(coordinates4[i][0]);
+        map_graph->latitude.push_back(coordinates4[i][1]);
+    }
+    map_graph->first_out.assign(first_out4, first_out4 + 4);
+    map_graph->head.assign(head4, head4 + 5);
+    map_graph->geo_distance.assign(geo_distance4, geo_distance4 + 5);
+    map_graph->default_travel_time.assign(default_travel_time4, default_travel_time4 + 5);
+    map_graph->initialize();
+
+    const time_t grace_period = 60000;
+    auto path_manager = new IMS::PathManager(map_graph, grace_period);
+
+    auto path1 = new IMS::Path();
+    path1->start_time = 60000;
+    path1->end_time = 120000;
+    path1->enter_times[60000] = 0;
+    path1->enter_times[90000] = 1;
+
+    auto path2 = new IMS::Path();
+    path2->start_time = 300000;
+    path2->end_time = 400000;
+    path2->enter_times[300000] = 0;
+
+    /* Test can add paths and inject density */
+    assert(path_manager->add_path(path1) == 0);
+    assert(path_manager->add_path(path2) == 1);
+    assert(path_manager->get_num_of_active_paths() == 2);
+    assert(map_graph->find_current_density(0, 70000) == 1.0 / map_graph->geo_distance[0]);
+    assert(map_graph->find_current_density(0, 310000) == 1.0 / map_graph->geo_distance[0]);
+
+    /* Test nothing retired within grace period */
+    assert(path_manager->retire_expired_paths(path1->end_time + grace_period - 1) == 0);
+    assert(map_graph->find_current_density(1, 100000) == 1.0 / map_graph->geo_distance[1]);
+
+    /* Test overdue path is retired and density is compacted */
+    assert(path_manager->retire_expired_paths(path1->end_time + grace_period) == 1);
+    assert(path_manager->get_num_of_active_paths() == 1);
+    assert(map_graph->find_current_density(1, 100000) == 0);
+    assert(map_graph->current_density.find(1) == nullptr); // released
+    // Density of path2 on the same edge is unchanged
+    assert(map_graph->current_density[0].size() == 3);
+    assert(map_graph->find_current_density(0, 310000) == 1.0 / map_graph->geo_distance[0]);
+
+    /* Test removed path is not retired again */
+    assert(path_manager->remove_path(1) == 1);
+    assert(path_manager->remove_path(1) == 0);
+    assert(map_graph->find_current_density(0, 310000) == 0);
+    assert(path_manager->retire_expired_paths(path2->end_time + grace_period) == 0);
+
+    /* Test retiring in batches */
+    for(unsigned i = 0; i < 10; i++)
+    {
+        path_manager->add_path(path1);
+    }
+    assert(map_graph->find_current_density(0, 70000) == 10.0 / map_graph->geo_distance[0]);
+    assert(path_manager->retire_expired_paths(path2->end_time + grace_period, 3) == 10);
+    assert(path_manager->get_num_of_active_paths() == 0);
+    assert(map_graph->find_current_density(0, 70000) == 0);
+    assert(map_graph->current_density.find(0) == nullptr);
+
+    delete path1;
+    delete path2;
+    delete path_manager;
+    delete map_graph;
+
+    cout << "==== All Path Manager Test passed ====" << endl;
+}
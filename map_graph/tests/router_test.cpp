@@ -1,5 +1,8 @@
 #include <iostream>
 #include <cassert>
+#include <limits>
+#include <queue>
+#include <set>
 
 #include "map_graph_test_data.h"
 #include "../include/ims/router.h"
@@ -31,6 +34,12 @@ int main()
     // Travel time needed before time = 100 should be shortest (default)
     assert(router->retrieve_realized_weight(1, 99) == map_graph->default_travel_time[1]);
     assert(router->retrieve_realized_weight(1, 100) == 2 * (map_graph->default_travel_time[1]));
+    // Incidents are added only when entering within their validity window
+    vector<unsigned> affected_edges{0};
+    incident_manager->add_incident(affected_edges, 5, 200, 300);
+    assert(router->retrieve_realized_weight(0, 199) == map_graph->default_travel_time[0]);
+    assert(router->retrieve_realized_weight(0, 200) == map_graph->default_travel_time[0] + 5);
+    assert(router->retrieve_realized_weight(0, 300) == map_graph->default_travel_time[0]);
 
     cout << "==== All Router Test passed ====" << endl;
 
@@ -63,5 +72,157 @@ int main()
     }
     cout << endl;
 
+    cout << "==== Precise Heuristic Test ====" << endl;
+    // Shortest travel time between all pairs
+    const unsigned n = map_graph2->get_num_of_nodes();
+    vector< vector<unsigned> > shortest(n, vector<unsigned>(n, (unsigned)INFINITY));
+    for(unsigned from = 0; from < n; from++)
+    {
+        shortest[from][from] = 0;
+        for(unsigned round = 0; round < n; round++)
+        {
+            for(unsigned u = 0; u < n; u++)
+            {
+                if(shortest[from][u] == (unsigned)INFINITY) continue;
+                map_graph2->for_each_out_edge(u, [&](const unsigned &edge, const unsigned &v)
+                {
+                    shortest[from][v] = min(shortest[from][v], shortest[from][u] + map_graph2->default_travel_time[edge]);
+                });
+            }
+        }
+    }
+    vector< vector<unsigned> > cell_heuristic(n, vector<unsigned>(n));
+    for(unsigned from = 0; from < n; from++)
+    {
+        for(unsigned to = 0; to < n; to++)
+        {
+            cell_heuristic[from][to] = router2->retrieve_future_weight(from, to);
+        }
+    }
+    auto partitions = map_graph2->partition(2, 3);
+    map_graph2->preprocess_boundary_distances(partitions);
+    assert(map_graph2->boundary_distances->memory_size() == 2 * 2 * n * sizeof(unsigned));
+    // Boundary nodes are at distance 0 of their boundary
+    for (unsigned p = partitions->level_first[1]; p < partitions->num_of_partitions(); p++)
+    {
+        for (auto node : partitions->outwards_of(p))
+        {
+            assert(map_graph2->boundary_distances->outbound(partitions->layer[p], node) == 0);
+        }
+        for (auto node : partitions->inwards_of(p))
+        {
+            assert(map_graph2->boundary_distances->inbound(partitions->layer[p], node) == 0);
+        }
+    }
+    delete partitions;
+    // Never looser than the cell bound, and admissible wherever the cell bound is
+    for(unsigned from = 0; from < n; from++)
+    {
+        for(unsigned to = 0; to < n; to++)
+        {
+            unsigned h = router2->retrieve_future_weight(from, to);
+            assert(h >= cell_heuristic[from][to]);
+            assert(cell_heuristic[from][to] > shortest[from][to] || h <= shortest[from][to]);
+        }
+    }
+    auto precise_path = router2->route(4, 0, 0);
+    assert(precise_path->end_time == path1->end_time);
+
+    cout << "==== Weight Profile Test ====" << endl;
+    // 3 times slower from 07:00 and 2 times from 10:00 local time, UTC+8
+    vector<unsigned> start_times{0, 7 * 3600, 10 * 3600};
+    vector< vector<unsigned> > travel_times(3, map_graph2->default_travel_time.to_vector());
+    for(unsigned edge = 0; edge < map_graph2->get_num_of_edges(); edge++)
+    {
+        travel_times[1][edge] *= 3;
+        travel_times[2][edge] *= 2;
+    }
+    partitions = map_graph2->partition(2, 3);
+    map_graph2->set_weight_profiles(start_times, travel_times, 8 * 3600, partitions);
+    delete partitions;
+    // Time 0 is 08:00 local
+    assert(map_graph2->find_weight_profile(0) == 1);
+    assert(map_graph2->find_weight_profile(2 * 3600 * 1000) == 2);
+    assert(map_graph2->find_weight_profile(16 * 3600 * 1000) == 0);
+    assert(map_graph2->find_weight_profile(-(8 * 3600 + 1) * 1000) == 2);
+    assert(router2->retrieve_realized_weight(0, 0) == 3 * map_graph2->default_travel_time[0]);
+    assert(router2->retrieve_realized_weight(0, 16 * 3600 * 1000) == map_graph2->default_travel_time[0]);
+    // Heuristic of a profile is built on the lower weights of the profiles applying until 3 hours after it ends
+    for(unsigned from = 0; from < n; from++)
+    {
+        for(unsigned to = 0; to < n; to++)
+        {
+            assert(router2->retrieve_future_weight(from, to, 1) == 2 * cell_heuristic[from][to]);
+            assert(router2->retrieve_future_weight(from, to, 2) == cell_heuristic[from][to]);
+            assert(router2->retrieve_future_weight(from, to, 0) == cell_heuristic[from][to]);
+        }
+    }
+    auto peak_path = router2->route(4, 0, 0);
+    assert(peak_path->end_time == 3 * path1->end_time);
+    auto night_path = router2->route(4, 0, 16 * 3600);
+    assert(night_path->end_time - night_path->start_time == path1->end_time);
+    delete peak_path;
+    delete night_path;
+
+    // Routes across three profiles: 3000 times slower from 08:00 and 08:05, 10 times from 08:10, 1000 times otherwise
+    start_times = {0, 8 * 3600, 8 * 3600 + 300, 8 * 3600 + 600, 9 * 3600};
+    vector<unsigned> factors{1000, 3000, 3000, 10, 1000};
+    travel_times.assign(start_times.size(), map_graph2->default_travel_time.to_vector());
+    for(unsigned profile = 0; profile < start_times.size(); profile++)
+    {
+        for(auto & travel_time : travel_times[profile])
+        {
+            travel_time *= factors[profile];
+        }
+    }
+    partitions = map_graph2->partition(2, 3);
+    map_graph2->set_weight_profiles(start_times, travel_times, 8 * 3600, partitions);
+    delete partitions;
+    // Earliest arrival (ms) departing at a time (ms), by a search without heuristic
+    auto earliest_arrival = [&](const unsigned &origin, const unsigned &destination, const time_t &departure)
+    {
+        vector<time_t> arrival(n, numeric_limits<time_t>::max());
+        priority_queue<pair<time_t, unsigned>, vector<pair<time_t, unsigned> >, greater<pair<time_t, unsigned> > > open;
+        arrival[origin] = departure;
+        open.push(make_pair(departure, origin));
+        while(!open.empty())
+        {
+            time_t time = open.top().first;
+            unsigned u = open.top().second;
+            open.pop();
+            if(time > arrival[u]) continue;
+            map_graph2->for_each_out_edge(u, [&](const unsigned &edge, const unsigned &v)
+            {
+                time_t next_time = time + router2->retrieve_realized_weight(edge, time);
+                if(next_time < arrival[v])
+                {
+                    arrival[v] = next_time;
+                    open.push(make_pair(next_time, v));
+                }
+            });
+        }
+        return arrival[destination];
+    };
+    // Admissible at every node reached in each profile, though the rest of the route reaches later profiles
+    for(time_t time : {0LL, 200000LL, 400000LL})
+    {
+        unsigned profile = map_graph2->find_weight_profile(time);
+        for(unsigned from = 0; from < n; from++)
+        {
+            time_t arrival = earliest_arrival(from, 0, time);
+            if(arrival == numeric_limits<time_t>::max()) continue;
+            assert(router2->retrieve_future_weight(from, 0, profile) <= arrival - time);
+        }
+    }
+    auto crossing_path = router2->route(4, 0, 0);
+    assert(crossing_path->end_time == earliest_arrival(4, 0, 0));
+    set<unsigned> crossed_profiles;
+    for(auto & enter_time : crossing_path->enter_times)
+    {
+        crossed_profiles.insert(map_graph2->find_weight_profile(enter_time.first));
+    }
+    assert(crossed_profiles == set<unsigned>({1, 2, 3}));
+    delete crossing_path;
+
     cout << "==== All Router Test passed ====" << endl;
 }
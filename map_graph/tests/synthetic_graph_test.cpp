@@ -0,0 +1,153 @@
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <memory>
+#include <queue>
+
+#include "../include/ims/router.h"
+#include "../include/ims/synthetic_graph.h"
+
+using namespace std;
+
+/* Number of nodes reached from node 0, along edges or against them */
+unsigned count_reached(const IMS::SyntheticGraph::road_graph_t &graph, const bool &is_backward)
+{
+    const unsigned n = graph.first_out.size();
+    vector< vector<unsigned> > neighbours(n);
+    for(unsigned tail = 0; tail < n; tail++)
+    {
+        unsigned last_edge = tail + 1 == n? graph.head.size() : graph.first_out[tail + 1];
+        for(unsigned edge = graph.first_out[tail]; edge < last_edge; edge++)
+        {
+            if(is_backward) neighbours[graph.head[edge]].push_back(tail);
+            else neighbours[tail].push_back(graph.head[edge]);
+        }
+    }
+    vector<bool> is_reached(n, false);
+    queue<unsigned> frontier;
+    frontier.push(0);
+    is_reached[0] = true;
+    unsigned num_of_reached = 1;
+    while(!frontier.empty())
+    {
+        unsigned node = frontier.front();
+        frontier.pop();
+        for(auto neighbour : neighbours[node])
+        {
+            if(!is_reached[neighbour])
+            {
+                is_reached[neighbour] = true;
+                num_of_reached++;
+                frontier.push(neighbour);
+            }
+        }
+    }
+    return num_of_reached;
+}
+
+/* Shape of a generated graph: valid adjacency arrays, strongly connected, degree and speeds of road networks */
+void check_graph(const IMS::SyntheticGraph::options_t &options)
+{
+    auto graph = IMS::SyntheticGraph::generate(options);
+    const unsigned n = options.num_of_nodes;
+    const unsigned m = graph.head.size();
+    assert(graph.first_out.size() == n && graph.longitude.size() == n && graph.latitude.size() == n);
+    assert(graph.travel_time.size() == m && graph.geo_distance.size() == m && graph.road_class.size() == m);
+    assert(graph.first_out[0] == 0);
+    for(unsigned node = 1; node < n; node++)
+    {
+        assert(graph.first_out[node - 1] <= graph.first_out[node]);
+    }
+    assert(count_reached(graph, false) == n);
+    assert(count_reached(graph, true) == n);
+
+    // Roads per junction: a road in both directions is 2 edges, a one-way road 1
+    unsigned num_of_two_way_edges = 0;
+    for(unsigned tail = 0; tail < n; tail++)
+    {
+        unsigned last_edge = tail + 1 == n? m : graph.first_out[tail + 1];
+        for(unsigned edge = graph.first_out[tail]; edge < last_edge; edge++)
+        {
+            unsigned head = graph.head[edge];
+            assert(head < n && head != tail);
+            unsigned head_last_edge = head + 1 == n? m : graph.first_out[head + 1];
+            for(unsigned back = graph.first_out[head]; back < head_last_edge; back++)
+            {
+                num_of_two_way_edges += graph.head[back] == tail? 1 : 0;
+            }
+
+            // Length matches the coordinates, travel time the speed of the road class
+            double dx = (graph.longitude[head] - graph.longitude[tail]) * 111320 * cos(options.latitude * M_PI / 180);
+            double dy = (graph.latitude[head] - graph.latitude[tail]) * 111320;
+            assert(fabs(hypot(dx, dy) - graph.geo_distance[edge]) < 2);
+            double speed = graph.geo_distance[edge] / (graph.travel_time[edge] / 1000.0) * 3.6;
+            double class_speed = IMS::SyntheticGraph::SPEED[graph.road_class[edge]];
+            assert(graph.geo_distance[edge] < 10 || fabs(speed / class_speed - 1) <= IMS::SyntheticGraph::SPEED_NOISE + 0.05);
+        }
+    }
+    double mean_degree = (num_of_two_way_edges / 2.0 + (m - num_of_two_way_edges)) * 2 / n;
+    cout << (options.topology == IMS::SyntheticGraph::PERTURBED_GRID? "grid " : "random ") << n << ": " << m
+         << " edges, mean degree " << mean_degree << ", one-way edges " << m - num_of_two_way_edges << endl;
+    assert(fabs(mean_degree - options.mean_degree) < 0.15);
+    assert(m > num_of_two_way_edges);
+}
+
+int main()
+{
+    cout << "==== Synthetic Graph Test ====" << endl;
+    IMS::SyntheticGraph::options_t options;
+
+    // Descriptions
+    assert(IMS::SyntheticGraph::parse_options("random:5000", options));
+    assert(options.topology == IMS::SyntheticGraph::RANDOM_GEOMETRIC && options.num_of_nodes == 5000);
+    assert(IMS::SyntheticGraph::parse_options("grid:1000", options));
+    assert(options.topology == IMS::SyntheticGraph::PERTURBED_GRID && options.num_of_nodes == 1000);
+    assert(!IMS::SyntheticGraph::parse_options("grid:", options));
+    assert(!IMS::SyntheticGraph::parse_options("hexagon:1000", options));
+    assert(!IMS::SyntheticGraph::parse_options("grid:-5", options));
+
+    // Both topologies, a grid with a partial last row
+    for(auto topology : {IMS::SyntheticGraph::PERTURBED_GRID, IMS::SyntheticGraph::RANDOM_GEOMETRIC})
+    {
+        options.topology = topology;
+        for(unsigned n : {1000u, 20001u})
+        {
+            options.num_of_nodes = n;
+            check_graph(options);
+        }
+    }
+
+    // Same seed, same graph; another seed, another graph
+    options.num_of_nodes = 2000;
+    auto graph = IMS::SyntheticGraph::generate(options);
+    assert(IMS::SyntheticGraph::generate(options).travel_time == graph.travel_time);
+    options.seed = 43;
+    assert(IMS::SyntheticGraph::generate(options).travel_time != graph.travel_time);
+
+    // Invalid options
+    options.mean_degree = 5;
+    bool is_thrown = false;
+    try
+    {
+        IMS::SyntheticGraph::generate(options);
+    }
+    catch(runtime_error &e)
+    {
+        is_thrown = true;
+    }
+    assert(is_thrown);
+
+    // Ready to route
+    options.mean_degree = 2.8;
+    options.topology = IMS::SyntheticGraph::PERTURBED_GRID;
+    unique_ptr<IMS::MapGraph> map_graph(IMS::SyntheticGraph::build_map_graph(options, 4, 2));
+    assert(map_graph->get_num_of_nodes() == 2000 && map_graph->flat_distance_tables != nullptr);
+    IMS::IncidentManager incident_manager(map_graph->get_num_of_edges());
+    IMS::Router router(map_graph.get(), &incident_manager);
+    IMS::Path * path = router.route(0, 1999, 0);
+    assert(path != nullptr && path->end_time > path->start_time);
+    delete path;
+
+    cout << "Synthetic graph test passed" << endl;
+    return 0;
+}
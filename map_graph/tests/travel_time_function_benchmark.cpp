@@ -0,0 +1,129 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <memory>
+#include <cstdio>
+
+#include "../include/ims/router.h"
+#include "../include/ims/synthetic_graph.h"
+
+using namespace std;
+
+/* Hourly samples of half of the edges, each following one of a few congestion patterns with morning and evening
+ * peaks, scaled by up to noise percent per sample.
+ */
+vector< vector< pair<unsigned, unsigned> > > build_samples(const IMS::MapGraph &graph, const unsigned &noise)
+{
+    const unsigned num_of_patterns = 8;
+    mt19937 generator(3);
+    uniform_int_distribution<unsigned> random_pattern(0, num_of_patterns * 2 - 1);
+    uniform_real_distribution<double> random_noise(1, 1 + noise / 100.0);
+    vector< vector< pair<unsigned, unsigned> > > samples(graph.get_num_of_edges());
+    for(unsigned edge = 0; edge < samples.size(); edge++)
+    {
+        unsigned pattern = random_pattern(generator);
+        if(pattern >= num_of_patterns)
+        {
+            continue;
+        }
+        for(unsigned hour = 0; hour < 24; hour++)
+        {
+            double peak = (hour >= 7 && hour <= 9) || (hour >= 17 && hour <= 19)? 1.5 + 0.25 * pattern : 1;
+            double factor = hour < 6? 1 : peak * (1 + 0.05 * (pattern % 3));
+            samples[edge].push_back(make_pair(hour * 3600, graph.get_travel_time(edge) * factor * random_noise(generator)));
+        }
+    }
+    return samples;
+}
+
+/* Benchmark of memory, building and evaluation of travel time functions.
+ * Usage: travel_time_function_benchmark [grid side] [interval (minutes)] [sample noise (%)] [number of routes]
+ */
+int main(int argc, char ** argv)
+{
+    unsigned side = argc > 1? stoul(argv[1]) : 300;
+    unsigned interval = argc > 2? stoul(argv[2]) * 60 : 900;
+    unsigned noise = argc > 3? stoul(argv[3]) : 0;
+    unsigned num_of_routes = argc > 4? stoul(argv[4]) : 200;
+    const string function_file_path = "travel_time_function_benchmark.ttf";
+
+    cout << "==== Travel Time Function Benchmark ====" << endl;
+    IMS::SyntheticGraph::options_t options; // perturbed grid of side x side nodes
+    options.num_of_nodes = side * side;
+    unique_ptr<IMS::MapGraph> map_graph(IMS::SyntheticGraph::build_map_graph(options, 4, 3));
+    const unsigned num_of_edges = map_graph->get_num_of_edges();
+    cout << map_graph->get_num_of_nodes() << " nodes, " << num_of_edges << " edges, " << interval / 60
+         << " min breakpoints, " << noise << "% sample noise" << endl;
+
+    auto samples = build_samples(*map_graph, noise);
+    auto start = chrono::steady_clock::now();
+    unique_ptr<IMS::TravelTimeFunction::travel_time_function_table_t> table(
+            IMS::TravelTimeFunction::build(map_graph->default_travel_time, samples, interval, 8 * 3600));
+    auto build_time = chrono::steady_clock::now() - start;
+    IMS::TravelTimeFunction::write(*table, map_graph->get_checksum(), function_file_path);
+    map_graph->load_travel_time_functions(function_file_path);
+
+    // Memory, against a travel time (unsigned) per edge and breakpoint
+    size_t memory = table->memory_size();
+    size_t plain_memory = (size_t)num_of_edges * table->num_of_breakpoints() * sizeof(unsigned);
+    cout << "Build: " << chrono::duration_cast<chrono::milliseconds>(build_time).count() << " ms, "
+         << table->num_of_functions() << " distinct functions" << endl;
+    cout << "Memory: " << memory / 1024 << " KiB, unsigned per edge and breakpoint: " << plain_memory / 1024
+         << " KiB (" << 100.0 * memory / plain_memory << "%)" << endl;
+
+    // Evaluation cost, against the default travel time
+    mt19937 generator(7);
+    uniform_int_distribution<unsigned> random_edge(0, num_of_edges - 1);
+    uniform_int_distribution<long long> random_time(0, IMS::TravelTimeFunction::DAY * 7);
+    const unsigned num_of_lookups = 10000000;
+    vector<pair<unsigned, time_t> > lookups(num_of_lookups);
+    for(auto & lookup : lookups)
+    {
+        lookup = make_pair(random_edge(generator), 1546272000000LL + random_time(generator));
+    }
+    for(bool is_function : {false, true})
+    {
+        unsigned long long checksum = 0;
+        start = chrono::steady_clock::now();
+        for(auto & lookup : lookups)
+        {
+            checksum += is_function? map_graph->get_travel_time(lookup.first, lookup.second)
+                                   : map_graph->get_travel_time(lookup.first);
+        }
+        auto lookup_time = chrono::steady_clock::now() - start;
+        cout << (is_function? "Function" : "Default") << " travel time: "
+             << chrono::duration_cast<chrono::nanoseconds>(lookup_time).count() / (double) num_of_lookups
+             << " ns / lookup (checksum " << checksum << ")" << endl;
+    }
+
+    // Routing with and without the functions
+    uniform_int_distribution<unsigned> random_node(0, side * side - 1);
+    vector<pair<unsigned, unsigned> > od_pairs(num_of_routes);
+    for(auto & od_pair : od_pairs)
+    {
+        od_pair = make_pair(random_node(generator), random_node(generator));
+    }
+    unique_ptr<IMS::MapGraph> default_graph(IMS::SyntheticGraph::build_map_graph(options, 4, 3));
+    auto incident_manager = new IMS::IncidentManager(num_of_edges);
+    for(auto graph : {default_graph.get(), map_graph.get()})
+    {
+        IMS::Router router(graph, incident_manager);
+        double checksum = 0;
+        start = chrono::steady_clock::now();
+        for(auto & od_pair : od_pairs)
+        {
+            auto path = router.route(od_pair.first, od_pair.second, 1546300800); // 08:00 in UTC+8
+            checksum += path->end_time - path->start_time;
+            delete path;
+        }
+        auto route_time = chrono::steady_clock::now() - start;
+        cout << (graph == map_graph.get()? "Function" : "Default") << " route: "
+             << chrono::duration_cast<chrono::microseconds>(route_time).count() / (double) num_of_routes
+             << " us / route (total travel time " << checksum << " ms)" << endl;
+    }
+
+    delete incident_manager;
+    remove(function_file_path.c_str());
+    return 0;
+}
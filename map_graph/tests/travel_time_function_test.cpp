@@ -0,0 +1,191 @@
+#include <iostream>
+#include <fstream>
+#include <cassert>
+#include <cstdio>
+#include <memory>
+
+#include "map_graph_test_data.h"
+#include "../include/ims/router.h"
+
+using namespace std;
+
+IMS::MapGraph * build_graph()
+{
+    auto map_graph = build_graph16();
+    map_graph->default_travel_time[3] = 600000; // 1 -> 2, long enough for a drop faster than time passes
+    map_graph->initialize();
+    map_graph->preprocess(2, 3);
+    return map_graph;
+}
+
+int main()
+{
+    const string history_file_path = "travel_time_function_test.history";
+    const string function_file_path = "travel_time_function_test.ttf";
+    const int utc_offset = 8 * 3600;
+    const time_t midnight = -utc_offset * 1000LL; // 00:00 local, ms
+    auto map_graph = build_graph();
+
+    cout << "==== Travel Time Function Test ====" << endl;
+    // Samples from text file
+    {
+        ofstream history(history_file_path);
+        history << "# 0 -> 1 and 0 -> 4 are slow in the morning" << endl;
+        history << "utc_offset 28800" << endl;
+        history << "0 1 08:00 300" << endl;
+        history << "0 1 20:00 100" << endl;
+        history << "0 4 08:00 300" << endl;
+        history << "0 4 20:00 100" << endl;
+        history << "0 5 12:00 5" << endl;
+        history << "1 2 08:00 24000000" << endl;
+        history << "1 2 09:00 600000" << endl;
+    }
+    vector< vector< pair<unsigned, unsigned> > > samples;
+    int read_utc_offset;
+    map_graph->read_travel_time_history(history_file_path, samples, read_utc_offset);
+    assert(read_utc_offset == utc_offset);
+    assert(samples.size() == 30);
+    assert(samples[0].size() == 2 && samples[0][0] == make_pair(8 * 3600u, 300u));
+    assert(samples[1].size() == 2 && samples[4].empty());
+
+    // Interpolated between samples, around midnight too
+    unique_ptr<IMS::TravelTimeFunction::travel_time_function_table_t> table(
+            IMS::TravelTimeFunction::build(map_graph->default_travel_time, samples, 1800, utc_offset));
+    assert(table->num_of_breakpoints() == 48);
+    assert(table->evaluate(0, 100, midnight + 8 * 3600000LL) == 300);
+    assert(table->evaluate(0, 100, midnight + 14 * 3600000LL) == 200);
+    assert(table->evaluate(0, 100, midnight + 20 * 3600000LL) == 100);
+    assert(table->evaluate(0, 100, midnight + 26 * 3600000LL) == 200);
+    // Edges without samples keep the default travel time, faster samples are raised to it
+    assert(table->evaluate(5, 100, midnight + 8 * 3600000LL) == 100);
+    assert(table->evaluate(2, 10, midnight + 12 * 3600000LL) == 10);
+    // Identical functions are stored once: constant, 0 -> 1 and 0 -> 4, 1 -> 2
+    assert(table->function_of_edge[0] == table->function_of_edge[1]);
+    assert(table->function_of_edge[2] == 0 && table->function_of_edge[5] == 0);
+    assert(table->num_of_functions() == 3);
+    assert(table->memory_size() == 30 * sizeof(unsigned) + 3 * 48 * sizeof(uint16_t));
+
+    // FIFO: 1 -> 2 drops from 24000000 to 600000 ms within an hour, it is raised to drop slower than time passes
+    assert(table->evaluate(3, 600000, midnight + 8 * 3600000LL) == 24000000);
+    assert(table->evaluate(3, 600000, midnight + 9 * 3600000LL) > 600000);
+    time_t last_exit_time = 0;
+    for(time_t time = midnight; time < midnight + IMS::TravelTimeFunction::DAY; time += 1000)
+    {
+        time_t exit_time = time + table->evaluate(3, 600000, time);
+        assert(time == midnight || exit_time >= last_exit_time);
+        last_exit_time = exit_time;
+    }
+    for(time_t time = midnight + 8 * 3600000LL; time < midnight + 8 * 3600000LL + 1800000; time++)
+    {
+        time_t exit_time = time + table->evaluate(3, 600000, time);
+        assert(time == midnight + 8 * 3600000LL || exit_time >= last_exit_time);
+        last_exit_time = exit_time;
+    }
+
+    // Side file is mapped in place and replaces the base travel time of routing
+    IMS::TravelTimeFunction::write(*table, map_graph->get_checksum(), function_file_path);
+    map_graph->load_travel_time_functions(function_file_path);
+    assert(map_graph->travel_time_functions->function_of_edge.is_mapped());
+    assert(map_graph->travel_time_functions->factor == table->factor.get_vector());
+    assert(map_graph->travel_time_functions->utc_offset == utc_offset);
+    assert(map_graph->find_weight_profile(midnight) == IMS::MapGraph::NO_PROFILE);
+    for(unsigned edge = 0; edge < 30; edge++)
+    {
+        for(time_t time = midnight; time < midnight + IMS::TravelTimeFunction::DAY; time += 600000)
+        {
+            assert(map_graph->get_travel_time(edge, time)
+                   == table->evaluate(edge, map_graph->get_travel_time(edge), time));
+        }
+    }
+    auto incident_manager = new IMS::IncidentManager();
+    IMS::Router router(map_graph, incident_manager);
+    assert(router.retrieve_realized_weight(0, midnight + 8 * 3600000LL) == 300);
+    auto morning_path = router.route(0, 1, (midnight + 8 * 3600000LL) / 1000);
+    assert(morning_path->end_time - morning_path->start_time == 300);
+    auto evening_path = router.route(0, 1, (midnight + 20 * 3600000LL) / 1000);
+    assert(evening_path->end_time - evening_path->start_time == 100);
+    delete morning_path;
+    delete evening_path;
+
+    // Edge IDs must not change while loaded
+    auto partitions = map_graph->partition(2, 3);
+    vector<IMS::edge_change_t> changes(1);
+    changes[0].type = IMS::edge_change_t::RETIME;
+    changes[0].from = 0;
+    changes[0].to = 1;
+    changes[0].travel_time = 50;
+    bool is_rejected = false;
+    try
+    {
+        map_graph->apply_edge_changes(changes, partitions);
+    }
+    catch(runtime_error &e)
+    {
+        is_rejected = true;
+    }
+    assert(is_rejected);
+    delete partitions;
+
+    // Files of another graph or corrupted files are rejected, the loaded functions are kept
+    auto other_graph = build_graph();
+    other_graph->default_travel_time[0] = 50;
+    is_rejected = false;
+    try
+    {
+        other_graph->load_travel_time_functions(function_file_path);
+    }
+    catch(runtime_error &e)
+    {
+        is_rejected = true;
+    }
+    assert(is_rejected && other_graph->travel_time_functions == nullptr);
+    {
+        fstream file(function_file_path, ios::in | ios::out | ios::binary);
+        file.seekp(-1, ios::end);
+        file.put(1);
+    }
+    is_rejected = false;
+    try
+    {
+        map_graph->load_travel_time_functions(function_file_path);
+    }
+    catch(runtime_error &e)
+    {
+        is_rejected = true;
+    }
+    assert(is_rejected && map_graph->travel_time_functions != nullptr);
+    assert(map_graph->get_travel_time(0, midnight + 8 * 3600000LL) == 300);
+
+    // Invalid intervals and samples are rejected
+    is_rejected = false;
+    try
+    {
+        delete IMS::TravelTimeFunction::build(map_graph->default_travel_time, samples, 7 * 3600, utc_offset);
+    }
+    catch(runtime_error &e)
+    {
+        is_rejected = true;
+    }
+    assert(is_rejected);
+    {
+        ofstream history(history_file_path);
+        history << "0 2 08:00 300" << endl;
+    }
+    is_rejected = false;
+    try
+    {
+        map_graph->read_travel_time_history(history_file_path, samples, read_utc_offset);
+    }
+    catch(runtime_error &e)
+    {
+        is_rejected = true;
+    }
+    assert(is_rejected);
+
+    delete incident_manager;
+    delete other_graph;
+    delete map_graph;
+    remove(history_file_path.c_str());
+    remove(function_file_path.c_str());
+    cout << "==== All Travel Time Function Test passed ====" << endl;
+}